@@ -0,0 +1,77 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "jwt/jwt.hpp"
+
+/***
+ * Compares rebuilding a verified jwt_object from its
+ * binary form with parsing the JSON text of its parts.
+ *
+ * Usage: bench_binary_decode [iterations]
+ */
+
+template <typename Func>
+double ns_per_op(int iters, Func&& fn)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; ++i) fn();
+  auto t1 = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+}
+
+int main(int argc, char* argv[])
+{
+  using namespace jwt::params;
+
+  int iters = argc > 1 ? std::atoi(argv[1]) : 100000;
+  if (iters <= 0) iters = 1;
+
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret"), headers({{"kid", "key-1"}})};
+  obj.add_claim("iss", "https://auth.example.com/")
+     .add_claim("sub", "auth0|5d3f6c7a8b9c0d1e2f3a4b5c")
+     .add_claim("aud", "https://api.example.com/")
+     .add_claim("exp", 4102444800)
+     .add_claim("iat", 1513862371)
+     .add_claim("nbf", 1513862371)
+     .add_claim("jti", "8f14e45f-ceea-467a-9af0-1c4d1a2b3c4d")
+     .add_claim("scope", "openid profile email read:orders write:orders")
+     .add_claim("email", "someone@example.com")
+     .add_claim("email_verified", true)
+     .add_claim("tenant", 4711)
+     .add_claim("roles", std::vector<std::string>{"admin", "billing", "support"});
+
+  const std::string hdr_text = obj.header().create_json_obj().dump();
+  const std::string pld_text = obj.payload().create_json_obj().dump();
+  const std::vector<uint8_t> bin = obj.to_binary();
+
+  std::error_code ec;
+  jwt::jwt_object out;
+  out.from_binary(bin.data(), bin.size(), ec);
+  if (ec || out.payload().create_json_obj() != obj.payload().create_json_obj()) {
+    std::cerr << "Round trip failed" << std::endl;
+    return 1;
+  }
+
+  double parse_ns = ns_per_op(iters, [&] {
+    json_t hdr = json_t::parse(hdr_text);
+    json_t pld = json_t::parse(pld_text);
+    if (pld.empty() || hdr.empty()) std::abort();
+  });
+
+  double binary_ns = ns_per_op(iters, [&] {
+    jwt::jwt_object copy;
+    copy.from_binary(bin.data(), bin.size(), ec);
+    if (ec) std::abort();
+  });
+
+  std::cout << "JSON text:   " << std::setw(6) << hdr_text.size() + pld_text.size() << " bytes  "
+            << std::fixed << std::setprecision(0) << std::setw(8) << parse_ns << " ns/op\n"
+            << "binary form: " << std::setw(6) << bin.size() << " bytes  "
+            << std::setw(8) << binary_ns << " ns/op" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "jwt/jwt.hpp"
+
+/***
+ * Counts the heap allocations made by a single encode
+ * and decode, for the HMAC, RSA and ECDSA algorithms.
+ *
+ * Usage: bench_decode_allocs [iterations]
+ */
+
+static std::atomic<uint64_t> g_allocs{0};
+
+void* operator new(std::size_t n)
+{
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+std::string read_from_file(const std::string& path)
+{
+  std::string contents;
+  std::ifstream is{path, std::ifstream::binary};
+
+  if (is) {
+    // get length of file:
+    is.seekg (0, is.end);
+    auto length = is.tellg();
+    is.seekg (0, is.beg);
+    contents.resize(length);
+
+    is.read(&contents[0], length);
+    if (!is) {
+      is.close();
+      return {};
+    }
+  }
+
+  is.close();
+  return contents;
+}
+
+void measure(const char* alg, const std::string& sign_key,
+             const std::string& verify_key, int iters)
+{
+  using namespace jwt::params;
+
+  const std::vector<std::string> algs{alg};
+  jwt::jwt_object obj{algorithm(alg), secret(sign_key)};
+  obj.add_claim("iss", "arun.muralidharan")
+     .add_claim("sub", "admin")
+     .add_claim("exp", 4102444800);
+
+  auto vkey = jwt::key::from_secret(verify_key);
+  std::string token = obj.signature();
+
+  uint64_t before = g_allocs.load();
+  for (int i = 0; i < iters; ++i) {
+    token = obj.signature();
+  }
+  uint64_t enc = g_allocs.load() - before;
+
+  before = g_allocs.load();
+  for (int i = 0; i < iters; ++i) {
+    std::error_code ec;
+    jwt::decode(token, algorithms(algs), ec, secret(vkey));
+    if (ec) std::abort();
+  }
+  uint64_t dec = g_allocs.load() - before;
+
+  std::cout << alg
+            << "  encode: " << static_cast<double>(enc) / iters
+            << "  decode: " << static_cast<double>(dec) / iters
+            << " allocations (operator new only)\n";
+}
+
+int main(int argc, char* argv[])
+{
+  int iters = argc > 1 ? std::atoi(argv[1]) : 1000;
+
+  measure("HS256", "secret", "secret", iters);
+  measure("RS256",
+          read_from_file(CERT_ROOT_DIR "/rsa_certs/rsa256_priv.pem"),
+          read_from_file(CERT_ROOT_DIR "/rsa_certs/rsa256_pub.pem"),
+          iters);
+  measure("ES384",
+          read_from_file(CERT_ROOT_DIR "/ec_certs/ec384_priv.pem"),
+          read_from_file(CERT_ROOT_DIR "/ec_certs/ec384_pub.pem"),
+          iters);
+
+  return 0;
+}
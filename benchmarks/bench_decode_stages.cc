@@ -0,0 +1,134 @@
+// The stage hooks are compiled in for this benchmark only
+#ifndef CPP_JWT_INSTRUMENT
+#define CPP_JWT_INSTRUMENT
+#endif
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "jwt/jwt.hpp"
+
+/***
+ * Reports where `jwt::decode` spends its time, stage by
+ * stage, for HS256, RS256 and ES384 tokens, and what
+ * recording into a `histogram_sink` adds to a decode.
+ *
+ * Usage: bench_decode_stages [iterations]
+ */
+
+std::string read_from_file(const std::string& path)
+{
+  std::string contents;
+  std::ifstream is{path, std::ifstream::binary};
+
+  if (is) {
+    // get length of file:
+    is.seekg (0, is.end);
+    auto length = is.tellg();
+    is.seekg (0, is.beg);
+    contents.resize(length);
+
+    is.read(&contents[0], length);
+    if (!is) {
+      is.close();
+      return {};
+    }
+  }
+
+  is.close();
+  return contents;
+}
+
+std::string make_token(const char* alg, const std::string& key)
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm(alg), secret(key), headers({{"kid", "key-1"}})};
+  obj.add_claim("iss", "https://auth.example.com/")
+     .add_claim("sub", "auth0|5d3f6c7a8b9c0d1e2f3a4b5c")
+     .add_claim("aud", "https://api.example.com/")
+     .add_claim("exp", 4102444800)
+     .add_claim("iat", 1513862371)
+     .add_claim("scope", "openid profile email read:orders write:orders");
+  return obj.signature();
+}
+
+template <typename Func>
+double ns_per_op(int iters, Func&& fn)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; ++i) fn();
+  auto t1 = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+}
+
+const char* stage_name(jwt::decode_stage stage)
+{
+  switch (stage) {
+    case jwt::decode_stage::SPLIT:          return "split";
+    case jwt::decode_stage::HEADER_BASE64:  return "header base64";
+    case jwt::decode_stage::HEADER_JSON:    return "header json";
+    case jwt::decode_stage::PAYLOAD_BASE64: return "payload base64";
+    case jwt::decode_stage::PAYLOAD_JSON:   return "payload json";
+    case jwt::decode_stage::CLAIMS:         return "claims";
+    case jwt::decode_stage::SIGNATURE:      return "signature";
+    case jwt::decode_stage::TOTAL:          return "total";
+  };
+  return "";
+}
+
+void run(const char* alg, const std::string& token, const std::string& key, int iters)
+{
+  using namespace jwt::params;
+
+  const jwt::key vkey = jwt::key::from_secret(key);
+  std::error_code ec;
+
+  auto decode_once = [&] {
+    jwt::decode(token, algorithms({alg}), ec, secret(vkey), issuer("https://auth.example.com/"));
+    if (ec) std::abort();
+  };
+
+  decode_once();
+  double plain_ns = ns_per_op(iters, decode_once);
+
+  jwt::histogram_sink sink;
+  jwt::set_decode_sink(&sink);
+  double traced_ns = ns_per_op(iters, decode_once);
+  jwt::set_decode_sink(nullptr);
+
+  const auto algo = jwt::str_to_alg(alg);
+  std::cout << alg << " (" << token.length() << " byte token): "
+            << std::fixed << std::setprecision(0)
+            << plain_ns << " ns/decode without a sink, "
+            << traced_ns << " ns/decode traced\n";
+
+  for (size_t i = 0; i < jwt::decode_stage_count; ++i) {
+    auto stage = static_cast<jwt::decode_stage>(i);
+    auto h = sink.histogram(algo, jwt::decode_outcome::OK, stage);
+    std::cout << "  " << std::left << std::setw(16) << stage_name(stage) << std::right
+              << std::setw(9) << h.mean_nanos() << " ns mean"
+              << std::setw(9) << h.quantile_nanos(0.99) << " ns p99 bound\n";
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int iters = argc > 1 ? std::atoi(argv[1]) : 2000;
+  if (iters <= 0) iters = 1;
+
+  const std::string rsa_priv = read_from_file(CERT_ROOT_DIR "/rsa_certs/rsa256_priv.pem");
+  const std::string rsa_pub = read_from_file(CERT_ROOT_DIR "/rsa_certs/rsa256_pub.pem");
+  const std::string ec_priv = read_from_file(CERT_ROOT_DIR "/ec_certs/ec384_priv.pem");
+  const std::string ec_pub = read_from_file(CERT_ROOT_DIR "/ec_certs/ec384_pub.pem");
+
+  run("HS256", make_token("HS256", "secret"), "secret", iters * 10);
+  run("RS256", make_token("RS256", rsa_priv), rsa_pub, iters);
+  run("ES384", make_token("ES384", ec_priv), ec_pub, iters);
+
+  return 0;
+}
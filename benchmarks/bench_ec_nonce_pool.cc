@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "jwt/jwt.hpp"
+
+/***
+ * Compares the latency of a burst of ES256 signatures with a
+ * plain key handle and with one whose nonce pool was filled
+ * while the issuer was idle.
+ *
+ * Usage: bench_ec_nonce_pool [burst size]
+ */
+
+template <typename Func>
+double us_per_op(int iters, Func&& fn)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; ++i) fn();
+  auto t1 = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::micro>(t1 - t0).count() / iters;
+}
+
+int main(int argc, char* argv[])
+{
+#if defined(CPP_JWT_HAS_EC_NONCE_POOL)
+  int burst = argc > 1 ? std::atoi(argv[1]) : 1000;
+  if (burst <= 0) burst = 1;
+
+  EVP_PKEY* pkey = EVP_EC_gen("P-256");
+  unsigned char* der = nullptr;
+  int der_len = i2d_PrivateKey(pkey, &der);
+  auto plain = jwt::key::from_der(jwt::string_view{reinterpret_cast<char*>(der),
+                                                   static_cast<size_t>(der_len)});
+  OPENSSL_free(der);
+  EVP_PKEY_free(pkey);
+
+  auto pooled = plain.with_nonce_pool(static_cast<size_t>(burst));
+  const jwt::ec_nonce_pool& pool = *pooled.nonce_pool();
+  while (pool.available() < pool.capacity()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  const std::string data(220, 'x');
+  auto sign = [&](const jwt::key& k) {
+    return [&] {
+      if (jwt::detail::sign_with_pkey<jwt::algo::ES256>(k, data).second) std::abort();
+    };
+  };
+
+  double plain_us = us_per_op(burst, sign(plain));
+  double pooled_us = us_per_op(burst, sign(pooled));
+
+  std::cout << "burst of " << burst << " ES256 signatures\n"
+            << std::fixed << std::setprecision(1)
+            << "inline nonces: " << std::setw(7) << plain_us << " us/signature\n"
+            << "nonce pool:    " << std::setw(7) << pooled_us << " us/signature ("
+            << pool.misses() << " misses)" << std::endl;
+#else
+  (void)argc;
+  (void)argv;
+  std::cout << "No nonce pool with this OpenSSL build" << std::endl;
+#endif
+  return 0;
+}
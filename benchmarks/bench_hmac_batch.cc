@@ -0,0 +1,104 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "jwt/jwt.hpp"
+
+/***
+ * Compares verifying a batch of HS256 tokens one at a time
+ * with OpenSSL against the multi-buffer batch path, for each
+ * kernel the CPU can run.
+ *
+ * Usage: bench_hmac_batch [tokens] [rounds]
+ */
+
+template <typename Func>
+double ns_per_token(size_t tokens, int rounds, Func&& fn)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i) fn();
+  auto t1 = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / (tokens * rounds);
+}
+
+int main(int argc, char* argv[])
+{
+  using namespace jwt::params;
+  using jwt::detail::sha256_mb_kernel;
+
+  size_t count = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 1024;
+  int rounds = argc > 2 ? std::atoi(argv[2]) : 200;
+  if (!count) count = 1;
+  if (rounds <= 0) rounds = 1;
+
+  // Tokens of about 150 to 300 bytes
+  std::vector<std::string> tokens;
+  for (size_t i = 0; i < count; ++i) {
+    jwt::jwt_object obj{algorithm("HS256"), secret("a-32-byte-shared-secret-for-hs256")};
+    obj.add_claim("iss", "https://auth.example.com/")
+       .add_claim("sub", "user-" + std::to_string(i))
+       .add_claim("exp", 4102444800)
+       .add_claim("scope", std::string(i % 120, 's'));
+    tokens.push_back(obj.signature());
+  }
+
+  std::vector<jwt::string_view> heads, signs;
+  size_t bytes = 0;
+  for (const auto& t : tokens) {
+    auto dot = t.rfind('.');
+    heads.emplace_back(t.data(), dot);
+    signs.emplace_back(t.data() + dot + 1, t.length() - dot - 1);
+    bytes += dot;
+  }
+
+  const jwt::string_view key = "a-32-byte-shared-secret-for-hs256";
+  std::vector<jwt::verify_result_t> results(count);
+
+  auto check = [&] {
+    for (const auto& r : results) {
+      if (!r.first) std::abort();
+    }
+  };
+
+  double one_shot = ns_per_token(count, rounds, [&] {
+    for (size_t i = 0; i < count; ++i) {
+      results[i] = jwt::HMACSign<jwt::algo::HS256>::verify(key, heads[i], signs[i]);
+    }
+  });
+  check();
+
+  std::cout << count << " tokens, " << bytes / count << " bytes signed on average\n"
+            << std::fixed << std::setprecision(0)
+            << "one at a time (OpenSSL): " << std::setw(6) << one_shot << " ns/token" << std::endl;
+
+  jwt::detail::hmac_sha256_key pads;
+  pads.init(key.data(), key.length());
+  std::vector<uint8_t> macs(32 * count);
+
+  const std::pair<sha256_mb_kernel, const char*> kernels[] = {
+    {sha256_mb_kernel::X4_SSSE3, "multi-buffer x4 SSSE3:  "},
+    {sha256_mb_kernel::X8_AVX2,  "multi-buffer x8 AVX2:   "},
+  };
+
+  for (const auto& k : kernels) {
+    if (jwt::detail::sha256_mb_best_kernel() < k.first) continue;
+
+    double mb = ns_per_token(count, rounds, [&] {
+      jwt::detail::hmac_sha256_batch(pads, heads.data(), count,
+                                     reinterpret_cast<uint8_t (*)[32]>(macs.data()), k.first);
+    });
+    std::cout << k.second << std::setw(6) << mb << " ns/token (MACs only)" << std::endl;
+  }
+
+  double batch = ns_per_token(count, rounds, [&] {
+    jwt::HMACSign<jwt::algo::HS256>::verify_batch(key, heads.data(), signs.data(),
+                                                   count, results.data());
+  });
+  check();
+  std::cout << "verify_batch:            " << std::setw(6) << batch << " ns/token" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "jwt/jwt.hpp"
+
+/***
+ * Compares the MAC of a token sized message computed by
+ * OpenSSL with the in-tree HMAC, from the secret and from the
+ * pad states kept by a key handle.
+ *
+ * Usage: bench_hmac_inline [message bytes] [iterations]
+ */
+
+template <typename Func>
+double ns_per_op(int iters, Func&& fn)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; ++i) fn();
+  auto t1 = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+}
+
+template <typename Hasher>
+void run(const char* name, const std::string& key, const std::string& msg, int iters)
+{
+  using state_t = typename Hasher::mac_state;
+  const auto* data = reinterpret_cast<const unsigned char*>(msg.data());
+  unsigned char mac[EVP_MAX_MD_SIZE];
+  unsigned int len = 0;
+
+  double openssl = ns_per_op(iters, [&] {
+    if (!HMAC(Hasher{}(), key.data(), static_cast<int>(key.length()), data, msg.length(), mac, &len)) {
+      std::abort();
+    }
+  });
+
+  double from_secret = ns_per_op(iters, [&] {
+    state_t st;
+    st.init(key.data(), key.length());
+    st.mac(data, msg.length(), mac);
+  });
+
+  state_t pads;
+  pads.init(key.data(), key.length());
+  double from_pads = ns_per_op(iters, [&] {
+    pads.mac(data, msg.length(), mac);
+  });
+
+  std::cout << name << "  OpenSSL " << std::setw(6) << openssl
+            << "  in-tree " << std::setw(6) << from_secret
+            << "  precomputed pads " << std::setw(6) << from_pads << " ns/op" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+  size_t bytes = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 220;
+  int iters = argc > 2 ? std::atoi(argv[2]) : 200000;
+  if (iters <= 0) iters = 1;
+
+  const std::string key = "a-32-byte-shared-secret-for-hmac";
+  const std::string msg(bytes, 'x');
+
+  std::cout << bytes << " byte message, SHA-NI "
+            << (jwt::detail::sha256_ni_supported() ? "used" : "not available") << "\n"
+            << std::fixed << std::setprecision(0);
+
+  run<jwt::algo::HS256>("HS256", key, msg, iters);
+  run<jwt::algo::HS384>("HS384", key, msg, iters);
+  run<jwt::algo::HS512>("HS512", key, msg, iters);
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include "jwt/jwt.hpp"
+
+/***
+ * Measures loading a key ring at startup against the number
+ * of keys: parsing PEM on one thread and on all cores, and
+ * loading a snapshot of DER keys written by `save_snapshot`.
+ *
+ * The keys cycle through the RSA and EC public keys of the
+ * test certificates, three RSA keys to one EC key.
+ *
+ * Usage: bench_key_load [key counts...]
+ */
+
+#define CERT_PATH(p) CERT_ROOT_DIR "/" p
+
+std::string read_from_file(const std::string& path)
+{
+  std::ifstream is{path, std::ifstream::binary};
+  return std::string{std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+}
+
+template <typename Func>
+double ms_for(Func&& fn)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  fn();
+  auto t1 = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<size_t> counts;
+  for (int i = 1; i < argc; ++i) {
+    counts.push_back(static_cast<size_t>(std::atoi(argv[i])));
+  }
+  if (counts.empty()) counts = {1000, 5000, 20000};
+
+  const std::vector<std::string> pems = {
+    read_from_file(CERT_PATH("rsa_certs/rsa256_pub.pem")),
+    read_from_file(CERT_PATH("rsa_certs/rsa384_pub.pem")),
+    read_from_file(CERT_PATH("rsa_certs/rsa512_pub.pem")),
+    read_from_file(CERT_PATH("ec_certs/ec384_pub.pem")),
+  };
+
+  const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  const std::string path = "bench_key_load.snapshot";
+
+  std::cout << "threads: " << cores << "\n"
+            << std::setw(8) << "keys"
+            << std::setw(14) << "PEM 1 thread"
+            << std::setw(14) << "PEM all"
+            << std::setw(16) << "snapshot 1 thr"
+            << std::setw(14) << "snapshot all"
+            << std::setw(12) << "file KiB" << " (ms)" << std::endl;
+
+  for (size_t n : counts) {
+    std::vector<jwt::key_ring::source_type> sources;
+    sources.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+      sources.emplace_back("tenant-" + std::to_string(i), pems[i % pems.size()]);
+    }
+
+    std::error_code ec;
+    jwt::key_ring ring;
+
+    double serial = ms_for([&] { ring.load(sources, ec, 1); });
+    double parallel = ms_for([&] { ring.load(sources, ec, cores); });
+    if (ec || ring.size() != n) {
+      std::cerr << "PEM load failed: " << ec.message() << std::endl;
+      return 1;
+    }
+
+    ring.save_snapshot(path, ec);
+    if (ec) {
+      std::cerr << "Snapshot save failed: " << ec.message() << std::endl;
+      return 1;
+    }
+
+    jwt::key_ring restored;
+    double snap_serial = ms_for([&] { restored.load_snapshot(path, ec, 1); });
+    double snap_parallel = ms_for([&] { restored.load_snapshot(path, ec, cores); });
+    if (ec || restored.size() != n) {
+      std::cerr << "Snapshot load failed: " << ec.message() << std::endl;
+      return 1;
+    }
+
+    std::ifstream is{path, std::ifstream::binary | std::ifstream::ate};
+    std::cout << std::fixed << std::setprecision(1)
+              << std::setw(8) << n
+              << std::setw(14) << serial
+              << std::setw(14) << parallel
+              << std::setw(16) << snap_serial
+              << std::setw(14) << snap_parallel
+              << std::setw(12) << is.tellg() / 1024.0 << std::endl;
+  }
+
+  std::remove(path.c_str());
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <strings.h>
+#include <vector>
+#include "jwt/jwt.hpp"
+
+/***
+ * Compares the perfect hash lookup of `str_to_alg` with the
+ * chain of `strcasecmp` calls it replaced, over the `alg`
+ * values of a mix of tokens.
+ *
+ * Usage: bench_str_to_alg [iterations]
+ */
+
+jwt::algorithm chained_str_to_alg(const char* alg)
+{
+  if (!strcasecmp(alg, "NONE"))  return jwt::algorithm::NONE;
+  if (!strcasecmp(alg, "HS256")) return jwt::algorithm::HS256;
+  if (!strcasecmp(alg, "HS384")) return jwt::algorithm::HS384;
+  if (!strcasecmp(alg, "HS512")) return jwt::algorithm::HS512;
+  if (!strcasecmp(alg, "RS256")) return jwt::algorithm::RS256;
+  if (!strcasecmp(alg, "RS384")) return jwt::algorithm::RS384;
+  if (!strcasecmp(alg, "RS512")) return jwt::algorithm::RS512;
+  if (!strcasecmp(alg, "ES256")) return jwt::algorithm::ES256;
+  if (!strcasecmp(alg, "ES384")) return jwt::algorithm::ES384;
+  if (!strcasecmp(alg, "ES512")) return jwt::algorithm::ES512;
+  return jwt::algorithm::UNKN;
+}
+
+template <typename Func>
+double ns_per_op(int iters, size_t n, Func&& fn)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; ++i) fn();
+  auto t1 = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / (iters * n);
+}
+
+int main(int argc, char* argv[])
+{
+  int iters = argc > 1 ? std::atoi(argv[1]) : 200000;
+  if (iters <= 0) iters = 1;
+
+  const std::vector<std::string> algs = {"RS256", "ES256", "HS256", "ES384", "RS512",
+                                         "HS512", "PS256", "EdDSA", "none", "ES512"};
+  volatile int sink = 0;
+
+  double chained = ns_per_op(iters, algs.size(), [&] {
+    for (const auto& a : algs) sink = sink + static_cast<int>(chained_str_to_alg(a.c_str()));
+  });
+  double hashed = ns_per_op(iters, algs.size(), [&] {
+    for (const auto& a : algs) sink = sink + static_cast<int>(jwt::str_to_alg(a));
+  });
+
+  std::cout << std::fixed << std::setprecision(1)
+            << "strcasecmp chain: " << std::setw(6) << chained << " ns/lookup\n"
+            << "perfect hash:     " << std::setw(6) << hashed << " ns/lookup" << std::endl;
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "jwt/jwt.hpp"
+
+/***
+ * Measures RS256 verification throughput as the number of
+ * verifying threads grows, with one shared parsed key and
+ * with a per thread replicated key.
+ *
+ * Usage: bench_verify_scaling [max_threads] [seconds_per_run]
+ */
+
+std::string read_from_file(const std::string& path)
+{
+  std::string contents;
+  std::ifstream is{path, std::ifstream::binary};
+
+  if (is) {
+    // get length of file:
+    is.seekg (0, is.end);
+    auto length = is.tellg();
+    is.seekg (0, is.beg);
+    contents.resize(length);
+
+    is.read(&contents[0], length);
+    if (!is) {
+      is.close();
+      return {};
+    }
+  }
+
+  is.close();
+  return contents;
+}
+
+double run(const std::string& token, const jwt::key& key, unsigned nthreads, double secs)
+{
+  using namespace jwt::params;
+
+  std::atomic<bool> start{false};
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> total{0};
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < nthreads; ++i) {
+    workers.emplace_back([&] {
+      std::vector<std::string> algs{"RS256"};
+      uint64_t count = 0;
+      while (!start.load()) std::this_thread::yield();
+      while (!stop.load(std::memory_order_relaxed)) {
+        std::error_code ec;
+        jwt::decode(token, algorithms(algs), ec, secret(key));
+        if (ec) std::abort();
+        ++count;
+      }
+      total += count;
+    });
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  start = true;
+  std::this_thread::sleep_for(std::chrono::duration<double>(secs));
+  stop = true;
+  for (auto& t : workers) t.join();
+  auto t1 = std::chrono::steady_clock::now();
+
+  return total.load() / std::chrono::duration<double>(t1 - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+  using namespace jwt::params;
+
+  unsigned max_threads = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+  double secs = argc > 2 ? std::atof(argv[2]) : 1.0;
+  if (max_threads == 0) max_threads = 1;
+
+  std::string priv_key = read_from_file(CERT_ROOT_DIR "/rsa_certs/rsa256_priv.pem");
+  std::string pub_key = read_from_file(CERT_ROOT_DIR "/rsa_certs/rsa256_pub.pem");
+  if (priv_key.empty() || pub_key.empty()) {
+    std::cerr << "Could not read the RSA keys" << std::endl;
+    return 1;
+  }
+
+  jwt::jwt_object obj{algorithm("RS256"), secret(priv_key), payload({{"sub", "bench"}})};
+  const std::string token = obj.signature();
+
+  auto shared = jwt::key::from_pem(pub_key);
+  auto replicated = shared.replicated(max_threads);
+
+  std::cout << std::setw(8) << "threads"
+            << std::setw(16) << "shared/s"
+            << std::setw(16) << "replicated/s" << std::endl;
+
+  for (unsigned n = 1; n <= max_threads; n *= 2) {
+    std::cout << std::setw(8) << n
+              << std::setw(16) << std::fixed << std::setprecision(0) << run(token, shared, n, secs)
+              << std::setw(16) << run(token, replicated, n, secs) << std::endl;
+    if (n < max_threads && n * 2 > max_threads) n = max_threads / 2;
+  }
+
+  return 0;
+}
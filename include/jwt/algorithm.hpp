@@ -33,6 +33,8 @@ SOFTWARE.
 #include <cassert>
 #include <memory>
 #include <system_error>
+#include <type_traits>
+#include <vector>
 
 #include <openssl/bn.h>
 #include <openssl/bio.h>
@@ -49,6 +51,9 @@ SOFTWARE.
 #include "jwt/error_codes.hpp"
 #include "jwt/base64.hpp"
 #include "jwt/config.hpp"
+#include "jwt/detail/asn1.hpp"
+#include "jwt/detail/sha256_mb.hpp"
+#include "jwt/detail/sha512.hpp"
 
 namespace jwt {
 
@@ -78,6 +83,9 @@ namespace algo {
  */
 struct HS256
 {
+  /// Precomputed key state of the in-tree HMAC
+  using mac_state = detail::hmac_sha256_key;
+
   const EVP_MD* operator()() noexcept
   {
     return EVP_sha256();
@@ -89,6 +97,9 @@ struct HS256
  */
 struct HS384
 {
+  /// Precomputed key state of the in-tree HMAC
+  using mac_state = detail::hmac_sha384_key;
+
   const EVP_MD* operator()() noexcept
   {
     return EVP_sha384();
@@ -100,6 +111,9 @@ struct HS384
  */
 struct HS512
 {
+  /// Precomputed key state of the in-tree HMAC
+  using mac_state = detail::hmac_sha512_key;
+
   const EVP_MD* operator()() noexcept
   {
     return EVP_sha512();
@@ -243,28 +257,47 @@ inline jwt::string_view alg_to_str(SCOPED_ENUM algorithm alg) noexcept
   JWT_NOT_REACHED("Code not reached");
 }
 
+namespace detail {
+
+/*!
+ * The algorithms by the slot of their name.
+ */
+constexpr SCOPED_ENUM algorithm alg_name_table[16] = {
+  algorithm::UNKN,  algorithm::HS512, algorithm::ES256, algorithm::RS384,
+  algorithm::UNKN,  algorithm::HS256, algorithm::ES384, algorithm::UNKN,
+  algorithm::UNKN,  algorithm::HS384, algorithm::NONE,  algorithm::RS512,
+  algorithm::UNKN,  algorithm::UNKN,  algorithm::ES512, algorithm::RS256,
+};
+
+/*!
+ * A perfect hash of the algorithm names, case insensitive,
+ * into the slots of `alg_name_table`. Any other string of four
+ * or five characters lands on some slot as well and is told
+ * apart by comparing it with the name found there.
+ */
+inline size_t alg_name_slot(const char* s, size_t len) noexcept
+{
+  return (static_cast<size_t>(s[0] | 0x20) + 4 * static_cast<size_t>(s[2] | 0x20) + len) & 15;
+}
+
+} // END namespace detail
+
 /**
  * Convert stringified algorithm to enum class.
  * The string comparison is case insesitive.
  */
 inline SCOPED_ENUM algorithm str_to_alg(const jwt::string_view alg) noexcept
 {
-  if (!alg.length()) return algorithm::UNKN;
-
-  if (!strcasecmp(alg.data(), "NONE"))  return algorithm::NONE;
-  if (!strcasecmp(alg.data(), "HS256")) return algorithm::HS256;
-  if (!strcasecmp(alg.data(), "HS384")) return algorithm::HS384;
-  if (!strcasecmp(alg.data(), "HS512")) return algorithm::HS512;
-  if (!strcasecmp(alg.data(), "RS256")) return algorithm::RS256;
-  if (!strcasecmp(alg.data(), "RS384")) return algorithm::RS384;
-  if (!strcasecmp(alg.data(), "RS512")) return algorithm::RS512;
-  if (!strcasecmp(alg.data(), "ES256")) return algorithm::ES256;
-  if (!strcasecmp(alg.data(), "ES384")) return algorithm::ES384;
-  if (!strcasecmp(alg.data(), "ES512")) return algorithm::ES512;
+  if (alg.length() != 4 && alg.length() != 5) return algorithm::UNKN;
 
-  return algorithm::UNKN;
+  const SCOPED_ENUM algorithm cand = detail::alg_name_table[detail::alg_name_slot(alg.data(), alg.length())];
+  if (cand == algorithm::UNKN) return algorithm::UNKN;
 
-  JWT_NOT_REACHED("Code not reached");
+  const jwt::string_view name = alg_to_str(cand);
+  if (name.length() != alg.length() || strncasecmp(alg.data(), name.data(), alg.length())) {
+    return algorithm::UNKN;
+  }
+  return cand;
 }
 
 /**
@@ -334,6 +367,8 @@ struct HMACSign
 {
   /// The type of Hashing algorithm
   using hasher_type = Hasher;
+  /// The precomputed key state of the in-tree HMAC
+  using mac_state_type = typename Hasher::mac_state;
 
   /**
    * Signs the input using the HMAC algorithm using the
@@ -350,6 +385,14 @@ struct HMACSign
    */
   static sign_result_t sign(const jwt::string_view key, const jwt::string_view data)
   {
+    if (inline_suited(key, data.length())) {
+      mac_state_type state;
+      state.init(key.data(), key.length());
+      auto res = sign(state, data);
+      state.clear();
+      return res;
+    }
+
     std::string sign;
     sign.resize(EVP_MAX_MD_SIZE);
     std::error_code ec{};
@@ -395,6 +438,103 @@ struct HMACSign
   static verify_result_t
   verify(const jwt::string_view key, const jwt::string_view head, const jwt::string_view sign);
 
+  /**
+   * Signs the input with the precomputed pad states of a key
+   * (see `jwt::key`), skipping OpenSSL and the two pad blocks.
+   *
+   * HS256 uses the Intel SHA extensions where the CPU has them.
+   * The result is the same as that of `sign` with the key.
+   */
+  static sign_result_t sign(const mac_state_type& key, const jwt::string_view data)
+  {
+    unsigned char mac[mac_state_type::digest_size];
+    key.mac(reinterpret_cast<const uint8_t*>(data.data()), data.length(), mac);
+    return { std::string(reinterpret_cast<const char*>(mac), sizeof(mac)), std::error_code{} };
+  }
+
+  /**
+   * Verifies the signature with the precomputed pad states of
+   * a key. See the `sign` overload taking them.
+   */
+  static verify_result_t
+  verify(const mac_state_type& key, const jwt::string_view head, const jwt::string_view sign)
+  {
+    unsigned char mac[mac_state_type::digest_size];
+    key.mac(reinterpret_cast<const uint8_t*>(head.data()), head.length(), mac);
+    return compare_mac(mac, sizeof(mac), sign);
+  }
+
+  /**
+   * Verifies the signature of a header and payload which
+   * are spread over several segments. The MAC is computed
+   * over the segments in place.
+   */
+  static verify_result_t
+  verify(const jwt::string_view key, const segmented_view& head, const jwt::string_view sign);
+
+  /**
+   * Signs each of the `count` inputs in `data` with the same
+   * key, writing the results to `out`.
+   *
+   * For HS256 on x86 CPUs with SSSE3 or AVX2 the MACs are
+   * computed 4 or 8 at a time by the multi-buffer SHA-256 (see
+   * "jwt/detail/sha256_mb.hpp"). Otherwise, and for the other
+   * algorithms, they are computed one at a time with `sign`.
+   * The results are the same either way.
+   */
+  static void sign_batch(const jwt::string_view key,
+                         const jwt::string_view* data,
+                         size_t count,
+                         sign_result_t* out);
+
+  /**
+   * Verifies each of the `count` signatures in `signs` against
+   * the matching header and payload in `heads` with the same
+   * key, writing the results to `out`.
+   * Uses the multi-buffer SHA-256 as `sign_batch` does.
+   */
+  static void verify_batch(const jwt::string_view key,
+                           const jwt::string_view* heads,
+                           const jwt::string_view* signs,
+                           size_t count,
+                           verify_result_t* out);
+
+private:
+  /*!
+   * Checks if the in-tree HMAC should compute the MAC of `len`
+   * bytes. Empty keys keep going to OpenSSL for its errors.
+   */
+  static bool inline_suited(const jwt::string_view key, size_t len) noexcept
+  {
+    return !key.empty() && mac_state_type::preferred(len);
+  }
+
+  /*!
+   * Compares the MAC against the URL safe base64 encoded signature.
+   */
+  static verify_result_t
+  compare_mac(const unsigned char* mac, size_t mac_len, const jwt::string_view sign);
+
+  /*!
+   * Computes the MACs of `data` with the multi-buffer kernel.
+   * Returns false if there is none for `Hasher` or the CPU.
+   */
+  static bool batch_mac(const jwt::string_view key,
+                        const jwt::string_view* data,
+                        size_t count,
+                        std::vector<uint8_t>& macs,
+                        std::true_type);
+
+  /*!
+   */
+  static bool batch_mac(const jwt::string_view,
+                        const jwt::string_view*,
+                        size_t,
+                        std::vector<uint8_t>&,
+                        std::false_type)
+  {
+    return false;
+  }
 };
 
 /**
@@ -446,6 +586,16 @@ struct HMACSign<algo::NONE>
     return { true, ec };
   }
 
+  /**
+   * Basically a no-op. Sets the error code to NoneAlgorithmUsed.
+   */
+  static verify_result_t
+  verify(const jwt::string_view key, const segmented_view& head, const jwt::string_view sign)
+  {
+    (void)head;
+    return verify(key, jwt::string_view{}, sign);
+  }
+
 };
 
 
@@ -482,28 +632,57 @@ public:
   {
     std::error_code ec{};
 
-    std::string ii{data.data(), data.length()};
-
     EC_PKEY_uptr pkey{load_key(key, ec), ev_pkey_deletor};
     if (ec) return { std::string{}, ec };
 
+    return sign(pkey.get(), data);
+  }
+
+  /**
+   * Signs the input data using an already parsed private key.
+   */
+  static sign_result_t sign(EVP_PKEY* pkey, const jwt::string_view data)
+  {
+    std::error_code ec{};
+
+    if (!pkey || EVP_PKEY_id(pkey) != Hasher::type) {
+      return { std::string{}, AlgorithmErrc::SigningErr };
+    }
+
     //TODO: Use stack string here ?
-    std::string sign = evp_digest(pkey.get(), data, ec);
+    std::string sign = evp_digest(pkey, data, ec);
 
     if (ec) return { std::string{}, ec };
 
     if (Hasher::type == EVP_PKEY_EC) {
-      sign = public_key_ser(pkey.get(), sign, ec);
+      public_key_ser(pkey, sign, ec);
     }
 
     return { std::move(sign), ec };
   }
 
   /**
+   * Verifies the JWT string against the signature using
+   * the PEM encoded public key `key`.
    */
   static verify_result_t
   verify(const jwt::string_view key, const jwt::string_view head, const jwt::string_view sign);
 
+  /**
+   * Verifies the JWT string against the signature using
+   * an already parsed key.
+   */
+  static verify_result_t
+  verify(EVP_PKEY* pkey, const jwt::string_view head, const jwt::string_view sign);
+
+  /**
+   * Verifies the signature of a header and payload which
+   * are spread over several segments, feeding the segments
+   * to the digest one after the other.
+   */
+  static verify_result_t
+  verify(EVP_PKEY* pkey, const segmented_view& head, const jwt::string_view sign);
+
 private:
 
   /*!
@@ -515,38 +694,19 @@ private:
   static std::string evp_digest(EVP_PKEY* pkey, const jwt::string_view data, std::error_code& ec);
 
   /*!
+   * Converts the DER encoded ECDSA signature in `sign`
+   * to the raw `r || s` form in place.
    */
-  static std::string public_key_ser(EVP_PKEY* pkey, jwt::string_view sign, std::error_code& ec);
-
-#if defined(OPENSSL_VERSION_NUMBER) && OPENSSL_VERSION_NUMBER < 0x10100000L || defined(LIBRESSL_VERSION_NUMBER) && LIBRESSL_VERSION_NUMBER < 0x20700000L
-
+  static void public_key_ser(EVP_PKEY* pkey, std::string& sign, std::error_code& ec);
 
-  //ATTN: Below 2 functions
-  //are Taken from https://github.com/nginnever/zogminer/issues/39
-
-  /**
-   */
-  static void ECDSA_SIG_get0(const ECDSA_SIG* sig, const BIGNUM** pr, const BIGNUM** ps)
-  {
-    if (pr != nullptr) *pr = sig->r;
-    if (ps != nullptr) *ps = sig->s;
-  };
-
-  /**
+  /*!
+   * Size in bytes of each of the `r` and `s` coordinates
+   * of an ECDSA signature produced with the key.
    */
-  static int ECDSA_SIG_set0(ECDSA_SIG* sig, BIGNUM* r, BIGNUM* s)
+  static size_t ec_coord_size(EVP_PKEY* pkey) noexcept
   {
-    if (r == nullptr || s == nullptr) return 0;
-
-    BN_clear_free(sig->r);
-    BN_clear_free(sig->s);
-
-    sig->r = r;
-    sig->s = s;
-    return 1;
+    return (static_cast<size_t>(EVP_PKEY_bits(pkey)) + 7) / 8;
   }
-
-#endif
 };
 
 } // END namespace jwt
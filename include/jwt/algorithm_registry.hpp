@@ -0,0 +1,163 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_ALGORITHM_REGISTRY_HPP
+#define CPP_JWT_ALGORITHM_REGISTRY_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "jwt/algorithm.hpp"
+#include "jwt/key.hpp"
+
+namespace jwt {
+
+/**
+ * The implementation of a signing algorithm as the encoder
+ * and decoder call it.
+ *
+ * The built-in entries use `HMACSign` and `PEMSign`. An
+ * application can override any of the functions of an
+ * algorithm with `register_algorithm`, for instance to sign
+ * with a key held by a hardware module, without patching the
+ * library.
+ */
+struct algorithm_entry
+{
+  /// Signs with a secret or a PEM encoded key
+  sign_func_t sign = nullptr;
+  /// Verifies with a secret or a PEM encoded key
+  verify_func_t verify = nullptr;
+  /// Signs with a key handle
+  sign_key_func_t sign_key = nullptr;
+  /// Verifies with a key handle, over a possibly segmented input
+  verify_key_func_t verify_key = nullptr;
+  /// The kind of key of the algorithm: SECRET for HMAC,
+  /// PUBLIC for a key pair, NONE for the "none" algorithm
+  SCOPED_ENUM key_type key_kind = key_type::NONE;
+};
+
+/**
+ * The entry in effect for `alg`: the registered override or
+ * the built-in entry. All functions are null for
+ * `algorithm::UNKN` and `algorithm::TERM`.
+ *
+ * A single array lookup; safe to call while another thread
+ * registers an override.
+ */
+const algorithm_entry& algorithm_impl(SCOPED_ENUM algorithm alg) noexcept;
+
+/**
+ * The entry `alg` had before any override.
+ */
+const algorithm_entry& builtin_algorithm_impl(SCOPED_ENUM algorithm alg) noexcept;
+
+/**
+ * Overrides the implementation of `alg` for the whole process.
+ *
+ * Functions left null in `entry` keep the built-in ones, and the
+ * key kind always stays that of the algorithm. Meant to be
+ * called at startup; tokens being signed or verified at the same
+ * time use either the old or the new entry.
+ *
+ * Returns false, changing nothing, for `algorithm::UNKN` and
+ * `algorithm::TERM`.
+ */
+bool register_algorithm(SCOPED_ENUM algorithm alg, const algorithm_entry& entry);
+
+/**
+ * Restores the built-in implementation of `alg`.
+ */
+void reset_algorithm(SCOPED_ENUM algorithm alg);
+
+namespace detail {
+
+/*!
+ * Number of slots of the registry, one per enumerator.
+ */
+constexpr size_t algorithm_slots = static_cast<size_t>(algorithm::TERM) + 1;
+
+/*!
+ * The entries of all algorithms indexed by the enum.
+ *
+ * A slot points either at the built-in entry or at an override.
+ * Overrides are kept until the process exits, so a reader may
+ * still use an entry which was replaced meanwhile.
+ */
+class algorithm_registry
+{
+public:
+  /*!
+   */
+  static algorithm_registry& instance()
+  {
+    static algorithm_registry registry;
+    return registry;
+  }
+
+  /*!
+   */
+  const algorithm_entry& get(SCOPED_ENUM algorithm alg) const noexcept
+  {
+    const size_t i = static_cast<size_t>(alg);
+    return *slots_[i < algorithm_slots ? i : static_cast<size_t>(algorithm::UNKN)]
+              .load(std::memory_order_acquire);
+  }
+
+  /*!
+   */
+  const algorithm_entry& builtin(SCOPED_ENUM algorithm alg) const noexcept
+  {
+    const size_t i = static_cast<size_t>(alg);
+    return builtin_[i < algorithm_slots ? i : static_cast<size_t>(algorithm::UNKN)];
+  }
+
+  /*!
+   */
+  bool set(SCOPED_ENUM algorithm alg, const algorithm_entry& entry);
+
+  /*!
+   */
+  void reset(SCOPED_ENUM algorithm alg);
+
+private:
+  /*!
+   */
+  algorithm_registry();
+
+private:
+  algorithm_entry builtin_[algorithm_slots];
+  std::atomic<const algorithm_entry*> slots_[algorithm_slots];
+
+  /// Serializes the overrides
+  std::mutex mtx_;
+  std::vector<std::unique_ptr<algorithm_entry>> overrides_;
+};
+
+} // END namespace detail
+} // END namespace jwt
+
+#include "jwt/impl/algorithm_registry.ipp"
+
+#endif
@@ -0,0 +1,265 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_ASYNC_HPP
+#define CPP_JWT_ASYNC_HPP
+
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <system_error>
+#include <condition_variable>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+# if __has_include(<coroutine>)
+#  include <coroutine>
+#  define CPP_JWT_HAS_COROUTINES 1
+# endif
+#endif
+
+#include "jwt/jwt.hpp"
+
+namespace jwt {
+
+/**
+ * What `verify_pool` does with a job when its queue is full.
+ */
+enum class overflow_policy
+{
+  // Wait for a free spot in the queue
+  block = 0,
+  // Run the job on the submitting thread
+  run_inline,
+  // Drop the job. The decode reports `resource_unavailable_try_again`.
+  reject,
+};
+
+/**
+ * A fixed set of worker threads running the signature
+ * verification of asynchronous decodes.
+ *
+ * Jobs are queued in a bounded FIFO. When it is full the
+ * `overflow_policy` decides whether the submitter waits,
+ * does the work itself or gets the job rejected, so that
+ * a burst of tokens can not grow the queue without bound.
+ *
+ * The destructor runs the jobs still in the queue and joins
+ * the workers.
+ */
+class verify_pool
+{
+public: // 'tors
+  /**
+   * Starts the pool.
+   *
+   * Arguments:
+   *  @threads : Number of worker threads. At least one is started.
+   *  @queue_capacity : Maximum number of jobs waiting for a worker.
+   *  @policy : What to do with jobs once the queue is full.
+   */
+  explicit verify_pool(size_t threads = std::thread::hardware_concurrency(),
+                       size_t queue_capacity = 1024,
+                       overflow_policy policy = overflow_policy::block);
+
+  /// Non copyable and assignable
+  verify_pool(const verify_pool&) = delete;
+  verify_pool& operator=(const verify_pool&) = delete;
+
+  ~verify_pool();
+
+public: // Exposed APIs
+  /**
+   * Queues a job.
+   * Returns false if the job was rejected because
+   * the queue is full and the policy is `reject`.
+   */
+  bool submit(std::function<void()> job);
+
+  /**
+   * Number of worker threads.
+   */
+  size_t threads() const noexcept
+  {
+    return workers_.size();
+  }
+
+  /**
+   * Number of jobs waiting for a worker.
+   */
+  size_t queued() const
+  {
+    std::lock_guard<std::mutex> lk{mtx_};
+    return queue_.size();
+  }
+
+private: // Private APIs
+  /*!
+   */
+  void work();
+
+private: // Data members
+  /// Maximum queue length
+  size_t capacity_;
+
+  /// Policy when the queue is full
+  overflow_policy policy_;
+
+  /// Set when shutting down
+  bool stop_ = false;
+
+  /// Guards the queue and `stop_`
+  mutable std::mutex mtx_;
+
+  /// Signalled when a job is queued
+  std::condition_variable not_empty_;
+
+  /// Signalled when a job is taken off the queue
+  std::condition_variable not_full_;
+
+  /// The jobs
+  std::deque<std::function<void()>> queue_;
+
+  /// The workers
+  std::vector<std::thread> workers_;
+};
+
+/// The decoded object along with the decode result
+using decode_result_t = std::pair<jwt_object, std::error_code>;
+
+namespace detail {
+
+/*!
+ * Everything an asynchronous decode needs once the
+ * caller has returned: a copy of the token, the object
+ * parsed from it and the signature check left to do.
+ */
+struct async_decode_state
+{
+  std::string token;
+  jwt_object obj;
+  pending_signature pending;
+  std::error_code ec;
+  std::exception_ptr error;
+
+  /// Runs the pending signature check. Does not throw.
+  void run() noexcept;
+
+  /// Result for the promise or awaiter
+  decode_result_t result()
+  {
+    if (error) std::rethrow_exception(error);
+    return { std::move(obj), ec };
+  }
+};
+
+using async_decode_state_ptr = std::shared_ptr<async_decode_state>;
+
+/*!
+ * Runs the inline part of the decode on a copy of the token.
+ */
+template <typename SequenceT, typename... Args>
+async_decode_state_ptr decode_async_prepare(const jwt::string_view enc_str,
+                                            const params::detail::algorithms_param<SequenceT>& algos,
+                                            Args&&... args);
+
+} // END namespace detail
+
+/**
+ * Decodes the token with the signature verified on `pool`.
+ *
+ * Parsing and the claim checks are cheap and run on the calling
+ * thread, using the same parameters as `jwt::decode`. A token
+ * failing them, or needing no signature check, gets an already
+ * satisfied future. Only the signature verification is queued.
+ *
+ * Errors are reported through the `error_code` of the result.
+ * If the pool rejects the job it is set to
+ * `std::errc::resource_unavailable_try_again`.
+ *
+ * NOTE: The `cache` parameter is not consulted.
+ */
+template <typename SequenceT, typename... Args>
+std::future<decode_result_t>
+decode_async(verify_pool& pool,
+             const jwt::string_view enc_str,
+             const params::detail::algorithms_param<SequenceT>& algos,
+             Args&&... args);
+
+#if defined(CPP_JWT_HAS_COROUTINES)
+
+/**
+ * Awaitable returned by `jwt::await_decode`.
+ * The coroutine is resumed on the pool worker
+ * which verified the signature.
+ */
+class decode_awaitable
+{
+public: // 'tors
+  decode_awaitable(verify_pool& pool, detail::async_decode_state_ptr state)
+    : pool_(&pool)
+    , state_(std::move(state))
+  {
+  }
+
+public: // Awaiter interface
+  bool await_ready() const noexcept
+  {
+    return state_->ec || !state_->pending.required;
+  }
+
+  bool await_suspend(std::coroutine_handle<> h);
+
+  decode_result_t await_resume()
+  {
+    return state_->result();
+  }
+
+private: // Data members
+  verify_pool* pool_;
+  detail::async_decode_state_ptr state_;
+};
+
+/**
+ * Coroutine flavour of `decode_async`:
+ *
+ *   auto res = co_await jwt::await_decode(pool, token, algorithms({"RS256"}), secret(key));
+ */
+template <typename SequenceT, typename... Args>
+decode_awaitable await_decode(verify_pool& pool,
+                              const jwt::string_view enc_str,
+                              const params::detail::algorithms_param<SequenceT>& algos,
+                              Args&&... args);
+
+#endif // CPP_JWT_HAS_COROUTINES
+
+} // END namespace jwt
+
+#include "jwt/impl/async.ipp"
+
+#endif
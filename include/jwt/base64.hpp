@@ -29,6 +29,8 @@ SOFTWARE.
 #include <ostream>
 #include "jwt/config.hpp"
 #include "jwt/string_view.hpp"
+#include "jwt/short_string.hpp"
+#include "jwt/segments.hpp"
 
 namespace jwt {
 
@@ -76,22 +78,18 @@ private:
 
 /**
  * Encodes a sequence of octet into base64 string.
- * Returns std::string resized to contain only the
- * encoded data (as usual without null terminator).
+ * Writes the encoded data to the buffer `out` which
+ * must have space for atleast `encoding_size(len)` bytes.
  *
- * The encoded string is atleast `encoding_size(input len)`
- * in size.
+ * Returns the number of bytes written.
  *
  * Arguments:
  *  @in : Input byte string to be encoded.
  *  @len : Length of the input byte string.
+ *  @out : Output buffer.
  */
-inline std::string base64_encode(const char* in, size_t len)
+inline size_t base64_encode(const char* in, size_t len, char* out) noexcept
 {
-  std::string result;
-  const auto encoded_siz = encoding_size(len);
-  result.resize(encoded_siz);
-
   constexpr static const EMap emap{};
 
   int i = 0;
@@ -101,10 +99,10 @@ inline std::string base64_encode(const char* in, size_t len)
     const auto second = in[i+1];
     const auto third  = in[i+2];
 
-    result[j++] = emap.at( (first >> 2) & 0x3F                           );
-    result[j++] = emap.at(((first  & 0x03) << 4) | ((second & 0xF0) >> 4));
-    result[j++] = emap.at(((second & 0x0F) << 2) | ((third  & 0xC0) >> 6));
-    result[j++] = emap.at(                          (third  & 0x3F)      );
+    out[j++] = emap.at( (first >> 2) & 0x3F                           );
+    out[j++] = emap.at(((first  & 0x03) << 4) | ((second & 0xF0) >> 4));
+    out[j++] = emap.at(((second & 0x0F) << 2) | ((third  & 0xC0) >> 6));
+    out[j++] = emap.at(                          (third  & 0x3F)      );
   }
 
   switch (len % 3) {
@@ -113,27 +111,46 @@ inline std::string base64_encode(const char* in, size_t len)
     const auto first  = in[i];
     const auto second = in[i+1];
 
-    result[j++] = emap.at( (first >> 2) & 0x3F                          );
-    result[j++] = emap.at(((first & 0x03) << 4) | ((second & 0xF0) >> 4));
-    result[j++] = emap.at(                         (second & 0x0F) << 2 );
-    result[j++] = '=';
+    out[j++] = emap.at( (first >> 2) & 0x3F                          );
+    out[j++] = emap.at(((first & 0x03) << 4) | ((second & 0xF0) >> 4));
+    out[j++] = emap.at(                         (second & 0x0F) << 2 );
+    out[j++] = '=';
     break;
   }
   case 1:
   {
     const auto first = in[i];
 
-    result[j++] = emap.at((first >> 2) & 0x3F);
-    result[j++] = emap.at((first & 0x03) << 4);
-    result[j++] = '=';
-    result[j++] = '=';
+    out[j++] = emap.at((first >> 2) & 0x3F);
+    out[j++] = emap.at((first & 0x03) << 4);
+    out[j++] = '=';
+    out[j++] = '=';
     break;
   }
   case 0:
     break;
   };
 
-  result.resize(j);
+  return static_cast<size_t>(j);
+}
+
+/**
+ * Encodes a sequence of octet into base64 string.
+ * Returns std::string resized to contain only the
+ * encoded data (as usual without null terminator).
+ *
+ * The encoded string is atleast `encoding_size(input len)`
+ * in size.
+ *
+ * Arguments:
+ *  @in : Input byte string to be encoded.
+ *  @len : Length of the input byte string.
+ */
+inline std::string base64_encode(const char* in, size_t len)
+{
+  std::string result;
+  result.resize(encoding_size(len));
+  result.resize(base64_encode(in, len, &result[0]));
 
   return result;
 }
@@ -181,18 +198,20 @@ private:
 
 /**
  * Decodes octet of base64 encoded byte string.
+ * Writes the decoded bytes to the buffer `out` which
+ * must have space for atleast `decoding_size(len)` bytes.
  *
- * Returns a std::string with the decoded byte string.
+ * Returns the number of bytes written.
+ * On malformed input `decoding_size(len)` is returned.
  *
  * Arguments:
  *  @in : Encoded base64 byte string.
  *  @len : Length of the encoded input byte string.
+ *  @out : Output buffer.
  */
-inline std::string base64_decode(const char* in, size_t len)
+inline size_t base64_decode(const char* in, size_t len, char* out) noexcept
 {
-  std::string result;
   const auto decoded_siz = decoding_size(len);
-  result.resize(decoded_siz);
 
   int i = 0;
   size_t bytes_rem = len;
@@ -205,16 +224,16 @@ inline std::string base64_decode(const char* in, size_t len)
   while (bytes_rem > 4)
   {
     // Error case in input
-    if (dmap.at(*in) == -1) return result;
+    if (dmap.at(*in) == -1) return decoded_siz;
 
     const auto first  = dmap.at(in[0]);
     const auto second = dmap.at(in[1]);
     const auto third  = dmap.at(in[2]);
     const auto fourth = dmap.at(in[3]);
 
-    result[i]     = (first  << 2) | (second >> 4);
-    result[i + 1] = (second << 4) | (third  >> 2);
-    result[i + 2] = (third  << 6) | fourth;
+    out[i]     = (first  << 2) | (second >> 4);
+    out[i + 1] = (second << 4) | (third  >> 2);
+    out[i + 2] = (third  << 6) | fourth;
 
     bytes_rem -= 4;
     i += 3;
@@ -227,7 +246,7 @@ inline std::string base64_decode(const char* in, size_t len)
   {
     const auto third  = dmap.at(in[2]);
     const auto fourth = dmap.at(in[3]);
-    result[i + 2] = (third << 6) | fourth;
+    out[i + 2] = (third << 6) | fourth;
     bytes_wr++;
   }
   //FALLTHROUGH
@@ -235,7 +254,7 @@ inline std::string base64_decode(const char* in, size_t len)
   {
     const auto second = dmap.at(in[1]);
     const auto third  = dmap.at(in[2]);
-    result[i + 1] = (second << 4) | (third >> 2);
+    out[i + 1] = (second << 4) | (third >> 2);
     bytes_wr++;
   }
   //FALLTHROUGH
@@ -243,12 +262,28 @@ inline std::string base64_decode(const char* in, size_t len)
   {
     const auto first  = dmap.at(in[0]);
     const auto second = dmap.at(in[1]);
-    result[i] = (first << 2) | (second >> 4);
+    out[i] = (first << 2) | (second >> 4);
     bytes_wr++;
   }
   };
 
-  result.resize(bytes_wr);
+  return bytes_wr;
+}
+
+/**
+ * Decodes octet of base64 encoded byte string.
+ *
+ * Returns a std::string with the decoded byte string.
+ *
+ * Arguments:
+ *  @in : Encoded base64 byte string.
+ *  @len : Length of the encoded input byte string.
+ */
+inline std::string base64_decode(const char* in, size_t len)
+{
+  std::string result;
+  result.resize(decoding_size(len));
+  result.resize(base64_decode(in, len, &result[0]));
 
   return result;
 }
@@ -289,7 +324,10 @@ inline size_t base64_uri_encode(char* data, size_t len) noexcept
 }
 
 /**
- * Decodes an input URL safe base64 encoded byte string.
+ * Decodes an input URL safe base64 encoded byte string
+ * into the string `out`, which can be of any string type
+ * such as a `short_string`.
+ * The padded intermediate is kept in a stack arena.
  *
  * NOTE: To be used only for decoding URL safe base64 encoded
  * byte string.
@@ -297,10 +335,14 @@ inline size_t base64_uri_encode(char* data, size_t len) noexcept
  * Arguments:
  *  @data : URL safe base64 encoded byte string.
  *  @len : Length of the input byte string.
+ *  @out : The string to hold the decoded bytes.
  */
-inline std::string base64_uri_decode(const char* data, size_t len)
+template <typename StringT>
+void base64_uri_decode(const char* data, size_t len, StringT& out)
 {
-  std::string uri_dec;
+  constexpr size_t scratch = 1024;
+  Arena<scratch> arena;
+  short_string<scratch> uri_dec{arena};
   uri_dec.resize(len + 4);
 
   size_t i = 0;
@@ -326,7 +368,134 @@ inline std::string base64_uri_decode(const char* data, size_t len)
     }
   }
 
-  return base64_decode(uri_dec.c_str(), uri_dec.length());
+  out.resize(decoding_size(uri_dec.length()));
+  out.resize(base64_decode(uri_dec.data(), uri_dec.length(), &out[0]));
+}
+
+/**
+ * Decodes an input URL safe base64 encoded byte string.
+ *
+ * NOTE: To be used only for decoding URL safe base64 encoded
+ * byte string.
+ *
+ * Arguments:
+ *  @data : URL safe base64 encoded byte string.
+ *  @len : Length of the input byte string.
+ */
+inline std::string base64_uri_decode(const char* data, size_t len)
+{
+  std::string uri_dec;
+  base64_uri_decode(data, len, uri_dec);
+  return uri_dec;
+}
+
+/**
+ * Incremental decoder for URL safe base64 input which
+ * arrives in pieces, with quanta split across them.
+ * Characters of the standard alphabet are accepted too.
+ * Decoding stops at the first padding character.
+ */
+class base64_uri_decoder
+{
+public:
+  /**
+   * Decodes the next piece of input to `out`, which must have
+   * space for atleast `decoding_size(len) + 3` bytes.
+   * Returns the number of bytes written.
+   */
+  size_t update(const char* in, size_t len, char* out) noexcept
+  {
+    constexpr static const DMap dmap{};
+    size_t wr = 0;
+
+    for (size_t i = 0; i < len && !done_; ++i) {
+      const char ch = in[i];
+      signed char v = ch == '-' ? 62
+                    : ch == '_' ? 63
+                    : dmap.at(static_cast<unsigned char>(ch));
+
+      if (v == -1) {
+        // Padding ends the input, anything else is malformed
+        if (ch != '=') error_ = true;
+        done_ = true;
+        break;
+      }
+
+      quantum_[n_++] = v;
+      if (n_ == 4) {
+        out[wr++] = static_cast<char>((quantum_[0] << 2) | (quantum_[1] >> 4));
+        out[wr++] = static_cast<char>((quantum_[1] << 4) | (quantum_[2] >> 2));
+        out[wr++] = static_cast<char>((quantum_[2] << 6) | quantum_[3]);
+        n_ = 0;
+      }
+    }
+
+    return wr;
+  }
+
+  /**
+   * Flushes the last partial quantum to `out`, which
+   * must have space for 2 bytes.
+   * Returns the number of bytes written.
+   */
+  size_t finish(char* out) noexcept
+  {
+    size_t wr = 0;
+
+    switch (n_) {
+    case 3:
+      out[1] = static_cast<char>((quantum_[1] << 4) | (quantum_[2] >> 2));
+      wr++;
+    //FALLTHROUGH
+    case 2:
+      out[0] = static_cast<char>((quantum_[0] << 2) | (quantum_[1] >> 4));
+      wr++;
+      break;
+    case 1:
+      error_ = true;
+      break;
+    };
+
+    n_ = 0;
+    done_ = true;
+    return wr;
+  }
+
+  /**
+   * True if the input was not valid base64.
+   */
+  bool error() const noexcept
+  {
+    return error_;
+  }
+
+private:
+  signed char quantum_[4] = {0, 0, 0, 0};
+  size_t n_ = 0;
+  bool done_ = false;
+  bool error_ = false;
+};
+
+/**
+ * Decodes URL safe base64 input spread over the segments
+ * of `in` into the string `out`, without gathering it.
+ *
+ * Returns false if the input was not valid base64.
+ */
+template <typename StringT>
+bool base64_uri_decode(const segmented_view& in, StringT& out)
+{
+  base64_uri_decoder dec;
+  out.resize(decoding_size(in.length()) + 3);
+
+  size_t wr = 0;
+  in.for_each([&](jwt::string_view piece) {
+    wr += dec.update(piece.data(), piece.length(), &out[wr]);
+  });
+  wr += dec.finish(&out[wr]);
+
+  out.resize(wr);
+  return !dec.error();
 }
 
 } // END namespace jwt
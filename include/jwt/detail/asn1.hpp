@@ -0,0 +1,422 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+#ifndef CPP_JWT_ASN1_HPP
+#define CPP_JWT_ASN1_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace jwt {
+namespace detail {
+
+/**
+ * A minimal DER codec for the `ECDSA-Sig-Value` structure:
+ *
+ *   ECDSA-Sig-Value ::= SEQUENCE { r INTEGER, s INTEGER }
+ *
+ * JWS carries ECDSA signatures as the fixed width concatenation
+ * `r || s` (RFC 7518 Section 3.4) whereas OpenSSL produces and
+ * consumes the DER form. Converting between the two here, on caller
+ * provided buffers, avoids the BIGNUM and ECDSA_SIG round trips.
+ */
+
+/// Largest coordinate size of the supported curves (P-521).
+constexpr size_t ecdsa_max_coord_size = 66;
+
+/// Largest DER encoding of a signature for the supported curves.
+/// SEQUENCE header (3) + 2 * (INTEGER header (2) + pad (1) + coordinate).
+constexpr size_t ecdsa_max_der_size = 3 + 2 * (2 + 1 + ecdsa_max_coord_size);
+
+/**
+ * Reads one DER INTEGER at `in` (bounded by `end`) and writes its
+ * magnitude right aligned into `out` of exactly `coord_len` bytes.
+ *
+ * Returns the pointer past the consumed INTEGER or nullptr on
+ * malformed input or if the value does not fit.
+ */
+inline const uint8_t* der_read_integer(const uint8_t* in,
+                                       const uint8_t* end,
+                                       uint8_t* out,
+                                       size_t coord_len) noexcept
+{
+  if (end - in < 2 || in[0] != 0x02) return nullptr;
+
+  // Coordinates of the supported curves always use the short form length
+  size_t len = in[1];
+  if (len == 0 || len > 0x7F) return nullptr;
+  in += 2;
+  if (static_cast<size_t>(end - in) < len) return nullptr;
+
+  // ECDSA integers are never negative
+  if (in[0] & 0x80) return nullptr;
+
+  const uint8_t* val = in;
+  size_t val_len = len;
+  while (val_len > 1 && val[0] == 0x00) { ++val; --val_len; }
+
+  if (val_len > coord_len) return nullptr;
+
+  size_t pad = coord_len - val_len;
+  for (size_t i = 0; i < pad; ++i) out[i] = 0;
+  for (size_t i = 0; i < val_len; ++i) out[pad + i] = val[i];
+
+  return in + len;
+}
+
+/**
+ * Converts a DER encoded ECDSA signature to the raw `r || s` form.
+ *
+ * Arguments:
+ *  @der : The DER encoded signature.
+ *  @der_len : Length of the DER encoded signature.
+ *  @raw : Output buffer of atleast `2 * coord_len` bytes.
+ *  @coord_len : Size in bytes of each of the coordinates.
+ *
+ * Returns:
+ *  true if the conversion succeeded, false for malformed input.
+ */
+inline bool ecdsa_der_to_raw(const uint8_t* der,
+                             size_t der_len,
+                             uint8_t* raw,
+                             size_t coord_len) noexcept
+{
+  if (coord_len == 0 || coord_len > ecdsa_max_coord_size) return false;
+  if (der_len < 2 || der[0] != 0x30) return false;
+
+  const uint8_t* end = der + der_len;
+  const uint8_t* in = der + 2;
+  size_t seq_len = der[1];
+
+  if (seq_len == 0x81) {
+    if (der_len < 3) return false;
+    seq_len = der[2];
+    if (seq_len < 0x80) return false; // non-minimal length
+    ++in;
+  } else if (seq_len > 0x7F) {
+    return false;
+  }
+
+  if (static_cast<size_t>(end - in) != seq_len) return false;
+
+  in = der_read_integer(in, end, raw, coord_len);
+  if (!in) return false;
+
+  in = der_read_integer(in, end, raw + coord_len, coord_len);
+  if (!in) return false;
+
+  return in == end;
+}
+
+/**
+ * Converts a raw `r || s` ECDSA signature to its DER form.
+ *
+ * Arguments:
+ *  @raw : The raw signature of `2 * coord_len` bytes.
+ *  @coord_len : Size in bytes of each of the coordinates.
+ *  @der : Output buffer.
+ *  @der_cap : Capacity of the output buffer.
+ *
+ * Returns:
+ *  Number of bytes written to `der` or 0 on failure.
+ */
+inline size_t ecdsa_raw_to_der(const uint8_t* raw,
+                               size_t coord_len,
+                               uint8_t* der,
+                               size_t der_cap) noexcept
+{
+  if (coord_len == 0 || coord_len > ecdsa_max_coord_size) return 0;
+
+  const uint8_t* vals[2] = { raw, raw + coord_len };
+  size_t lens[2] = { coord_len, coord_len };
+  bool pads[2] = { false, false };
+
+  for (int i = 0; i < 2; ++i) {
+    while (lens[i] > 1 && vals[i][0] == 0x00) { ++vals[i]; --lens[i]; }
+    pads[i] = (vals[i][0] & 0x80) != 0;
+  }
+
+  size_t content_len = 0;
+  for (int i = 0; i < 2; ++i) {
+    content_len += 2 + (pads[i] ? 1 : 0) + lens[i];
+  }
+
+  size_t hdr_len = content_len < 0x80 ? 2 : 3;
+  if (hdr_len + content_len > der_cap) return 0;
+
+  size_t pos = 0;
+  der[pos++] = 0x30;
+  if (hdr_len == 3) der[pos++] = 0x81;
+  der[pos++] = static_cast<uint8_t>(content_len);
+
+  for (int i = 0; i < 2; ++i) {
+    der[pos++] = 0x02;
+    der[pos++] = static_cast<uint8_t>(lens[i] + (pads[i] ? 1 : 0));
+    if (pads[i]) der[pos++] = 0x00;
+    for (size_t j = 0; j < lens[i]; ++j) der[pos++] = vals[i][j];
+  }
+
+  return pos;
+}
+
+/**
+ * A minimal DER writer for the `SubjectPublicKeyInfo` structure
+ * of RSA (RFC 8017) and EC (RFC 5480) public keys:
+ *
+ *   SubjectPublicKeyInfo ::= SEQUENCE {
+ *     algorithm        SEQUENCE { OID, parameters },
+ *     subjectPublicKey BIT STRING }
+ *
+ * Keys which arrive as their components (JWK `n` and `e`, or an
+ * EC point) are wrapped into it and handed to `d2i_PUBKEY`, which
+ * works the same on all the supported OpenSSL versions.
+ */
+
+/// OID of rsaEncryption (1.2.840.113549.1.1.1)
+constexpr uint8_t der_oid_rsa[] = { 0x06, 0x09, 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01, 0x01 };
+
+/// OID of id-ecPublicKey (1.2.840.10045.2.1)
+constexpr uint8_t der_oid_ec[] = { 0x06, 0x07, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x02, 0x01 };
+
+/// OIDs of the named curves P-256, P-384 and P-521
+constexpr uint8_t der_oid_p256[] = { 0x06, 0x08, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x03, 0x01, 0x07 };
+constexpr uint8_t der_oid_p384[] = { 0x06, 0x05, 0x2B, 0x81, 0x04, 0x00, 0x22 };
+constexpr uint8_t der_oid_p521[] = { 0x06, 0x05, 0x2B, 0x81, 0x04, 0x00, 0x23 };
+
+/**
+ * Appends a DER length.
+ */
+inline void der_put_length(std::string& out, size_t len)
+{
+  if (len < 0x80) {
+    out.push_back(static_cast<char>(len));
+    return;
+  }
+
+  size_t nbytes = 0;
+  for (size_t l = len; l; l >>= 8) ++nbytes;
+
+  out.push_back(static_cast<char>(0x80 | nbytes));
+  while (nbytes--) {
+    out.push_back(static_cast<char>((len >> (8 * nbytes)) & 0xFF));
+  }
+}
+
+/**
+ * Appends a value with its tag and length.
+ */
+inline void der_put_tlv(std::string& out, uint8_t tag, const char* data, size_t len)
+{
+  out.push_back(static_cast<char>(tag));
+  der_put_length(out, len);
+  out.append(data, len);
+}
+
+/**
+ * Appends a non negative INTEGER given by its big endian
+ * magnitude, as found in JWK members.
+ */
+inline void der_put_unsigned(std::string& out, const uint8_t* mag, size_t len)
+{
+  while (len > 1 && mag[0] == 0x00) { ++mag; --len; }
+
+  const bool pad = len == 0 || (mag[0] & 0x80) != 0;
+
+  out.push_back(0x02);
+  der_put_length(out, len + (pad ? 1 : 0));
+  if (pad) out.push_back(0x00);
+  out.append(reinterpret_cast<const char*>(mag), len);
+}
+
+/**
+ * Builds the `SubjectPublicKeyInfo` of an RSA public key
+ * from its modulus and public exponent.
+ */
+inline std::string rsa_spki_der(const uint8_t* n, size_t n_len,
+                                const uint8_t* e, size_t e_len)
+{
+  // RSAPublicKey ::= SEQUENCE { modulus INTEGER, publicExponent INTEGER }
+  std::string ints;
+  der_put_unsigned(ints, n, n_len);
+  der_put_unsigned(ints, e, e_len);
+
+  std::string bits(1, '\0');
+  der_put_tlv(bits, 0x30, ints.data(), ints.length());
+
+  std::string alg_id(reinterpret_cast<const char*>(der_oid_rsa), sizeof(der_oid_rsa));
+  alg_id.append("\x05\x00", 2);
+
+  std::string body;
+  der_put_tlv(body, 0x30, alg_id.data(), alg_id.length());
+  der_put_tlv(body, 0x03, bits.data(), bits.length());
+
+  std::string spki;
+  der_put_tlv(spki, 0x30, body.data(), body.length());
+  return spki;
+}
+
+/**
+ * Builds the `SubjectPublicKeyInfo` of an EC public key
+ * from the DER OID of its curve and its encoded point.
+ */
+inline std::string ec_spki_der(const uint8_t* curve_oid, size_t oid_len,
+                               const uint8_t* point, size_t point_len)
+{
+  std::string alg_id(reinterpret_cast<const char*>(der_oid_ec), sizeof(der_oid_ec));
+  alg_id.append(reinterpret_cast<const char*>(curve_oid), oid_len);
+
+  std::string bits(1, '\0');
+  bits.append(reinterpret_cast<const char*>(point), point_len);
+
+  std::string body;
+  der_put_tlv(body, 0x30, alg_id.data(), alg_id.length());
+  der_put_tlv(body, 0x03, bits.data(), bits.length());
+
+  std::string spki;
+  der_put_tlv(spki, 0x30, body.data(), body.length());
+  return spki;
+}
+
+/**
+ * Reads the tag and length of the DER value at `in`, which
+ * must have the tag `tag`. Sets `content` and `len` to its
+ * contents.
+ *
+ * Returns the pointer past the value or nullptr on malformed
+ * input.
+ */
+inline const uint8_t* der_read_tlv(const uint8_t* in,
+                                   const uint8_t* end,
+                                   uint8_t tag,
+                                   const uint8_t*& content,
+                                   size_t& len) noexcept
+{
+  if (end - in < 2 || in[0] != tag) return nullptr;
+
+  len = in[1];
+  in += 2;
+
+  if (len & 0x80) {
+    size_t nbytes = len & 0x7F;
+    if (nbytes == 0 || nbytes > 3 || static_cast<size_t>(end - in) < nbytes) return nullptr;
+
+    len = 0;
+    for (size_t i = 0; i < nbytes; ++i) {
+      len = (len << 8) | in[i];
+    }
+    in += nbytes;
+  }
+
+  if (static_cast<size_t>(end - in) < len) return nullptr;
+
+  content = in;
+  return in + len;
+}
+
+/**
+ * The parts of a `SubjectPublicKeyInfo`. The OID and the
+ * parameters include their tag and length.
+ */
+struct spki_parts
+{
+  const uint8_t* oid = nullptr;
+  size_t oid_len = 0;
+  const uint8_t* params = nullptr;
+  size_t params_len = 0;
+  /// The contents of the BIT STRING, past the unused bits count
+  const uint8_t* key = nullptr;
+  size_t key_len = 0;
+};
+
+/**
+ * Splits a DER encoded `SubjectPublicKeyInfo` into its parts.
+ * Returns false on malformed input or trailing bytes.
+ */
+inline bool der_read_spki(const uint8_t* der, size_t der_len, spki_parts& parts) noexcept
+{
+  const uint8_t* end = der + der_len;
+  const uint8_t* body = nullptr;
+  size_t body_len = 0;
+
+  if (der_read_tlv(der, end, 0x30, body, body_len) != end) return false;
+
+  const uint8_t* body_end = body + body_len;
+  const uint8_t* alg_id = nullptr;
+  size_t alg_id_len = 0;
+
+  const uint8_t* in = der_read_tlv(body, body_end, 0x30, alg_id, alg_id_len);
+  if (!in) return false;
+
+  const uint8_t* bits = nullptr;
+  size_t bits_len = 0;
+  if (der_read_tlv(in, body_end, 0x03, bits, bits_len) != body_end) return false;
+  if (bits_len < 1 || bits[0] != 0x00) return false;
+
+  const uint8_t* alg_end = alg_id + alg_id_len;
+  const uint8_t* oid = nullptr;
+  size_t oid_len = 0;
+
+  const uint8_t* params = der_read_tlv(alg_id, alg_end, 0x06, oid, oid_len);
+  if (!params) return false;
+
+  parts.oid = alg_id;
+  parts.oid_len = static_cast<size_t>(params - alg_id);
+  parts.params = params;
+  parts.params_len = static_cast<size_t>(alg_end - params);
+  parts.key = bits + 1;
+  parts.key_len = bits_len - 1;
+
+  return true;
+}
+
+/**
+ * Reads the modulus and public exponent of an `RSAPublicKey`,
+ * without their sign padding.
+ * Returns false on malformed input.
+ */
+inline bool der_read_rsa_public(const uint8_t* der, size_t der_len,
+                                const uint8_t*& n, size_t& n_len,
+                                const uint8_t*& e, size_t& e_len) noexcept
+{
+  const uint8_t* end = der + der_len;
+  const uint8_t* body = nullptr;
+  size_t body_len = 0;
+
+  if (der_read_tlv(der, end, 0x30, body, body_len) != end) return false;
+
+  const uint8_t* body_end = body + body_len;
+  const uint8_t* in = der_read_tlv(body, body_end, 0x02, n, n_len);
+  if (!in || der_read_tlv(in, body_end, 0x02, e, e_len) != body_end) return false;
+
+  // Negative values are not valid here
+  if (!n_len || !e_len || (n[0] & 0x80) || (e[0] & 0x80)) return false;
+
+  while (n_len > 1 && n[0] == 0x00) { ++n; --n_len; }
+  while (e_len > 1 && e[0] == 0x00) { ++e; --e_len; }
+
+  return true;
+}
+
+} // END namespace detail
+} // END namespace jwt
+
+#endif
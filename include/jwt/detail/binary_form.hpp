@@ -0,0 +1,350 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+#ifndef CPP_JWT_BINARY_FORM_HPP
+#define CPP_JWT_BINARY_FORM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace jwt {
+namespace detail {
+
+/**
+ * A flat, tagged layout for JSON values, used as the body of
+ * the binary forms written by `to_binary` of the JWT components.
+ *
+ * Every value is a tag byte followed by its body. Lengths,
+ * counts and integers are LEB128 varints, signed integers
+ * zigzag encoded first. Reals are the 8 IEEE bytes in little
+ * endian.
+ *
+ *   null, false, true: no body
+ *   unsigned, signed : varint
+ *   real             : 8 bytes
+ *   string           : length, bytes
+ *   array            : count, values
+ *   object           : count, (key length, key, value)...
+ *
+ * JSON text and CBOR both go through the generic SAX parser
+ * of the JSON library. This layout is read straight into the
+ * JSON value instead: lengths are known up front, and object
+ * members, which are written in key order, are appended without
+ * a lookup.
+ *
+ * Strings are not validated as UTF-8 on reading, the layout is
+ * meant for forms written by `to_binary`. Binary JSON values,
+ * which JSON text cannot produce, are written as null.
+ */
+enum class binary_tag: uint8_t
+{
+  NULL_VALUE = 0,
+  FALSE_VALUE,
+  TRUE_VALUE,
+  UNSIGNED,
+  SIGNED,
+  REAL,
+  STRING,
+  ARRAY,
+  OBJECT,
+};
+
+/// Deepest nesting accepted when reading
+constexpr size_t binary_max_depth = 64;
+
+/*!
+ */
+inline void binary_put_tag(std::vector<uint8_t>& out, binary_tag tag)
+{
+  out.push_back(static_cast<uint8_t>(tag));
+}
+
+/*!
+ */
+inline void binary_put_varint(std::vector<uint8_t>& out, uint64_t v)
+{
+  while (v >= 0x80) {
+    out.push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(v));
+}
+
+/*!
+ */
+inline void binary_put_u64(std::vector<uint8_t>& out, uint64_t v)
+{
+  for (size_t i = 0; i < 8; ++i) {
+    out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+  }
+}
+
+/*!
+ */
+inline void binary_put_bytes(std::vector<uint8_t>& out, const char* data, size_t len)
+{
+  binary_put_varint(out, len);
+  out.insert(out.end(),
+             reinterpret_cast<const uint8_t*>(data),
+             reinterpret_cast<const uint8_t*>(data) + len);
+}
+
+/**
+ * Appends the JSON value `j` to `out`.
+ */
+template <typename Json>
+void binary_write(const Json& j, std::vector<uint8_t>& out)
+{
+  using value_t = typename Json::value_t;
+
+  switch (j.type()) {
+  case value_t::boolean:
+    binary_put_tag(out, *j.template get_ptr<const typename Json::boolean_t*>()
+                        ? binary_tag::TRUE_VALUE
+                        : binary_tag::FALSE_VALUE);
+    break;
+  case value_t::number_unsigned:
+    binary_put_tag(out, binary_tag::UNSIGNED);
+    binary_put_varint(out, *j.template get_ptr<const typename Json::number_unsigned_t*>());
+    break;
+  case value_t::number_integer:
+  {
+    int64_t v = *j.template get_ptr<const typename Json::number_integer_t*>();
+    binary_put_tag(out, binary_tag::SIGNED);
+    binary_put_varint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+    break;
+  }
+  case value_t::number_float:
+  {
+    double d = *j.template get_ptr<const typename Json::number_float_t*>();
+    uint64_t bits = 0;
+    std::memcpy(&bits, &d, sizeof(bits));
+    binary_put_tag(out, binary_tag::REAL);
+    binary_put_u64(out, bits);
+    break;
+  }
+  case value_t::string:
+  {
+    const auto& s = *j.template get_ptr<const typename Json::string_t*>();
+    binary_put_tag(out, binary_tag::STRING);
+    binary_put_bytes(out, s.data(), s.length());
+    break;
+  }
+  case value_t::array:
+  {
+    const auto& arr = *j.template get_ptr<const typename Json::array_t*>();
+    binary_put_tag(out, binary_tag::ARRAY);
+    binary_put_varint(out, arr.size());
+    for (const auto& elem : arr) {
+      binary_write(elem, out);
+    }
+    break;
+  }
+  case value_t::object:
+  {
+    const auto& members = *j.template get_ptr<const typename Json::object_t*>();
+    binary_put_tag(out, binary_tag::OBJECT);
+    binary_put_varint(out, members.size());
+    for (const auto& m : members) {
+      binary_put_bytes(out, m.first.data(), m.first.length());
+      binary_write(m.second, out);
+    }
+    break;
+  }
+  default:
+    binary_put_tag(out, binary_tag::NULL_VALUE);
+    break;
+  };
+}
+
+/**
+ * Reads JSON values from a buffer holding the layout.
+ * The buffer must outlive the reader.
+ */
+class binary_reader
+{
+public:
+  binary_reader(const uint8_t* data, size_t len) noexcept
+    : cur_(data)
+    , end_(data + len)
+  {
+  }
+
+  /**
+   * Reads the next value to `out`.
+   * Returns false if the input is malformed.
+   */
+  template <typename Json>
+  bool read(Json& out, size_t depth = 0)
+  {
+    if (cur_ == end_ || depth > binary_max_depth) return false;
+
+    switch (static_cast<binary_tag>(*cur_++)) {
+    case binary_tag::NULL_VALUE:
+      out = nullptr;
+      return true;
+    case binary_tag::FALSE_VALUE:
+      out = false;
+      return true;
+    case binary_tag::TRUE_VALUE:
+      out = true;
+      return true;
+    case binary_tag::UNSIGNED:
+    {
+      uint64_t v = 0;
+      if (!get_varint(v)) return false;
+      out = static_cast<typename Json::number_unsigned_t>(v);
+      return true;
+    }
+    case binary_tag::SIGNED:
+    {
+      uint64_t v = 0;
+      if (!get_varint(v)) return false;
+      out = static_cast<typename Json::number_integer_t>(
+          static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1));
+      return true;
+    }
+    case binary_tag::REAL:
+    {
+      uint64_t v = 0;
+      if (!get_u64(v)) return false;
+      double d = 0;
+      std::memcpy(&d, &v, sizeof(d));
+      out = d;
+      return true;
+    }
+    case binary_tag::STRING:
+    {
+      const char* s = nullptr;
+      size_t len = 0;
+      if (!get_bytes(s, len)) return false;
+      out = typename Json::string_t(s, len);
+      return true;
+    }
+    case binary_tag::ARRAY:
+    {
+      uint64_t count = 0;
+      // Every element takes atleast a byte
+      if (!get_varint(count) || count > remaining()) return false;
+
+      out = Json::array();
+      auto& arr = *out.template get_ptr<typename Json::array_t*>();
+      arr.reserve(count);
+      for (uint64_t i = 0; i < count; ++i) {
+        arr.emplace_back();
+        if (!read(arr.back(), depth + 1)) return false;
+      }
+      return true;
+    }
+    case binary_tag::OBJECT:
+    {
+      uint64_t count = 0;
+      // Every member takes atleast 2 bytes
+      if (!get_varint(count) || count > remaining() / 2) return false;
+
+      out = Json::object();
+      auto& members = *out.template get_ptr<typename Json::object_t*>();
+      for (uint64_t i = 0; i < count; ++i) {
+        const char* key = nullptr;
+        size_t len = 0;
+        if (!get_bytes(key, len)) return false;
+
+        auto itr = members.emplace_hint(members.end(),
+                                        typename Json::object_t::key_type(key, len),
+                                        Json{});
+        if (!read(itr->second, depth + 1)) return false;
+      }
+      return true;
+    }
+    default:
+      return false;
+    };
+  }
+
+  /**
+   * Checks if all the input has been read.
+   */
+  bool at_end() const noexcept
+  {
+    return cur_ == end_;
+  }
+
+public: // Raw reads, for the formats built on the layout
+  /**
+   * Number of bytes left.
+   */
+  size_t remaining() const noexcept
+  {
+    return static_cast<size_t>(end_ - cur_);
+  }
+
+  /**
+   * Reads a varint.
+   */
+  bool get_varint(uint64_t& v) noexcept
+  {
+    v = 0;
+    for (unsigned shift = 0; shift < 64 && cur_ != end_; shift += 7) {
+      uint8_t b = *cur_++;
+      v |= static_cast<uint64_t>(b & 0x7f) << shift;
+      if (!(b & 0x80)) return true;
+    }
+    return false;
+  }
+
+  /**
+   * Reads 8 bytes in little endian.
+   */
+  bool get_u64(uint64_t& v) noexcept
+  {
+    if (remaining() < 8) return false;
+    v = 0;
+    for (size_t i = 0; i < 8; ++i) {
+      v |= static_cast<uint64_t>(cur_[i]) << (8 * i);
+    }
+    cur_ += 8;
+    return true;
+  }
+
+  /**
+   * Reads a varint length and points `data` at that many bytes.
+   */
+  bool get_bytes(const char*& data, size_t& len) noexcept
+  {
+    uint64_t n = 0;
+    if (!get_varint(n) || remaining() < n) return false;
+    len = static_cast<size_t>(n);
+    data = reinterpret_cast<const char*>(cur_);
+    cur_ += len;
+    return true;
+  }
+
+private:
+  const uint8_t* cur_;
+  const uint8_t* end_;
+};
+
+} // END namespace detail
+} // END namespace jwt
+
+#endif
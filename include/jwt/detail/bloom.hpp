@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+#ifndef CPP_JWT_BLOOM_HPP
+#define CPP_JWT_BLOOM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace jwt {
+namespace detail {
+
+/**
+ * A split block Bloom filter over precomputed 64 bit hashes.
+ *
+ * The filter is an array of 64 byte blocks of eight 64 bit words.
+ * A key selects one block and sets one bit in each of its words,
+ * so a lookup touches a single cache line. About 16 bits per key
+ * give a false positive rate in the order of 0.1%.
+ *
+ * The functions work on caller owned (or mapped) words so that
+ * the same layout can be used in memory and on disk.
+ */
+struct block_bloom
+{
+  /// Words per block
+  static constexpr size_t block_words = 8;
+
+  /**
+   * Number of blocks for `n` keys at `bits_per_key`.
+   */
+  static size_t blocks_for(size_t n, size_t bits_per_key = 16) noexcept
+  {
+    size_t blocks = (n * bits_per_key + 511) / 512;
+    return blocks ? blocks : 1;
+  }
+
+  /**
+   * Adds the hash to the filter.
+   */
+  static void add(uint64_t* words, size_t blocks, uint64_t h) noexcept
+  {
+    uint64_t* block = words + block_index(h, blocks) * block_words;
+    const uint64_t bits = mix(h);
+    for (size_t i = 0; i < block_words; ++i) {
+      block[i] |= uint64_t(1) << ((bits >> (6 * i)) & 63);
+    }
+  }
+
+  /**
+   * Returns false if the hash was definitely not added.
+   */
+  static bool may_contain(const uint64_t* words, size_t blocks, uint64_t h) noexcept
+  {
+    const uint64_t* block = words + block_index(h, blocks) * block_words;
+    const uint64_t bits = mix(h);
+    uint64_t miss = 0;
+    for (size_t i = 0; i < block_words; ++i) {
+      miss |= ~block[i] & (uint64_t(1) << ((bits >> (6 * i)) & 63));
+    }
+    return miss == 0;
+  }
+
+private:
+  /*!
+   * Maps the high half of the hash onto [0, blocks)
+   * without a division.
+   */
+  static size_t block_index(uint64_t h, size_t blocks) noexcept
+  {
+    return static_cast<size_t>(((h >> 32) * static_cast<uint64_t>(blocks)) >> 32);
+  }
+
+  /*!
+   * Decorrelates the bit positions from the block index.
+   */
+  static uint64_t mix(uint64_t h) noexcept
+  {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+  }
+};
+
+} // END namespace detail
+} // END namespace jwt
+
+#endif
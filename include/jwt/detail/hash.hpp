@@ -0,0 +1,89 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+#ifndef CPP_JWT_HASH_HPP
+#define CPP_JWT_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace jwt {
+namespace detail {
+
+/**
+ * MurmurHash64A by Austin Appleby (public domain).
+ *
+ * A fast, non-cryptographic 64 bit hash used for indexing
+ * tokens and claims in the in-memory stores. Callers must
+ * never treat a hash match as proof of equality.
+ */
+inline uint64_t hash_bytes(const void* key, size_t len, uint64_t seed = 0) noexcept
+{
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+
+  uint64_t h = seed ^ (len * m);
+
+  const unsigned char* data = static_cast<const unsigned char*>(key);
+  const unsigned char* end = data + (len / 8) * 8;
+
+  while (data != end) {
+    uint64_t k;
+    std::memcpy(&k, data, sizeof(k));
+    data += 8;
+
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+
+    h ^= k;
+    h *= m;
+  }
+
+  switch (len & 7) {
+  case 7: h ^= uint64_t(data[6]) << 48;
+  //FALLTHROUGH
+  case 6: h ^= uint64_t(data[5]) << 40;
+  //FALLTHROUGH
+  case 5: h ^= uint64_t(data[4]) << 32;
+  //FALLTHROUGH
+  case 4: h ^= uint64_t(data[3]) << 24;
+  //FALLTHROUGH
+  case 3: h ^= uint64_t(data[2]) << 16;
+  //FALLTHROUGH
+  case 2: h ^= uint64_t(data[1]) << 8;
+  //FALLTHROUGH
+  case 1: h ^= uint64_t(data[0]);
+          h *= m;
+  };
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+
+  return h;
+}
+
+} // END namespace detail
+} // END namespace jwt
+
+#endif
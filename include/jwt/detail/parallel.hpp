@@ -0,0 +1,77 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_PARALLEL_HPP
+#define CPP_JWT_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace jwt {
+namespace detail {
+
+/**
+ * Calls `fn(i)` for every `i` in [0, count) on up to `threads`
+ * threads, the calling one included. Zero threads means the
+ * number of hardware threads. Returns when all calls are done.
+ *
+ * Items are handed out one at a time, which suits work of
+ * uneven cost such as parsing keys of different types.
+ * `fn` must not throw.
+ */
+template <typename Fn>
+void parallel_for(size_t count, size_t threads, Fn&& fn)
+{
+  if (!threads) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::min(threads, count);
+
+  if (threads <= 1) {
+    for (size_t i = 0; i < count; ++i) fn(i);
+    return;
+  }
+
+  std::atomic<size_t> next{0};
+  auto worker = [count, &next, &fn] {
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count; ) {
+      fn(i);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (size_t i = 1; i < threads; ++i) {
+    workers.emplace_back(worker);
+  }
+  worker();
+
+  for (auto& t : workers) t.join();
+}
+
+} // END namespace detail
+} // END namespace jwt
+
+#endif
@@ -0,0 +1,411 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_SHA256_HPP
+#define CPP_JWT_SHA256_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <openssl/evp.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+# define CPP_JWT_HAS_SHA_NI 1
+# include <immintrin.h>
+# define CPP_JWT_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace jwt {
+namespace detail {
+
+/**
+ * SHA-256 (FIPS 180-4) pieces for the in-tree HMAC paths.
+ *
+ * OpenSSL stays the reference implementation; these exist for
+ * the cases its one message at a time API cannot serve well,
+ * such as hashing many short messages side by side, or a token
+ * of a few hundred bytes whose MAC costs less than the setup of
+ * an OpenSSL HMAC context.
+ */
+
+/// Messages up to this many bytes go through the portable
+/// compression rather than OpenSSL when SHA-NI is missing
+constexpr size_t hmac_portable_max = 1024;
+
+/// The type of the compression functions
+using sha256_compress_t = void (*) (uint32_t state[8], const uint8_t* data, size_t nblocks);
+
+/// Bytes in a SHA-256 block
+constexpr size_t sha256_block_size = 64;
+
+/// Bytes in a SHA-256 digest
+constexpr size_t sha256_digest_size = 32;
+
+/*!
+ */
+alignas(64) constexpr uint32_t sha256_k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/*!
+ */
+constexpr uint32_t sha256_iv[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+/*!
+ */
+inline uint32_t sha256_load_be32(const uint8_t* p) noexcept
+{
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+/*!
+ */
+inline void sha256_store_be32(uint8_t* p, uint32_t v) noexcept
+{
+  p[0] = static_cast<uint8_t>(v >> 24);
+  p[1] = static_cast<uint8_t>(v >> 16);
+  p[2] = static_cast<uint8_t>(v >> 8);
+  p[3] = static_cast<uint8_t>(v);
+}
+
+/*!
+ */
+inline uint32_t sha256_rotr(uint32_t x, unsigned n) noexcept
+{
+  return (x >> n) | (x << (32 - n));
+}
+
+/**
+ * Runs the compression function over `nblocks` blocks.
+ * Portable version.
+ */
+inline void sha256_compress(uint32_t state[8], const uint8_t* data, size_t nblocks) noexcept
+{
+  uint32_t w[64];
+
+  for (; nblocks; --nblocks, data += sha256_block_size) {
+    for (size_t i = 0; i < 16; ++i) {
+      w[i] = sha256_load_be32(data + 4 * i);
+    }
+    for (size_t i = 16; i < 64; ++i) {
+      uint32_t s0 = sha256_rotr(w[i - 15], 7) ^ sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = sha256_rotr(w[i - 2], 17) ^ sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (size_t i = 0; i < 64; ++i) {
+      uint32_t s1 = sha256_rotr(e, 6) ^ sha256_rotr(e, 11) ^ sha256_rotr(e, 25);
+      uint32_t ch = (e & f) ^ (~e & g);
+      uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+      uint32_t s0 = sha256_rotr(a, 2) ^ sha256_rotr(a, 13) ^ sha256_rotr(a, 22);
+      uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+      uint32_t t2 = s0 + maj;
+
+      h = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+  }
+}
+
+#if defined(CPP_JWT_HAS_SHA_NI)
+
+/*!
+ * Four rounds with the message words `w`.
+ */
+CPP_JWT_TARGET("sha,sse4.1")
+inline void sha256_ni_rounds(__m128i& abef, __m128i& cdgh, __m128i w, const uint32_t* k) noexcept
+{
+  const __m128i msg = _mm_add_epi32(w, _mm_load_si128(reinterpret_cast<const __m128i*>(k)));
+  cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+  abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0e));
+}
+
+/*!
+ * The next four message words from the last sixteen.
+ */
+CPP_JWT_TARGET("sha,sse4.1")
+inline __m128i sha256_ni_schedule(__m128i w0, __m128i w1, __m128i w2, __m128i w3) noexcept
+{
+  const __m128i t = _mm_add_epi32(_mm_sha256msg1_epu32(w0, w1), _mm_alignr_epi8(w3, w2, 4));
+  return _mm_sha256msg2_epu32(t, w3);
+}
+
+/**
+ * Runs the compression function over `nblocks` blocks with
+ * the Intel SHA extensions, which do two rounds per
+ * instruction.
+ */
+CPP_JWT_TARGET("sha,sse4.1")
+inline void sha256_ni_compress(uint32_t state[8], const uint8_t* data, size_t nblocks) noexcept
+{
+  const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  // The instructions keep the state as ABEF and CDGH
+  __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xb1);
+  __m128i cdgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1b);
+  __m128i abef = _mm_alignr_epi8(tmp, cdgh, 8);
+  cdgh = _mm_blend_epi16(cdgh, tmp, 0xf0);
+
+  for (; nblocks; --nblocks, data += sha256_block_size) {
+    const __m128i abef_in = abef;
+    const __m128i cdgh_in = cdgh;
+    const __m128i* in = reinterpret_cast<const __m128i*>(data);
+
+    __m128i w0 = _mm_shuffle_epi8(_mm_loadu_si128(in), bswap);
+    __m128i w1 = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), bswap);
+    __m128i w2 = _mm_shuffle_epi8(_mm_loadu_si128(in + 2), bswap);
+    __m128i w3 = _mm_shuffle_epi8(_mm_loadu_si128(in + 3), bswap);
+
+    sha256_ni_rounds(abef, cdgh, w0, sha256_k);
+    sha256_ni_rounds(abef, cdgh, w1, sha256_k + 4);
+    sha256_ni_rounds(abef, cdgh, w2, sha256_k + 8);
+    sha256_ni_rounds(abef, cdgh, w3, sha256_k + 12);
+
+    for (size_t i = 16; i < 64; i += 16) {
+      w0 = sha256_ni_schedule(w0, w1, w2, w3);
+      sha256_ni_rounds(abef, cdgh, w0, sha256_k + i);
+      w1 = sha256_ni_schedule(w1, w2, w3, w0);
+      sha256_ni_rounds(abef, cdgh, w1, sha256_k + i + 4);
+      w2 = sha256_ni_schedule(w2, w3, w0, w1);
+      sha256_ni_rounds(abef, cdgh, w2, sha256_k + i + 8);
+      w3 = sha256_ni_schedule(w3, w0, w1, w2);
+      sha256_ni_rounds(abef, cdgh, w3, sha256_k + i + 12);
+    }
+
+    abef = _mm_add_epi32(abef, abef_in);
+    cdgh = _mm_add_epi32(cdgh, cdgh_in);
+  }
+
+  tmp = _mm_shuffle_epi32(abef, 0x1b);
+  cdgh = _mm_shuffle_epi32(cdgh, 0xb1);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(tmp, cdgh, 0xf0));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(cdgh, tmp, 8));
+}
+
+/**
+ * Checks once if the CPU has the SHA extensions.
+ */
+inline bool sha256_ni_supported() noexcept
+{
+  static const bool supported = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+  }();
+  return supported;
+}
+
+#else
+
+inline bool sha256_ni_supported() noexcept
+{
+  return false;
+}
+
+#endif // CPP_JWT_HAS_SHA_NI
+
+/**
+ * The fastest compression function the CPU can run.
+ */
+inline sha256_compress_t sha256_best_compress() noexcept
+{
+#if defined(CPP_JWT_HAS_SHA_NI)
+  if (sha256_ni_supported()) return sha256_ni_compress;
+#endif
+  return sha256_compress;
+}
+
+/**
+ * Writes the padding which ends a message of `total_len` bytes
+ * whose last `tail_len` bytes (less than a block) are `tail`.
+ * `out` must hold two blocks. Returns the number of blocks
+ * written, one or two.
+ */
+inline size_t sha256_pad_tail(const uint8_t* tail, size_t tail_len,
+                              uint64_t total_len, uint8_t* out) noexcept
+{
+  const size_t nblocks = tail_len < sha256_block_size - 8 ? 1 : 2;
+  const size_t end = nblocks * sha256_block_size;
+
+  if (tail_len) std::memcpy(out, tail, tail_len);
+  out[tail_len] = 0x80;
+  std::memset(out + tail_len + 1, 0, end - tail_len - 1 - 8);
+
+  const uint64_t bits = total_len * 8;
+  for (size_t i = 0; i < 8; ++i) {
+    out[end - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+  }
+  return nblocks;
+}
+
+/**
+ * The state of HMAC-SHA-256 for a key after the inner and
+ * outer pads have gone through the compression function.
+ *
+ * Computed once per key, it saves the two pad blocks on
+ * every MAC.
+ */
+struct hmac_sha256_key
+{
+  /// Bytes in the MAC
+  static constexpr size_t digest_size = sha256_digest_size;
+
+  uint32_t inner[8];
+  uint32_t outer[8];
+
+  /**
+   * Checks if a message of `len` bytes is better served by
+   * `mac` than by OpenSSL: always with SHA-NI, and for short
+   * messages with the portable compression.
+   */
+  static bool preferred(size_t len) noexcept
+  {
+#if defined(CPP_JWT_NO_INLINE_HMAC)
+    (void)len;
+    return false;
+#else
+    return sha256_ni_supported() || len <= hmac_portable_max;
+#endif
+  }
+
+  /**
+   * Sets up the pad states for `key`.
+   * Keys longer than a block are hashed first (RFC 2104).
+   */
+  void init(const void* key, size_t key_len) noexcept
+  {
+    uint8_t k[sha256_block_size] = {};
+
+    if (key_len > sha256_block_size) {
+      unsigned int len = 0;
+      EVP_Digest(key, key_len, k, &len, EVP_sha256(), nullptr);
+    } else if (key_len) {
+      std::memcpy(k, key, key_len);
+    }
+
+    uint8_t pad[sha256_block_size];
+    const sha256_compress_t compress = sha256_best_compress();
+
+    for (size_t i = 0; i < sha256_block_size; ++i) pad[i] = k[i] ^ 0x36;
+    std::memcpy(inner, sha256_iv, sizeof(inner));
+    compress(inner, pad, 1);
+
+    for (size_t i = 0; i < sha256_block_size; ++i) pad[i] = k[i] ^ 0x5c;
+    std::memcpy(outer, sha256_iv, sizeof(outer));
+    compress(outer, pad, 1);
+
+    // Key material on the stack
+    OPENSSL_cleanse(k, sizeof(k));
+    OPENSSL_cleanse(pad, sizeof(pad));
+  }
+
+  /**
+   * Wipes the pad states.
+   */
+  void clear() noexcept
+  {
+    OPENSSL_cleanse(inner, sizeof(inner));
+    OPENSSL_cleanse(outer, sizeof(outer));
+  }
+
+  /**
+   * Writes the MAC of `len` bytes at `data` to `out` with the
+   * fastest compression function the CPU can run.
+   */
+  void mac(const uint8_t* data, size_t len, uint8_t out[sha256_digest_size]) const noexcept;
+};
+
+/**
+ * Writes the block which the outer hash runs over: the inner
+ * digest in `inner` followed by the padding for a message of
+ * one block plus a digest.
+ */
+inline void hmac_sha256_outer_block(const uint32_t inner[8], uint8_t block[sha256_block_size]) noexcept
+{
+  for (size_t i = 0; i < 8; ++i) {
+    sha256_store_be32(block + 4 * i, inner[i]);
+  }
+  block[32] = 0x80;
+  std::memset(block + 33, 0, sha256_block_size - 33 - 8);
+
+  const uint64_t bits = (sha256_block_size + sha256_digest_size) * 8;
+  for (size_t i = 0; i < 8; ++i) {
+    block[sha256_block_size - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+  }
+}
+
+/**
+ * HMAC-SHA-256 of one message with the compression function
+ * `compress`, the portable one by default.
+ */
+inline void hmac_sha256(const hmac_sha256_key& key, const uint8_t* data, size_t len,
+                        uint8_t out[sha256_digest_size],
+                        sha256_compress_t compress = sha256_compress) noexcept
+{
+  uint32_t st[8];
+  std::memcpy(st, key.inner, sizeof(st));
+
+  const size_t full = len / sha256_block_size;
+  compress(st, data, full);
+
+  uint8_t tail[2 * sha256_block_size];
+  const size_t tail_len = len - full * sha256_block_size;
+  compress(st, tail,
+           sha256_pad_tail(data + full * sha256_block_size, tail_len,
+                           sha256_block_size + len, tail));
+
+  uint8_t block[sha256_block_size];
+  hmac_sha256_outer_block(st, block);
+  std::memcpy(st, key.outer, sizeof(st));
+  compress(st, block, 1);
+
+  for (size_t i = 0; i < 8; ++i) {
+    sha256_store_be32(out + 4 * i, st[i]);
+  }
+}
+
+inline void hmac_sha256_key::mac(const uint8_t* data, size_t len,
+                                 uint8_t out[sha256_digest_size]) const noexcept
+{
+  hmac_sha256(*this, data, len, out, sha256_best_compress());
+}
+
+} // END namespace detail
+} // END namespace jwt
+
+#endif
@@ -0,0 +1,393 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_SHA256_MB_HPP
+#define CPP_JWT_SHA256_MB_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "jwt/string_view.hpp"
+#include "jwt/detail/sha256.hpp"
+
+#if defined(CPP_JWT_TARGET)
+# define CPP_JWT_HAS_SHA256_MB 1
+#endif
+
+namespace jwt {
+namespace detail {
+
+/**
+ * Multi-buffer SHA-256: the compression function runs on
+ * several independent messages at once, one per SIMD lane,
+ * with the state and message words of lane `l` in element `l`
+ * of the vectors.
+ *
+ * A single SHA-256 is a serial chain of rounds which leaves
+ * most of a vector unit idle. Messages of different tokens do
+ * not depend on each other, so 4 (SSSE3) or 8 (AVX2) of them
+ * go through the same rounds side by side.
+ *
+ * The kernels are compiled for their instruction set with
+ * target attributes and picked at runtime, so the library does
+ * not need to be built with -mavx2.
+ */
+enum class sha256_mb_kernel
+{
+  // No SIMD kernel for this CPU or compiler
+  NONE = 0,
+  // 4 lanes of 128 bit vectors
+  X4_SSSE3,
+  // 8 lanes of 256 bit vectors
+  X8_AVX2,
+};
+
+#if defined(CPP_JWT_HAS_SHA256_MB)
+
+/*!
+ */
+CPP_JWT_TARGET("ssse3")
+inline __m128i sha256_x4_rotr(__m128i x, int n) noexcept
+{
+  return _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n));
+}
+
+/**
+ * Runs the compression function over one block for each of
+ * 4 lanes. `st` holds the states transposed, word major.
+ */
+CPP_JWT_TARGET("ssse3")
+inline void sha256_x4_compress(uint32_t (*st)[4], const uint8_t* const blocks[4]) noexcept
+{
+  const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+  __m128i w[64];
+
+  for (size_t k = 0; k < 4; ++k) {
+    __m128i r0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks[0] + 16 * k)), bswap);
+    __m128i r1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks[1] + 16 * k)), bswap);
+    __m128i r2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks[2] + 16 * k)), bswap);
+    __m128i r3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks[3] + 16 * k)), bswap);
+
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    __m128i t1 = _mm_unpackhi_epi32(r0, r1);
+    __m128i t2 = _mm_unpacklo_epi32(r2, r3);
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+    w[4 * k + 0] = _mm_unpacklo_epi64(t0, t2);
+    w[4 * k + 1] = _mm_unpackhi_epi64(t0, t2);
+    w[4 * k + 2] = _mm_unpacklo_epi64(t1, t3);
+    w[4 * k + 3] = _mm_unpackhi_epi64(t1, t3);
+  }
+
+  for (size_t i = 16; i < 64; ++i) {
+    __m128i s0 = _mm_xor_si128(_mm_xor_si128(sha256_x4_rotr(w[i - 15], 7), sha256_x4_rotr(w[i - 15], 18)),
+                               _mm_srli_epi32(w[i - 15], 3));
+    __m128i s1 = _mm_xor_si128(_mm_xor_si128(sha256_x4_rotr(w[i - 2], 17), sha256_x4_rotr(w[i - 2], 19)),
+                               _mm_srli_epi32(w[i - 2], 10));
+    w[i] = _mm_add_epi32(_mm_add_epi32(w[i - 16], s0), _mm_add_epi32(w[i - 7], s1));
+  }
+
+  __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(st[0]));
+  __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(st[1]));
+  __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(st[2]));
+  __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(st[3]));
+  __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(st[4]));
+  __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(st[5]));
+  __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(st[6]));
+  __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(st[7]));
+
+  for (size_t i = 0; i < 64; ++i) {
+    __m128i s1 = _mm_xor_si128(_mm_xor_si128(sha256_x4_rotr(e, 6), sha256_x4_rotr(e, 11)),
+                               sha256_x4_rotr(e, 25));
+    __m128i ch = _mm_xor_si128(_mm_and_si128(e, f), _mm_andnot_si128(e, g));
+    __m128i t1 = _mm_add_epi32(_mm_add_epi32(h, s1),
+                               _mm_add_epi32(_mm_add_epi32(ch, _mm_set1_epi32(static_cast<int>(sha256_k[i]))), w[i]));
+    __m128i s0 = _mm_xor_si128(_mm_xor_si128(sha256_x4_rotr(a, 2), sha256_x4_rotr(a, 13)),
+                               sha256_x4_rotr(a, 22));
+    __m128i maj = _mm_or_si128(_mm_and_si128(a, b), _mm_and_si128(c, _mm_or_si128(a, b)));
+    __m128i t2 = _mm_add_epi32(s0, maj);
+
+    h = g; g = f; f = e; e = _mm_add_epi32(d, t1);
+    d = c; c = b; b = a; a = _mm_add_epi32(t1, t2);
+  }
+
+  __m128i* out = reinterpret_cast<__m128i*>(st);
+  _mm_storeu_si128(out + 0, _mm_add_epi32(a, _mm_loadu_si128(out + 0)));
+  _mm_storeu_si128(out + 1, _mm_add_epi32(b, _mm_loadu_si128(out + 1)));
+  _mm_storeu_si128(out + 2, _mm_add_epi32(c, _mm_loadu_si128(out + 2)));
+  _mm_storeu_si128(out + 3, _mm_add_epi32(d, _mm_loadu_si128(out + 3)));
+  _mm_storeu_si128(out + 4, _mm_add_epi32(e, _mm_loadu_si128(out + 4)));
+  _mm_storeu_si128(out + 5, _mm_add_epi32(f, _mm_loadu_si128(out + 5)));
+  _mm_storeu_si128(out + 6, _mm_add_epi32(g, _mm_loadu_si128(out + 6)));
+  _mm_storeu_si128(out + 7, _mm_add_epi32(h, _mm_loadu_si128(out + 7)));
+}
+
+/*!
+ */
+CPP_JWT_TARGET("avx2")
+inline __m256i sha256_x8_rotr(__m256i x, int n) noexcept
+{
+  return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+/*!
+ * Loads 16 bytes of the blocks of lanes `l` and `l + 4`
+ * into the low and high halves of a vector.
+ */
+CPP_JWT_TARGET("avx2")
+inline __m256i sha256_x8_load(const uint8_t* const blocks[8], size_t l, size_t off) noexcept
+{
+  __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks[l] + off));
+  __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks[l + 4] + off));
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+/**
+ * Runs the compression function over one block for each of
+ * 8 lanes. `st` holds the states transposed, word major.
+ */
+CPP_JWT_TARGET("avx2")
+inline void sha256_x8_compress(uint32_t (*st)[8], const uint8_t* const blocks[8]) noexcept
+{
+  const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                        12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+  __m256i w[64];
+
+  // The unpacks work within each half, which holds lanes
+  // 0-3 in the low one and 4-7 in the high one
+  for (size_t k = 0; k < 4; ++k) {
+    __m256i r0 = _mm256_shuffle_epi8(sha256_x8_load(blocks, 0, 16 * k), bswap);
+    __m256i r1 = _mm256_shuffle_epi8(sha256_x8_load(blocks, 1, 16 * k), bswap);
+    __m256i r2 = _mm256_shuffle_epi8(sha256_x8_load(blocks, 2, 16 * k), bswap);
+    __m256i r3 = _mm256_shuffle_epi8(sha256_x8_load(blocks, 3, 16 * k), bswap);
+
+    __m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+    __m256i t1 = _mm256_unpackhi_epi32(r0, r1);
+    __m256i t2 = _mm256_unpacklo_epi32(r2, r3);
+    __m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+
+    w[4 * k + 0] = _mm256_unpacklo_epi64(t0, t2);
+    w[4 * k + 1] = _mm256_unpackhi_epi64(t0, t2);
+    w[4 * k + 2] = _mm256_unpacklo_epi64(t1, t3);
+    w[4 * k + 3] = _mm256_unpackhi_epi64(t1, t3);
+  }
+
+  for (size_t i = 16; i < 64; ++i) {
+    __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(sha256_x8_rotr(w[i - 15], 7), sha256_x8_rotr(w[i - 15], 18)),
+                                  _mm256_srli_epi32(w[i - 15], 3));
+    __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(sha256_x8_rotr(w[i - 2], 17), sha256_x8_rotr(w[i - 2], 19)),
+                                  _mm256_srli_epi32(w[i - 2], 10));
+    w[i] = _mm256_add_epi32(_mm256_add_epi32(w[i - 16], s0), _mm256_add_epi32(w[i - 7], s1));
+  }
+
+  __m256i* io = reinterpret_cast<__m256i*>(st);
+  __m256i a = _mm256_loadu_si256(io + 0);
+  __m256i b = _mm256_loadu_si256(io + 1);
+  __m256i c = _mm256_loadu_si256(io + 2);
+  __m256i d = _mm256_loadu_si256(io + 3);
+  __m256i e = _mm256_loadu_si256(io + 4);
+  __m256i f = _mm256_loadu_si256(io + 5);
+  __m256i g = _mm256_loadu_si256(io + 6);
+  __m256i h = _mm256_loadu_si256(io + 7);
+
+  for (size_t i = 0; i < 64; ++i) {
+    __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(sha256_x8_rotr(e, 6), sha256_x8_rotr(e, 11)),
+                                  sha256_x8_rotr(e, 25));
+    __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+    __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, s1),
+                                  _mm256_add_epi32(_mm256_add_epi32(ch, _mm256_set1_epi32(static_cast<int>(sha256_k[i]))), w[i]));
+    __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(sha256_x8_rotr(a, 2), sha256_x8_rotr(a, 13)),
+                                  sha256_x8_rotr(a, 22));
+    __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+    __m256i t2 = _mm256_add_epi32(s0, maj);
+
+    h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+    d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+  }
+
+  _mm256_storeu_si256(io + 0, _mm256_add_epi32(a, _mm256_loadu_si256(io + 0)));
+  _mm256_storeu_si256(io + 1, _mm256_add_epi32(b, _mm256_loadu_si256(io + 1)));
+  _mm256_storeu_si256(io + 2, _mm256_add_epi32(c, _mm256_loadu_si256(io + 2)));
+  _mm256_storeu_si256(io + 3, _mm256_add_epi32(d, _mm256_loadu_si256(io + 3)));
+  _mm256_storeu_si256(io + 4, _mm256_add_epi32(e, _mm256_loadu_si256(io + 4)));
+  _mm256_storeu_si256(io + 5, _mm256_add_epi32(f, _mm256_loadu_si256(io + 5)));
+  _mm256_storeu_si256(io + 6, _mm256_add_epi32(g, _mm256_loadu_si256(io + 6)));
+  _mm256_storeu_si256(io + 7, _mm256_add_epi32(h, _mm256_loadu_si256(io + 7)));
+
+  // Avoids the AVX-SSE transition penalty in the caller
+  _mm256_zeroupper();
+}
+
+/**
+ * Computes the HMACs of `count` messages with `Lanes` of them
+ * in flight at once, refilling a lane with the next message as
+ * soon as its current one is done. `compress` is the kernel.
+ */
+template <size_t Lanes, typename Compress>
+void hmac_sha256_lanes(const hmac_sha256_key& key,
+                       const jwt::string_view* msgs,
+                       size_t count,
+                       uint8_t (*out)[sha256_digest_size],
+                       Compress compress) noexcept
+{
+  /// No message; the block of an idle lane
+  constexpr size_t idle = static_cast<size_t>(-1);
+  static const uint8_t idle_block[sha256_block_size] = {};
+
+  struct lane
+  {
+    size_t msg = idle;
+    size_t block = 0;
+    /// Blocks read straight from the message
+    size_t full = 0;
+    /// Blocks of the inner hash, then one of the outer
+    size_t nblocks = 0;
+    uint8_t tail[2 * sha256_block_size];
+  };
+
+  alignas(32) uint32_t st[8][Lanes];
+  lane lanes[Lanes];
+  const uint8_t* blocks[Lanes];
+
+  size_t next = 0;
+  size_t active = 0;
+
+  auto set_state = [&st](size_t l, const uint32_t from[8]) {
+    for (size_t i = 0; i < 8; ++i) st[i][l] = from[i];
+  };
+
+  auto start = [&](size_t l) {
+    lane& ln = lanes[l];
+    if (next == count) {
+      ln.msg = idle;
+      return;
+    }
+
+    ln.msg = next++;
+    const auto data = reinterpret_cast<const uint8_t*>(msgs[ln.msg].data());
+    const size_t len = msgs[ln.msg].length();
+
+    ln.block = 0;
+    ln.full = len / sha256_block_size;
+    ln.nblocks = ln.full + sha256_pad_tail(data + ln.full * sha256_block_size,
+                                           len - ln.full * sha256_block_size,
+                                           sha256_block_size + len, ln.tail);
+    set_state(l, key.inner);
+    ++active;
+  };
+
+  for (size_t l = 0; l < Lanes; ++l) start(l);
+
+  while (active) {
+    for (size_t l = 0; l < Lanes; ++l) {
+      const lane& ln = lanes[l];
+      if (ln.msg == idle) {
+        blocks[l] = idle_block;
+      } else if (ln.block < ln.full) {
+        blocks[l] = reinterpret_cast<const uint8_t*>(msgs[ln.msg].data()) + ln.block * sha256_block_size;
+      } else if (ln.block < ln.nblocks) {
+        blocks[l] = ln.tail + (ln.block - ln.full) * sha256_block_size;
+      } else {
+        // The outer block, written over the tail
+        blocks[l] = ln.tail;
+      }
+    }
+
+    compress(st, blocks);
+
+    for (size_t l = 0; l < Lanes; ++l) {
+      lane& ln = lanes[l];
+      if (ln.msg == idle) continue;
+
+      uint32_t digest[8];
+      for (size_t i = 0; i < 8; ++i) digest[i] = st[i][l];
+
+      if (++ln.block == ln.nblocks) {
+        // Inner hash done, the outer one is a single block
+        hmac_sha256_outer_block(digest, ln.tail);
+        set_state(l, key.outer);
+      } else if (ln.block > ln.nblocks) {
+        for (size_t i = 0; i < 8; ++i) {
+          sha256_store_be32(out[ln.msg] + 4 * i, digest[i]);
+        }
+        --active;
+        start(l);
+      }
+    }
+  }
+}
+
+/**
+ * The best kernel for the CPU running the process.
+ */
+inline sha256_mb_kernel sha256_mb_best_kernel() noexcept
+{
+  static const sha256_mb_kernel best = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return sha256_mb_kernel::X8_AVX2;
+    if (__builtin_cpu_supports("ssse3")) return sha256_mb_kernel::X4_SSSE3;
+    return sha256_mb_kernel::NONE;
+  }();
+  return best;
+}
+
+#else
+
+inline sha256_mb_kernel sha256_mb_best_kernel() noexcept
+{
+  return sha256_mb_kernel::NONE;
+}
+
+#endif // CPP_JWT_HAS_SHA256_MB
+
+/**
+ * Computes the HMAC-SHA-256 of `count` messages with the same
+ * key using the multi-buffer kernel `kernel`, which must be
+ * supported by the CPU.
+ *
+ * Returns false, computing nothing, for `sha256_mb_kernel::NONE`.
+ */
+inline bool hmac_sha256_batch(const hmac_sha256_key& key,
+                              const jwt::string_view* msgs,
+                              size_t count,
+                              uint8_t (*out)[sha256_digest_size],
+                              sha256_mb_kernel kernel = sha256_mb_best_kernel()) noexcept
+{
+  switch (kernel) {
+#if defined(CPP_JWT_HAS_SHA256_MB)
+    case sha256_mb_kernel::X8_AVX2:
+      hmac_sha256_lanes<8>(key, msgs, count, out, sha256_x8_compress);
+      return true;
+    case sha256_mb_kernel::X4_SSSE3:
+      hmac_sha256_lanes<4>(key, msgs, count, out, sha256_x4_compress);
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+} // END namespace detail
+} // END namespace jwt
+
+#endif
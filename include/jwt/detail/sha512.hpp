@@ -0,0 +1,298 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_SHA512_HPP
+#define CPP_JWT_SHA512_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <openssl/evp.h>
+
+#include "jwt/detail/sha256.hpp"
+
+namespace jwt {
+namespace detail {
+
+/**
+ * SHA-512 and SHA-384 (FIPS 180-4) for the in-tree HMAC path
+ * of HS384 and HS512.
+ *
+ * The SHA extensions of most x86 CPUs only cover SHA-256, so
+ * there is only the portable compression here. It is used for
+ * messages of up to `hmac_portable_max` bytes, where the fixed
+ * cost of an OpenSSL HMAC call outweighs its faster assembly.
+ */
+
+/// Bytes in a SHA-512 block
+constexpr size_t sha512_block_size = 128;
+
+/*!
+ */
+alignas(64) constexpr uint64_t sha512_k[80] = {
+  0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+  0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+  0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+  0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+  0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+  0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+  0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+  0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+  0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+  0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+  0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+  0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+  0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+  0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+  0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+  0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+  0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+  0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+  0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+  0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+/*!
+ */
+constexpr uint64_t sha512_iv[8] = {
+  0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+  0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+/*!
+ */
+constexpr uint64_t sha384_iv[8] = {
+  0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL, 0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+  0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL, 0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL,
+};
+
+/*!
+ */
+inline uint64_t sha512_load_be64(const uint8_t* p) noexcept
+{
+  return (static_cast<uint64_t>(sha256_load_be32(p)) << 32) | sha256_load_be32(p + 4);
+}
+
+/*!
+ */
+inline void sha512_store_be64(uint8_t* p, uint64_t v) noexcept
+{
+  sha256_store_be32(p, static_cast<uint32_t>(v >> 32));
+  sha256_store_be32(p + 4, static_cast<uint32_t>(v));
+}
+
+/*!
+ */
+inline uint64_t sha512_rotr(uint64_t x, unsigned n) noexcept
+{
+  return (x >> n) | (x << (64 - n));
+}
+
+/*!
+ * One round. The caller rotates the roles of the working
+ * variables instead of moving them.
+ */
+inline void sha512_round(uint64_t a, uint64_t b, uint64_t c, uint64_t& d,
+                         uint64_t e, uint64_t f, uint64_t g, uint64_t& h,
+                         uint64_t kw) noexcept
+{
+  const uint64_t t1 = h + (sha512_rotr(e, 14) ^ sha512_rotr(e, 18) ^ sha512_rotr(e, 41)) +
+                      ((e & f) ^ (~e & g)) + kw;
+  const uint64_t t2 = (sha512_rotr(a, 28) ^ sha512_rotr(a, 34) ^ sha512_rotr(a, 39)) +
+                      ((a & b) ^ (a & c) ^ (b & c));
+  d += t1;
+  h = t1 + t2;
+}
+
+/**
+ * Runs the compression function over `nblocks` blocks.
+ */
+inline void sha512_compress(uint64_t state[8], const uint8_t* data, size_t nblocks) noexcept
+{
+  uint64_t w[80];
+
+  for (; nblocks; --nblocks, data += sha512_block_size) {
+    for (size_t i = 0; i < 16; ++i) {
+      w[i] = sha512_load_be64(data + 8 * i);
+    }
+    for (size_t i = 16; i < 80; ++i) {
+      uint64_t s0 = sha512_rotr(w[i - 15], 1) ^ sha512_rotr(w[i - 15], 8) ^ (w[i - 15] >> 7);
+      uint64_t s1 = sha512_rotr(w[i - 2], 19) ^ sha512_rotr(w[i - 2], 61) ^ (w[i - 2] >> 6);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (size_t i = 0; i < 80; i += 8) {
+      sha512_round(a, b, c, d, e, f, g, h, sha512_k[i] + w[i]);
+      sha512_round(h, a, b, c, d, e, f, g, sha512_k[i + 1] + w[i + 1]);
+      sha512_round(g, h, a, b, c, d, e, f, sha512_k[i + 2] + w[i + 2]);
+      sha512_round(f, g, h, a, b, c, d, e, sha512_k[i + 3] + w[i + 3]);
+      sha512_round(e, f, g, h, a, b, c, d, sha512_k[i + 4] + w[i + 4]);
+      sha512_round(d, e, f, g, h, a, b, c, sha512_k[i + 5] + w[i + 5]);
+      sha512_round(c, d, e, f, g, h, a, b, sha512_k[i + 6] + w[i + 6]);
+      sha512_round(b, c, d, e, f, g, h, a, sha512_k[i + 7] + w[i + 7]);
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+  }
+}
+
+/**
+ * Writes the padding which ends a message of `total_len` bytes
+ * whose last `tail_len` bytes (less than a block) are `tail`.
+ * `out` must hold two blocks. Returns the number of blocks
+ * written, one or two.
+ */
+inline size_t sha512_pad_tail(const uint8_t* tail, size_t tail_len,
+                              uint64_t total_len, uint8_t* out) noexcept
+{
+  const size_t nblocks = tail_len < sha512_block_size - 16 ? 1 : 2;
+  const size_t end = nblocks * sha512_block_size;
+
+  // `tail` may already be in place in `out`
+  if (tail_len) std::memmove(out, tail, tail_len);
+  out[tail_len] = 0x80;
+  std::memset(out + tail_len + 1, 0, end - tail_len - 1 - 8);
+
+  // The upper half of the 128 bit length is always zero here
+  sha512_store_be64(out + end - 8, total_len * 8);
+  return nblocks;
+}
+
+/**
+ * The state of HMAC-SHA-384 (`DigestSize` 48) or HMAC-SHA-512
+ * (`DigestSize` 64) for a key after the inner and outer pads
+ * have gone through the compression function.
+ * See `hmac_sha256_key`.
+ */
+template <size_t DigestSize>
+struct basic_hmac_sha512_key
+{
+  static_assert(DigestSize == 48 || DigestSize == 64, "SHA-384 or SHA-512 only");
+
+  /// Bytes in the MAC
+  static constexpr size_t digest_size = DigestSize;
+
+  uint64_t inner[8];
+  uint64_t outer[8];
+
+  /**
+   * Checks if a message of `len` bytes is better served by
+   * `mac` than by OpenSSL.
+   */
+  static bool preferred(size_t len) noexcept
+  {
+#if defined(CPP_JWT_NO_INLINE_HMAC)
+    (void)len;
+    return false;
+#else
+    return len <= hmac_portable_max;
+#endif
+  }
+
+  /**
+   * Sets up the pad states for `key`.
+   * Keys longer than a block are hashed first (RFC 2104).
+   */
+  void init(const void* key, size_t key_len) noexcept
+  {
+    uint8_t k[sha512_block_size] = {};
+
+    if (key_len > sha512_block_size) {
+      unsigned int len = 0;
+      EVP_Digest(key, key_len, k, &len,
+                 DigestSize == 48 ? EVP_sha384() : EVP_sha512(), nullptr);
+    } else if (key_len) {
+      std::memcpy(k, key, key_len);
+    }
+
+    const uint64_t* iv = DigestSize == 48 ? sha384_iv : sha512_iv;
+    uint8_t pad[sha512_block_size];
+
+    for (size_t i = 0; i < sha512_block_size; ++i) pad[i] = k[i] ^ 0x36;
+    std::memcpy(inner, iv, sizeof(inner));
+    sha512_compress(inner, pad, 1);
+
+    for (size_t i = 0; i < sha512_block_size; ++i) pad[i] = k[i] ^ 0x5c;
+    std::memcpy(outer, iv, sizeof(outer));
+    sha512_compress(outer, pad, 1);
+
+    // Key material on the stack
+    OPENSSL_cleanse(k, sizeof(k));
+    OPENSSL_cleanse(pad, sizeof(pad));
+  }
+
+  /**
+   * Wipes the pad states.
+   */
+  void clear() noexcept
+  {
+    OPENSSL_cleanse(inner, sizeof(inner));
+    OPENSSL_cleanse(outer, sizeof(outer));
+  }
+
+  /**
+   * Writes the MAC of `len` bytes at `data` to `out`.
+   */
+  void mac(const uint8_t* data, size_t len, uint8_t out[DigestSize]) const noexcept
+  {
+    uint64_t st[8];
+    std::memcpy(st, inner, sizeof(st));
+
+    const size_t full = len / sha512_block_size;
+    sha512_compress(st, data, full);
+
+    uint8_t tail[2 * sha512_block_size];
+    const size_t tail_len = len - full * sha512_block_size;
+    sha512_compress(st, tail,
+                    sha512_pad_tail(data + full * sha512_block_size, tail_len,
+                                    sha512_block_size + len, tail));
+
+    // The outer hash runs over the inner digest
+    uint8_t block[2 * sha512_block_size];
+    for (size_t i = 0; i < DigestSize / 8; ++i) {
+      sha512_store_be64(block + 8 * i, st[i]);
+    }
+    std::memcpy(st, outer, sizeof(st));
+    sha512_compress(st, block,
+                    sha512_pad_tail(block, DigestSize, sha512_block_size + DigestSize, block));
+
+    for (size_t i = 0; i < DigestSize / 8; ++i) {
+      sha512_store_be64(out + 8 * i, st[i]);
+    }
+  }
+};
+
+/// HMAC-SHA-384 key state
+using hmac_sha384_key = basic_hmac_sha512_key<48>;
+
+/// HMAC-SHA-512 key state
+using hmac_sha512_key = basic_hmac_sha512_key<64>;
+
+} // END namespace detail
+} // END namespace jwt
+
+#endif
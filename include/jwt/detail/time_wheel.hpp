@@ -0,0 +1,224 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+#ifndef CPP_JWT_TIME_WHEEL_HPP
+#define CPP_JWT_TIME_WHEEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace jwt {
+namespace detail {
+
+/**
+ * A hierarchical timing wheel with a resolution of one second.
+ *
+ * Items are scheduled at an absolute expiry time (seconds since
+ * epoch) and handed back to the caller once `advance` moves the
+ * wheel past that time. Each level has 64 slots, so the four levels
+ * cover about 194 days. Items further out are parked in an overflow
+ * list which is looked at again each time the top level turns.
+ *
+ * Scheduling is O(1) and advancing costs O(1) per elapsed second
+ * plus O(1) per expired or cascaded item.
+ *
+ * Not thread safe. The stores using it guard it with their own lock.
+ */
+template <typename T>
+class time_wheel
+{
+public: // 'tors
+  /**
+   * Creates a wheel whose current time is `now`.
+   */
+  explicit time_wheel(uint64_t now = 0) noexcept
+    : now_(now)
+  {
+  }
+
+public: // Exposed APIs
+  /**
+   * The current time of the wheel.
+   */
+  uint64_t now() const noexcept
+  {
+    return now_;
+  }
+
+  /**
+   * Number of scheduled items.
+   */
+  size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  /**
+   * Schedules `item` to expire at `expiry`.
+   * Items with an expiry at or before the current time
+   * expire on the next advance.
+   */
+  void schedule(uint64_t expiry, T item)
+  {
+    place(expiry, std::move(item), now_ + 1);
+    ++size_;
+  }
+
+  /**
+   * Moves the wheel to `now` and calls `fn(item, expiry)`
+   * for every item which expired on the way.
+   */
+  template <typename F>
+  void advance(uint64_t now, F&& fn);
+
+  /**
+   * Drops all the scheduled items.
+   */
+  void clear() noexcept
+  {
+    for (auto& level : buckets_) {
+      for (auto& bucket : level) bucket.clear();
+    }
+    overflow_.clear();
+    size_ = 0;
+  }
+
+private: // Private APIs
+  /// Slots per level is 2^bits
+  static constexpr unsigned bits = 6;
+  static constexpr unsigned slots = 1u << bits;
+  static constexpr unsigned levels = 4;
+
+  using bucket_type = std::vector<std::pair<uint64_t, T>>;
+
+  /*!
+   * Puts the item in the bucket covering `max(expiry, floor)`.
+   */
+  void place(uint64_t expiry, T item, uint64_t floor);
+
+  /*!
+   * Re-places every item of a bucket relative to the current time.
+   */
+  template <typename F>
+  void cascade(bucket_type& bucket, F& fn);
+
+private: // Data members
+  /// Current time
+  uint64_t now_ = 0;
+
+  /// Number of scheduled items
+  size_t size_ = 0;
+
+  /// The wheels
+  bucket_type buckets_[levels][slots];
+
+  /// Items beyond the span of the wheels
+  bucket_type overflow_;
+};
+
+template <typename T>
+void time_wheel<T>::place(uint64_t expiry, T item, uint64_t floor)
+{
+  uint64_t t = expiry < floor ? floor : expiry;
+
+  const unsigned span_bits = bits * levels;
+  if ((t >> span_bits) != (now_ >> span_bits)) {
+    overflow_.emplace_back(expiry, std::move(item));
+    return;
+  }
+
+  unsigned level = 0;
+  while (level + 1 < levels &&
+         (t >> (bits * (level + 1))) != (now_ >> (bits * (level + 1)))) {
+    ++level;
+  }
+
+  auto slot = (t >> (bits * level)) & (slots - 1);
+  buckets_[level][slot].emplace_back(expiry, std::move(item));
+}
+
+template <typename T>
+template <typename F>
+void time_wheel<T>::cascade(bucket_type& bucket, F& fn)
+{
+  bucket_type items;
+  items.swap(bucket);
+
+  for (auto& elem : items) {
+    if (elem.first <= now_) {
+      --size_;
+      fn(elem.second, elem.first);
+    } else {
+      place(elem.first, std::move(elem.second), now_);
+    }
+  }
+}
+
+template <typename T>
+template <typename F>
+void time_wheel<T>::advance(uint64_t now, F&& fn)
+{
+  if (now <= now_) return;
+
+  // After a long gap it is cheaper to re-place everything once
+  // than to step through each second.
+  if (now - now_ > slots * slots) {
+    now_ = now;
+    if (!overflow_.empty()) cascade(overflow_, fn);
+    for (auto& level : buckets_) {
+      for (auto& bucket : level) {
+        if (!bucket.empty()) cascade(bucket, fn);
+      }
+    }
+    return;
+  }
+
+  while (now_ < now) {
+    ++now_;
+
+    // Pull down the buckets of the higher levels whose
+    // time range starts at this second.
+    unsigned top = 0;
+    while (top + 1 < levels &&
+           ((now_ >> (bits * (top + 1))) << (bits * (top + 1))) == now_) {
+      ++top;
+    }
+    if (top == levels - 1 && !overflow_.empty()) {
+      cascade(overflow_, fn);
+    }
+    for (unsigned level = top; level > 0; --level) {
+      auto slot = (now_ >> (bits * level)) & (slots - 1);
+      if (!buckets_[level][slot].empty()) {
+        cascade(buckets_[level][slot], fn);
+      }
+    }
+
+    auto& bucket = buckets_[0][now_ & (slots - 1)];
+    if (!bucket.empty()) cascade(bucket, fn);
+  }
+}
+
+} // END namespace detail
+} // END namespace jwt
+
+#endif
@@ -0,0 +1,213 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_EC_NONCE_POOL_HPP
+#define CPP_JWT_EC_NONCE_POOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#if defined(__linux__)
+# include <pthread.h>
+# include <sched.h>
+#endif
+
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+
+#include "jwt/algorithm.hpp"
+#include "jwt/string_view.hpp"
+
+// The pool works on the EC_KEY level, deprecated in OpenSSL 3
+// but there is no EVP interface to split off the nonce
+#if !defined(OPENSSL_NO_DEPRECATED_3_0)
+# define CPP_JWT_HAS_EC_NONCE_POOL 1
+#endif
+
+#if defined(CPP_JWT_HAS_EC_NONCE_POOL)
+
+namespace jwt {
+
+/**
+ * A bounded pool of precomputed ECDSA nonces for one private
+ * key, kept full by a background thread.
+ *
+ * Most of the cost of an ECDSA signature is the point `k·G`
+ * for its random nonce `k`, which does not depend on the data
+ * being signed. The pool computes `(k^-1, r)` pairs ahead with
+ * `ECDSA_sign_setup` while the signer is idle, and `sign` only
+ * does the scalar arithmetic left with `ECDSA_do_sign_ex`.
+ *
+ * Each pair is taken out of the pool under a lock, used for one
+ * signature and wiped, so no nonce is ever used twice. When a
+ * burst empties the pool, signing computes a fresh nonce inline
+ * as usual until the thread catches up.
+ *
+ * The thread sleeps until half of the pool is used, then tops
+ * it up again. On Linux it runs under SCHED_IDLE, so it only
+ * gets a CPU which nothing else wants.
+ *
+ * Usually made through `jwt::key::with_nonce_pool`.
+ */
+class ec_nonce_pool
+{
+public: // 'tors
+  /**
+   * Constructs a pool of up to `capacity` nonces for the EC
+   * private key `pkey`. Nothing is computed until `start`.
+   */
+  ec_nonce_pool(EVP_PKEY* pkey, size_t capacity);
+
+  /**
+   * Stops the background thread and wipes the unused nonces.
+   */
+  ~ec_nonce_pool();
+
+  /// The pool is not copyable nor movable
+  ec_nonce_pool(const ec_nonce_pool&) = delete;
+  ec_nonce_pool& operator=(const ec_nonce_pool&) = delete;
+
+public: // Exposed APIs
+  /**
+   * Starts the background thread filling the pool.
+   * Sets InvalidKeyErr in `ec` if the key is not an EC private
+   * key. Does nothing if the thread is running already.
+   */
+  void start(std::error_code& ec);
+
+  /**
+   * Exception throwing version of `start`.
+   * Throws `InvalidKeyError`.
+   */
+  void start();
+
+  /**
+   * Stops the background thread, if any. The nonces computed
+   * so far stay available.
+   */
+  void stop();
+
+  /**
+   * Checks if the background thread is running.
+   */
+  bool running() const noexcept
+  {
+    return filler_.joinable();
+  }
+
+  /**
+   * Most nonces kept in the pool.
+   */
+  size_t capacity() const noexcept
+  {
+    return capacity_;
+  }
+
+  /**
+   * Number of nonces ready for signing.
+   */
+  size_t available() const
+  {
+    std::lock_guard<std::mutex> lk{mtx_};
+    return pairs_.size();
+  }
+
+  /**
+   * Number of signatures which found the pool empty and
+   * computed their nonce inline.
+   */
+  uint64_t misses() const noexcept
+  {
+    return misses_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Signs `data` hashed with `md`, returning the signature in
+   * the raw `r || s` form of JWS.
+   * Sets SigningErr if the key cannot be used.
+   */
+  sign_result_t sign(const EVP_MD* md, const jwt::string_view data);
+
+private: // Private types
+  /*!
+   * A precomputed `(k^-1, r)` pair.
+   */
+  struct nonce
+  {
+    BIGNUM* kinv = nullptr;
+    BIGNUM* r = nullptr;
+  };
+
+private: // Private APIs
+  /*!
+   * Computes nonces while the pool is not full.
+   */
+  void fill();
+
+  /*!
+   * The number of nonces left at which the filler wakes up.
+   */
+  size_t low_water() const noexcept
+  {
+    return capacity_ / 2;
+  }
+
+  /*!
+   * Wipes and frees a pair.
+   */
+  static void release(nonce& n) noexcept
+  {
+    BN_clear_free(n.kinv);
+    BN_clear_free(n.r);
+    n.kinv = n.r = nullptr;
+  }
+
+private: // Data members
+  /// The key as the ECDSA functions take it
+  EC_KEY* eckey_ = nullptr;
+  /// Size in bytes of each of `r` and `s`
+  size_t coord_size_ = 0;
+  size_t capacity_ = 0;
+
+  mutable std::mutex mtx_;
+  /// Wakes the filler at the low water mark or to stop
+  std::condition_variable cv_;
+  std::deque<nonce> pairs_;
+  bool stopping_ = false;
+
+  std::atomic<uint64_t> misses_{0};
+  std::thread filler_;
+};
+
+} // END namespace jwt
+
+#include "jwt/impl/ec_nonce_pool.ipp"
+
+#endif // CPP_JWT_HAS_EC_NONCE_POOL
+
+#endif
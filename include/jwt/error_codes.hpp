@@ -70,6 +70,14 @@ enum class DecodeErrc
   // Key/secret passed as argument for NONE algorithm.
   // Not a hard error.
   KeyNotRequiredForNoneAlg,
+  // Authorization header does not carry Bearer credentials
+  AuthSchemeMismatch,
+  // Token longer than the allowed maximum
+  TokenTooLarge,
+  // Binary form is truncated or malformed
+  BinaryFormatError,
+  // Binary form was written by another version
+  BinaryVersionMismatch,
 };
 
 /**
@@ -100,6 +108,10 @@ enum class VerificationErrc
   TypeConversionError,
   // Algorithm confusion attack detected
   AlgoConfusionAttack,
+  // The jti of the token has been seen before
+  TokenReplayed,
+  // The token is in the revocation set
+  TokenRevoked,
 };
 
 /**
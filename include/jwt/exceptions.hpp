@@ -273,6 +273,38 @@ public:
   }
 };
 
+/**
+ * Derived from VerificationError.
+ * Thrown when a `jti_store` is passed to decode and
+ * the jti of the token has already been recorded.
+ */
+class TokenReplayedError final: public VerificationError
+{
+public:
+  /**
+   */
+  TokenReplayedError(std::string msg)
+    : VerificationError(std::move(msg))
+  {
+  }
+};
+
+/**
+ * Derived from VerificationError.
+ * Thrown when a `revocation_set` is passed to decode
+ * and the token is found in it.
+ */
+class TokenRevokedError final: public VerificationError
+{
+public:
+  /**
+   */
+  TokenRevokedError(std::string msg)
+    : VerificationError(std::move(msg))
+  {
+  }
+};
+
 class InvalidKeyError final: public VerificationError
 {
 public:
@@ -56,6 +56,14 @@ verify_result_t HMACSign<Hasher>::verify(
     const jwt::string_view head,
     const jwt::string_view jwt_sign)
 {
+  if (inline_suited(key, head.length())) {
+    mac_state_type state;
+    state.init(key.data(), key.length());
+    auto res = verify(state, head, jwt_sign);
+    state.clear();
+    return res;
+  }
+
   std::error_code ec{};
 
   unsigned char enc_buf[EVP_MAX_MD_SIZE];
@@ -72,23 +80,160 @@ verify_result_t HMACSign<Hasher>::verify(
     ec = AlgorithmErrc::VerificationErr;
     return {false, ec};
   }
-  if (enc_buf_len == 0) {
+
+  return compare_mac(enc_buf, enc_buf_len, jwt_sign);
+}
+
+template <typename Hasher>
+verify_result_t HMACSign<Hasher>::verify(
+    const jwt::string_view key,
+    const segmented_view& head,
+    const jwt::string_view jwt_sign)
+{
+  if (head.contiguous()) {
+    return verify(key, head.as_contiguous(), jwt_sign);
+  }
+
+  std::error_code ec{};
+
+  EC_PKEY_uptr mac_key{
+    EVP_PKEY_new_mac_key(EVP_PKEY_HMAC,
+                         nullptr,
+                         reinterpret_cast<const unsigned char*>(key.data()),
+                         static_cast<int>(key.length())),
+    ev_pkey_deletor};
+
+  if (!mac_key) {
+    ec = AlgorithmErrc::VerificationErr;
+    return {false, ec};
+  }
+
+  EVP_MDCTX_uptr mdctx_ptr{EVP_MD_CTX_create(), evp_md_ctx_deletor};
+  if (!mdctx_ptr) {
+    throw MemoryAllocationException("EVP_MD_CTX_create failed");
+  }
+
+  if (EVP_DigestSignInit(
+        mdctx_ptr.get(), nullptr, Hasher{}(), nullptr, mac_key.get()) != 1) {
+    ec = AlgorithmErrc::VerificationErr;
+    return {false, ec};
+  }
+
+  bool ok = true;
+  head.for_each([&](jwt::string_view piece) {
+    if (ok) {
+      ok = EVP_DigestSignUpdate(mdctx_ptr.get(), piece.data(), piece.length()) == 1;
+    }
+  });
+
+  unsigned char enc_buf[EVP_MAX_MD_SIZE];
+  size_t enc_buf_len = sizeof(enc_buf);
+
+  if (!ok || EVP_DigestSignFinal(mdctx_ptr.get(), enc_buf, &enc_buf_len) != 1) {
+    ec = AlgorithmErrc::VerificationErr;
+    return {false, ec};
+  }
+
+  return compare_mac(enc_buf, enc_buf_len, jwt_sign);
+}
+
+template <typename Hasher>
+bool HMACSign<Hasher>::batch_mac(
+    const jwt::string_view key,
+    const jwt::string_view* data,
+    size_t count,
+    std::vector<uint8_t>& macs,
+    std::true_type)
+{
+  // A lane per message only pays off with several of them,
+  // and an empty key keeps the errors of the one-shot path
+  if (count < 2 || key.empty() ||
+      detail::sha256_mb_best_kernel() == detail::sha256_mb_kernel::NONE) {
+    return false;
+  }
+
+  detail::hmac_sha256_key pads;
+  pads.init(key.data(), key.length());
+
+  macs.resize(count * detail::sha256_digest_size);
+  using digest_t = uint8_t[detail::sha256_digest_size];
+  bool done = detail::hmac_sha256_batch(pads, data, count,
+                                        reinterpret_cast<digest_t*>(macs.data()));
+  pads.clear();
+
+  return done;
+}
+
+template <typename Hasher>
+void HMACSign<Hasher>::sign_batch(
+    const jwt::string_view key,
+    const jwt::string_view* data,
+    size_t count,
+    sign_result_t* out)
+{
+  std::vector<uint8_t> macs;
+
+  if (batch_mac(key, data, count, macs, std::is_same<Hasher, algo::HS256>{})) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i].first.assign(reinterpret_cast<const char*>(&macs[i * detail::sha256_digest_size]),
+                          detail::sha256_digest_size);
+      out[i].second.clear();
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = sign(key, data[i]);
+  }
+}
+
+template <typename Hasher>
+void HMACSign<Hasher>::verify_batch(
+    const jwt::string_view key,
+    const jwt::string_view* heads,
+    const jwt::string_view* signs,
+    size_t count,
+    verify_result_t* out)
+{
+  std::vector<uint8_t> macs;
+
+  if (batch_mac(key, heads, count, macs, std::is_same<Hasher, algo::HS256>{})) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = compare_mac(&macs[i * detail::sha256_digest_size], detail::sha256_digest_size, signs[i]);
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = verify(key, heads[i], signs[i]);
+  }
+}
+
+template <typename Hasher>
+verify_result_t HMACSign<Hasher>::compare_mac(
+    const unsigned char* mac,
+    size_t mac_len,
+    const jwt::string_view jwt_sign)
+{
+  std::error_code ec{};
+
+  if (mac_len == 0) {
     ec = AlgorithmErrc::VerificationErr;
     return {false, ec};
   }
 
-  std::string b64_enc_str = jwt::base64_encode((const char*)&enc_buf[0], enc_buf_len);
+  char b64_enc_str[encoding_size(EVP_MAX_MD_SIZE)];
+  auto new_len = jwt::base64_encode((const char*)mac, mac_len, b64_enc_str);
 
-  if (!b64_enc_str.length()) {
+  if (!new_len) {
     ec = AlgorithmErrc::VerificationErr;
     return {false, ec};
   }
 
   // Make the base64 string url safe
-  auto new_len = jwt::base64_uri_encode(&b64_enc_str[0], b64_enc_str.length());
-  b64_enc_str.resize(new_len);
+  new_len = jwt::base64_uri_encode(b64_enc_str, new_len);
 
-  bool ret = (new_len == jwt_sign.size()) && (CRYPTO_memcmp(b64_enc_str.data(), jwt_sign.data(), new_len) == 0);
+  bool ret = (new_len == jwt_sign.size()) && (CRYPTO_memcmp(b64_enc_str, jwt_sign.data(), new_len) == 0);
 
   return { ret, ec };
 }
@@ -101,7 +246,6 @@ verify_result_t PEMSign<Hasher>::verify(
     const jwt::string_view jwt_sign)
 {
   std::error_code ec{};
-  std::string dec_sig = base64_uri_decode(jwt_sign.data(), jwt_sign.length());
 
   BIO_uptr bufkey{
       BIO_new_mem_buf((void*)key.data(), static_cast<int>(key.length())),
@@ -120,56 +264,64 @@ verify_result_t PEMSign<Hasher>::verify(
     return { false, ec };
   }
 
-  int pkey_type = EVP_PKEY_id(pkey.get());
+  return verify(pkey.get(), head, jwt_sign);
+}
+
+template <typename Hasher>
+verify_result_t PEMSign<Hasher>::verify(
+    EVP_PKEY* pkey,
+    const jwt::string_view head,
+    const jwt::string_view jwt_sign)
+{
+  return verify(pkey, segmented_view{head}, jwt_sign);
+}
+
+template <typename Hasher>
+verify_result_t PEMSign<Hasher>::verify(
+    EVP_PKEY* pkey,
+    const segmented_view& head,
+    const jwt::string_view jwt_sign)
+{
+  std::error_code ec{};
+
+  if (!pkey) {
+    ec = AlgorithmErrc::InvalidKeyErr;
+    return { false, ec };
+  }
+
+  int pkey_type = EVP_PKEY_id(pkey);
 
   if (pkey_type != Hasher::type) {
     ec = AlgorithmErrc::VerificationErr;
     return { false, ec };
   }
 
-  //Convert EC signature back to ASN1
-  if (Hasher::type == EVP_PKEY_EC) {
-    EC_SIG_uptr ec_sig{ECDSA_SIG_new(), ec_sig_deletor};
-    if (!ec_sig) {
-      throw MemoryAllocationException("ECDSA_SIG_new failed");
-    }
-
-    //Get the actual ec_key
-    EC_KEY_uptr ec_key{EVP_PKEY_get1_EC_KEY(pkey.get()), ec_key_deletor};
-    if (!ec_key) {
-      throw MemoryAllocationException("EVP_PKEY_get1_EC_KEY failed");
-    }
+  // Fits the signatures of upto 4096 bit RSA keys
+  constexpr size_t sig_scratch = 512;
+  Arena<sig_scratch> arena;
+  short_string<sig_scratch> dec_sig{arena};
+  base64_uri_decode(jwt_sign.data(), jwt_sign.length(), dec_sig);
 
-    unsigned int degree = EC_GROUP_get_degree(
-        EC_KEY_get0_group(ec_key.get()));
-    
-    unsigned int bn_len = (degree + 7) / 8;
+  const unsigned char* sig_data = reinterpret_cast<const unsigned char*>(dec_sig.data());
+  size_t sig_len = dec_sig.length();
 
-    if ((bn_len * 2) != dec_sig.length()) {
-      ec = AlgorithmErrc::VerificationErr;
-      return { false, ec };
-    }
+  //Convert EC signature back to ASN1
+  unsigned char der_sig[detail::ecdsa_max_der_size];
 
-    BIGNUM* ec_sig_r = BN_bin2bn((unsigned char*)dec_sig.data(), bn_len, nullptr);
-    BIGNUM* ec_sig_s = BN_bin2bn((unsigned char*)dec_sig.data() + bn_len, bn_len, nullptr);
+  if (Hasher::type == EVP_PKEY_EC) {
+    size_t bn_len = ec_coord_size(pkey);
 
-    if (!ec_sig_r || !ec_sig_s) {
+    if ((bn_len * 2) != dec_sig.length()) {
       ec = AlgorithmErrc::VerificationErr;
       return { false, ec };
     }
 
-    ECDSA_SIG_set0(ec_sig.get(), ec_sig_r, ec_sig_s);
-
-    size_t nlen = i2d_ECDSA_SIG(ec_sig.get(), nullptr);
-    dec_sig.resize(nlen);
-
-    auto data = reinterpret_cast<unsigned char*>(&dec_sig[0]);
-    nlen = i2d_ECDSA_SIG(ec_sig.get(), &data);
-
-    if (nlen == 0) {
+    sig_len = detail::ecdsa_raw_to_der(sig_data, bn_len, der_sig, sizeof(der_sig));
+    if (sig_len == 0) {
       ec = AlgorithmErrc::VerificationErr;
       return { false, ec };
     }
+    sig_data = der_sig;
   }
 
   EVP_MDCTX_uptr mdctx_ptr{EVP_MD_CTX_create(), evp_md_ctx_deletor};
@@ -178,18 +330,24 @@ verify_result_t PEMSign<Hasher>::verify(
   }
 
   if (EVP_DigestVerifyInit(
-        mdctx_ptr.get(), nullptr, Hasher{}(), nullptr, pkey.get()) != 1) {
+        mdctx_ptr.get(), nullptr, Hasher{}(), nullptr, pkey) != 1) {
     ec = AlgorithmErrc::VerificationErr;
     return { false, ec };
   }
 
-  if (EVP_DigestVerifyUpdate(mdctx_ptr.get(), head.data(), head.length()) != 1) {
+  bool ok = true;
+  head.for_each([&](jwt::string_view piece) {
+    if (ok) {
+      ok = EVP_DigestVerifyUpdate(mdctx_ptr.get(), piece.data(), piece.length()) == 1;
+    }
+  });
+
+  if (!ok) {
     ec = AlgorithmErrc::VerificationErr;
     return { false, ec };
   }
 
-  if (EVP_DigestVerifyFinal(
-        mdctx_ptr.get(), (unsigned char*)&dec_sig[0], dec_sig.length()) != 1) {
+  if (EVP_DigestVerifyFinal(mdctx_ptr.get(), sig_data, sig_len) != 1) {
     ec = AlgorithmErrc::VerificationErr;
     return { false, ec };
   }
@@ -272,64 +430,34 @@ std::string PEMSign<Hasher>::evp_digest(
     return {};
   }
 
+  // The first call only reports the maximum signature size
+  sign.resize(len);
+
   return sign;
 }
 
 template <typename Hasher>
-std::string PEMSign<Hasher>::public_key_ser(
+void PEMSign<Hasher>::public_key_ser(
     EVP_PKEY* pkey, 
-    jwt::string_view sign, 
+    std::string& sign, 
     std::error_code& ec)
 {
-  // Get the EC_KEY representing a public key and
-  // (optionaly) an associated private key
-  std::string new_sign;
   ec.clear();
 
-  EC_KEY_uptr ec_key{EVP_PKEY_get1_EC_KEY(pkey), ec_key_deletor};
+  size_t bn_len = ec_coord_size(pkey);
+  unsigned char raw_sig[2 * detail::ecdsa_max_coord_size];
 
-  if (!ec_key) {
+  if (!detail::ecdsa_der_to_raw(
+        reinterpret_cast<const unsigned char*>(sign.data()),
+        sign.length(),
+        raw_sig,
+        bn_len)) {
     ec = AlgorithmErrc::SigningErr;
-    return {};
+    return;
   }
 
-  uint32_t degree = EC_GROUP_get_degree(EC_KEY_get0_group(ec_key.get()));
-
-  ec_key.reset(nullptr);
-
-  auto char_ptr = &sign[0];
-
-  EC_SIG_uptr ec_sig{d2i_ECDSA_SIG(nullptr,
-                                   (const unsigned char**)&char_ptr,
-                                   static_cast<long>(sign.length())),
-                     ec_sig_deletor};
-
-  if (!ec_sig) {
-    ec = AlgorithmErrc::SigningErr;
-    return {};
-  }
-
-  const BIGNUM* ec_sig_r = nullptr;
-  const BIGNUM* ec_sig_s = nullptr;
-
-  ECDSA_SIG_get0(ec_sig.get(), &ec_sig_r, &ec_sig_s);
-
-  int r_len = BN_num_bytes(ec_sig_r);
-  int s_len = BN_num_bytes(ec_sig_s);
-  int bn_len = static_cast<int>((degree + 7) / 8);
-
-  if ((r_len > bn_len) || (s_len > bn_len)) {
-    ec = AlgorithmErrc::SigningErr;
-    return {};
-  }
-
-  auto buf_len = 2 * bn_len;
-  new_sign.resize(buf_len);
-
-  BN_bn2bin(ec_sig_r, (unsigned char*)&new_sign[0] + bn_len - r_len);
-  BN_bn2bin(ec_sig_s, (unsigned char*)&new_sign[0] + buf_len - s_len);
-
-  return new_sign;
+  // Reuses the capacity of the DER signature buffer
+  sign.assign(reinterpret_cast<const char*>(raw_sig), 2 * bn_len);
 }
 
 } // END namespace jwt
@@ -0,0 +1,208 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_ALGORITHM_REGISTRY_IPP
+#define CPP_JWT_ALGORITHM_REGISTRY_IPP
+
+namespace jwt {
+namespace detail {
+
+/*!
+ * Adapts the HMAC signing to the key handles.
+ * Uses the pad states of the key if the in-tree HMAC suits.
+ */
+template <typename Hasher>
+sign_result_t sign_with_secret(const jwt::key& k, const jwt::string_view data)
+{
+  const auto* state = k.mac_state<Hasher>();
+  if (state && state->preferred(data.length())) {
+    return HMACSign<Hasher>::sign(*state, data);
+  }
+  return HMACSign<Hasher>::sign(k.material(), data);
+}
+
+/*!
+ * The NONE algorithm has no key to precompute.
+ */
+template <>
+inline sign_result_t sign_with_secret<algo::NONE>(const jwt::key& k, const jwt::string_view data)
+{
+  return HMACSign<algo::NONE>::sign(k.material(), data);
+}
+
+/*!
+ * Adapts the PEM signing to the key handles.
+ * EC keys with a nonce pool sign through it.
+ */
+template <typename Hasher>
+sign_result_t sign_with_pkey(const jwt::key& k, const jwt::string_view data)
+{
+#if defined(CPP_JWT_HAS_EC_NONCE_POOL)
+  if (Hasher::type == EVP_PKEY_EC) {
+    if (ec_nonce_pool* pool = k.nonce_pool()) return pool->sign(Hasher{}(), data);
+  }
+#endif
+  return PEMSign<Hasher>::sign(k.local_pkey(), data);
+}
+
+/*!
+ * Adapts the HMAC verification to the key handles.
+ * Uses the pad states of the key as `sign_with_secret` does.
+ */
+template <typename Hasher>
+verify_result_t verify_with_secret(const jwt::key& k,
+                                   const segmented_view& head,
+                                   const jwt::string_view jwt_sign)
+{
+  const auto* state = k.mac_state<Hasher>();
+  if (state && head.contiguous() && state->preferred(head.length())) {
+    return HMACSign<Hasher>::verify(*state, head.as_contiguous(), jwt_sign);
+  }
+  return HMACSign<Hasher>::verify(k.material(), head, jwt_sign);
+}
+
+/*!
+ * The NONE algorithm has no key to precompute.
+ */
+template <>
+inline verify_result_t verify_with_secret<algo::NONE>(const jwt::key& k,
+                                                      const segmented_view& head,
+                                                      const jwt::string_view jwt_sign)
+{
+  return HMACSign<algo::NONE>::verify(k.material(), head, jwt_sign);
+}
+
+/*!
+ * Adapts the PEM verification to the key handles.
+ */
+template <typename Hasher>
+verify_result_t verify_with_pkey(const jwt::key& k,
+                                 const segmented_view& head,
+                                 const jwt::string_view jwt_sign)
+{
+  return PEMSign<Hasher>::verify(k.local_pkey(), head, jwt_sign);
+}
+
+
+/*!
+ * The built-in entry of an HMAC algorithm.
+ */
+template <typename Hasher>
+algorithm_entry hmac_entry() noexcept
+{
+  algorithm_entry e;
+  e.sign = HMACSign<Hasher>::sign;
+  e.verify = HMACSign<Hasher>::verify;
+  e.sign_key = sign_with_secret<Hasher>;
+  e.verify_key = verify_with_secret<Hasher>;
+  e.key_kind = std::is_same<Hasher, algo::NONE>::value ? key_type::NONE : key_type::SECRET;
+  return e;
+}
+
+/*!
+ * The built-in entry of an RSA or ECDSA algorithm.
+ */
+template <typename Hasher>
+algorithm_entry pem_entry() noexcept
+{
+  algorithm_entry e;
+  e.sign = PEMSign<Hasher>::sign;
+  e.verify = PEMSign<Hasher>::verify;
+  e.sign_key = sign_with_pkey<Hasher>;
+  e.verify_key = verify_with_pkey<Hasher>;
+  e.key_kind = key_type::PUBLIC;
+  return e;
+}
+
+inline algorithm_registry::algorithm_registry()
+{
+  builtin_[static_cast<size_t>(algorithm::NONE)]  = hmac_entry<algo::NONE>();
+  builtin_[static_cast<size_t>(algorithm::HS256)] = hmac_entry<algo::HS256>();
+  builtin_[static_cast<size_t>(algorithm::HS384)] = hmac_entry<algo::HS384>();
+  builtin_[static_cast<size_t>(algorithm::HS512)] = hmac_entry<algo::HS512>();
+  builtin_[static_cast<size_t>(algorithm::RS256)] = pem_entry<algo::RS256>();
+  builtin_[static_cast<size_t>(algorithm::RS384)] = pem_entry<algo::RS384>();
+  builtin_[static_cast<size_t>(algorithm::RS512)] = pem_entry<algo::RS512>();
+  builtin_[static_cast<size_t>(algorithm::ES256)] = pem_entry<algo::ES256>();
+  builtin_[static_cast<size_t>(algorithm::ES384)] = pem_entry<algo::ES384>();
+  builtin_[static_cast<size_t>(algorithm::ES512)] = pem_entry<algo::ES512>();
+
+  for (size_t i = 0; i < algorithm_slots; ++i) {
+    slots_[i].store(&builtin_[i], std::memory_order_relaxed);
+  }
+}
+
+inline bool algorithm_registry::set(SCOPED_ENUM algorithm alg, const algorithm_entry& entry)
+{
+  const size_t i = static_cast<size_t>(alg);
+  if (i >= static_cast<size_t>(algorithm::UNKN)) return false;
+
+  const algorithm_entry& base = builtin_[i];
+
+  std::unique_ptr<algorithm_entry> e{new algorithm_entry};
+  e->sign = entry.sign ? entry.sign : base.sign;
+  e->verify = entry.verify ? entry.verify : base.verify;
+  e->sign_key = entry.sign_key ? entry.sign_key : base.sign_key;
+  e->verify_key = entry.verify_key ? entry.verify_key : base.verify_key;
+  e->key_kind = base.key_kind;
+
+  std::lock_guard<std::mutex> lk{mtx_};
+  slots_[i].store(e.get(), std::memory_order_release);
+  overrides_.push_back(std::move(e));
+
+  return true;
+}
+
+inline void algorithm_registry::reset(SCOPED_ENUM algorithm alg)
+{
+  const size_t i = static_cast<size_t>(alg);
+  if (i >= algorithm_slots) return;
+
+  std::lock_guard<std::mutex> lk{mtx_};
+  slots_[i].store(&builtin_[i], std::memory_order_release);
+}
+
+} // END namespace detail
+
+inline const algorithm_entry& algorithm_impl(SCOPED_ENUM algorithm alg) noexcept
+{
+  return detail::algorithm_registry::instance().get(alg);
+}
+
+inline const algorithm_entry& builtin_algorithm_impl(SCOPED_ENUM algorithm alg) noexcept
+{
+  return detail::algorithm_registry::instance().builtin(alg);
+}
+
+inline bool register_algorithm(SCOPED_ENUM algorithm alg, const algorithm_entry& entry)
+{
+  return detail::algorithm_registry::instance().set(alg, entry);
+}
+
+inline void reset_algorithm(SCOPED_ENUM algorithm alg)
+{
+  detail::algorithm_registry::instance().reset(alg);
+}
+
+} // END namespace jwt
+
+#endif
@@ -0,0 +1,194 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_ASYNC_IPP
+#define CPP_JWT_ASYNC_IPP
+
+namespace jwt {
+
+inline verify_pool::verify_pool(size_t threads,
+                                size_t queue_capacity,
+                                overflow_policy policy)
+  : capacity_(queue_capacity ? queue_capacity : 1)
+  , policy_(policy)
+{
+  if (threads == 0) threads = 1;
+
+  workers_.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back([this] { work(); });
+  }
+}
+
+inline verify_pool::~verify_pool()
+{
+  {
+    std::lock_guard<std::mutex> lk{mtx_};
+    stop_ = true;
+  }
+  not_empty_.notify_all();
+  not_full_.notify_all();
+
+  for (auto& t : workers_) t.join();
+}
+
+inline bool verify_pool::submit(std::function<void()> job)
+{
+  std::unique_lock<std::mutex> lk{mtx_};
+
+  if (queue_.size() >= capacity_) {
+    switch (policy_) {
+      case overflow_policy::block:
+        not_full_.wait(lk, [this] { return stop_ || queue_.size() < capacity_; });
+        break;
+      case overflow_policy::run_inline:
+        lk.unlock();
+        job();
+        return true;
+      case overflow_policy::reject:
+        return false;
+    }
+  }
+
+  queue_.push_back(std::move(job));
+  lk.unlock();
+  not_empty_.notify_one();
+
+  return true;
+}
+
+inline void verify_pool::work()
+{
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lk{mtx_};
+      not_empty_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+
+      // Drain what is left before exiting
+      if (queue_.empty()) return;
+
+      job = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    not_full_.notify_one();
+
+    job();
+  }
+}
+
+namespace detail {
+
+inline void async_decode_state::run() noexcept
+{
+  try {
+    ec = pending.run(obj.header(), token);
+  } catch (...) {
+    error = std::current_exception();
+  }
+}
+
+template <typename SequenceT, typename... Args>
+async_decode_state_ptr decode_async_prepare(const jwt::string_view enc_str,
+                                            const params::detail::algorithms_param<SequenceT>& algos,
+                                            Args&&... args)
+{
+  auto state = std::make_shared<async_decode_state>();
+  state->token.assign(enc_str.data(), enc_str.length());
+  state->obj = decode_prepare(state->token, algos, state->ec, state->pending,
+                              std::forward<Args>(args)...);
+
+  // The verification outlives the caller's borrowed secret.
+  auto& sign = state->pending.sign;
+  if (state->pending.required && !sign.handle()) {
+    sign = jwt_signature{jwt::key::from_secret(sign.secret())};
+  }
+  return state;
+}
+
+} // END namespace detail
+
+template <typename SequenceT, typename... Args>
+std::future<decode_result_t>
+decode_async(verify_pool& pool,
+             const jwt::string_view enc_str,
+             const params::detail::algorithms_param<SequenceT>& algos,
+             Args&&... args)
+{
+  auto state = detail::decode_async_prepare(enc_str, algos, std::forward<Args>(args)...);
+  auto promise = std::make_shared<std::promise<decode_result_t>>();
+  auto fut = promise->get_future();
+
+  if (state->ec || !state->pending.required) {
+    promise->set_value(state->result());
+    return fut;
+  }
+
+  bool queued = pool.submit([state, promise] {
+    state->run();
+    if (state->error) {
+      promise->set_exception(state->error);
+    } else {
+      promise->set_value(state->result());
+    }
+  });
+
+  if (!queued) {
+    state->ec = std::make_error_code(std::errc::resource_unavailable_try_again);
+    promise->set_value(state->result());
+  }
+
+  return fut;
+}
+
+#if defined(CPP_JWT_HAS_COROUTINES)
+
+inline bool decode_awaitable::await_suspend(std::coroutine_handle<> h)
+{
+  auto state = state_;
+  bool queued = pool_->submit([state, h] {
+    state->run();
+    h.resume();
+  });
+
+  if (!queued) {
+    state_->ec = std::make_error_code(std::errc::resource_unavailable_try_again);
+    return false;
+  }
+
+  return true;
+}
+
+template <typename SequenceT, typename... Args>
+decode_awaitable await_decode(verify_pool& pool,
+                              const jwt::string_view enc_str,
+                              const params::detail::algorithms_param<SequenceT>& algos,
+                              Args&&... args)
+{
+  return { pool, detail::decode_async_prepare(enc_str, algos, std::forward<Args>(args)...) };
+}
+
+#endif // CPP_JWT_HAS_COROUTINES
+
+} // END namespace jwt
+
+#endif
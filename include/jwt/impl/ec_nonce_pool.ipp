@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_EC_NONCE_POOL_IPP
+#define CPP_JWT_EC_NONCE_POOL_IPP
+
+namespace jwt {
+
+inline ec_nonce_pool::ec_nonce_pool(EVP_PKEY* pkey, size_t capacity)
+  : capacity_(capacity ? capacity : 1)
+{
+  if (pkey && EVP_PKEY_id(pkey) == EVP_PKEY_EC) {
+    eckey_ = EVP_PKEY_get1_EC_KEY(pkey);
+    coord_size_ = (static_cast<size_t>(EVP_PKEY_bits(pkey)) + 7) / 8;
+  }
+}
+
+inline ec_nonce_pool::~ec_nonce_pool()
+{
+  stop();
+
+  for (auto& n : pairs_) release(n);
+  if (eckey_) EC_KEY_free(eckey_);
+}
+
+inline void ec_nonce_pool::start(std::error_code& ec)
+{
+  ec.clear();
+
+  if (!eckey_ || !EC_KEY_get0_private_key(eckey_)) {
+    ec = AlgorithmErrc::InvalidKeyErr;
+    return;
+  }
+  if (filler_.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> lk{mtx_};
+    stopping_ = false;
+  }
+  filler_ = std::thread{[this] { fill(); }};
+}
+
+inline void ec_nonce_pool::start()
+{
+  std::error_code ec;
+  start(ec);
+  if (ec) {
+    throw InvalidKeyError(ec.message());
+  }
+}
+
+inline void ec_nonce_pool::stop()
+{
+  if (!filler_.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> lk{mtx_};
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  filler_.join();
+}
+
+inline void ec_nonce_pool::fill()
+{
+#if defined(__linux__)
+  // Only runs on an otherwise idle CPU, so that refilling
+  // does not compete with the signing it is meant to speed up
+  sched_param param{};
+  pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+  std::unique_lock<std::mutex> lk{mtx_};
+
+  while (true) {
+    // Tops the pool up, then sleeps until half of it is used
+    if (pairs_.size() == capacity_) {
+      cv_.wait(lk, [this] { return stopping_ || pairs_.size() <= low_water(); });
+    }
+    if (stopping_) return;
+
+    // The point multiplication runs unlocked
+    lk.unlock();
+    nonce n;
+    const bool ok = ECDSA_sign_setup(eckey_, nullptr, &n.kinv, &n.r) == 1;
+    lk.lock();
+
+    if (!ok) {
+      // Only fails on allocation; signing falls back inline
+      release(n);
+      cv_.wait_for(lk, std::chrono::milliseconds(100), [this] { return stopping_; });
+      continue;
+    }
+    pairs_.push_back(n);
+  }
+}
+
+inline sign_result_t ec_nonce_pool::sign(const EVP_MD* md, const jwt::string_view data)
+{
+  if (!eckey_ || !md) {
+    return { std::string{}, AlgorithmErrc::SigningErr };
+  }
+
+  unsigned char dgst[EVP_MAX_MD_SIZE];
+  unsigned int dgst_len = 0;
+  if (EVP_Digest(data.data(), data.length(), dgst, &dgst_len, md, nullptr) != 1) {
+    return { std::string{}, AlgorithmErrc::SigningErr };
+  }
+
+  nonce n;
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lk{mtx_};
+    if (!pairs_.empty()) {
+      n = pairs_.front();
+      pairs_.pop_front();
+      wake = pairs_.size() == low_water();
+    }
+  }
+
+  ECDSA_SIG* sig = nullptr;
+  if (n.kinv) {
+    if (wake) cv_.notify_one();
+    sig = ECDSA_do_sign_ex(dgst, static_cast<int>(dgst_len), n.kinv, n.r, eckey_);
+    release(n);
+  } else {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // An empty pool, or the rare nonce giving s == 0
+  if (!sig) {
+    sig = ECDSA_do_sign(dgst, static_cast<int>(dgst_len), eckey_);
+  }
+  if (!sig) {
+    return { std::string{}, AlgorithmErrc::SigningErr };
+  }
+
+  EC_SIG_uptr sig_ptr{sig, ec_sig_deletor};
+  const BIGNUM* r = nullptr;
+  const BIGNUM* s = nullptr;
+  ECDSA_SIG_get0(sig, &r, &s);
+
+  std::string out(2 * coord_size_, '\0');
+  unsigned char* p = reinterpret_cast<unsigned char*>(&out[0]);
+
+  if (BN_bn2binpad(r, p, static_cast<int>(coord_size_)) < 0 ||
+      BN_bn2binpad(s, p + coord_size_, static_cast<int>(coord_size_)) < 0) {
+    return { std::string{}, AlgorithmErrc::SigningErr };
+  }
+
+  return { std::move(out), std::error_code{} };
+}
+
+} // END namespace jwt
+
+#endif
@@ -86,6 +86,14 @@ struct DecodeErrorCategory: std::error_category
       return "key not present";
     case DecodeErrc::KeyNotRequiredForNoneAlg:
       return "key not required for NONE algorithm";
+    case DecodeErrc::AuthSchemeMismatch:
+      return "authorization scheme is not Bearer";
+    case DecodeErrc::TokenTooLarge:
+      return "token too large";
+    case DecodeErrc::BinaryFormatError:
+      return "binary form is malformed";
+    case DecodeErrc::BinaryVersionMismatch:
+      return "binary form version mismatch";
     };
     return "unknown decode error";
   }
@@ -126,6 +134,10 @@ struct VerificationErrorCategory: std::error_category
       return "type conversion error";
     case VerificationErrc::AlgoConfusionAttack:
       return "algo confusion attack possibility";
+    case VerificationErrc::TokenReplayed:
+      return "token replayed";
+    case VerificationErrc::TokenRevoked:
+      return "token revoked";
     };
     return "unknown verification error";
   }
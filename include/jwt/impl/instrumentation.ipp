@@ -0,0 +1,209 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_INSTRUMENTATION_IPP
+#define CPP_JWT_INSTRUMENTATION_IPP
+
+namespace jwt {
+
+namespace detail {
+
+/*!
+ */
+inline std::atomic<decode_sink*>& decode_sink_slot() noexcept
+{
+  static std::atomic<decode_sink*> sink{nullptr};
+  return sink;
+}
+
+/*!
+ * Source of the histogram sink ids. Ids are never reused,
+ * so a cached shard of a destroyed sink is never matched.
+ */
+inline uint64_t next_histogram_sink_id() noexcept
+{
+  static std::atomic<uint64_t> next{1};
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*!
+ * Adds `v` to a counter which only the calling thread writes.
+ */
+inline void add_owned(std::atomic<uint64_t>& counter, uint64_t v) noexcept
+{
+  counter.store(counter.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+} // END namespace detail
+
+inline decode_outcome outcome_of(const std::error_code& ec) noexcept
+{
+  if (!ec) return decode_outcome::OK;
+
+  const auto& cat = ec.category();
+  if (cat == make_error_code(VerificationErrc{}).category()) {
+    return decode_outcome::VERIFICATION_ERROR;
+  }
+  if (cat == make_error_code(AlgorithmErrc{}).category()) {
+    return decode_outcome::ALGORITHM_ERROR;
+  }
+  return decode_outcome::DECODE_ERROR;
+}
+
+inline decode_sink* set_decode_sink(decode_sink* sink) noexcept
+{
+  return detail::decode_sink_slot().exchange(sink, std::memory_order_acq_rel);
+}
+
+inline decode_sink* current_decode_sink() noexcept
+{
+  return detail::decode_sink_slot().load(std::memory_order_acquire);
+}
+
+//========================================================================
+
+inline size_t latency_histogram::bucket_of(uint64_t nanos) noexcept
+{
+  size_t b = 0;
+  while (nanos > 1 && b + 1 < bucket_count) {
+    nanos >>= 1;
+    ++b;
+  }
+  return b;
+}
+
+inline uint64_t latency_histogram::quantile_nanos(double q) const noexcept
+{
+  if (!count) return 0;
+
+  q = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+  uint64_t rank = static_cast<uint64_t>(q * (count - 1)) + 1;
+
+  for (size_t b = 0; b < bucket_count; ++b) {
+    if (buckets[b] >= rank) return uint64_t{1} << (b + 1);
+    rank -= buckets[b];
+  }
+  return uint64_t{1} << bucket_count;
+}
+
+inline void latency_histogram::merge(const latency_histogram& other) noexcept
+{
+  count += other.count;
+  total_nanos += other.total_nanos;
+  total_bytes += other.total_bytes;
+  for (size_t b = 0; b < bucket_count; ++b) {
+    buckets[b] += other.buckets[b];
+  }
+}
+
+//========================================================================
+
+inline histogram_sink::histogram_sink()
+  : id_(detail::next_histogram_sink_id())
+{
+}
+
+inline void histogram_sink::record(const decode_trace& trace) noexcept
+{
+  shard* s = local_shard();
+  if (!s) return;
+
+  size_t a = static_cast<size_t>(trace.alg);
+  if (a >= algorithm_count) a = static_cast<size_t>(algorithm::UNKN);
+
+  auto& cells = s->cells[a][static_cast<size_t>(trace.outcome())];
+
+  for (size_t i = 0; i < decode_stage_count; ++i) {
+    if (!trace.ran(static_cast<decode_stage>(i))) continue;
+
+    cell& c = cells[i];
+    detail::add_owned(c.count, 1);
+    detail::add_owned(c.total_nanos, trace.nanos[i]);
+    detail::add_owned(c.total_bytes, trace.bytes[i]);
+    detail::add_owned(c.buckets[latency_histogram::bucket_of(trace.nanos[i])], 1);
+  }
+}
+
+inline latency_histogram histogram_sink::histogram(SCOPED_ENUM algorithm alg,
+                                                   decode_outcome outcome,
+                                                   decode_stage stage) const
+{
+  latency_histogram h;
+  const size_t a = static_cast<size_t>(alg);
+  if (a >= algorithm_count) return h;
+
+  std::lock_guard<std::mutex> lk{mtx_};
+
+  for (const auto& s : shards_) {
+    const cell& c = s->cells[a][static_cast<size_t>(outcome)][static_cast<size_t>(stage)];
+
+    h.count += c.count.load(std::memory_order_relaxed);
+    h.total_nanos += c.total_nanos.load(std::memory_order_relaxed);
+    h.total_bytes += c.total_bytes.load(std::memory_order_relaxed);
+    for (size_t b = 0; b < latency_histogram::bucket_count; ++b) {
+      h.buckets[b] += c.buckets[b].load(std::memory_order_relaxed);
+    }
+  }
+
+  return h;
+}
+
+inline histogram_sink::shard* histogram_sink::local_shard() noexcept
+{
+  struct cached_shard
+  {
+    uint64_t sink_id = 0;
+    shard* s = nullptr;
+  };
+  static thread_local cached_shard cached;
+
+  if (cached.sink_id == id_) return cached.s;
+
+  const auto self = std::this_thread::get_id();
+  std::lock_guard<std::mutex> lk{mtx_};
+
+  shard* found = nullptr;
+  for (const auto& s : shards_) {
+    if (s->owner == self) {
+      found = s.get();
+      break;
+    }
+  }
+
+  if (!found) {
+    try {
+      std::unique_ptr<shard> s{new shard};
+      s->owner = self;
+      shards_.push_back(std::move(s));
+      found = shards_.back().get();
+    } catch (const std::bad_alloc&) {
+      return nullptr;
+    }
+  }
+
+  cached = cached_shard{id_, found};
+  return found;
+}
+
+} // END namespace jwt
+
+#endif
@@ -0,0 +1,172 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_JTI_STORE_IPP
+#define CPP_JWT_JTI_STORE_IPP
+
+namespace jwt {
+
+inline jti_store::jti_store(size_t shards, std::chrono::seconds max_ttl)
+  : max_ttl_(static_cast<uint64_t>(max_ttl.count()))
+{
+  size_t nshards = 1;
+  while (nshards < shards) nshards <<= 1;
+
+  const uint64_t t = now();
+
+  shards_.reserve(nshards);
+  for (size_t i = 0; i < nshards; ++i) {
+    std::unique_ptr<shard> s{new shard{}};
+    s->slots.resize(64);
+    s->wheel = detail::time_wheel<uint64_t>{t};
+    shards_.push_back(std::move(s));
+  }
+}
+
+inline bool jti_store::insert(const jwt::string_view jti, uint64_t expiry)
+{
+  const uint64_t h = hash_of(jti);
+  const uint64_t t = now();
+  shard& s = shard_for(h);
+
+  std::lock_guard<std::mutex> lk{s.mtx};
+  expire(s, t);
+
+  size_t idx = probe(s.slots, h);
+  slot& e = s.slots[idx];
+
+  if (e.hash == h) {
+    if (e.expiry > t) return false;
+
+    // Expired but not dropped yet; the pending timer
+    // sees the new expiry and leaves it alone.
+    e.expiry = expiry;
+    s.wheel.schedule(expiry, h);
+    return true;
+  }
+
+  // Keep the load factor under 3/4
+  if ((s.count + 1) * 4 > s.slots.size() * 3) {
+    grow(s);
+    idx = probe(s.slots, h);
+  }
+
+  s.slots[idx].hash = h;
+  s.slots[idx].expiry = expiry;
+  s.count++;
+  s.wheel.schedule(expiry, h);
+
+  return true;
+}
+
+inline bool jti_store::contains(const jwt::string_view jti) const
+{
+  const uint64_t h = hash_of(jti);
+  const shard& s = shard_for(h);
+
+  std::lock_guard<std::mutex> lk{s.mtx};
+  const slot& e = s.slots[probe(s.slots, h)];
+
+  return e.hash == h && e.expiry > now();
+}
+
+inline size_t jti_store::size() const
+{
+  size_t total = 0;
+  for (const auto& s : shards_) {
+    std::lock_guard<std::mutex> lk{s->mtx};
+    total += s->count;
+  }
+  return total;
+}
+
+inline void jti_store::clear()
+{
+  for (auto& s : shards_) {
+    std::lock_guard<std::mutex> lk{s->mtx};
+    std::fill(s->slots.begin(), s->slots.end(), slot{});
+    s->count = 0;
+    s->wheel.clear();
+  }
+}
+
+inline size_t jti_store::probe(const std::vector<slot>& slots, uint64_t hash) noexcept
+{
+  const size_t mask = slots.size() - 1;
+  size_t idx = hash & mask;
+
+  while (slots[idx].hash != 0 && slots[idx].hash != hash) {
+    idx = (idx + 1) & mask;
+  }
+
+  return idx;
+}
+
+inline void jti_store::erase_at(shard& s, size_t idx) noexcept
+{
+  const size_t mask = s.slots.size() - 1;
+  size_t hole = idx;
+  size_t next = (idx + 1) & mask;
+
+  while (s.slots[next].hash != 0) {
+    size_t home = s.slots[next].hash & mask;
+
+    // Move the entry into the hole unless its home
+    // lies cyclically in (hole, next]
+    bool stays = hole <= next ? (hole < home && home <= next)
+                              : (hole < home || home <= next);
+    if (!stays) {
+      s.slots[hole] = s.slots[next];
+      hole = next;
+    }
+    next = (next + 1) & mask;
+  }
+
+  s.slots[hole] = slot{};
+  s.count--;
+}
+
+inline void jti_store::grow(shard& s)
+{
+  std::vector<slot> old(s.slots.size() * 2);
+  old.swap(s.slots);
+
+  for (const auto& e : old) {
+    if (e.hash != 0) {
+      s.slots[probe(s.slots, e.hash)] = e;
+    }
+  }
+}
+
+inline void jti_store::expire(shard& s, uint64_t t)
+{
+  s.wheel.advance(t, [&s, t](uint64_t h, uint64_t) {
+    size_t idx = probe(s.slots, h);
+    if (s.slots[idx].hash == h && s.slots[idx].expiry <= t) {
+      erase_at(s, idx);
+    }
+  });
+}
+
+} // END namespace jwt
+
+#endif
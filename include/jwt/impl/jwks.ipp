@@ -0,0 +1,254 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_JWKS_IPP
+#define CPP_JWT_JWKS_IPP
+
+#include "jwt/detail/asn1.hpp"
+
+namespace jwt {
+
+namespace detail {
+
+/*!
+ * A named curve usable for JWS.
+ */
+struct jwk_curve
+{
+  const char* crv;
+  SCOPED_ENUM algorithm alg;
+  size_t coord_len;
+};
+
+/*!
+ * Looks up the curve by its JWK `crv` name.
+ * Returns nullptr for the unsupported ones.
+ */
+inline const jwk_curve* find_jwk_curve(const std::string& crv) noexcept
+{
+  static const jwk_curve curves[] = {
+    { "P-256", algorithm::ES256, 32 },
+    { "P-384", algorithm::ES384, 48 },
+    { "P-521", algorithm::ES512, 66 },
+  };
+
+  for (const auto& c : curves) {
+    if (crv == c.crv) return &c;
+  }
+  return nullptr;
+}
+
+} // END namespace detail
+
+inline bool jwks::decode_member(const json_t& jwk, const char* name, std::string& out)
+{
+  auto itr = jwk.find(name);
+  if (itr == jwk.end() || !itr->is_string()) return false;
+
+  const auto& enc = itr->get_ref<const std::string&>();
+  if (enc.empty()) return false;
+
+  jwt::string_view sv{enc.data(), enc.length()};
+  out.clear();
+  return base64_uri_decode(segmented_view{&sv, 1}, out);
+}
+
+inline jwt::key jwks::to_key(const json_t& jwk, std::error_code& ec)
+{
+  ec.clear();
+
+  if (!jwk.is_object()) {
+    ec = AlgorithmErrc::InvalidKeyErr;
+    return {};
+  }
+
+  auto kty_itr = jwk.find("kty");
+  if (kty_itr == jwk.end() || !kty_itr->is_string()) {
+    ec = AlgorithmErrc::InvalidKeyErr;
+    return {};
+  }
+  const auto& kty = kty_itr->get_ref<const std::string&>();
+
+  // Keys meant for encryption only
+  auto use_itr = jwk.find("use");
+  if (use_itr != jwk.end() && (!use_itr->is_string() || *use_itr != "sig")) {
+    return {};
+  }
+
+  algorithm alg = algorithm::UNKN;
+  auto alg_itr = jwk.find("alg");
+  if (alg_itr != jwk.end()) {
+    if (!alg_itr->is_string()) {
+      ec = AlgorithmErrc::InvalidKeyErr;
+      return {};
+    }
+    alg = str_to_alg(alg_itr->get_ref<const std::string&>());
+    // Algorithms not implemented here
+    if (alg == algorithm::UNKN || alg == algorithm::NONE) return {};
+  }
+
+  auto alg_in = [alg](algorithm first, algorithm last) {
+    return alg == algorithm::UNKN || (alg >= first && alg <= last);
+  };
+
+  if (kty == "RSA") {
+    if (!alg_in(algorithm::RS256, algorithm::RS512)) {
+      ec = AlgorithmErrc::InvalidKeyErr;
+      return {};
+    }
+
+    std::string n, e;
+    if (!decode_member(jwk, "n", n) || !decode_member(jwk, "e", e)) {
+      ec = AlgorithmErrc::InvalidKeyErr;
+      return {};
+    }
+
+    const std::string der = detail::rsa_spki_der(
+        reinterpret_cast<const uint8_t*>(n.data()), n.length(),
+        reinterpret_cast<const uint8_t*>(e.data()), e.length());
+
+    return jwt::key::from_der(der, ec, alg);
+  }
+
+  if (kty == "EC") {
+    auto crv_itr = jwk.find("crv");
+    if (crv_itr == jwk.end() || !crv_itr->is_string()) {
+      ec = AlgorithmErrc::InvalidKeyErr;
+      return {};
+    }
+
+    const detail::jwk_curve* curve = detail::find_jwk_curve(crv_itr->get_ref<const std::string&>());
+    if (!curve) return {};
+
+    if (alg == algorithm::UNKN) {
+      alg = curve->alg;
+    } else if (alg != curve->alg) {
+      ec = AlgorithmErrc::InvalidKeyErr;
+      return {};
+    }
+
+    // The coordinates are of the full field size (RFC 7518 Section 6.2.1)
+    std::string x, y;
+    if (!decode_member(jwk, "x", x) || !decode_member(jwk, "y", y) ||
+        x.length() != curve->coord_len || y.length() != curve->coord_len) {
+      ec = AlgorithmErrc::InvalidKeyErr;
+      return {};
+    }
+
+    // Uncompressed point; OpenSSL checks that it is on the curve
+    std::string point(1, '\x04');
+    point += x;
+    point += y;
+
+    return jwt::key::from_ec_point(point, alg, ec);
+  }
+
+  if (kty == "oct") {
+    if (!alg_in(algorithm::HS256, algorithm::HS512)) {
+      ec = AlgorithmErrc::InvalidKeyErr;
+      return {};
+    }
+
+    std::string k;
+    if (!decode_member(jwk, "k", k)) {
+      ec = AlgorithmErrc::InvalidKeyErr;
+      return {};
+    }
+
+    return jwt::key::from_raw_secret(k, alg);
+  }
+
+  // Other key types
+  return {};
+}
+
+inline std::vector<key_ring::value_type>
+jwks::load(const jwt::string_view json_text, std::error_code& ec)
+{
+  ec.clear();
+
+  json_t doc = json_t::parse(json_text.data(), json_text.data() + json_text.length(),
+                             nullptr, false);
+
+  auto keys_itr = doc.is_object() ? doc.find("keys") : doc.end();
+  if (doc.is_discarded() || !doc.is_object() ||
+      keys_itr == doc.end() || !keys_itr->is_array()) {
+    ec = DecodeErrc::JsonParseError;
+    return {};
+  }
+
+  std::vector<key_ring::value_type> res;
+  res.reserve(keys_itr->size());
+
+  for (const auto& jwk : *keys_itr) {
+    jwt::key k = to_key(jwk, ec);
+    if (ec) return {};
+    if (!k) continue;
+
+    std::string kid;
+    auto kid_itr = jwk.find("kid");
+    if (kid_itr != jwk.end() && kid_itr->is_string()) {
+      kid = kid_itr->get_ref<const std::string&>();
+    }
+
+    res.emplace_back(std::move(kid), std::move(k));
+  }
+
+  return res;
+}
+
+inline std::vector<key_ring::value_type> jwks::load(const jwt::string_view json_text)
+{
+  std::error_code ec;
+  auto res = load(json_text, ec);
+  throw_if_error(ec);
+  return res;
+}
+
+inline void jwks::load(const jwt::string_view json_text, key_ring& ring, std::error_code& ec)
+{
+  auto keys = load(json_text, ec);
+  if (ec) return;
+
+  ring.assign(std::move(keys));
+}
+
+inline void jwks::load(const jwt::string_view json_text, key_ring& ring)
+{
+  std::error_code ec;
+  load(json_text, ring, ec);
+  throw_if_error(ec);
+}
+
+inline void jwks::throw_if_error(const std::error_code& ec)
+{
+  if (!ec) return;
+
+  if (ec == DecodeErrc::JsonParseError) {
+    throw DecodeError(ec.message());
+  }
+  throw InvalidKeyError(ec.message());
+}
+
+} // END namespace jwt
+
+#endif
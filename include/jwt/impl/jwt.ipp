@@ -63,18 +63,107 @@ std::ostream& operator<< (std::ostream& os, const T& obj)
 
 //========================================================================
 
+namespace detail {
+
+/*!
+ * Appends the prefix of a binary form holding `kind`.
+ */
+inline void write_binary_prefix(std::vector<uint8_t>& out, binary_kind kind)
+{
+  out.push_back('J');
+  out.push_back('W');
+  out.push_back('B');
+  out.push_back(binary_version);
+  out.push_back(static_cast<uint8_t>(kind));
+}
+
+/*!
+ * Checks that `data` starts with the prefix
+ * of a binary form holding `kind`.
+ */
+inline std::error_code check_binary_prefix(const uint8_t* data, size_t len, binary_kind kind)
+{
+  if (len < binary_prefix_size ||
+      data[0] != 'J' || data[1] != 'W' || data[2] != 'B' ||
+      data[4] != static_cast<uint8_t>(kind)) {
+    return DecodeErrc::BinaryFormatError;
+  }
+  if (data[3] != binary_version) {
+    return DecodeErrc::BinaryVersionMismatch;
+  }
+  return {};
+}
+
+/*!
+ * Reads the JSON object in the binary layout at `data`
+ * to `out`. `out` is left as it was on failure.
+ */
+inline std::error_code read_binary_object(const uint8_t* data, size_t len, json_t& out)
+{
+  binary_reader reader{data, len};
+  json_t obj;
+
+  if (!reader.read(obj) || !reader.at_end() || !obj.is_object()) {
+    return DecodeErrc::BinaryFormatError;
+  }
+  out = std::move(obj);
+  return {};
+}
+
+} // END namespace detail
+
+//========================================================================
+
 inline void jwt_header::decode(const jwt::string_view enc_str, std::error_code& ec)
 {
   ec.clear();
-  std::string json_str = base64_decode(enc_str);
+  Arena<detail::header_scratch_size> arena;
+  short_string<detail::header_scratch_size> json_str{arena};
+
+  detail::stage_timer b64_timer{decode_stage::HEADER_BASE64, enc_str.length()};
+  base64_decode(enc_str, json_str);
+  b64_timer.stop();
 
+  detail::stage_timer json_timer{decode_stage::HEADER_JSON, json_str.length()};
+  parse_json(json_str.data(), json_str.length(), ec);
+}
+
+inline void jwt_header::decode(const segmented_view& enc_str, std::error_code& ec)
+{
+  if (enc_str.contiguous()) {
+    decode(enc_str.as_contiguous(), ec);
+    return;
+  }
+
+  ec.clear();
+  Arena<detail::header_scratch_size> arena;
+  short_string<detail::header_scratch_size> json_str{arena};
+
+  detail::stage_timer b64_timer{decode_stage::HEADER_BASE64, enc_str.length()};
+  if (!base64_uri_decode(enc_str, json_str)) {
+    ec = DecodeErrc::JsonParseError;
+    return;
+  }
+  b64_timer.stop();
+
+  detail::stage_timer json_timer{decode_stage::HEADER_JSON, json_str.length()};
+  parse_json(json_str.data(), json_str.length(), ec);
+}
+
+inline void jwt_header::parse_json(const char* data, size_t len, std::error_code& ec)
+{
   try {
-    payload_ = json_t::parse(std::move(json_str));
+    payload_ = json_t::parse(data, data + len);
   } catch(const std::exception&) {
     ec = DecodeErrc::JsonParseError;
     return;
   }
 
+  load_fields(ec);
+}
+
+inline void jwt_header::load_fields(std::error_code& ec)
+{
   //Look for the algorithm field
   auto alg_itr = payload_.find("alg");
   if (alg_itr == payload_.end()) {
@@ -82,14 +171,14 @@ inline void jwt_header::decode(const jwt::string_view enc_str, std::error_code&
     return;
   }
 
-  alg_ = str_to_alg(alg_itr.value().get<std::string>());
+  alg_ = str_to_alg(alg_itr.value().get_ref<const std::string&>());
 
   if (alg_ != algorithm::NONE)
   {
     auto itr = payload_.find("typ");
 
     if (itr != payload_.end()) {
-      const auto& typ = itr.value().get<std::string>();
+      const auto& typ = itr.value().get_ref<const std::string&>();
       if (strcasecmp(typ.c_str(), "JWT")) {
         ec = DecodeErrc::TypMismatch;
         return;
@@ -101,16 +190,50 @@ inline void jwt_header::decode(const jwt::string_view enc_str, std::error_code&
     //TODO:
   }
 
-  // Populate header
-  for (auto it = payload_.begin(); it != payload_.end(); ++it) {
-    auto ret = headers_.insert(it.key());
-    if (!ret.second) {
-      ec = DecodeErrc::DuplClaims;
-      //ATTN: Dont stop the decode here
-      //Not a hard error.
-    }
+  return;
+}
+
+inline void jwt_header::to_binary(std::vector<uint8_t>& out) const
+{
+  detail::write_binary_prefix(out, detail::binary_kind::HEADER);
+  detail::binary_write(payload_, out);
+}
+
+inline std::vector<uint8_t> jwt_header::to_binary() const
+{
+  std::vector<uint8_t> out;
+  to_binary(out);
+  return out;
+}
+
+inline void jwt_header::from_binary(const uint8_t* data, size_t len, std::error_code& ec)
+{
+  ec = detail::check_binary_prefix(data, len, detail::binary_kind::HEADER);
+  if (ec) {
+    return;
+  }
+
+  ec = detail::read_binary_object(data + detail::binary_prefix_size,
+                                  len - detail::binary_prefix_size,
+                                  payload_);
+  if (ec) {
+    return;
   }
 
+  try {
+    load_fields(ec);
+  } catch (const json_ns::detail::type_error&) {
+    ec = DecodeErrc::BinaryFormatError;
+  }
+}
+
+inline void jwt_header::from_binary(const uint8_t* data, size_t len)
+{
+  std::error_code ec;
+  from_binary(data, len, ec);
+  if (ec) {
+    throw DecodeError(ec.message());
+  }
   return;
 }
 
@@ -127,22 +250,83 @@ inline void jwt_header::decode(const jwt::string_view enc_str)
 inline void jwt_payload::decode(const jwt::string_view enc_str, std::error_code& ec)
 {
   ec.clear();
-  std::string json_str = base64_decode(enc_str);
+  Arena<detail::payload_scratch_size> arena;
+  short_string<detail::payload_scratch_size> json_str{arena};
+
+  detail::stage_timer b64_timer{decode_stage::PAYLOAD_BASE64, enc_str.length()};
+  base64_decode(enc_str, json_str);
+  b64_timer.stop();
+
+  detail::stage_timer json_timer{decode_stage::PAYLOAD_JSON, json_str.length()};
   try {
-    payload_ = json_t::parse(std::move(json_str));
+    payload_ = json_t::parse(json_str.begin(), json_str.end());
   } catch(const std::exception&) {
     ec = DecodeErrc::JsonParseError;
     return;
   }
-  //populate the claims set
-  for (auto it = payload_.begin(); it != payload_.end(); ++it) {
-    auto ret = claim_names_.insert(it.key());
-    if (!ret.second) {
-      ec = DecodeErrc::DuplClaims;
-      break;
-    }
+
+  return;
+}
+
+inline void jwt_payload::decode(const segmented_view& enc_str, std::error_code& ec)
+{
+  if (enc_str.contiguous()) {
+    decode(enc_str.as_contiguous(), ec);
+    return;
+  }
+
+  ec.clear();
+  Arena<detail::payload_scratch_size> arena;
+  short_string<detail::payload_scratch_size> json_str{arena};
+
+  detail::stage_timer b64_timer{decode_stage::PAYLOAD_BASE64, enc_str.length()};
+  if (!base64_uri_decode(enc_str, json_str)) {
+    ec = DecodeErrc::JsonParseError;
+    return;
   }
+  b64_timer.stop();
 
+  detail::stage_timer json_timer{decode_stage::PAYLOAD_JSON, json_str.length()};
+  try {
+    payload_ = json_t::parse(json_str.begin(), json_str.end());
+  } catch(const std::exception&) {
+    ec = DecodeErrc::JsonParseError;
+    return;
+  }
+}
+
+inline void jwt_payload::to_binary(std::vector<uint8_t>& out) const
+{
+  detail::write_binary_prefix(out, detail::binary_kind::PAYLOAD);
+  detail::binary_write(payload_, out);
+}
+
+inline std::vector<uint8_t> jwt_payload::to_binary() const
+{
+  std::vector<uint8_t> out;
+  to_binary(out);
+  return out;
+}
+
+inline void jwt_payload::from_binary(const uint8_t* data, size_t len, std::error_code& ec)
+{
+  ec = detail::check_binary_prefix(data, len, detail::binary_kind::PAYLOAD);
+  if (ec) {
+    return;
+  }
+
+  ec = detail::read_binary_object(data + detail::binary_prefix_size,
+                                  len - detail::binary_prefix_size,
+                                  payload_);
+}
+
+inline void jwt_payload::from_binary(const uint8_t* data, size_t len)
+{
+  std::error_code ec;
+  from_binary(data, len, ec);
+  if (ec) {
+    throw DecodeError(ec.message());
+  }
   return;
 }
 
@@ -162,31 +346,35 @@ inline std::string jwt_signature::encode(const jwt_header& header,
 {
   std::string jwt_msg;
   ec.clear();
-  //TODO: Optimize allocations
 
   sign_func_t sign_fn = get_sign_algorithm_impl(header);
 
-  std::string hdr_sign = header.base64_encode();
-  std::string pld_sign = payload.base64_encode();
-  std::string data     = hdr_sign + '.' + pld_sign;
+  // The signing input is built in place in the message
+  header.base64_encode_append(jwt_msg);
+  jwt_msg += '.';
+  payload.base64_encode_append(jwt_msg);
+
+  const auto data_len = jwt_msg.length();
+  const jwt::string_view data{jwt_msg.data(), data_len};
 
-  auto res = sign_fn(key_, data);
+  auto res = handle_ ? get_sign_key_algorithm_impl(header)(handle_, data)
+                     : sign_fn(key_, data);
 
   if (res.second && res.second != AlgorithmErrc::NoneAlgorithmUsed) {
     ec = res.second;
     return {};
   }
 
-  std::string b64hash;
+  jwt_msg += '.';
 
   if (!res.second) {
-    b64hash = base64_encode(res.first.c_str(), res.first.length());
-  }
+    const auto pos = data_len + 1;
+    jwt_msg.resize(pos + encoding_size(res.first.length()));
 
-  auto new_len = base64_uri_encode(&b64hash[0], b64hash.length());
-  b64hash.resize(new_len);
-
-  jwt_msg = data + '.' + b64hash;
+    auto new_len = base64_encode(res.first.c_str(), res.first.length(), &jwt_msg[pos]);
+    new_len = base64_uri_encode(&jwt_msg[pos], new_len);
+    jwt_msg.resize(pos + new_len);
+  }
 
   return jwt_msg;
 }
@@ -200,69 +388,60 @@ inline verify_result_t jwt_signature::verify(const jwt_header& header,
     return {false, VerificationErrc::AlgoConfusionAttack};
   }
 
+  if (handle_) {
+    verify_key_func_t verify_fn = get_verify_key_algorithm_impl(header);
+    return verify_fn(handle_, segmented_view{hdr_pld_sign}, jwt_sign);
+  }
+
   verify_func_t verify_fn = get_verify_algorithm_impl(header);
   return verify_fn(key_, hdr_pld_sign, jwt_sign);
 }
 
+inline verify_result_t jwt_signature::verify(const jwt_header& header,
+                                             const segmented_view& hdr_pld_sign,
+                                             const jwt::string_view jwt_sign)
+{
+  if (hdr_pld_sign.contiguous()) {
+    return verify(header, hdr_pld_sign.as_contiguous(), jwt_sign);
+  }
+
+  auto check_res = check_for_algo_confusion_attack(header);
+  if (check_res.first) {
+    return {false, VerificationErrc::AlgoConfusionAttack};
+  }
+
+  verify_key_func_t verify_fn = get_verify_key_algorithm_impl(header);
+
+  if (handle_) {
+    return verify_fn(handle_, hdr_pld_sign, jwt_sign);
+  }
+
+  // The incremental verification works on key handles only
+  return verify_fn(jwt::key::from_secret(key_), hdr_pld_sign, jwt_sign);
+}
+
 inline verify_result_t jwt_signature::check_for_algo_confusion_attack(
   const jwt_header& hdr) const
 {
-  switch (hdr.algo()) {
-    case algorithm::RS256:
-    case algorithm::RS384:
-    case algorithm::RS512:
-    case algorithm::ES256:
-    case algorithm::ES384:
-    case algorithm::ES512:
-      return {false, std::error_code{}};
-    default:
-      // For all other cases make sure that the secret provided
-      // is not the public key.
-      return is_secret_a_public_key(key_);
+  if (algorithm_impl(hdr.algo()).key_kind == key_type::PUBLIC) {
+    return {false, std::error_code{}};
+  }
+
+  // For all other cases make sure that the secret provided
+  // is not the public key.
+  // The key handles know their type from when they were parsed.
+  if (handle_) {
+    return {handle_.type() != key_type::SECRET, std::error_code{}};
   }
+  return is_secret_a_public_key(key_);
 }
 
 
 inline sign_func_t
 jwt_signature::get_sign_algorithm_impl(const jwt_header& hdr) const noexcept
 {
-  sign_func_t ret = nullptr;
-
-  switch (hdr.algo()) {
-  case algorithm::HS256:
-    ret = HMACSign<algo::HS256>::sign;
-    break;
-  case algorithm::HS384:
-    ret = HMACSign<algo::HS384>::sign;
-    break;
-  case algorithm::HS512:
-    ret = HMACSign<algo::HS512>::sign;
-    break;
-  case algorithm::NONE:
-    ret = HMACSign<algo::NONE>::sign;
-    break;
-  case algorithm::RS256:
-    ret = PEMSign<algo::RS256>::sign;
-    break;
-  case algorithm::RS384:
-    ret = PEMSign<algo::RS384>::sign;
-    break;
-  case algorithm::RS512:
-    ret = PEMSign<algo::RS512>::sign;
-    break;
-  case algorithm::ES256:
-    ret = PEMSign<algo::ES256>::sign;
-    break;
-  case algorithm::ES384:
-    ret = PEMSign<algo::ES384>::sign;
-    break;
-  case algorithm::ES512:
-    ret = PEMSign<algo::ES512>::sign;
-    break;
-  default:
-    assert (0 && "Code not reached");
-  };
-
+  sign_func_t ret = algorithm_impl(hdr.algo()).sign;
+  assert (ret && "Code not reached");
   return ret;
 }
 
@@ -271,43 +450,26 @@ jwt_signature::get_sign_algorithm_impl(const jwt_header& hdr) const noexcept
 inline verify_func_t
 jwt_signature::get_verify_algorithm_impl(const jwt_header& hdr) const noexcept
 {
-  verify_func_t ret = nullptr;
-
-  switch (hdr.algo()) {
-  case algorithm::HS256:
-    ret = HMACSign<algo::HS256>::verify;
-    break;
-  case algorithm::HS384:
-    ret = HMACSign<algo::HS384>::verify;
-    break;
-  case algorithm::HS512:
-    ret = HMACSign<algo::HS512>::verify;
-    break;
-  case algorithm::NONE:
-    ret = HMACSign<algo::NONE>::verify;
-    break;
-  case algorithm::RS256:
-    ret = PEMSign<algo::RS256>::verify;
-    break;
-  case algorithm::RS384:
-    ret = PEMSign<algo::RS384>::verify;
-    break;
-  case algorithm::RS512:
-    ret = PEMSign<algo::RS512>::verify;
-    break;
-  case algorithm::ES256:
-    ret = PEMSign<algo::ES256>::verify;
-    break;
-  case algorithm::ES384:
-    ret = PEMSign<algo::ES384>::verify;
-    break;
-  case algorithm::ES512:
-    ret = PEMSign<algo::ES512>::verify;
-    break;
-  default:
-    assert (0 && "Code not reached");
-  };
+  verify_func_t ret = algorithm_impl(hdr.algo()).verify;
+  assert (ret && "Code not reached");
+  return ret;
+}
+
+
 
+inline sign_key_func_t
+jwt_signature::get_sign_key_algorithm_impl(const jwt_header& hdr) const noexcept
+{
+  sign_key_func_t ret = algorithm_impl(hdr.algo()).sign_key;
+  assert (ret && "Code not reached");
+  return ret;
+}
+
+inline verify_key_func_t
+jwt_signature::get_verify_key_algorithm_impl(const jwt_header& hdr) const noexcept
+{
+  verify_key_func_t ret = algorithm_impl(hdr.algo()).verify_key;
+  assert (ret && "Code not reached");
   return ret;
 }
 
@@ -325,21 +487,53 @@ jwt_object::jwt_object(
   set_parameters(std::forward<First>(first), std::forward<Rest>(rest)...);
 }
 
+namespace detail {
+
+/*!
+ * Moves a value out of a mapping owned by a parameter.
+ * Copies it if the parameter refers to the caller's mapping.
+ */
+template <typename Map, typename V>
+decltype(auto) forward_mapped(V& v) noexcept
+{
+  using ref_t = std::conditional_t<std::is_lvalue_reference<Map>::value, const V&, V&&>;
+  return static_cast<ref_t>(v);
+}
+
+} // END namespace detail
+
 template <typename Map, typename... Rest>
 void jwt_object::set_parameters(
     params::detail::payload_param<Map>&& payload, Rest&&... rargs)
 {
-  for (const auto& elem : payload.get()) {
-    payload_.add_claim(std::move(elem.first), std::move(elem.second));
+  auto&& claims = std::move(payload).get();
+  for (auto& elem : claims) {
+    payload_.add_claim(elem.first, detail::forward_mapped<Map>(elem.second));
   }
   set_parameters(std::forward<Rest>(rargs)...);
 }
 
+template <typename T, typename... Rest>
+void jwt_object::set_parameters(
+    params::detail::claims_param<T>&& claims, Rest&&... rargs)
+{
+  payload_.add_claims(json_t(std::move(claims).get()));
+  set_parameters(std::forward<Rest>(rargs)...);
+}
+
 template <typename... Rest>
 void jwt_object::set_parameters(
     params::detail::secret_param secret, Rest&&... rargs)
 {
-  secret_.assign(secret.get().data(), secret.get().length());
+  secret_ = jwt::key::from_secret(secret.get());
+  set_parameters(std::forward<Rest>(rargs)...);
+}
+
+template <typename... Rest>
+void jwt_object::set_parameters(
+    params::detail::key_param k, Rest&&... rargs)
+{
+  secret_ = k.get();
   set_parameters(std::forward<Rest>(rargs)...);
 }
 
@@ -355,8 +549,9 @@ template <typename Map, typename... Rest>
 void jwt_object::set_parameters(
     params::detail::headers_param<Map>&& header, Rest&&... rargs)
 {
-  for (const auto& elem : header.get()) {
-    header_.add_header(std::move(elem.first), std::move(elem.second));
+  auto&& headers = std::move(header).get();
+  for (auto& elem : headers) {
+    header_.add_header(elem.first, detail::forward_mapped<Map>(elem.second));
   }
 
   set_parameters(std::forward<Rest>(rargs)...);
@@ -389,7 +584,7 @@ inline std::string jwt_object::signature(std::error_code& ec) const
 
   //key/secret should be set for any algorithm except NONE
   if (header().algo() != jwt::algorithm::NONE) {
-    if (secret_.length() == 0) {
+    if (secret_.material().length() == 0) {
       ec = AlgorithmErrc::KeyNotFoundErr;
       return {};
     }
@@ -409,6 +604,75 @@ inline std::string jwt_object::signature() const
   return res;
 }
 
+inline std::vector<uint8_t> jwt_object::to_binary() const
+{
+  std::vector<uint8_t> out;
+  detail::write_binary_prefix(out, detail::binary_kind::OBJECT);
+
+  // Length of the header form, little endian
+  const size_t len_pos = out.size();
+  out.resize(len_pos + 4);
+
+  header_.to_binary(out);
+  const auto hdr_len = static_cast<uint32_t>(out.size() - len_pos - 4);
+  for (size_t i = 0; i < 4; ++i) {
+    out[len_pos + i] = static_cast<uint8_t>(hdr_len >> (8 * i));
+  }
+
+  payload_.to_binary(out);
+  return out;
+}
+
+inline void jwt_object::from_binary(const uint8_t* data, size_t len, std::error_code& ec)
+{
+  ec = detail::check_binary_prefix(data, len, detail::binary_kind::OBJECT);
+  if (ec) {
+    return;
+  }
+
+  if (len < detail::binary_prefix_size + 4) {
+    ec = DecodeErrc::BinaryFormatError;
+    return;
+  }
+
+  const uint8_t* rest = data + detail::binary_prefix_size;
+  size_t hdr_len = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    hdr_len |= static_cast<size_t>(rest[i]) << (8 * i);
+  }
+
+  rest += 4;
+  const size_t rest_len = len - detail::binary_prefix_size - 4;
+  if (hdr_len > rest_len) {
+    ec = DecodeErrc::BinaryFormatError;
+    return;
+  }
+
+  jwt_header hdr;
+  hdr.from_binary(rest, hdr_len, ec);
+  if (ec) {
+    return;
+  }
+
+  jwt_payload pld;
+  pld.from_binary(rest + hdr_len, rest_len - hdr_len, ec);
+  if (ec) {
+    return;
+  }
+
+  header_ = std::move(hdr);
+  payload_ = std::move(pld);
+}
+
+inline void jwt_object::from_binary(const uint8_t* data, size_t len)
+{
+  std::error_code ec;
+  from_binary(data, len, ec);
+  if (ec) {
+    throw DecodeError(ec.message());
+  }
+}
+
 template <typename Params, typename SequenceT>
 std::error_code jwt_object::verify(
     const Params& dparams,
@@ -560,10 +824,28 @@ jwt_object::three_parts(const jwt::string_view enc_str)
   return result;
 }
 
+inline std::array<segmented_view, 3>
+jwt_object::three_parts(const segmented_view& enc_str)
+{
+  std::array<segmented_view, 3> result;
+
+  size_t fpos = enc_str.find('.');
+  assert (fpos != segmented_view::npos);
+
+  result[0] = enc_str.subview(0, fpos);
+
+  size_t spos = enc_str.find('.', fpos + 1);
+
+  result[1] = enc_str.subview(fpos + 1, spos - fpos - 1);
+  result[2] = enc_str.subview(spos + 1);
+
+  return result;
+}
+
 template <typename DecodeParams, typename... Rest>
 void jwt_object::set_decode_params(DecodeParams& dparams, params::detail::secret_param s, Rest&&... args)
 {
-  dparams.secret.assign(s.get().data(), s.get().length());
+  dparams.secret = s.get();
   dparams.has_secret = true;
   jwt_object::set_decode_params(dparams, std::forward<Rest>(args)...);
 }
@@ -571,7 +853,25 @@ void jwt_object::set_decode_params(DecodeParams& dparams, params::detail::secret
 template <typename DecodeParams, typename T, typename... Rest>
 void jwt_object::set_decode_params(DecodeParams& dparams, params::detail::secret_function_param<T>&& s, Rest&&... args)
 {
-  dparams.secret = s.get(*dparams.payload_ptr);
+  // The returned secret would not outlive the decode call, so
+  // it is owned by a key handle instead of being borrowed.
+  dparams.key = jwt::key::from_secret(s.get(*dparams.payload_ptr));
+  dparams.has_secret = true;
+  jwt_object::set_decode_params(dparams, std::forward<Rest>(args)...);
+}
+
+template <typename DecodeParams, typename... Rest>
+void jwt_object::set_decode_params(DecodeParams& dparams, params::detail::key_param k, Rest&&... args)
+{
+  dparams.key = k.get();
+  dparams.has_secret = true;
+  jwt_object::set_decode_params(dparams, std::forward<Rest>(args)...);
+}
+
+template <typename DecodeParams, typename... Rest>
+void jwt_object::set_decode_params(DecodeParams& dparams, params::detail::key_ring_param r, Rest&&... args)
+{
+  dparams.ring = &r.get();
   dparams.has_secret = true;
   jwt_object::set_decode_params(dparams, std::forward<Rest>(args)...);
 }
@@ -628,6 +928,42 @@ void jwt_object::set_decode_params(DecodeParams& dparams, params::detail::valida
   jwt_object::set_decode_params(dparams, std::forward<Rest>(args)...);
 }
 
+template <typename DecodeParams, typename... Rest>
+void jwt_object::set_decode_params(DecodeParams& dparams, params::detail::cache_param, Rest&&... args)
+{
+  // Handled by decode before getting here
+  jwt_object::set_decode_params(dparams, std::forward<Rest>(args)...);
+}
+
+template <typename DecodeParams, typename... Rest>
+void jwt_object::set_decode_params(DecodeParams& dparams, params::detail::shared_cache_param, Rest&&... args)
+{
+  // Handled by decode before getting here
+  jwt_object::set_decode_params(dparams, std::forward<Rest>(args)...);
+}
+
+template <typename DecodeParams, typename... Rest>
+void jwt_object::set_decode_params(DecodeParams& dparams, params::detail::replay_param r, Rest&&... args)
+{
+  dparams.replay = &r.get();
+  dparams.validate_jti = true;
+  jwt_object::set_decode_params(dparams, std::forward<Rest>(args)...);
+}
+
+template <typename DecodeParams, typename... Rest>
+void jwt_object::set_decode_params(DecodeParams& dparams, params::detail::revoked_param r, Rest&&... args)
+{
+  dparams.revoked = &r.get();
+  jwt_object::set_decode_params(dparams, std::forward<Rest>(args)...);
+}
+
+template <typename DecodeParams, typename... Rest>
+void jwt_object::set_decode_params(DecodeParams& dparams, params::detail::max_length_param, Rest&&... args)
+{
+  // Handled by decode before getting here
+  jwt_object::set_decode_params(dparams, std::forward<Rest>(args)...);
+}
+
 template <typename DecodeParams>
 void jwt_object::set_decode_params(DecodeParams& dparams)
 {
@@ -637,13 +973,127 @@ void jwt_object::set_decode_params(DecodeParams& dparams)
 
 //==================================================================
 
-template <typename SequenceT, typename... Args>
-jwt_object decode(const jwt::string_view enc_str,
-                  const params::detail::algorithms_param<SequenceT>& algos,
-                  std::error_code& ec,
-                  Args&&... args)
+namespace detail {
+
+inline std::error_code pending_signature::run(const jwt_header& hdr,
+                                             const jwt::string_view enc_str)
+{
+  //MemoryAllocationError is not caught
+  verify_result_t res = sign.verify(
+      hdr,
+      jwt::string_view{enc_str.data(), signed_len},
+      jwt::string_view{enc_str.data() + sign_pos, enc_str.length() - sign_pos});
+
+  if (res.second) return res.second;
+  if (!res.first) return VerificationErrc::InvalidSignature;
+
+  if (replay && !replay->insert(jti, jti_expiry)) {
+    return VerificationErrc::TokenReplayed;
+  }
+
+  return {};
+}
+
+/*!
+ * Calls `fn` with the bytes of `v` as a single
+ * `jwt::string_view`, gathering them in a scratch
+ * buffer if they span segments.
+ */
+template <typename Func>
+decltype(auto) with_contiguous(const segmented_view& v, Func&& fn)
+{
+  if (v.contiguous()) {
+    return fn(v.as_contiguous());
+  }
+
+  Arena<signature_scratch_size> arena;
+  short_string<signature_scratch_size> buf{arena};
+  buf.resize(v.length());
+  v.copy(&buf[0]);
+
+  return fn(jwt::string_view{buf.data(), buf.length()});
+}
+
+inline std::error_code pending_signature::run(const jwt_header& hdr,
+                                             const segmented_view& enc_str)
+{
+  if (enc_str.contiguous()) {
+    return run(hdr, enc_str.as_contiguous());
+  }
+
+  // Only the signature is gathered, the signed part
+  // is fed to the verifier segment by segment.
+  verify_result_t res = with_contiguous(
+      enc_str.subview(sign_pos),
+      [&](const jwt::string_view jwt_sign) {
+        //MemoryAllocationError is not caught
+        return sign.verify(hdr, enc_str.subview(0, signed_len), jwt_sign);
+      });
+
+  if (res.second) return res.second;
+  if (!res.first) return VerificationErrc::InvalidSignature;
+
+  if (replay && !replay->insert(jti, jti_expiry)) {
+    return VerificationErrc::TokenReplayed;
+  }
+
+  return {};
+}
+
+/*!
+ * Number of dots in the token.
+ */
+inline size_t dot_count(const jwt::string_view enc_str)
+{
+  return static_cast<size_t>(std::count(std::begin(enc_str), std::end(enc_str), '.'));
+}
+
+inline size_t dot_count(const segmented_view& enc_str)
+{
+  return enc_str.count('.');
+}
+
+/*!
+ * Looks up the encoded signature in the revoked set.
+ */
+template <typename Revoked>
+bool is_revoked_signature(const Revoked& revoked, const jwt::string_view sig)
+{
+  return revoked.is_revoked_signature(sig);
+}
+
+template <typename Revoked>
+bool is_revoked_signature(const Revoked& revoked, const segmented_view& sig)
+{
+  return with_contiguous(sig, [&](const jwt::string_view s) {
+    return revoked.is_revoked_signature(s);
+  });
+}
+
+/*!
+ * The jti claim as a string. Values of other
+ * types are taken in their JSON form.
+ */
+inline std::string jti_value(const jwt_payload& payload)
+{
+  const json_t& jti = payload.create_json_obj()["jti"];
+  return jti.is_string() ? jti.get<std::string>() : jti.dump();
+}
+
+/*!
+ * Parses the token and runs all the checks up to,
+ * but not including, the signature verification
+ * which is left in `pending`.
+ */
+template <typename TokenT, typename SequenceT, typename... Args>
+jwt_object decode_prepare(const TokenT& enc_str,
+                          const params::detail::algorithms_param<SequenceT>& algos,
+                          std::error_code& ec,
+                          pending_signature& pending,
+                          Args&&... args)
 {
   ec.clear();
+  pending.required = false;
   jwt_object obj;
 
   if (algos.get().size() == 0) {
@@ -653,9 +1103,13 @@ jwt_object decode(const jwt::string_view enc_str,
 
   struct decode_params
   {
-    /// key to decode the JWS
+    /// key to decode the JWS. Borrowed from the caller.
     bool has_secret = false;
-    std::string secret;
+    jwt::string_view secret;
+
+    /// Parsed key or key ring. Take precedence over `secret`.
+    jwt::key key;
+    const jwt::key_ring* ring = nullptr;
 
     /// Verify parameter. Defaulted to true.
     bool verify = true;
@@ -684,20 +1138,33 @@ jwt_object decode(const jwt::string_view enc_str,
     //Validate JTI
     bool validate_jti = false;
     const jwt_payload* payload_ptr = 0;
+
+    //Replay protection. Implies validate_jti.
+    jwt::jti_store* replay = nullptr;
+
+    //Revoked tokens
+    const jwt::revocation_set* revoked = nullptr;
   };
 
   decode_params dparams{};
-  
+
+  stage_timer split_timer{decode_stage::SPLIT, enc_str.length()};
+
+  const auto* max_len = params::detail::find_param<params::detail::max_length_param>(args...);
+  if (max_len && enc_str.length() > max_len->get()) {
+    ec = DecodeErrc::TokenTooLarge;
+    return obj;
+  }
 
   //Signature must have atleast 2 dots
-  auto dot_cnt = std::count_if(std::begin(enc_str), std::end(enc_str),
-                               [](char ch) { return ch == '.'; });
+  auto dot_cnt = dot_count(enc_str);
   if (dot_cnt < 2) {
     ec = DecodeErrc::SignatureFormatError;
     return obj;
   }
 
   auto parts = jwt_object::three_parts(enc_str);
+  split_timer.stop();
 
   //throws decode error
   jwt_header hdr{};
@@ -705,6 +1172,7 @@ jwt_object decode(const jwt::string_view enc_str,
   if (ec) {
     return obj;
   }
+  trace_algorithm(hdr.algo());
   //obj.header(jwt_header{parts[0]});
   obj.header(std::move(hdr));
 
@@ -732,6 +1200,7 @@ jwt_object decode(const jwt::string_view enc_str,
   dparams.payload_ptr = & obj.payload();
   jwt_object::set_decode_params(dparams, std::forward<Args>(args)...);
   if (dparams.verify) {
+    stage_timer claims_timer{decode_stage::CLAIMS, 0};
     try {
       ec = obj.verify(dparams, algos);
     } catch (const json_ns::detail::type_error&) {
@@ -740,6 +1209,23 @@ jwt_object decode(const jwt::string_view enc_str,
 
     if (ec) return obj;
 
+    if (dparams.revoked) {
+      if (parts[2].length() && is_revoked_signature(*dparams.revoked, parts[2])) {
+        ec = VerificationErrc::TokenRevoked;
+        return obj;
+      }
+      if (obj.has_claim("jti")) {
+        const json_t& jti = obj.payload().create_json_obj()["jti"];
+        bool hit = jti.is_string()
+                   ? dparams.revoked->is_revoked_jti(jti.get_ref<const std::string&>())
+                   : dparams.revoked->is_revoked_jti(jti.dump());
+        if (hit) {
+          ec = VerificationErrc::TokenRevoked;
+          return obj;
+        }
+      }
+    }
+
     //Verify the signature only if some algorithm was used
     if (obj.header().algo() != algorithm::NONE)
     {
@@ -747,22 +1233,42 @@ jwt_object decode(const jwt::string_view enc_str,
         ec = DecodeErrc::KeyNotPresent;
         return obj;
       }
-      jwt_signature jsign{dparams.secret};
- 
-      // Length of the encoded header and payload only.
-      // Addition of '1' to account for the '.' character.
-      auto l = parts[0].length() + 1 + parts[1].length();
+      jwt::key vkey = dparams.key;
+
+      if (dparams.ring) {
+        vkey = dparams.ring->find(obj.header().kid());
+        if (!vkey) {
+          ec = DecodeErrc::KeyNotPresent;
+          return obj;
+        }
+      }
 
-      //MemoryAllocationError is not caught
-      verify_result_t res = jsign.verify(obj.header(), enc_str.substr(0, l), parts[2]);
-      if (res.second) {
-        ec = res.second;
+      if (vkey && vkey.algo() != algorithm::UNKN &&
+          vkey.algo() != obj.header().algo()) {
+        ec = VerificationErrc::InvalidAlgorithm;
         return obj;
       }
 
-      if (!res.first) {
-        ec = VerificationErrc::InvalidSignature;
-        return obj;
+      pending.sign = vkey ? jwt_signature{vkey}
+                          : jwt_signature{dparams.secret};
+
+      // Length of the encoded header and payload only.
+      // Addition of '1' to account for the '.' character.
+      pending.signed_len = parts[0].length() + 1 + parts[1].length();
+      pending.sign_pos = pending.signed_len + 1;
+      pending.required = true;
+
+      if (dparams.replay) {
+        pending.jti = jti_value(obj.payload());
+
+        // Past `exp` the token is rejected as expired anyway
+        auto curr_time = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        pending.jti_expiry = obj.has_claim(registered_claims::expiration)
+            ? obj.payload().get_claim_value<uint64_t>(registered_claims::expiration) + dparams.leeway
+            : dparams.replay->default_expiry(static_cast<uint64_t>(curr_time));
+        pending.replay = dparams.replay;
       }
     } else {
       ec = AlgorithmErrc::NoneAlgorithmUsed;
@@ -772,6 +1278,165 @@ jwt_object decode(const jwt::string_view enc_str,
   return obj; 
 }
 
+/*!
+ * Decodes the token without consulting the cache.
+ */
+template <typename TokenT, typename SequenceT, typename... Args>
+jwt_object decode_uncached(const TokenT& enc_str,
+                           const params::detail::algorithms_param<SequenceT>& algos,
+                           std::error_code& ec,
+                           Args&&... args)
+{
+  pending_signature pending;
+  jwt_object obj = decode_prepare(enc_str, algos, ec, pending, std::forward<Args>(args)...);
+
+  if (!ec && pending.required) {
+    stage_timer sign_timer{decode_stage::SIGNATURE, pending.signed_len};
+    ec = pending.run(obj.header(), enc_str);
+  }
+
+  return obj;
+}
+
+/*!
+ * Checks if a `cache` or a `shared_cache` parameter is passed.
+ */
+template <typename... Args>
+using has_cache_param = std::integral_constant<bool,
+  meta::has_type<params::detail::cache_param, meta::list<std::decay_t<Args>...>>::value ||
+  meta::has_type<params::detail::shared_cache_param, meta::list<std::decay_t<Args>...>>::value
+>;
+
+/*!
+ * Decodes through the cache. The cache type is kept
+ * a template parameter so that "jwt/token_cache.hpp"
+ * is only required by callers passing one.
+ */
+template <typename Cache, typename DecodeFn>
+jwt_object decode_through(Cache& cache,
+                          const jwt::string_view enc_str,
+                          std::error_code& ec,
+                          DecodeFn&& decode_fn)
+{
+  return cache.decode(enc_str, ec, std::forward<DecodeFn>(decode_fn));
+}
+
+/*!
+ * Decodes through the caches passed. The tags tell if
+ * the process local and the shared cache are passed. The
+ * local one is consulted first.
+ */
+template <typename SequenceT, typename... Args>
+jwt_object decode_cached(std::false_type,
+                         std::false_type,
+                         const jwt::string_view enc_str,
+                         const params::detail::algorithms_param<SequenceT>& algos,
+                         std::error_code& ec,
+                         Args&&... args)
+{
+  return decode_uncached(enc_str, algos, ec, args...);
+}
+
+template <typename SequenceT, typename... Args>
+jwt_object decode_cached(std::false_type,
+                         std::true_type,
+                         const jwt::string_view enc_str,
+                         const params::detail::algorithms_param<SequenceT>& algos,
+                         std::error_code& ec,
+                         Args&&... args)
+{
+  auto& cache = params::detail::find_param<params::detail::shared_cache_param>(args...)->get();
+  return decode_through(cache, enc_str, ec, [&](std::error_code& dec_ec) {
+    return decode_uncached(enc_str, algos, dec_ec, args...);
+  });
+}
+
+template <typename HasShared, typename SequenceT, typename... Args>
+jwt_object decode_cached(std::true_type,
+                         HasShared,
+                         const jwt::string_view enc_str,
+                         const params::detail::algorithms_param<SequenceT>& algos,
+                         std::error_code& ec,
+                         Args&&... args)
+{
+  auto& cache = params::detail::find_param<params::detail::cache_param>(args...)->get();
+  return decode_through(cache, enc_str, ec, [&](std::error_code& dec_ec) {
+    return decode_cached(std::false_type{}, HasShared{}, enc_str, algos, dec_ec, args...);
+  });
+}
+
+template <typename SequenceT, typename... Args>
+jwt_object decode_dispatch(std::false_type,
+                           const jwt::string_view enc_str,
+                           const params::detail::algorithms_param<SequenceT>& algos,
+                           std::error_code& ec,
+                           Args&&... args)
+{
+  return decode_uncached(enc_str, algos, ec, std::forward<Args>(args)...);
+}
+
+template <typename SequenceT, typename... Args>
+jwt_object decode_dispatch(std::true_type,
+                           const jwt::string_view enc_str,
+                           const params::detail::algorithms_param<SequenceT>& algos,
+                           std::error_code& ec,
+                           Args&&... args)
+{
+  const auto* verify = params::detail::find_param<params::detail::verify_param>(args...);
+
+  const auto* replay = params::detail::find_param<params::detail::replay_param>(args...);
+
+  // Results decoded without verification are not worth caching,
+  // and a cache hit would let a replayed token through.
+  if ((verify && !verify->get()) || replay) {
+    return decode_uncached(enc_str, algos, ec, std::forward<Args>(args)...);
+  }
+
+  using arg_list = meta::list<std::decay_t<Args>...>;
+  using has_local = meta::has_type<params::detail::cache_param, arg_list>;
+  using has_shared = meta::has_type<params::detail::shared_cache_param, arg_list>;
+
+  return decode_cached(has_local{}, has_shared{}, enc_str, algos, ec, args...);
+}
+
+template <typename SequenceT, typename... Args>
+jwt_object decode_segmented(std::false_type,
+                            const segmented_view& enc_str,
+                            const params::detail::algorithms_param<SequenceT>& algos,
+                            std::error_code& ec,
+                            Args&&... args)
+{
+  return decode_uncached(enc_str, algos, ec, std::forward<Args>(args)...);
+}
+
+template <typename SequenceT, typename... Args>
+jwt_object decode_segmented(std::true_type,
+                            const segmented_view& enc_str,
+                            const params::detail::algorithms_param<SequenceT>& algos,
+                            std::error_code& ec,
+                            Args&&... args)
+{
+  // The cache is keyed on the whole token
+  std::string token(enc_str.length(), '\0');
+  enc_str.copy(&token[0]);
+
+  return jwt::decode(jwt::string_view{token}, algos, ec, std::forward<Args>(args)...);
+}
+
+} // END namespace detail
+
+template <typename SequenceT, typename... Args>
+jwt_object decode(const jwt::string_view enc_str,
+                  const params::detail::algorithms_param<SequenceT>& algos,
+                  std::error_code& ec,
+                  Args&&... args)
+{
+  using has_cache = detail::has_cache_param<Args...>;
+
+  detail::decode_tracer tracer{enc_str.length(), ec};
+  return detail::decode_dispatch(has_cache{}, enc_str, algos, ec, std::forward<Args>(args)...);
+}
+
 
 
 template <typename SequenceT, typename... Args>
@@ -792,6 +1457,129 @@ jwt_object decode(const jwt::string_view enc_str,
   return jwt_obj;
 }
 
+inline jwt::string_view bearer_token(const jwt::string_view header_value,
+                                     std::error_code& ec,
+                                     size_t max_len) noexcept
+{
+  ec.clear();
+
+  auto is_ws = [](char ch) { return ch == ' ' || ch == '\t'; };
+
+  const char* first = header_value.data();
+  const char* last = first + header_value.length();
+
+  while (first != last && is_ws(*first)) ++first;
+  while (last != first && is_ws(*(last - 1))) --last;
+
+  // The scheme must be followed by atleast one space
+  constexpr size_t scheme_len = 6;
+  const size_t value_len = static_cast<size_t>(last - first);
+  if (value_len < scheme_len ||
+      strncasecmp(first, "Bearer", scheme_len) ||
+      (value_len > scheme_len && !is_ws(first[scheme_len]))) {
+    ec = DecodeErrc::AuthSchemeMismatch;
+    return {};
+  }
+
+  first += scheme_len;
+  while (first != last && is_ws(*first)) ++first;
+
+  const size_t len = static_cast<size_t>(last - first);
+  if (len > max_len) {
+    ec = DecodeErrc::TokenTooLarge;
+    return {};
+  }
+
+  // token68 characters, with the padding only at the end
+  const char* pad = last;
+  while (pad != first && *(pad - 1) == '=') --pad;
+
+  bool valid = pad != first;
+  for (const char* p = first; valid && p != pad; ++p) {
+    const char ch = *p;
+    valid = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+            (ch >= '0' && ch <= '9') ||
+            ch == '-' || ch == '.' || ch == '_' || ch == '~' ||
+            ch == '+' || ch == '/';
+  }
+
+  if (!valid) {
+    ec = DecodeErrc::SignatureFormatError;
+    return {};
+  }
+
+  return jwt::string_view{first, len};
+}
+
+template <typename SequenceT, typename... Args>
+jwt_object decode_bearer(const jwt::string_view header_value,
+                         const params::detail::algorithms_param<SequenceT>& algos,
+                         std::error_code& ec,
+                         Args&&... args)
+{
+  const auto* max_len = params::detail::find_param<params::detail::max_length_param>(args...);
+
+  jwt::string_view token = bearer_token(
+      header_value, ec, max_len ? max_len->get() : detail::default_max_bearer_length);
+  if (ec) {
+    return jwt_object{};
+  }
+
+  return decode(token, algos, ec, std::forward<Args>(args)...);
+}
+
+template <typename SequenceT, typename... Args>
+jwt_object decode_bearer(const jwt::string_view header_value,
+                         const params::detail::algorithms_param<SequenceT>& algos,
+                         Args&&... args)
+{
+  std::error_code ec{};
+  auto jwt_obj = decode_bearer(header_value,
+                               algos,
+                               ec,
+                               std::forward<Args>(args)...);
+
+  if (ec) {
+    jwt_throw_exception(ec);
+  }
+
+  return jwt_obj;
+}
+
+template <typename SequenceT, typename... Args>
+jwt_object decode(const segmented_view& enc_str,
+                  const params::detail::algorithms_param<SequenceT>& algos,
+                  std::error_code& ec,
+                  Args&&... args)
+{
+  if (enc_str.contiguous()) {
+    return decode(enc_str.as_contiguous(), algos, ec, std::forward<Args>(args)...);
+  }
+
+  using has_cache = detail::has_cache_param<Args...>;
+
+  detail::decode_tracer tracer{enc_str.length(), ec};
+  return detail::decode_segmented(has_cache{}, enc_str, algos, ec, std::forward<Args>(args)...);
+}
+
+template <typename SequenceT, typename... Args>
+jwt_object decode(const segmented_view& enc_str,
+                  const params::detail::algorithms_param<SequenceT>& algos,
+                  Args&&... args)
+{
+  std::error_code ec{};
+  auto jwt_obj = decode(enc_str,
+                        algos,
+                        ec,
+                        std::forward<Args>(args)...);
+
+  if (ec) {
+    jwt_throw_exception(ec);
+  }
+
+  return jwt_obj;
+}
+
 
 void jwt_throw_exception(const std::error_code& ec)
 {
@@ -842,6 +1630,14 @@ void jwt_throw_exception(const std::error_code& ec)
       {
         throw TypeConversionError(ec.message());
       }
+      case VerificationErrc::TokenReplayed:
+      {
+        throw TokenReplayedError(ec.message());
+      }
+      case VerificationErrc::TokenRevoked:
+      {
+        throw TokenRevokedError(ec.message());
+      }
       default:
         assert (0 && "Unknown error code");
     };
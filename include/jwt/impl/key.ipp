@@ -0,0 +1,445 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_KEY_IPP
+#define CPP_JWT_KEY_IPP
+
+namespace jwt {
+
+inline EVP_PKEY* key::parse_pem(const jwt::string_view pem, SCOPED_ENUM key_type& type)
+{
+  type = key_type::NONE;
+
+  // Cheap check to avoid handing every HMAC secret to the PEM parser
+  static const char marker[] = "-----BEGIN";
+  if (std::search(pem.begin(), pem.end(),
+                  marker, marker + sizeof(marker) - 1) == pem.end()) {
+    return nullptr;
+  }
+
+  BIO_uptr bio_ptr{
+      BIO_new_mem_buf((void*)pem.data(), static_cast<int>(pem.length())),
+      bio_deletor};
+
+  if (!bio_ptr) {
+    throw MemoryAllocationException("BIO_new_mem_buf failed");
+  }
+
+  EVP_PKEY* pkey = PEM_read_bio_PUBKEY(bio_ptr.get(), nullptr, nullptr, nullptr);
+  if (pkey) {
+    type = key_type::PUBLIC;
+    return pkey;
+  }
+
+  if (BIO_reset(bio_ptr.get()) != 1) {
+    return nullptr;
+  }
+
+  pkey = PEM_read_bio_PrivateKey(bio_ptr.get(), nullptr, nullptr, nullptr);
+  if (pkey) {
+    type = key_type::PRIVATE;
+  }
+
+  return pkey;
+}
+
+inline EVP_PKEY* key::parse_der(const jwt::string_view der, SCOPED_ENUM key_type& type)
+{
+  type = key_type::NONE;
+
+  auto begin = reinterpret_cast<const unsigned char*>(der.data());
+  auto end = begin + der.length();
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  // d2i_PUBKEY costs two orders of magnitude more than
+  // importing the components, which matters for large key sets
+  detail::spki_parts parts;
+  if (detail::der_read_spki(begin, der.length(), parts)) {
+    bool handled = false;
+    EVP_PKEY* imported = import_public(parts, handled);
+    if (handled) {
+      if (imported) {
+        type = key_type::PUBLIC;
+      }
+      return imported;
+    }
+  }
+#endif
+
+  // Trailing bytes are not part of a key
+  auto whole = [end](EVP_PKEY* pkey, const unsigned char* in) -> EVP_PKEY* {
+    if (pkey && in != end) {
+      EVP_PKEY_free(pkey);
+      return nullptr;
+    }
+    return pkey;
+  };
+
+  const unsigned char* in = begin;
+  EVP_PKEY* pkey = d2i_PUBKEY(nullptr, &in, static_cast<long>(der.length()));
+  if (pkey) {
+    pkey = whole(pkey, in);
+    if (pkey) {
+      type = key_type::PUBLIC;
+    }
+    return pkey;
+  }
+
+  // PKCS#8 or the traditional form of the key type
+  in = begin;
+  pkey = d2i_AutoPrivateKey(nullptr, &in, static_cast<long>(der.length()));
+  pkey = whole(pkey, in);
+  if (pkey) {
+    type = key_type::PRIVATE;
+  }
+
+  return pkey;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+inline EVP_PKEY* key::import_public(const detail::spki_parts& parts, bool& handled)
+{
+  handled = false;
+
+  auto oid_is = [&parts](const uint8_t* oid, size_t len) {
+    return parts.oid_len == len && std::equal(oid, oid + len, parts.oid);
+  };
+
+  std::unique_ptr<OSSL_PARAM_BLD, decltype(&OSSL_PARAM_BLD_free)>
+    bld{OSSL_PARAM_BLD_new(), OSSL_PARAM_BLD_free};
+  std::unique_ptr<BIGNUM, decltype(&BN_free)> n{nullptr, BN_free};
+  std::unique_ptr<BIGNUM, decltype(&BN_free)> e{nullptr, BN_free};
+  const char* name = nullptr;
+
+  if (oid_is(detail::der_oid_rsa, sizeof(detail::der_oid_rsa))) {
+    handled = true;
+    name = "RSA";
+
+    // The parameters must be NULL or absent
+    static const uint8_t null_params[] = {0x05, 0x00};
+    if (parts.params_len && !(parts.params_len == sizeof(null_params) &&
+          std::equal(null_params, null_params + sizeof(null_params), parts.params))) {
+      return nullptr;
+    }
+
+    const uint8_t* n_bytes = nullptr;
+    const uint8_t* e_bytes = nullptr;
+    size_t n_len = 0;
+    size_t e_len = 0;
+    if (!detail::der_read_rsa_public(parts.key, parts.key_len, n_bytes, n_len, e_bytes, e_len)) {
+      return nullptr;
+    }
+
+    n.reset(BN_bin2bn(n_bytes, static_cast<int>(n_len), nullptr));
+    e.reset(BN_bin2bn(e_bytes, static_cast<int>(e_len), nullptr));
+    if (!bld || !n || !e ||
+        !OSSL_PARAM_BLD_push_BN(bld.get(), OSSL_PKEY_PARAM_RSA_N, n.get()) ||
+        !OSSL_PARAM_BLD_push_BN(bld.get(), OSSL_PKEY_PARAM_RSA_E, e.get())) {
+      return nullptr;
+    }
+  }
+  else if (oid_is(detail::der_oid_ec, sizeof(detail::der_oid_ec))) {
+    auto params_is = [&parts](const uint8_t* oid, size_t len) {
+      return parts.params_len == len && std::equal(oid, oid + len, parts.params);
+    };
+
+    const char* group = nullptr;
+    if (params_is(detail::der_oid_p256, sizeof(detail::der_oid_p256))) {
+      group = "P-256";
+    } else if (params_is(detail::der_oid_p384, sizeof(detail::der_oid_p384))) {
+      group = "P-384";
+    } else if (params_is(detail::der_oid_p521, sizeof(detail::der_oid_p521))) {
+      group = "P-521";
+    } else {
+      // Other curves are left to the generic decoder
+      return nullptr;
+    }
+
+    handled = true;
+    name = "EC";
+
+    // Importing checks that the point is on the curve
+    if (!bld ||
+        !OSSL_PARAM_BLD_push_utf8_string(bld.get(), OSSL_PKEY_PARAM_GROUP_NAME, group, 0) ||
+        !OSSL_PARAM_BLD_push_octet_string(bld.get(), OSSL_PKEY_PARAM_PUB_KEY,
+                                          parts.key, parts.key_len)) {
+      return nullptr;
+    }
+  }
+  else {
+    return nullptr;
+  }
+
+  std::unique_ptr<OSSL_PARAM, decltype(&OSSL_PARAM_free)>
+    params{OSSL_PARAM_BLD_to_param(bld.get()), OSSL_PARAM_free};
+  std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)>
+    ctx{EVP_PKEY_CTX_new_from_name(nullptr, name, nullptr), EVP_PKEY_CTX_free};
+
+  EVP_PKEY* pkey = nullptr;
+  if (!params || !ctx ||
+      EVP_PKEY_fromdata_init(ctx.get()) <= 0 ||
+      EVP_PKEY_fromdata(ctx.get(), &pkey, EVP_PKEY_PUBLIC_KEY, params.get()) <= 0) {
+    return nullptr;
+  }
+
+  return pkey;
+}
+#endif
+
+inline key key::from_secret(const jwt::string_view secret, SCOPED_ENUM algorithm alg)
+{
+  auto d = std::make_shared<data>();
+  d->alg = alg;
+  d->material.assign(secret.data(), secret.length());
+
+  key_type type = key_type::NONE;
+  d->pkey.reset(parse_pem(d->material, type));
+
+  d->type = d->pkey ? type : key_type::SECRET;
+
+  return key{std::move(d)};
+}
+
+inline key key::from_raw_secret(const jwt::string_view secret, SCOPED_ENUM algorithm alg)
+{
+  auto d = std::make_shared<data>();
+  d->alg = alg;
+  d->type = key_type::SECRET;
+  d->material.assign(secret.data(), secret.length());
+
+  return key{std::move(d)};
+}
+
+inline key key::from_pem(const jwt::string_view pem,
+                         std::error_code& ec,
+                         SCOPED_ENUM algorithm alg)
+{
+  ec.clear();
+
+  auto d = std::make_shared<data>();
+  d->alg = alg;
+  d->material.assign(pem.data(), pem.length());
+  d->pkey.reset(parse_pem(d->material, d->type));
+
+  if (!d->pkey) {
+    ec = AlgorithmErrc::InvalidKeyErr;
+    return {};
+  }
+
+  return key{std::move(d)};
+}
+
+inline key key::from_pem(const jwt::string_view pem, SCOPED_ENUM algorithm alg)
+{
+  std::error_code ec;
+  key k = from_pem(pem, ec, alg);
+  if (ec) {
+    throw InvalidKeyError(ec.message());
+  }
+  return k;
+}
+
+inline key key::from_der(const jwt::string_view der,
+                         std::error_code& ec,
+                         SCOPED_ENUM algorithm alg)
+{
+  ec.clear();
+
+  auto d = std::make_shared<data>();
+  d->alg = alg;
+  d->der = true;
+  d->material.assign(der.data(), der.length());
+  d->pkey.reset(parse_der(d->material, d->type));
+
+  if (!d->pkey) {
+    ec = AlgorithmErrc::InvalidKeyErr;
+    return {};
+  }
+
+  return key{std::move(d)};
+}
+
+inline key key::from_der(const jwt::string_view der, SCOPED_ENUM algorithm alg)
+{
+  std::error_code ec;
+  key k = from_der(der, ec, alg);
+  if (ec) {
+    throw InvalidKeyError(ec.message());
+  }
+  return k;
+}
+
+inline key key::from_ec_point(const jwt::string_view point,
+                              SCOPED_ENUM algorithm alg,
+                              std::error_code& ec)
+{
+  ec.clear();
+
+  const uint8_t* oid = nullptr;
+  size_t oid_len = 0;
+
+  switch (alg) {
+    case algorithm::ES256:
+      oid = detail::der_oid_p256;
+      oid_len = sizeof(detail::der_oid_p256);
+      break;
+    case algorithm::ES384:
+      oid = detail::der_oid_p384;
+      oid_len = sizeof(detail::der_oid_p384);
+      break;
+    case algorithm::ES512:
+      oid = detail::der_oid_p521;
+      oid_len = sizeof(detail::der_oid_p521);
+      break;
+    default:
+      ec = AlgorithmErrc::InvalidKeyErr;
+      return {};
+  }
+
+  if (point.empty()) {
+    ec = AlgorithmErrc::InvalidKeyErr;
+    return {};
+  }
+
+  const std::string der = detail::ec_spki_der(
+      oid, oid_len,
+      reinterpret_cast<const uint8_t*>(point.data()), point.length());
+
+  return from_der(der, ec, alg);
+}
+
+inline key key::from_ec_point(const jwt::string_view point, SCOPED_ENUM algorithm alg)
+{
+  std::error_code ec;
+  key k = from_ec_point(point, alg, ec);
+  if (ec) {
+    throw InvalidKeyError(ec.message());
+  }
+  return k;
+}
+
+inline key key::replicated(size_t slots) const
+{
+  if (!evp_pkey()) return *this;
+
+  if (slots == 0) slots = std::thread::hardware_concurrency();
+  size_t n = 1;
+  while (n < slots) n <<= 1;
+
+  auto d = std::make_shared<data>();
+  d->type = data_->type;
+  d->alg = data_->alg;
+  d->material = data_->material;
+  d->der = data_->der;
+
+  EVP_PKEY_up_ref(data_->pkey.get());
+  d->pkey.reset(data_->pkey.get());
+
+  d->replica_mask = n - 1;
+  d->replicas.reset(new std::atomic<EVP_PKEY*>[n]);
+  for (size_t i = 0; i < n; ++i) {
+    d->replicas[i].store(nullptr, std::memory_order_relaxed);
+  }
+
+  return key{std::move(d)};
+}
+
+inline key key::with_nonce_pool(size_t capacity) const
+{
+#if defined(CPP_JWT_HAS_EC_NONCE_POOL)
+  if (type() != key_type::PRIVATE || EVP_PKEY_id(evp_pkey()) != EVP_PKEY_EC) {
+    return *this;
+  }
+
+  auto d = std::make_shared<data>();
+  d->type = data_->type;
+  d->alg = data_->alg;
+  d->material = data_->material;
+  d->der = data_->der;
+
+  EVP_PKEY_up_ref(data_->pkey.get());
+  d->pkey.reset(data_->pkey.get());
+
+  // Keeps the replication of the handle
+  if (data_->replicas) {
+    d->replica_mask = data_->replica_mask;
+    d->replicas.reset(new std::atomic<EVP_PKEY*>[d->replica_mask + 1]);
+    for (size_t i = 0; i <= d->replica_mask; ++i) {
+      d->replicas[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  d->nonces.reset(new ec_nonce_pool{d->pkey.get(), capacity});
+  d->nonces->start();
+
+  return key{std::move(d)};
+#else
+  (void)capacity;
+  return *this;
+#endif
+}
+
+inline EVP_PKEY* key::local_pkey() const
+{
+  if (!data_ || !data_->replicas) return evp_pkey();
+
+  auto& slot = data_->replicas[thread_slot_hash() & data_->replica_mask];
+
+  EVP_PKEY* p = slot.load(std::memory_order_acquire);
+  if (p) return p;
+
+  key_type type = key_type::NONE;
+  p = parse_material(*data_, type);
+  if (!p) return evp_pkey();
+
+  EVP_PKEY* expected = nullptr;
+  if (!slot.compare_exchange_strong(expected, p,
+                                    std::memory_order_acq_rel,
+                                    std::memory_order_acquire)) {
+    // Another thread of the same slot got there first
+    EVP_PKEY_free(p);
+    p = expected;
+  }
+
+  return p;
+}
+
+namespace detail {
+
+/*!
+ * Creates a handle from a PEM or DER encoded key, told apart
+ * by the PEM armor.
+ */
+inline jwt::key key_from_encoded(const jwt::string_view encoded, std::error_code& ec)
+{
+  static const char marker[] = "-----BEGIN";
+  const bool pem = std::search(encoded.begin(), encoded.end(),
+                               marker, marker + sizeof(marker) - 1) != encoded.end();
+
+  return pem ? jwt::key::from_pem(encoded, ec) : jwt::key::from_der(encoded, ec);
+}
+
+} // END namespace detail
+
+} // END namespace jwt
+
+#endif
@@ -0,0 +1,265 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_KEY_DIRECTORY_IPP
+#define CPP_JWT_KEY_DIRECTORY_IPP
+
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(CPP_JWT_HAS_INOTIFY)
+#include <sys/inotify.h>
+#endif
+
+namespace jwt {
+
+inline void key_directory::refresh(std::error_code& ec, size_t threads)
+{
+  std::lock_guard<std::mutex> lk{refresh_mtx_};
+  refresh_locked(ec, threads);
+  last_error_ = ec;
+}
+
+inline void key_directory::refresh(size_t threads)
+{
+  std::error_code ec;
+  refresh(ec, threads);
+
+  if (!ec) return;
+  if (ec.category() == std::system_category()) {
+    throw std::system_error(ec, path_);
+  }
+  throw InvalidKeyError(ec.message());
+}
+
+inline void key_directory::refresh_locked(std::error_code& ec, size_t threads)
+{
+  ec.clear();
+
+  std::map<std::string, file_stamp> listed;
+  if (!list_files(listed, ec)) {
+    return;
+  }
+
+  bool changed = false;
+
+  // Files gone since the last refresh
+  for (auto itr = files_.begin(); itr != files_.end(); ) {
+    if (listed.find(itr->first) == listed.end()) {
+      changed = changed || static_cast<bool>(itr->second.key);
+      itr = files_.erase(itr);
+    } else {
+      ++itr;
+    }
+  }
+
+  std::vector<parse_job> jobs;
+  for (const auto& elem : listed) {
+    auto itr = files_.find(elem.first);
+    if (itr == files_.end() || !(itr->second.stamp == elem.second)) {
+      jobs.push_back(parse_job{elem.first, elem.second, {}});
+    }
+  }
+
+  detail::parallel_for(jobs.size(), threads, [this, &jobs](size_t i) {
+    parse_file(jobs[i]);
+  });
+
+  for (auto& job : jobs) {
+    file_entry& entry = files_[job.name];
+
+    if (!job.key) {
+      // Keeps the previous key and tries again next time
+      entry.stamp = file_stamp{};
+      ec = AlgorithmErrc::InvalidKeyErr;
+      continue;
+    }
+
+    entry.stamp = job.stamp;
+    entry.key = std::move(job.key);
+    changed = true;
+  }
+
+  if (!changed) return;
+
+  std::vector<key_ring::value_type> keys;
+  keys.reserve(files_.size());
+  for (const auto& elem : files_) {
+    if (elem.second.key) {
+      keys.emplace_back(kid_of(elem.first), elem.second.key);
+    }
+  }
+
+  ring_.assign(std::move(keys));
+  generation_.fetch_add(1, std::memory_order_release);
+}
+
+inline bool key_directory::list_files(std::map<std::string, file_stamp>& files,
+                                      std::error_code& ec) const
+{
+  DIR* dir = ::opendir(path_.c_str());
+  if (!dir) {
+    ec.assign(errno, std::system_category());
+    return false;
+  }
+
+  std::string file_path = path_ + '/';
+  const size_t dir_len = file_path.length();
+
+  while (struct dirent* ent = ::readdir(dir)) {
+    if (ent->d_name[0] == '.') continue;
+
+    file_path.resize(dir_len);
+    file_path += ent->d_name;
+
+    // Follows links, as deployed through a symlinked directory
+    struct stat st;
+    if (::stat(file_path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+    file_stamp stamp;
+    stamp.dev = static_cast<uint64_t>(st.st_dev);
+    stamp.ino = static_cast<uint64_t>(st.st_ino);
+    stamp.size = static_cast<uint64_t>(st.st_size);
+#if defined(__APPLE__)
+    stamp.mtime_sec = st.st_mtimespec.tv_sec;
+    stamp.mtime_nsec = st.st_mtimespec.tv_nsec;
+#else
+    stamp.mtime_sec = st.st_mtim.tv_sec;
+    stamp.mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+
+    files.emplace(ent->d_name, stamp);
+  }
+
+  ::closedir(dir);
+  return true;
+}
+
+inline void key_directory::parse_file(parse_job& job) const
+{
+  std::ifstream is{path_ + '/' + job.name, std::ifstream::binary};
+  if (!is) return;
+
+  std::string contents{std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+  if (is.bad()) return;
+
+  std::error_code ec;
+  job.key = detail::key_from_encoded(contents, ec);
+}
+
+inline std::string key_directory::kid_of(const std::string& name)
+{
+  auto pos = name.rfind('.');
+  return pos == std::string::npos || pos == 0 ? name : name.substr(0, pos);
+}
+
+inline void key_directory::watch(std::error_code& ec)
+{
+  ec.clear();
+
+#if defined(CPP_JWT_HAS_INOTIFY)
+  if (watching()) return;
+
+  int ifd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (ifd < 0) {
+    ec.assign(errno, std::system_category());
+    return;
+  }
+
+  const uint32_t mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                        IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB;
+
+  int fds[2];
+  if (::inotify_add_watch(ifd, path_.c_str(), mask) < 0 || ::pipe2(fds, O_CLOEXEC) != 0) {
+    ec.assign(errno, std::system_category());
+    ::close(ifd);
+    return;
+  }
+
+  // After the watch is set, so that no change is missed
+  refresh(ec);
+
+  wake_fd_ = fds[1];
+  watcher_ = std::thread{&key_directory::watch_loop, this, ifd, fds[0]};
+#else
+  ec = std::make_error_code(std::errc::operation_not_supported);
+#endif
+}
+
+inline void key_directory::stop()
+{
+  if (!watching()) return;
+
+  char c = 0;
+  while (::write(wake_fd_, &c, 1) < 0 && errno == EINTR) {}
+
+  watcher_.join();
+  ::close(wake_fd_);
+  wake_fd_ = -1;
+}
+
+inline void key_directory::watch_loop(int inotify_fd, int wake_fd)
+{
+#if defined(CPP_JWT_HAS_INOTIFY)
+  // A config agent writes several files in a row
+  constexpr int settle_ms = 20;
+
+  struct pollfd pfds[2] = { {inotify_fd, POLLIN, 0}, {wake_fd, POLLIN, 0} };
+  alignas(struct inotify_event) char buf[4096];
+
+  int timeout = -1;
+  for (;;) {
+    int rc = ::poll(pfds, 2, timeout);
+    if (rc < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (pfds[1].revents || (pfds[0].revents & (POLLERR | POLLHUP | POLLNVAL))) break;
+
+    if (rc == 0) {
+      // Quiet for `settle_ms` since the last event
+      std::error_code ec;
+      refresh(ec);
+      timeout = -1;
+      continue;
+    }
+
+    // Only that something changed matters, not what
+    while (::read(inotify_fd, buf, sizeof(buf)) > 0) {}
+    timeout = settle_ms;
+  }
+#endif
+
+  ::close(inotify_fd);
+  ::close(wake_fd);
+}
+
+} // END namespace jwt
+
+#endif
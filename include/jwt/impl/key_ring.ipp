@@ -0,0 +1,345 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_KEY_RING_IPP
+#define CPP_JWT_KEY_RING_IPP
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include <openssl/evp.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace jwt {
+
+inline jwt::key key_ring::find(const snapshot_type& snap, const jwt::string_view kid)
+{
+  auto itr = std::lower_bound(snap.begin(), snap.end(), kid, kid_less);
+  if (itr == snap.end() || jwt::string_view{itr->first} != kid) {
+    return {};
+  }
+  return itr->second;
+}
+
+inline void key_ring::insert(const jwt::string_view kid, jwt::key k)
+{
+  std::lock_guard<std::mutex> lk{write_mtx_};
+
+  snapshot_type snap{*snapshot()};
+  auto itr = std::lower_bound(snap.begin(), snap.end(), kid, kid_less);
+
+  if (itr != snap.end() && jwt::string_view{itr->first} == kid) {
+    itr->second = std::move(k);
+  } else {
+    snap.emplace(itr, std::string{kid.data(), kid.length()}, std::move(k));
+  }
+
+  publish(std::move(snap));
+}
+
+inline bool key_ring::erase(const jwt::string_view kid)
+{
+  std::lock_guard<std::mutex> lk{write_mtx_};
+
+  snapshot_type snap{*snapshot()};
+  auto itr = std::lower_bound(snap.begin(), snap.end(), kid, kid_less);
+
+  if (itr == snap.end() || jwt::string_view{itr->first} != kid) {
+    return false;
+  }
+
+  snap.erase(itr);
+  publish(std::move(snap));
+
+  return true;
+}
+
+inline void key_ring::assign(std::vector<value_type> keys)
+{
+  // Stable so that the last of the duplicates stays last
+  std::stable_sort(keys.begin(), keys.end(),
+                   [](const value_type& a, const value_type& b) {
+                     return a.first < b.first;
+                   });
+
+  snapshot_type snap;
+  snap.reserve(keys.size());
+
+  for (auto& elem : keys) {
+    if (!snap.empty() && snap.back().first == elem.first) {
+      snap.back().second = std::move(elem.second);
+      continue;
+    }
+    snap.push_back(std::move(elem));
+  }
+
+  std::lock_guard<std::mutex> lk{write_mtx_};
+  publish(std::move(snap));
+}
+
+inline void key_ring::load(const std::vector<source_type>& sources,
+                           std::error_code& ec,
+                           size_t threads)
+{
+  ec.clear();
+
+  std::vector<value_type> keys(sources.size());
+  std::atomic<bool> failed{false};
+
+  detail::parallel_for(sources.size(), threads, [&](size_t i) {
+    std::error_code kec;
+    keys[i].first = sources[i].first;
+    keys[i].second = detail::key_from_encoded(sources[i].second, kec);
+    if (kec) failed.store(true, std::memory_order_relaxed);
+  });
+
+  if (failed.load()) {
+    ec = AlgorithmErrc::InvalidKeyErr;
+    return;
+  }
+
+  assign(std::move(keys));
+}
+
+inline bool key_ring::snapshot_material(const jwt::key& k, std::string& out)
+{
+  unsigned char* buf = nullptr;
+  int len = -1;
+
+  switch (k.type()) {
+    case key_type::SECRET:
+      out.assign(k.material().data(), k.material().length());
+      return true;
+    case key_type::PUBLIC:
+      len = i2d_PUBKEY(k.evp_pkey(), &buf);
+      break;
+    case key_type::PRIVATE:
+      len = i2d_PrivateKey(k.evp_pkey(), &buf);
+      break;
+    default:
+      return false;
+  }
+
+  if (len <= 0) return false;
+
+  out.assign(reinterpret_cast<const char*>(buf), static_cast<size_t>(len));
+  OPENSSL_free(buf);
+  return true;
+}
+
+inline void key_ring::save_snapshot(const std::string& path, std::error_code& ec) const
+{
+  ec.clear();
+
+  auto snap = snapshot();
+
+  std::vector<uint8_t> out{'J', 'W', 'K', 'R', snapshot_version};
+  detail::binary_put_varint(out, snap->size());
+
+  std::string material;
+  for (const auto& elem : *snap) {
+    if (!snapshot_material(elem.second, material)) {
+      ec = AlgorithmErrc::InvalidKeyErr;
+      return;
+    }
+    detail::binary_put_bytes(out, elem.first.data(), elem.first.length());
+    detail::binary_put_varint(out, static_cast<uint64_t>(elem.second.type()));
+    detail::binary_put_varint(out, static_cast<uint64_t>(elem.second.algo()));
+    detail::binary_put_bytes(out, material.data(), material.length());
+  }
+
+  unsigned char digest[snapshot_digest_size];
+  unsigned int dlen = 0;
+  if (EVP_Digest(out.data(), out.size(), digest, &dlen, EVP_sha256(), nullptr) != 1) {
+    ec = AlgorithmErrc::InvalidKeyErr;
+    return;
+  }
+  out.insert(out.end(), digest, digest + dlen);
+
+  // Written aside and renamed, so that readers never see half a file
+  const std::string tmp = path + ".tmp";
+
+#if defined(__unix__) || defined(__APPLE__)
+  // May hold private keys
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    ec.assign(errno, std::system_category());
+    return;
+  }
+
+  for (size_t off = 0; off < out.size(); ) {
+    ssize_t n = ::write(fd, out.data() + off, out.size() - off);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      ec.assign(errno, std::system_category());
+      break;
+    }
+    off += static_cast<size_t>(n);
+  }
+
+  if (!ec && ::fsync(fd) != 0) {
+    ec.assign(errno, std::system_category());
+  }
+  ::close(fd);
+#else
+  std::ofstream os{tmp, std::ofstream::binary | std::ofstream::trunc};
+  os.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+  os.close();
+  if (!os) {
+    ec = std::make_error_code(std::errc::io_error);
+  }
+#endif
+
+  if (!ec && std::rename(tmp.c_str(), path.c_str()) != 0) {
+    ec.assign(errno, std::system_category());
+  }
+  if (ec) {
+    std::remove(tmp.c_str());
+  }
+}
+
+inline void key_ring::load_snapshot(const std::string& path,
+                                    std::error_code& ec,
+                                    size_t threads)
+{
+  ec.clear();
+
+  errno = 0;
+  std::ifstream is{path, std::ifstream::binary};
+  if (!is) {
+    ec.assign(errno ? errno : ENOENT, std::system_category());
+    return;
+  }
+
+  const std::string contents{std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+  if (is.bad()) {
+    ec = std::make_error_code(std::errc::io_error);
+    return;
+  }
+
+  auto data = reinterpret_cast<const uint8_t*>(contents.data());
+  const size_t len = contents.length();
+
+  if (len < snapshot_prefix_size + snapshot_digest_size ||
+      data[0] != 'J' || data[1] != 'W' || data[2] != 'K' || data[3] != 'R') {
+    ec = DecodeErrc::BinaryFormatError;
+    return;
+  }
+  if (data[4] != snapshot_version) {
+    ec = DecodeErrc::BinaryVersionMismatch;
+    return;
+  }
+
+  const size_t body_end = len - snapshot_digest_size;
+
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int dlen = 0;
+  if (EVP_Digest(data, body_end, digest, &dlen, EVP_sha256(), nullptr) != 1 ||
+      dlen != snapshot_digest_size ||
+      !std::equal(digest, digest + dlen, data + body_end)) {
+    ec = DecodeErrc::BinaryFormatError;
+    return;
+  }
+
+  /// An entry as recorded, pointing into `contents`
+  struct entry
+  {
+    jwt::string_view kid;
+    key_type type;
+    SCOPED_ENUM algorithm alg;
+    jwt::string_view material;
+  };
+
+  detail::binary_reader reader{data + snapshot_prefix_size, body_end - snapshot_prefix_size};
+  std::vector<entry> entries;
+
+  uint64_t count = 0;
+  // Every entry takes atleast 4 bytes
+  if (!reader.get_varint(count) || count > reader.remaining() / 4) {
+    ec = DecodeErrc::BinaryFormatError;
+    return;
+  }
+  entries.reserve(static_cast<size_t>(count));
+
+  for (uint64_t i = 0; i < count; ++i) {
+    const char* kid = nullptr;
+    const char* material = nullptr;
+    size_t kid_len = 0;
+    size_t material_len = 0;
+    uint64_t type = 0;
+    uint64_t alg = 0;
+
+    if (!reader.get_bytes(kid, kid_len) ||
+        !reader.get_varint(type) || !reader.get_varint(alg) ||
+        !reader.get_bytes(material, material_len) ||
+        type < static_cast<uint64_t>(key_type::SECRET) ||
+        type > static_cast<uint64_t>(key_type::PRIVATE) ||
+        alg >= static_cast<uint64_t>(algorithm::TERM)) {
+      ec = DecodeErrc::BinaryFormatError;
+      return;
+    }
+
+    entries.push_back(entry{jwt::string_view{kid, kid_len},
+                            static_cast<key_type>(type),
+                            static_cast<SCOPED_ENUM algorithm>(alg),
+                            jwt::string_view{material, material_len}});
+  }
+
+  if (!reader.at_end()) {
+    ec = DecodeErrc::BinaryFormatError;
+    return;
+  }
+
+  std::vector<value_type> keys(entries.size());
+  std::atomic<bool> failed{false};
+
+  detail::parallel_for(entries.size(), threads, [&](size_t i) {
+    const entry& e = entries[i];
+    std::error_code kec;
+
+    keys[i].first.assign(e.kid.data(), e.kid.length());
+    keys[i].second = e.type == key_type::SECRET
+                   ? jwt::key::from_raw_secret(e.material, e.alg)
+                   : jwt::key::from_der(e.material, kec, e.alg);
+
+    if (kec || keys[i].second.type() != e.type) {
+      failed.store(true, std::memory_order_relaxed);
+    }
+  });
+
+  if (failed.load()) {
+    ec = AlgorithmErrc::InvalidKeyErr;
+    return;
+  }
+
+  assign(std::move(keys));
+}
+
+} // END namespace jwt
+
+#endif
@@ -0,0 +1,262 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_REVOCATION_SET_IPP
+#define CPP_JWT_REVOCATION_SET_IPP
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# define CPP_JWT_HAS_MMAP 1
+#endif
+
+namespace jwt {
+
+inline revocation_set::revocation_set(size_t bits_per_key)
+  : bits_per_key_(bits_per_key ? bits_per_key : 16)
+  , table_(build({}))
+{
+}
+
+inline void revocation_set::insert(std::vector<uint64_t> hashes)
+{
+  std::lock_guard<std::mutex> lk{write_mtx_};
+  auto curr = snapshot();
+
+  hashes.insert(hashes.end(), curr->hashes, curr->hashes + curr->count);
+  std::sort(hashes.begin(), hashes.end());
+  hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+  publish(build(std::move(hashes)));
+}
+
+inline void revocation_set::assign(std::vector<uint64_t> hashes)
+{
+  std::sort(hashes.begin(), hashes.end());
+  hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+  std::lock_guard<std::mutex> lk{write_mtx_};
+  publish(build(std::move(hashes)));
+}
+
+inline bool revocation_set::contains(uint64_t hash) const noexcept
+{
+  auto t = snapshot();
+
+  if (!detail::block_bloom::may_contain(t->filter, t->blocks, hash)) {
+    return false;
+  }
+
+  return std::binary_search(t->hashes, t->hashes + t->count, hash);
+}
+
+inline void revocation_set::save(const std::string& path, std::error_code& ec) const
+{
+  ec.clear();
+  auto t = snapshot();
+
+  static_assert(sizeof(snapshot_header) == 64, "Header must fill one block");
+
+  snapshot_header hdr{};
+  std::memcpy(hdr.magic, snapshot_magic(), sizeof(hdr.magic));
+  hdr.version = snapshot_version;
+  hdr.byte_order = snapshot_byte_order;
+  hdr.blocks = t->blocks;
+  hdr.count = t->count;
+  hdr.filter_offset = sizeof(snapshot_header);
+  hdr.hashes_offset = hdr.filter_offset + t->blocks * detail::block_bloom::block_words * 8;
+
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream os{tmp_path, std::ofstream::binary | std::ofstream::trunc};
+    os.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    os.write(reinterpret_cast<const char*>(t->filter),
+             t->blocks * detail::block_bloom::block_words * 8);
+    os.write(reinterpret_cast<const char*>(t->hashes), t->count * 8);
+    os.flush();
+
+    if (!os) {
+      ec = std::make_error_code(std::errc::io_error);
+      std::remove(tmp_path.c_str());
+      return;
+    }
+  }
+
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    ec = std::error_code{errno, std::generic_category()};
+    std::remove(tmp_path.c_str());
+  }
+}
+
+inline void revocation_set::save(const std::string& path) const
+{
+  std::error_code ec;
+  save(path, ec);
+  if (ec) {
+    throw std::system_error(ec, path);
+  }
+}
+
+inline std::shared_ptr<const void>
+revocation_set::map_file(const std::string& path, size_t& size, std::error_code& ec)
+{
+  size = 0;
+
+#if defined(CPP_JWT_HAS_MMAP)
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    ec = std::error_code{errno, std::generic_category()};
+    return nullptr;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ec = std::error_code{errno, std::generic_category()};
+    ::close(fd);
+    return nullptr;
+  }
+
+  size = static_cast<size_t>(st.st_size);
+  if (size < sizeof(snapshot_header)) {
+    ::close(fd);
+    ec = std::make_error_code(std::errc::invalid_argument);
+    return nullptr;
+  }
+
+  void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping stays valid after the descriptor is closed
+  ::close(fd);
+
+  if (addr == MAP_FAILED) {
+    ec = std::error_code{errno, std::generic_category()};
+    return nullptr;
+  }
+
+  return std::shared_ptr<const void>{addr, [size](const void* p) {
+    ::munmap(const_cast<void*>(p), size);
+  }};
+#else
+  std::ifstream is{path, std::ifstream::binary};
+  if (!is) {
+    ec = std::make_error_code(std::errc::no_such_file_or_directory);
+    return nullptr;
+  }
+
+  is.seekg(0, is.end);
+  size = static_cast<size_t>(is.tellg());
+  is.seekg(0, is.beg);
+
+  // uint64_t storage keeps the contents 8 byte aligned
+  auto buf = std::make_shared<std::vector<uint64_t>>((size + 7) / 8);
+  is.read(reinterpret_cast<char*>(buf->data()), size);
+  if (!is) {
+    ec = std::make_error_code(std::errc::io_error);
+    return nullptr;
+  }
+
+  return std::shared_ptr<const void>{buf, buf->data()};
+#endif
+}
+
+inline void revocation_set::load(const std::string& path, std::error_code& ec)
+{
+  ec.clear();
+
+  size_t size = 0;
+  auto mapping = map_file(path, size, ec);
+  if (ec) return;
+
+  snapshot_header hdr;
+  std::memcpy(&hdr, mapping.get(), sizeof(hdr));
+
+  // Checked in an order which keeps the arithmetic from overflowing
+  if (hdr.blocks > size / 64 || hdr.hashes_offset > size) {
+    ec = std::make_error_code(std::errc::invalid_argument);
+    return;
+  }
+
+  const uint64_t filter_bytes = hdr.blocks * detail::block_bloom::block_words * 8;
+
+  if (std::memcmp(hdr.magic, snapshot_magic(), sizeof(hdr.magic)) != 0 ||
+      hdr.version != snapshot_version ||
+      hdr.byte_order != snapshot_byte_order ||
+      hdr.blocks == 0 ||
+      hdr.filter_offset != sizeof(snapshot_header) ||
+      hdr.hashes_offset != hdr.filter_offset + filter_bytes ||
+      hdr.count != (size - hdr.hashes_offset) / 8 ||
+      (size - hdr.hashes_offset) % 8 != 0) {
+    ec = std::make_error_code(std::errc::invalid_argument);
+    return;
+  }
+
+  const char* base = static_cast<const char*>(mapping.get());
+
+  auto t = std::make_shared<table>();
+  t->filter = reinterpret_cast<const uint64_t*>(base + hdr.filter_offset);
+  t->blocks = static_cast<size_t>(hdr.blocks);
+  t->hashes = reinterpret_cast<const uint64_t*>(base + hdr.hashes_offset);
+  t->count = static_cast<size_t>(hdr.count);
+  t->mapping = std::move(mapping);
+
+  std::lock_guard<std::mutex> lk{write_mtx_};
+  publish(std::move(t));
+}
+
+inline void revocation_set::load(const std::string& path)
+{
+  std::error_code ec;
+  load(path, ec);
+  if (ec) {
+    throw std::system_error(ec, path);
+  }
+}
+
+inline revocation_set::table_ptr
+revocation_set::build(std::vector<uint64_t> sorted) const
+{
+  auto t = std::make_shared<table>();
+
+  t->blocks = detail::block_bloom::blocks_for(sorted.size(), bits_per_key_);
+  t->filter_store.assign(t->blocks * detail::block_bloom::block_words, 0);
+  for (uint64_t h : sorted) {
+    detail::block_bloom::add(t->filter_store.data(), t->blocks, h);
+  }
+
+  t->hash_store = std::move(sorted);
+
+  t->filter = t->filter_store.data();
+  t->hashes = t->hash_store.data();
+  t->count = t->hash_store.size();
+
+  return t;
+}
+
+} // END namespace jwt
+
+#endif
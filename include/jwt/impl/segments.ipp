@@ -0,0 +1,119 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_SEGMENTS_IPP
+#define CPP_JWT_SEGMENTS_IPP
+
+namespace jwt {
+
+inline segmented_view::segmented_view(const jwt::string_view* segs, size_t count) noexcept
+  : segs_(segs)
+  , count_(count)
+{
+  for (size_t i = 0; i < count; ++i) length_ += segs[i].length();
+}
+
+#if defined(CPP_JWT_HAS_IOVEC)
+inline segmented_view::segmented_view(const struct iovec* iov, size_t count) noexcept
+  : iov_(iov)
+  , count_(count)
+{
+  for (size_t i = 0; i < count; ++i) length_ += iov[i].iov_len;
+}
+#endif
+
+inline jwt::string_view segmented_view::segment(size_t i) const noexcept
+{
+  if (segs_) return segs_[i];
+#if defined(CPP_JWT_HAS_IOVEC)
+  if (iov_) {
+    const struct iovec& v = static_cast<const struct iovec*>(iov_)[i];
+    return jwt::string_view{static_cast<const char*>(v.iov_base), v.iov_len};
+  }
+#endif
+  return single_;
+}
+
+inline size_t segmented_view::find(char ch, size_t pos) const noexcept
+{
+  size_t base = 0;
+  size_t ret = npos;
+
+  subview(pos).for_each([&](jwt::string_view piece) {
+    if (ret != npos) return;
+    const void* p = std::memchr(piece.data(), ch, piece.length());
+    if (p) {
+      ret = pos + base + static_cast<size_t>(static_cast<const char*>(p) - piece.data());
+    }
+    base += piece.length();
+  });
+
+  return ret;
+}
+
+inline size_t segmented_view::count(char ch) const noexcept
+{
+  size_t n = 0;
+  for_each([&](jwt::string_view piece) {
+    for (char c : piece) n += (c == ch);
+  });
+  return n;
+}
+
+inline segmented_view segmented_view::subview(size_t pos, size_t len) const noexcept
+{
+  segmented_view ret{*this};
+  if (pos > length_) pos = length_;
+  if (len > length_ - pos) len = length_ - pos;
+
+  ret.offset_ = offset_ + pos;
+  ret.length_ = len;
+  return ret;
+}
+
+inline bool segmented_view::contiguous() const noexcept
+{
+  size_t pieces = 0;
+  for_each([&](jwt::string_view) { ++pieces; });
+  return pieces <= 1;
+}
+
+inline jwt::string_view segmented_view::as_contiguous() const noexcept
+{
+  jwt::string_view ret;
+  for_each([&](jwt::string_view piece) {
+    if (ret.empty()) ret = piece;
+  });
+  return ret;
+}
+
+inline void segmented_view::copy(char* out) const noexcept
+{
+  for_each([&](jwt::string_view piece) {
+    std::memcpy(out, piece.data(), piece.length());
+    out += piece.length();
+  });
+}
+
+} // END namespace jwt
+
+#endif
@@ -0,0 +1,385 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_SHARED_TOKEN_CACHE_IPP
+#define CPP_JWT_SHARED_TOKEN_CACHE_IPP
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <openssl/evp.h>
+
+namespace jwt {
+
+namespace detail {
+
+/// Waits of 1ms for a segment being set up by another process
+constexpr int shared_cache_attach_waits = 1000;
+
+/// Retries of a slot read torn by a writer
+constexpr int shared_cache_read_retries = 4;
+
+} // END namespace detail
+
+inline void shared_token_cache::remove(const std::string& name, std::error_code& ec)
+{
+  ec.clear();
+  if (::shm_unlink(name.c_str()) != 0) {
+    ec = std::error_code{errno, std::generic_category()};
+  }
+}
+
+inline void shared_token_cache::attach(const std::string& name,
+                                       std::error_code& ec,
+                                       size_t slots,
+                                       size_t max_form_size)
+{
+  ec.clear();
+  detach();
+
+  size_t nslots = probe_length;
+  while (nslots < slots) nslots <<= 1;
+
+  // Slots start on a cache line, as the header is one
+  const size_t slot_size = (sizeof(slot_header) + max_form_size + 63) & ~size_t{63};
+  static_assert(sizeof(segment_header) == 64, "segment header must be a cache line");
+
+  bool creator = true;
+  int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 && errno == EEXIST) {
+    creator = false;
+    fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+  }
+
+  if (fd < 0) {
+    ec = std::error_code{errno, std::generic_category()};
+    return;
+  }
+
+  size_t size = sizeof(segment_header) + nslots * slot_size;
+
+  if (creator) {
+    // The new segment reads as zeros, i.e. all slots free
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      ec = std::error_code{errno, std::generic_category()};
+      ::close(fd);
+      ::shm_unlink(name.c_str());
+      return;
+    }
+  } else {
+    // The creator may not have sized it yet
+    size = 0;
+    for (int i = 0; i < detail::shared_cache_attach_waits; ++i) {
+      struct stat st;
+      if (::fstat(fd, &st) != 0) {
+        ec = std::error_code{errno, std::generic_category()};
+        ::close(fd);
+        return;
+      }
+      if (static_cast<size_t>(st.st_size) >= sizeof(segment_header)) {
+        size = static_cast<size_t>(st.st_size);
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    if (size == 0) {
+      ::close(fd);
+      ec = std::make_error_code(std::errc::resource_unavailable_try_again);
+      return;
+    }
+  }
+
+  void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  // The mapping stays valid after the descriptor is closed
+  ::close(fd);
+
+  if (addr == MAP_FAILED) {
+    ec = std::error_code{errno, std::generic_category()};
+    return;
+  }
+
+  auto* hdr = static_cast<segment_header*>(addr);
+
+  if (creator) {
+    hdr->version = segment_version;
+    hdr->magic = segment_magic;
+    hdr->slots = nslots;
+    hdr->slot_size = slot_size;
+    hdr->max_form_size = max_form_size;
+    hdr->ready.store(1, std::memory_order_release);
+  } else {
+    bool ready = false;
+    for (int i = 0; i < detail::shared_cache_attach_waits; ++i) {
+      if (hdr->ready.load(std::memory_order_acquire)) {
+        ready = true;
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    if (!ready) {
+      ::munmap(addr, size);
+      ec = std::make_error_code(std::errc::resource_unavailable_try_again);
+      return;
+    }
+
+    // Checked in an order which keeps the arithmetic from overflowing
+    if (hdr->magic != segment_magic ||
+        hdr->version != segment_version ||
+        hdr->slots < probe_length ||
+        (hdr->slots & (hdr->slots - 1)) != 0 ||
+        hdr->slot_size % 64 != 0 ||
+        hdr->max_form_size > hdr->slot_size ||
+        hdr->slot_size < sizeof(slot_header) + hdr->max_form_size ||
+        hdr->slots > (size - sizeof(segment_header)) / hdr->slot_size) {
+      ::munmap(addr, size);
+      ec = std::make_error_code(std::errc::invalid_argument);
+      return;
+    }
+
+    nslots = static_cast<size_t>(hdr->slots);
+  }
+
+  base_ = addr;
+  map_size_ = size;
+  slots_ = nslots;
+  slot_size_ = static_cast<size_t>(hdr->slot_size);
+  max_form_size_ = static_cast<size_t>(hdr->max_form_size);
+}
+
+inline void shared_token_cache::attach(const std::string& name,
+                                       size_t slots,
+                                       size_t max_form_size)
+{
+  std::error_code ec;
+  attach(name, ec, slots, max_form_size);
+  if (ec) {
+    throw std::system_error(ec, name);
+  }
+}
+
+inline void shared_token_cache::detach() noexcept
+{
+  if (base_) {
+    ::munmap(base_, map_size_);
+  }
+  base_ = nullptr;
+  map_size_ = 0;
+  slots_ = slot_size_ = max_form_size_ = 0;
+}
+
+inline bool shared_token_cache::find(const jwt::string_view token, jwt_object& obj) const
+{
+  unsigned char digest[digest_size];
+  if (!base_ || !token_digest(token, digest)) return false;
+
+  uint64_t h = 0;
+  std::memcpy(&h, digest, sizeof(h));
+  const uint64_t t = now();
+
+  std::vector<uint8_t> form;
+
+  for (size_t i = 0; i < probe_length; ++i) {
+    slot_header* s = slot_at((h + i) & (slots_ - 1));
+    const uint8_t* s_form = reinterpret_cast<const uint8_t*>(s + 1);
+
+    for (int attempt = 0; attempt < detail::shared_cache_read_retries; ++attempt) {
+      const uint32_t seq = s->seq.load(std::memory_order_acquire);
+      // Held by a writer
+      if (seq & 1) break;
+
+      const bool match = s->expiry > t &&
+                         s->form_size <= max_form_size_ &&
+                         std::memcmp(s->digest, digest, digest_size) == 0;
+      if (match) {
+        form.assign(s_form, s_form + s->form_size);
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (s->seq.load(std::memory_order_relaxed) != seq) {
+        // Torn by a writer
+        continue;
+      }
+
+      if (!match) break;
+
+      std::error_code ec;
+      obj.from_binary(form.data(), form.size(), ec);
+      return !ec;
+    }
+  }
+
+  return false;
+}
+
+inline void shared_token_cache::insert(const jwt::string_view token, const jwt_object& obj)
+{
+  unsigned char digest[digest_size];
+  if (!base_ || !token_digest(token, digest)) return;
+
+  const uint64_t t = now();
+  const uint64_t expiry = expiry_for(obj, t);
+  if (expiry <= t) return;
+
+  const std::vector<uint8_t> form = obj.to_binary();
+  if (form.size() > max_form_size_) return;
+
+  uint64_t h = 0;
+  std::memcpy(&h, digest, sizeof(h));
+
+  // Pick a free or expired slot, else the one closest to expiry.
+  // The fields are read without the lock; they only guide the
+  // choice.
+  slot_header* target = nullptr;
+  uint32_t target_seq = 0;
+  uint64_t target_expiry = std::numeric_limits<uint64_t>::max();
+
+  for (size_t i = 0; i < probe_length; ++i) {
+    slot_header* s = slot_at((h + i) & (slots_ - 1));
+
+    const uint32_t seq = s->seq.load(std::memory_order_acquire);
+    if (seq & 1) continue;
+
+    uint64_t e = s->expiry;
+    if (e > t && std::memcmp(s->digest, digest, digest_size) == 0) {
+      // Stored already, likely by another process
+      return;
+    }
+    if (e <= t) e = 0;
+
+    if (e < target_expiry) {
+      target = s;
+      target_seq = seq;
+      target_expiry = e;
+    }
+  }
+
+  // Give up rather than wait if another writer got there first
+  if (!target ||
+      !target->seq.compare_exchange_strong(target_seq, target_seq + 1,
+                                           std::memory_order_acquire,
+                                           std::memory_order_relaxed)) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  target->expiry = expiry;
+  target->form_size = static_cast<uint32_t>(form.size());
+  std::memcpy(target->digest, digest, digest_size);
+  std::memcpy(reinterpret_cast<uint8_t*>(target + 1), form.data(), form.size());
+
+  target->seq.store(target_seq + 2, std::memory_order_release);
+}
+
+template <typename DecodeFn>
+jwt_object shared_token_cache::decode(const jwt::string_view token,
+                                      std::error_code& ec,
+                                      DecodeFn&& decode_fn)
+{
+  {
+    jwt_object obj;
+    if (find(token, obj)) {
+      ec.clear();
+      return obj;
+    }
+  }
+
+  jwt_object res = decode_fn(ec);
+  if (!ec) {
+    insert(token, res);
+  }
+
+  return res;
+}
+
+inline size_t shared_token_cache::size() const noexcept
+{
+  const uint64_t t = now();
+  size_t count = 0;
+
+  for (size_t i = 0; i < slots_; ++i) {
+    const slot_header* s = slot_at(i);
+    if (!(s->seq.load(std::memory_order_acquire) & 1) && s->expiry > t) {
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+inline size_t shared_token_cache::capacity() const noexcept
+{
+  return slots_;
+}
+
+inline void shared_token_cache::clear() noexcept
+{
+  for (size_t i = 0; i < slots_; ++i) {
+    slot_header* s = slot_at(i);
+
+    // Also releases slots left locked by a dead writer
+    const uint32_t seq = s->seq.load(std::memory_order_relaxed) | 1;
+    s->seq.store(seq, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s->expiry = 0;
+    s->form_size = 0;
+
+    s->seq.store(seq + 1, std::memory_order_release);
+  }
+}
+
+inline bool shared_token_cache::token_digest(const jwt::string_view token, unsigned char* out)
+{
+  unsigned int len = 0;
+  return EVP_Digest(token.data(), token.length(), out, &len, EVP_sha256(), nullptr) == 1 &&
+         len == digest_size;
+}
+
+inline uint64_t shared_token_cache::expiry_for(const jwt_object& obj, uint64_t t) const
+{
+  uint64_t expiry = t + max_ttl_;
+
+  if (obj.has_claim(registered_claims::expiration)) {
+    try {
+      auto exp = obj.payload().get_claim_value<uint64_t>(registered_claims::expiration);
+      if (exp < expiry) expiry = exp;
+    } catch (const std::exception&) {
+      return 0;
+    }
+  }
+
+  return expiry;
+}
+
+} // END namespace jwt
+
+#endif
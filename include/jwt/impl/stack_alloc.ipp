@@ -29,45 +29,74 @@ namespace jwt {
 
 template <size_t N, size_t alignment>
 template <size_t reqested_alignment>
-char* Arena<N, alignment>::allocate(size_t n) noexcept
+char* Arena<N, alignment>::allocate(size_t n)
 {
   static_assert (reqested_alignment <= alignment,
       "Requested alignment is too small for this arena");
 
-  assert (pointer_in_storage(ptr_) &&
-      "No more space in the arena or it has outgrown its capacity");
-
   n = align_up(n);
 
-  if ((ptr_ + n) <= (buf_ + N)) {
-    char* ret = ptr_;
-    ptr_ += n;
-
-    return ret;
+  if (n > static_cast<size_t>(end_ - ptr_)) {
+    grow(n);
   }
 
-  assert (0 && "Code should not reach here");
+  char* ret = ptr_;
+  ptr_ += n;
 
-  return nullptr;
+  return ret;
 }
 
 template <size_t N, size_t alignment>
 void Arena<N, alignment>::deallocate(char* p, size_t n) noexcept
 {
-  assert (pointer_in_storage(p) &&
-      "The address to de deleted does not lie inside the storage");
-
   n = align_up(n);
 
-  if ((p + n) == ptr_) {
+  if ((begin_ <= p) && (p + n) == ptr_) {
     ptr_ = p;
   }
 
   return;
 }
 
+template <size_t N, size_t alignment>
+void Arena<N, alignment>::grow(size_t n)
+{
+  // Double the size of the last block to keep the
+  // number of blocks logarithmic in the bytes used.
+  size_t bsize = 2 * (blocks_ ? blocks_->size : N);
+  if (bsize < n) bsize = n;
+
+  constexpr size_t hdr = align_up(sizeof(block));
+  block* b = static_cast<block*>(::operator new(hdr + bsize));
+  b->next = blocks_;
+  b->size = bsize;
+
+  blocks_ = b;
+  heap_size_ += bsize;
+  retired_ += static_cast<size_t>(ptr_ - begin_);
+
+  begin_ = reinterpret_cast<char*>(b) + hdr;
+  end_ = begin_ + bsize;
+  ptr_ = begin_;
+}
+
+template <size_t N, size_t alignment>
+void Arena<N, alignment>::release() noexcept
+{
+  while (blocks_) {
+    block* next = blocks_->next;
+    ::operator delete(blocks_);
+    blocks_ = next;
+  }
+
+  heap_size_ = 0;
+  retired_ = 0;
+  ptr_ = begin_ = buf_;
+  end_ = buf_ + N;
+}
+
 template <typename T, size_t N, size_t alignment>
-T* stack_alloc<T, N, alignment>::allocate(size_t n) noexcept
+T* stack_alloc<T, N, alignment>::allocate(size_t n)
 {
   return reinterpret_cast<T*>(
       arena_.template allocate<alignof(T)>(n * sizeof(T))
@@ -77,7 +106,7 @@ T* stack_alloc<T, N, alignment>::allocate(size_t n) noexcept
 template <typename T, size_t N, size_t alignment>
 void stack_alloc<T, N, alignment>::deallocate(T* p, size_t n) noexcept
 {
-  arena_.deallocate(reinterpret_cast<char*>(p), n);
+  arena_.deallocate(reinterpret_cast<char*>(p), n * sizeof(T));
   return;
 }
 
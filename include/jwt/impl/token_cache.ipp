@@ -0,0 +1,261 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_TOKEN_CACHE_IPP
+#define CPP_JWT_TOKEN_CACHE_IPP
+
+namespace jwt {
+
+inline token_cache::token_cache(size_t capacity,
+                                size_t shards,
+                                std::chrono::seconds max_ttl,
+                                std::chrono::seconds negative_ttl)
+  : max_ttl_(static_cast<uint64_t>(max_ttl.count()))
+  , negative_ttl_(static_cast<uint64_t>(negative_ttl.count()))
+{
+  size_t nshards = 1;
+  while (nshards < shards) nshards <<= 1;
+
+  shard_capacity_ = (capacity + nshards - 1) / nshards;
+  if (shard_capacity_ == 0) shard_capacity_ = 1;
+
+  const uint64_t t = now();
+
+  shards_.reserve(nshards);
+  for (size_t i = 0; i < nshards; ++i) {
+    std::unique_ptr<shard> s{new shard{}};
+    s->slots.resize(shard_capacity_);
+    s->free.reserve(shard_capacity_);
+    for (size_t j = shard_capacity_; j > 0; --j) {
+      s->free.push_back(static_cast<uint32_t>(j - 1));
+    }
+    s->index.reserve(shard_capacity_);
+    s->wheel = detail::time_wheel<timer_type>{t};
+    shards_.push_back(std::move(s));
+  }
+}
+
+inline bool token_cache::find(const jwt::string_view token,
+                              object_ptr& obj,
+                              std::error_code& ec)
+{
+  const uint64_t h = detail::hash_bytes(token.data(), token.length());
+  const uint64_t t = now();
+  shard& s = shard_for(h);
+
+  std::lock_guard<std::mutex> lk{s.mtx};
+  expire(s, t);
+
+  auto itr = s.index.find(h);
+  if (itr == s.index.end()) return false;
+
+  entry& e = s.slots[itr->second];
+  if (e.expiry <= t || jwt::string_view{e.token} != token) {
+    return false;
+  }
+
+  e.ref = true;
+  obj = e.obj;
+  ec = e.ec;
+
+  return true;
+}
+
+inline void token_cache::insert(const jwt::string_view token,
+                                object_ptr obj,
+                                const std::error_code& ec)
+{
+  const uint64_t t = now();
+  const uint64_t expiry = expiry_for(obj.get(), ec, t);
+  if (expiry <= t) return;
+
+  const uint64_t h = detail::hash_bytes(token.data(), token.length());
+  shard& s = shard_for(h);
+
+  std::lock_guard<std::mutex> lk{s.mtx};
+  expire(s, t);
+
+  uint32_t slot = 0;
+  auto itr = s.index.find(h);
+
+  if (itr != s.index.end()) {
+    // Same token or a hash collision; the newer one wins
+    slot = itr->second;
+  } else {
+    if (s.free.empty()) {
+      slot = evict(s);
+    } else {
+      slot = s.free.back();
+      s.free.pop_back();
+    }
+    s.index.emplace(h, slot);
+  }
+
+  entry& e = s.slots[slot];
+  e.hash = h;
+  e.expiry = expiry;
+  e.gen++;
+  e.used = true;
+  e.ref = false;
+  e.token.assign(token.data(), token.length());
+  e.obj = std::move(obj);
+  e.ec = ec;
+
+  // Timers of replaced or evicted entries stay in the wheel
+  // until they fire. Rebuild it if they start to pile up.
+  if (s.wheel.size() > 4 * s.slots.size()) {
+    s.wheel.clear();
+    for (uint32_t i = 0; i < s.slots.size(); ++i) {
+      if (s.slots[i].used) {
+        s.wheel.schedule(s.slots[i].expiry, timer_type{i, s.slots[i].gen});
+      }
+    }
+  } else {
+    s.wheel.schedule(expiry, timer_type{slot, e.gen});
+  }
+}
+
+template <typename DecodeFn>
+jwt_object token_cache::decode(const jwt::string_view token,
+                               std::error_code& ec,
+                               DecodeFn&& decode_fn)
+{
+  object_ptr obj;
+  if (find(token, obj, ec)) {
+    return *obj;
+  }
+
+  jwt_object res = decode_fn(ec);
+
+  // Only pay for the copy if the result is going to be kept
+  const uint64_t t = now();
+  if (expiry_for(&res, ec, t) > t) {
+    insert(token, std::make_shared<const jwt_object>(res), ec);
+  }
+
+  return res;
+}
+
+inline size_t token_cache::size() const
+{
+  size_t total = 0;
+  for (const auto& s : shards_) {
+    std::lock_guard<std::mutex> lk{s->mtx};
+    total += s->index.size();
+  }
+  return total;
+}
+
+inline void token_cache::clear()
+{
+  for (auto& s : shards_) {
+    std::lock_guard<std::mutex> lk{s->mtx};
+    for (uint32_t i = 0; i < s->slots.size(); ++i) {
+      if (s->slots[i].used) {
+        release(*s, i);
+        s->free.push_back(i);
+      }
+    }
+    s->wheel.clear();
+  }
+}
+
+inline uint64_t token_cache::expiry_for(const jwt_object* obj,
+                                        const std::error_code& ec,
+                                        uint64_t t) const
+{
+  if (!obj) return 0;
+
+  if (ec) {
+    // These can turn into a success later on
+    if (ec == VerificationErrc::ImmatureSignature ||
+        ec == DecodeErrc::KeyNotPresent) {
+      return 0;
+    }
+    return t + negative_ttl_;
+  }
+
+  uint64_t expiry = t + max_ttl_;
+
+  if (obj->has_claim(registered_claims::expiration)) {
+    try {
+      auto exp = obj->payload().get_claim_value<uint64_t>(registered_claims::expiration);
+      if (exp < expiry) expiry = exp;
+    } catch (const std::exception&) {
+      return 0;
+    }
+  }
+
+  return expiry;
+}
+
+inline void token_cache::expire(shard& s, uint64_t t)
+{
+  s.wheel.advance(t, [&s](const timer_type& tm, uint64_t) {
+    entry& e = s.slots[tm.first];
+    if (e.used && e.gen == tm.second) {
+      release(s, tm.first);
+      s.free.push_back(tm.first);
+    }
+  });
+}
+
+inline void token_cache::release(shard& s, uint32_t slot)
+{
+  entry& e = s.slots[slot];
+
+  auto itr = s.index.find(e.hash);
+  if (itr != s.index.end() && itr->second == slot) {
+    s.index.erase(itr);
+  }
+
+  e.used = false;
+  e.ref = false;
+  e.gen++;
+  e.obj.reset();
+  e.token.clear();
+}
+
+inline uint32_t token_cache::evict(shard& s)
+{
+  const size_t n = s.slots.size();
+
+  // Every used entry gets a second chance if it was looked up
+  // since the hand last passed it.
+  while (true) {
+    auto slot = static_cast<uint32_t>(s.hand);
+    s.hand = (s.hand + 1) % n;
+
+    entry& e = s.slots[slot];
+    if (e.ref) {
+      e.ref = false;
+      continue;
+    }
+
+    release(s, slot);
+    return slot;
+  }
+}
+
+} // END namespace jwt
+
+#endif
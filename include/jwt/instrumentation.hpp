@@ -0,0 +1,410 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_INSTRUMENTATION_HPP
+#define CPP_JWT_INSTRUMENTATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <system_error>
+
+#include "jwt/algorithm.hpp"
+
+namespace jwt {
+
+/**
+ * The stages of `jwt::decode`, in the order they run.
+ *
+ * The decode stages are only timed when the library is
+ * built with `CPP_JWT_INSTRUMENT` defined (the CMake option
+ * of the same name). Without it the hooks compile to nothing.
+ * The macro must be defined alike in all translation units.
+ */
+enum class decode_stage : uint8_t
+{
+  /// Length limit, dot count and split into the three parts
+  SPLIT = 0,
+  /// base64url decoding of the header
+  HEADER_BASE64,
+  /// JSON parsing of the header, and its `alg` and `typ` fields
+  HEADER_JSON,
+  /// base64url decoding of the payload
+  PAYLOAD_BASE64,
+  /// JSON parsing of the payload
+  PAYLOAD_JSON,
+  /// Allowed algorithms, registered claims, revocation and key lookup
+  CLAIMS,
+  /// Signature verification and replay check. Its bytes are the signed ones
+  SIGNATURE,
+  /// The whole call, including cache lookups
+  TOTAL,
+};
+
+constexpr size_t decode_stage_count = static_cast<size_t>(decode_stage::TOTAL) + 1;
+
+/**
+ * How a decode ended, after the category of its error code.
+ */
+enum class decode_outcome : uint8_t
+{
+  OK = 0,
+  /// DecodeErrc, and error codes of other categories
+  DECODE_ERROR,
+  /// VerificationErrc, e.g. an invalid signature or expired token
+  VERIFICATION_ERROR,
+  /// AlgorithmErrc, e.g. a token with the "none" algorithm
+  ALGORITHM_ERROR,
+};
+
+constexpr size_t decode_outcome_count = static_cast<size_t>(decode_outcome::ALGORITHM_ERROR) + 1;
+
+/**
+ * The outcome for the error code of a decode.
+ */
+decode_outcome outcome_of(const std::error_code& ec) noexcept;
+
+/**
+ * The timings of a single decode.
+ */
+struct decode_trace
+{
+  /// The algorithm of the header, UNKN if it was not parsed
+  SCOPED_ENUM algorithm alg = algorithm::UNKN;
+  /// The error code the decode returned
+  std::error_code ec;
+  /// Bit `1 << stage` is set for every stage which ran
+  uint32_t stages = 0;
+  /// Time spent in each stage, in nanoseconds
+  uint64_t nanos[decode_stage_count] = {};
+  /// Input bytes of each stage
+  uint64_t bytes[decode_stage_count] = {};
+
+  /**
+   * Tells if `stage` ran.
+   */
+  bool ran(decode_stage stage) const noexcept
+  {
+    return stages & (1u << static_cast<unsigned>(stage));
+  }
+
+  /**
+   * The outcome of the decode.
+   */
+  decode_outcome outcome() const noexcept
+  {
+    return outcome_of(ec);
+  }
+};
+
+/**
+ * Receives the trace of every decode while installed with
+ * `set_decode_sink`.
+ *
+ * `record` is called on the decoding thread once the decode
+ * returns, so it runs concurrently from all decoding threads
+ * and adds to the latency of each decode. It must not throw.
+ */
+class decode_sink
+{
+public:
+  virtual ~decode_sink() = default;
+
+  /**
+   * Called with the trace of a finished decode.
+   */
+  virtual void record(const decode_trace& trace) noexcept = 0;
+};
+
+/**
+ * Installs the sink for the traces of all threads and returns
+ * the previous one. Pass nullptr to stop tracing.
+ *
+ * The sink is not owned. A sink being replaced may still be
+ * called by the decodes in flight, so it must be kept alive
+ * until they finish.
+ */
+decode_sink* set_decode_sink(decode_sink* sink) noexcept;
+
+/**
+ * The installed sink, nullptr if none.
+ */
+decode_sink* current_decode_sink() noexcept;
+
+
+/**
+ * A histogram of stage latencies, with power of two buckets:
+ * bucket `i` counts the times in [2^i, 2^(i+1)) nanoseconds,
+ * bucket 0 also counts zero and the last bucket counts all
+ * times from 2^31 nanoseconds (about 2 seconds) on.
+ */
+struct latency_histogram
+{
+  static constexpr size_t bucket_count = 32;
+
+  uint64_t count = 0;
+  uint64_t total_nanos = 0;
+  uint64_t total_bytes = 0;
+  uint64_t buckets[bucket_count] = {};
+
+  /**
+   * The bucket counting `nanos`.
+   */
+  static size_t bucket_of(uint64_t nanos) noexcept;
+
+  /**
+   * The mean time, 0 if empty.
+   */
+  double mean_nanos() const noexcept
+  {
+    return count ? static_cast<double>(total_nanos) / count : 0.0;
+  }
+
+  /**
+   * An upper bound of the `q` quantile (0 <= q <= 1): the end
+   * of the bucket holding it. Returns 0 if empty.
+   */
+  uint64_t quantile_nanos(double q) const noexcept;
+
+  /**
+   * Adds the counts of `other`.
+   */
+  void merge(const latency_histogram& other) noexcept;
+};
+
+/**
+ * A decode sink keeping a latency histogram for every stage,
+ * per algorithm and outcome.
+ *
+ * Every thread records into its own shard of counters, which
+ * only that thread writes, so recording takes no lock and no
+ * locked instruction. The shard of a thread is allocated by its
+ * first decode (about 100 KiB) and kept until the sink goes away.
+ * Reading merges the shards, and may run while threads record.
+ */
+class histogram_sink final : public decode_sink
+{
+public: // 'tors
+  histogram_sink();
+
+  /// Non copyable and assignable
+  histogram_sink(const histogram_sink&) = delete;
+  histogram_sink& operator=(const histogram_sink&) = delete;
+
+  ~histogram_sink() = default;
+
+public: // Exposed APIs
+  /**
+   * Adds the stages of `trace` to the histograms of its
+   * algorithm and outcome.
+   */
+  void record(const decode_trace& trace) noexcept override;
+
+  /**
+   * The histogram of `stage` over all threads.
+   */
+  latency_histogram histogram(SCOPED_ENUM algorithm alg,
+                              decode_outcome outcome,
+                              decode_stage stage) const;
+
+  /**
+   * Number of decodes recorded with this algorithm and outcome.
+   */
+  uint64_t count(SCOPED_ENUM algorithm alg, decode_outcome outcome) const
+  {
+    return histogram(alg, outcome, decode_stage::TOTAL).count;
+  }
+
+private:
+  /*!
+   */
+  static constexpr size_t algorithm_count = static_cast<size_t>(algorithm::TERM) + 1;
+
+  /// The counters of one histogram, written by one thread only
+  struct cell
+  {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_nanos{0};
+    std::atomic<uint64_t> total_bytes{0};
+    std::atomic<uint64_t> buckets[latency_histogram::bucket_count] = {};
+  };
+
+  /// The counters of one thread
+  struct shard
+  {
+    std::thread::id owner;
+    cell cells[algorithm_count][decode_outcome_count][decode_stage_count];
+  };
+
+  /*!
+   * The shard of the calling thread, nullptr if it
+   * could not be allocated.
+   */
+  shard* local_shard() noexcept;
+
+private:
+  /// Tells the sinks apart in the per thread shard cache
+  const uint64_t id_;
+
+  /// Guards the shard list
+  mutable std::mutex mtx_;
+  std::vector<std::unique_ptr<shard>> shards_;
+};
+
+namespace detail {
+
+#if defined(CPP_JWT_INSTRUMENT)
+
+/*!
+ * The trace of the decode running on this thread.
+ */
+inline decode_trace*& active_trace() noexcept
+{
+  static thread_local decode_trace* trace = nullptr;
+  return trace;
+}
+
+/*!
+ */
+inline uint64_t trace_clock() noexcept
+{
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/*!
+ * Traces a call of `jwt::decode` if a sink is installed.
+ * A decode nested in a traced one adds to its trace.
+ */
+class decode_tracer
+{
+public:
+  decode_tracer(size_t token_len, const std::error_code& ec) noexcept
+    : ec_(ec)
+  {
+    if (active_trace()) return;
+    sink_ = current_decode_sink();
+    if (!sink_) return;
+
+    trace_.bytes[static_cast<size_t>(decode_stage::TOTAL)] = token_len;
+    active_trace() = &trace_;
+    start_ = trace_clock();
+  }
+
+  decode_tracer(const decode_tracer&) = delete;
+  decode_tracer& operator=(const decode_tracer&) = delete;
+
+  ~decode_tracer()
+  {
+    if (!sink_) return;
+
+    constexpr size_t total = static_cast<size_t>(decode_stage::TOTAL);
+    trace_.nanos[total] = trace_clock() - start_;
+    trace_.stages |= 1u << total;
+    trace_.ec = ec_;
+
+    active_trace() = nullptr;
+    sink_->record(trace_);
+  }
+
+private:
+  const std::error_code& ec_;
+  decode_sink* sink_ = nullptr;
+  uint64_t start_ = 0;
+  decode_trace trace_;
+};
+
+/*!
+ * Times a stage of the traced decode, from construction
+ * to `stop` or destruction.
+ */
+class stage_timer
+{
+public:
+  stage_timer(decode_stage stage, size_t bytes) noexcept
+    : trace_(active_trace())
+    , stage_(static_cast<size_t>(stage))
+  {
+    if (!trace_) return;
+    trace_->bytes[stage_] += bytes;
+    start_ = trace_clock();
+  }
+
+  stage_timer(const stage_timer&) = delete;
+  stage_timer& operator=(const stage_timer&) = delete;
+
+  ~stage_timer()
+  {
+    stop();
+  }
+
+  void stop() noexcept
+  {
+    if (!trace_) return;
+    trace_->nanos[stage_] += trace_clock() - start_;
+    trace_->stages |= 1u << stage_;
+    trace_ = nullptr;
+  }
+
+private:
+  decode_trace* trace_;
+  size_t stage_;
+  uint64_t start_ = 0;
+};
+
+/*!
+ * Sets the algorithm of the traced decode.
+ */
+inline void trace_algorithm(SCOPED_ENUM algorithm alg) noexcept
+{
+  if (decode_trace* trace = active_trace()) trace->alg = alg;
+}
+
+#else
+
+// The hooks when instrumentation is compiled out.
+
+struct decode_tracer
+{
+  decode_tracer(size_t, const std::error_code&) noexcept {}
+};
+
+struct stage_timer
+{
+  stage_timer(decode_stage, size_t) noexcept {}
+  void stop() noexcept {}
+};
+
+inline void trace_algorithm(SCOPED_ENUM algorithm) noexcept {}
+
+#endif
+
+} // END namespace detail
+} // END namespace jwt
+
+#include "jwt/impl/instrumentation.ipp"
+
+#endif
@@ -0,0 +1,189 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_JTI_STORE_HPP
+#define CPP_JWT_JTI_STORE_HPP
+
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+#include "jwt/string_view.hpp"
+#include "jwt/detail/hash.hpp"
+#include "jwt/detail/time_wheel.hpp"
+
+namespace jwt {
+
+/**
+ * Remembers the `jti` (JWT ID) of the tokens seen so far
+ * to reject tokens presented a second time.
+ *
+ * Passed to `jwt::decode` through the `replay` parameter.
+ * Each ID is kept until the `exp` of its token (plus the
+ * decode leeway), after which the token would be rejected
+ * as expired anyway, or for `max_ttl` if it has no `exp`.
+ *
+ * - The IDs are stored as 64 bit hashes in open addressing
+ *   tables with linear probing. Two distinct IDs hashing
+ *   the same make the second one look like a replay.
+ * - The store is split into shards, each with its own lock,
+ *   so concurrent inserts rarely wait on each other.
+ * - Expired IDs are dropped by a timing wheel per shard
+ *   while inserting, so no sweeping thread is needed.
+ */
+class jti_store
+{
+public: // 'tors
+  /**
+   * Construct the store.
+   *
+   * Arguments:
+   *  @shards : Number of shards. Rounded up to a power of two.
+   *  @max_ttl : How long to keep IDs of tokens without `exp`.
+   */
+  explicit jti_store(size_t shards = 64,
+                     std::chrono::seconds max_ttl = std::chrono::seconds{3600});
+
+  /// Non copyable and assignable
+  jti_store(const jti_store&) = delete;
+  jti_store& operator=(const jti_store&) = delete;
+
+  ~jti_store() = default;
+
+public: // Exposed APIs
+  /**
+   * Records the ID until `expiry` (seconds since epoch).
+   * Returns false if the ID is already recorded and has
+   * not expired, i.e. the token is a replay.
+   */
+  bool insert(const jwt::string_view jti, uint64_t expiry);
+
+  /**
+   * Checks if the ID is recorded and not expired.
+   */
+  bool contains(const jwt::string_view jti) const;
+
+  /**
+   * Number of IDs held. Includes IDs which have expired
+   * but not been dropped yet.
+   */
+  size_t size() const;
+
+  /**
+   * Drops all the IDs.
+   */
+  void clear();
+
+  /**
+   * The expiry to use for tokens without `exp`.
+   */
+  uint64_t default_expiry(uint64_t now) const noexcept
+  {
+    return now + max_ttl_;
+  }
+
+private: // Private types
+  /*!
+   * A hash of zero marks an empty slot.
+   */
+  struct slot
+  {
+    uint64_t hash = 0;
+    uint64_t expiry = 0;
+  };
+
+  /*!
+   */
+  struct shard
+  {
+    mutable std::mutex mtx;
+    std::vector<slot> slots;
+    size_t count = 0;
+    detail::time_wheel<uint64_t> wheel;
+  };
+
+private: // Private APIs
+  /*!
+   */
+  static uint64_t now() noexcept
+  {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count());
+  }
+
+  /*!
+   */
+  static uint64_t hash_of(const jwt::string_view jti) noexcept
+  {
+    uint64_t h = detail::hash_bytes(jti.data(), jti.length());
+    return h ? h : 1;
+  }
+
+  /*!
+   */
+  const shard& shard_for(uint64_t hash) const noexcept
+  {
+    return *shards_[(hash >> 48) & (shards_.size() - 1)];
+  }
+
+  shard& shard_for(uint64_t hash) noexcept
+  {
+    return *shards_[(hash >> 48) & (shards_.size() - 1)];
+  }
+
+  /*!
+   * Index of the slot holding `hash`, or of the
+   * empty slot ending its probe sequence.
+   */
+  static size_t probe(const std::vector<slot>& slots, uint64_t hash) noexcept;
+
+  /*!
+   * Removes the slot, shifting back the entries
+   * probing past it.
+   */
+  static void erase_at(shard& s, size_t idx) noexcept;
+
+  /*!
+   */
+  static void grow(shard& s);
+
+  /*!
+   */
+  static void expire(shard& s, uint64_t now);
+
+private: // Data members
+  /// TTL for IDs of tokens without `exp`
+  uint64_t max_ttl_;
+
+  /// The shards
+  std::vector<std::unique_ptr<shard>> shards_;
+};
+
+} // END namespace jwt
+
+#include "jwt/impl/jti_store.ipp"
+
+#endif
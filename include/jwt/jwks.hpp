@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_JWKS_HPP
+#define CPP_JWT_JWKS_HPP
+
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "jwt/jwt.hpp"
+#include "jwt/key.hpp"
+#include "jwt/key_ring.hpp"
+
+namespace jwt {
+
+/**
+ * Loading of JSON Web Key Sets (RFC 7517) into key handles.
+ *
+ * The key components are base64url decoded and the public keys
+ * are handed to OpenSSL as a DER `SubjectPublicKeyInfo` built from
+ * them, so no PEM is produced or parsed on the way. The handles
+ * are indexed by `kid` in a `jwt::key_ring` and pinned to the
+ * `alg` of their JWK, or for EC keys to the one of their curve.
+ *
+ * Supported are RSA keys (`n`, `e`), EC keys on P-256, P-384 and
+ * P-521 (`crv`, `x`, `y`) and symmetric keys (`k`). Keys of other
+ * types, curves or algorithms and keys meant for encryption are
+ * skipped, as RFC 7517 asks of implementations.
+ */
+class jwks
+{
+public: // Exposed static APIs
+  /**
+   * Builds the key handle for one JWK.
+   *
+   * Returns an empty handle, with `ec` clear, for keys which are
+   * skipped. Sets InvalidKeyErr in `ec` for malformed keys.
+   */
+  static jwt::key to_key(const json_t& jwk, std::error_code& ec);
+
+  /**
+   * Builds the handles for the keys of a JWK Set, paired with
+   * their `kid`. Keys without `kid` get an empty one, which is
+   * what tokens without a `kid` header are looked up with.
+   *
+   * Sets JsonParseError in `ec` if the text is not a JWK Set
+   * and InvalidKeyErr if any of its keys is malformed. Nothing
+   * is returned on error.
+   */
+  static std::vector<key_ring::value_type> load(const jwt::string_view json_text,
+                                                std::error_code& ec);
+
+  /**
+   * Exception throwing version of `load`.
+   * Throws `DecodeError` or `InvalidKeyError`.
+   */
+  static std::vector<key_ring::value_type> load(const jwt::string_view json_text);
+
+  /**
+   * Replaces the keys of `ring` with the ones of a JWK Set.
+   * The ring is left as it was on error.
+   */
+  static void load(const jwt::string_view json_text, key_ring& ring, std::error_code& ec);
+
+  /**
+   * Exception throwing version of `load`.
+   * Throws `DecodeError` or `InvalidKeyError`.
+   */
+  static void load(const jwt::string_view json_text, key_ring& ring);
+
+private: // Private APIs
+  /*!
+   * Base64url decodes the string member `name` of `jwk`.
+   * Returns false if it is missing or malformed.
+   */
+  static bool decode_member(const json_t& jwk, const char* name, std::string& out);
+
+  /*!
+   */
+  static void throw_if_error(const std::error_code& ec);
+};
+
+} // END namespace jwt
+
+#include "jwt/impl/jwks.ipp"
+
+#endif
@@ -27,6 +27,8 @@ SOFTWARE.
 #include <array>
 #include <string>
 #include <chrono>
+#include <vector>
+#include <cstdint>
 #include <ostream>
 #include <cassert>
 #include <cstring>
@@ -35,9 +37,13 @@ SOFTWARE.
 #include "jwt/base64.hpp"
 #include "jwt/config.hpp"
 #include "jwt/algorithm.hpp"
+#include "jwt/algorithm_registry.hpp"
 #include "jwt/string_view.hpp"
 #include "jwt/parameters.hpp"
+#include "jwt/segments.hpp"
+#include "jwt/instrumentation.hpp"
 #include "jwt/exceptions.hpp"
+#include "jwt/detail/binary_form.hpp"
 #if defined(CPP_JWT_USE_VENDORED_NLOHMANN_JSON)
 #include "jwt/json/json.hpp"
 #else
@@ -224,6 +230,41 @@ struct write_interface
   friend std::ostream& operator<< (std::ostream& os, const T& obj);
 };
 
+namespace detail {
+
+/// Stack bytes for the decoded JSON of a header.
+/// Larger headers continue on the heap.
+constexpr size_t header_scratch_size = 256;
+
+/// Stack bytes for the decoded JSON of a payload.
+/// Larger payloads continue on the heap.
+constexpr size_t payload_scratch_size = 1024;
+
+/// Longest token accepted from an Authorization
+/// header unless a `max_length` parameter is passed.
+constexpr size_t default_max_bearer_length = 8192;
+
+/// Stack bytes for an encoded signature gathered
+/// from a segmented token. Fits RSA 4096 signatures.
+constexpr size_t signature_scratch_size = 704;
+
+/// Version of the binary form written by `to_binary`
+constexpr uint8_t binary_version = 1;
+
+/// Bytes before the body of a binary form:
+/// "JWB", the version and the kind of component
+constexpr size_t binary_prefix_size = 5;
+
+/// The component held in a binary form
+enum class binary_kind: uint8_t
+{
+  HEADER = 1,
+  PAYLOAD,
+  OBJECT,
+};
+
+} // END namespace detail
+
 /**
  * Provides the functionality for doing
  * base64 encoding and decoding from the
@@ -240,14 +281,26 @@ struct base64_enc_dec
    * Does URL safe base64 encoding
    */
   std::string base64_encode(bool with_pretty = false) const
+  {
+    std::string b64_str;
+    base64_encode_append(b64_str, with_pretty);
+    return b64_str;
+  }
+
+  /**
+   * Does URL safe base64 encoding and appends the
+   * result to `out`, saving an intermediate string.
+   */
+  void base64_encode_append(std::string& out, bool with_pretty = false) const
   {
     std::string jstr = to_json_str(*static_cast<const Derived*>(this), with_pretty);
-    std::string b64_str = jwt::base64_encode(jstr.c_str(), jstr.length());
-    // Do the URI safe encoding
-    auto new_len = jwt::base64_uri_encode(&b64_str[0], b64_str.length());
-    b64_str.resize(new_len);
+    const auto pos = out.length();
+    out.resize(pos + jwt::encoding_size(jstr.length()));
 
-    return b64_str;
+    auto new_len = jwt::base64_encode(jstr.c_str(), jstr.length(), &out[pos]);
+    // Do the URI safe encoding
+    new_len = jwt::base64_uri_encode(&out[pos], new_len);
+    out.resize(pos + new_len);
   }
 
   /**
@@ -258,6 +311,15 @@ struct base64_enc_dec
     return jwt::base64_uri_decode(encoded_str.data(), encoded_str.length());
   }
 
+  /**
+   * Does URL safe base64 decoding into any string type.
+   */
+  template <typename StringT>
+  void base64_decode(const jwt::string_view encoded_str, StringT& out)
+  {
+    jwt::base64_uri_decode(encoded_str.data(), encoded_str.length(), out);
+  }
+
 };
 
 
@@ -301,6 +363,10 @@ public: // 'tors
   jwt_header(const jwt_header&) = default;
   jwt_header& operator=(const jwt_header&) = default;
 
+  /// Default move and move assignment
+  jwt_header(jwt_header&&) = default;
+  jwt_header& operator=(jwt_header&&) = default;
+
   ~jwt_header() = default;
 
 public: // Exposed APIs
@@ -364,6 +430,20 @@ public: // Exposed APIs
     return typ_;
   }
 
+  /**
+   * Get the key id (`kid`) header.
+   * Returns an empty view if the header is not present
+   * or is not a string.
+   * @note: The view refers to the header object and is valid
+   * as long as the header is not modified.
+   */
+  jwt::string_view kid() const noexcept
+  {
+    auto itr = payload_.find("kid");
+    if (itr == payload_.end() || !itr->is_string()) return {};
+    return itr->get_ref<const std::string&>();
+  }
+
   /**
    * Add a header to the JWT header.
    */
@@ -374,13 +454,13 @@ public: // Exposed APIs
            >
   bool add_header(const jwt::string_view hname, T&& hvalue, bool overwrite=false)
   {
-    auto itr = headers_.find(hname);
-    if (itr != std::end(headers_) && !overwrite) {
+    std::string name{hname.data(), hname.length()};
+
+    if (!overwrite && payload_.find(name) != payload_.end()) {
       return false;
     }
 
-    headers_.emplace(hname.data(), hname.length());
-    payload_[hname.data()] = std::forward<T>(hvalue);
+    payload_[std::move(name)] = std::forward<T>(hvalue);
 
     return true;
   }
@@ -409,24 +489,17 @@ public: // Exposed APIs
       return true;
     }
 
-    auto itr = headers_.find(hname);
-    if (itr == std::end(headers_)) {
-      return false;
-    }
-    payload_.erase(hname.data());
-    headers_.erase(hname.data());
-
-    return true;
+    return payload_.erase(std::string{hname.data(), hname.length()}) > 0;
   }
 
   /**
    * Checks if header with the given name
    * is present or not.
    */
-  bool has_header(const jwt::string_view hname)
+  bool has_header(const jwt::string_view hname) const
   {
     if (!strcasecmp(hname.data(), "typ")) return typ_ != type::NONE;
-    return headers_.find(hname) != std::end(headers_);
+    return payload_.find(std::string{hname.data(), hname.length()}) != payload_.end();
   }
 
 
@@ -462,6 +535,40 @@ public: // Exposed APIs
    */
   void decode(const jwt::string_view enc_str);
 
+  /**
+   * Decodes a header which is spread over several
+   * segments, without gathering the encoded string.
+   * Errors are reported as for the contiguous version.
+   */
+  void decode(const segmented_view& enc_str, std::error_code& ec);
+
+  /**
+   * Appends the binary form of the header to `out`.
+   * The binary form is the JSON object in a flat tagged
+   * layout behind a versioned prefix, and is read back by
+   * `from_binary` much faster than the JSON text is parsed.
+   */
+  void to_binary(std::vector<uint8_t>& out) const;
+
+  /**
+   * Returns the binary form of the header.
+   */
+  std::vector<uint8_t> to_binary() const;
+
+  /**
+   * Overwrites the header with the one held in the
+   * binary form at `data`.
+   * Sets BinaryFormatError for malformed input and
+   * BinaryVersionMismatch for forms of another version.
+   */
+  void from_binary(const uint8_t* data, size_t len, std::error_code& ec);
+
+  /**
+   * Exception throwing version of `from_binary`.
+   * Throws `DecodeError` exception.
+   */
+  void from_binary(const uint8_t* data, size_t len);
+
   /**
    * Creates a `json_t` object this class instance.
    * @note: Presence of this member function is a requirement
@@ -472,6 +579,19 @@ public: // Exposed APIs
     return payload_;
   }
 
+private: // Private implementation
+  /*!
+   * Parses the decoded JSON and validates the
+   * registered header fields.
+   */
+  void parse_json(const char* data, size_t len, std::error_code& ec);
+
+  /*!
+   * Sets the algorithm and type from the
+   * JSON object and validates them.
+   */
+  void load_fields(std::error_code& ec);
+
 private: // Data members
   /// The Algorithm to use for signature creation
   SCOPED_ENUM algorithm alg_ = algorithm::NONE;
@@ -479,11 +599,9 @@ private: // Data members
   /// The type of header
   SCOPED_ENUM type      typ_ = type::JWT;
 
-  // The JSON payload object
+  // The JSON payload object.
+  // Also the only record of the header names.
   json_t payload_;
-
-  //Extra headers for JWS
-  jwt_set::header_claim_set_t headers_; 
 };
 
 
@@ -514,6 +632,10 @@ public: // 'tors
   jwt_payload(const jwt_payload&) = default;
   jwt_payload& operator=(const jwt_payload&) = default;
 
+  /// Default move and move assignment
+  jwt_payload(jwt_payload&&) = default;
+  jwt_payload& operator=(jwt_payload&&) = default;
+
   ~jwt_payload() = default;
 
 public: // Exposed APIs
@@ -538,22 +660,42 @@ public: // Exposed APIs
            >
   bool add_claim(const jwt::string_view cname, T&& cvalue, bool overwrite=false)
   {
+    std::string name{cname.data(), cname.length()};
+
     // Duplicate claim names not allowed
     // if overwrite flag is set to true.
-    auto itr = claim_names_.find(cname);
-    if (itr != claim_names_.end() && !overwrite) {
+    if (!overwrite && payload_.find(name) != payload_.end()) {
       return false;
     }
 
-    // Add it to the known set of claims
-    claim_names_.emplace(cname.data(), cname.length());
-
     //Add it to the json payload
-    payload_[cname.data()] = std::forward<T>(cvalue);
+    payload_[std::move(name)] = std::forward<T>(cvalue);
 
     return true;
   }
 
+  /**
+   * Adds all the claims of a JSON object.
+   * The values are moved, and the whole object is moved
+   * if the payload has no claims yet.
+   * Claims already present are not overwritten.
+   *
+   * @note: `claims` must be a JSON object.
+   */
+  void add_claims(json_t&& claims)
+  {
+    assert (claims.is_object() && "Claims must be a JSON object");
+
+    if (payload_.empty()) {
+      payload_ = std::move(claims);
+      return;
+    }
+
+    for (auto it = claims.begin(); it != claims.end(); ++it) {
+      add_claim(it.key(), std::move(it.value()));
+    }
+  }
+
   /**
    * Adds a claim.
    * This overload takes string claim value.
@@ -659,13 +801,7 @@ public: // Exposed APIs
    */
   bool remove_claim(const jwt::string_view cname)
   {
-    auto itr = claim_names_.find(cname);
-    if (itr == claim_names_.end()) return false;
-
-    claim_names_.erase(itr);
-    payload_.erase(cname.data());
-
-    return true;
+    return payload_.erase(std::string{cname.data(), cname.length()}) > 0;
   }
 
   /**
@@ -683,12 +819,9 @@ public: // Exposed APIs
    * or not.
    * @note: Claim name is case sensitive for this API.
    */
-  //TODO: Not all libc++ version agrees with this
-  //because count() is not made const for is_transparent
-  //based overload
-  bool has_claim(const jwt::string_view cname) const noexcept
+  bool has_claim(const jwt::string_view cname) const
   {
-    return claim_names_.find(cname) != std::end(claim_names_);
+    return payload_.find(std::string{cname.data(), cname.length()}) != payload_.end();
   }
 
   /**
@@ -697,7 +830,7 @@ public: // Exposed APIs
    * Overload which takes the claim name as an instance
    * of `registered_claims` type.
    */
-  bool has_claim(SCOPED_ENUM registered_claims cname) const noexcept
+  bool has_claim(SCOPED_ENUM registered_claims cname) const
   {
     return has_claim(reg_claims_to_str(cname));
   }
@@ -709,10 +842,10 @@ public: // Exposed APIs
   template <typename T>
   bool has_claim_with_value(const jwt::string_view cname, T&& cvalue) const
   {
-    auto itr = claim_names_.find(cname);
-    if (itr == claim_names_.end()) return false;
+    auto itr = payload_.find(std::string{cname.data(), cname.length()});
+    if (itr == payload_.end()) return false;
 
-    return (cvalue == payload_[cname.data()]);
+    return (cvalue == *itr);
   }
 
   /**
@@ -755,6 +888,40 @@ public: // Exposed APIs
    */
   void decode(const jwt::string_view enc_str);
 
+  /**
+   * Decodes a payload which is spread over several
+   * segments, without gathering the encoded string.
+   * Errors are reported as for the contiguous version.
+   */
+  void decode(const segmented_view& enc_str, std::error_code& ec);
+
+  /**
+   * Appends the binary form of the payload to `out`.
+   * The binary form is the JSON object in a flat tagged
+   * layout behind a versioned prefix, and is read back by
+   * `from_binary` much faster than the JSON text is parsed.
+   */
+  void to_binary(std::vector<uint8_t>& out) const;
+
+  /**
+   * Returns the binary form of the payload.
+   */
+  std::vector<uint8_t> to_binary() const;
+
+  /**
+   * Overwrites the payload with the one held in the
+   * binary form at `data`.
+   * Sets BinaryFormatError for malformed input and
+   * BinaryVersionMismatch for forms of another version.
+   */
+  void from_binary(const uint8_t* data, size_t len, std::error_code& ec);
+
+  /**
+   * Exception throwing version of `from_binary`.
+   * Throws `DecodeError` exception.
+   */
+  void from_binary(const uint8_t* data, size_t len);
+
   /**
    * Creates a JSON object of the payload.
    *
@@ -768,10 +935,9 @@ public: // Exposed APIs
 
 private:
 
-  /// JSON object containing payload
+  /// JSON object containing payload.
+  /// Also the only record of the claim names.
   json_t payload_;
-  /// The set of claim names in the payload
-  jwt_set::header_claim_set_t claim_names_;
 };
 
 /**
@@ -790,9 +956,20 @@ public: // 'tors
 
   /**
    * Constructor which takes the key.
+   * The key is borrowed, not copied, and must
+   * outlive the signature object.
    */
   jwt_signature(const jwt::string_view key)
-    : key_(key.data(), key.length())
+    : key_(key)
+  {
+  }
+
+  /**
+   * Constructor which takes a key handle.
+   * The parsed key held by the handle is used as is.
+   */
+  jwt_signature(const jwt::key& key)
+    : handle_(key)
   {
   }
 
@@ -803,6 +980,22 @@ public: // 'tors
   ~jwt_signature() = default;
 
 public: // Exposed APIs
+  /**
+   * The borrowed key. Empty if a key handle is used.
+   */
+  jwt::string_view secret() const noexcept
+  {
+    return key_;
+  }
+
+  /**
+   * The key handle, if constructed with one.
+   */
+  const jwt::key& handle() const noexcept
+  {
+    return handle_;
+  }
+
   /**
    * Encodes the header and payload to get the
    * three part JWS signature.
@@ -820,6 +1013,14 @@ public: // Exposed APIs
               const jwt::string_view hdr_pld_sign,
               const jwt::string_view jwt_sign);
 
+  /**
+   * Verifies the JWS signature of a header and payload
+   * which are spread over several segments.
+   */
+  verify_result_t verify(const jwt_header& header,
+              const segmented_view& hdr_pld_sign,
+              const jwt::string_view jwt_sign);
+
 private: // Private implementation
   /*!
    */
@@ -829,14 +1030,25 @@ private: // Private implementation
    */
   verify_func_t get_verify_algorithm_impl(const jwt_header& hdr) const noexcept;
 
+  /*!
+   */
+  sign_key_func_t get_sign_key_algorithm_impl(const jwt_header& hdr) const noexcept;
+
+  /*!
+   */
+  verify_key_func_t get_verify_key_algorithm_impl(const jwt_header& hdr) const noexcept;
+
   /*!
    */
   verify_result_t check_for_algo_confusion_attack(const jwt_header& hdr) const;
 
 private: // Data members;
 
-  /// The key for creating the JWS
-  std::string key_;
+  /// The key for creating the JWS. Borrowed.
+  jwt::string_view key_;
+
+  /// The key handle. Takes precedence over `key_` if set.
+  jwt::key handle_;
 };
 
 
@@ -891,6 +1103,14 @@ public: // Exposed static APIs
   static std::array<jwt::string_view, 3>
   three_parts(const jwt::string_view enc_str);
 
+  /**
+   * Splits a JWT spread over several segments into
+   * its three parts. The parts are views over the same
+   * segments and may themselves span segments.
+   */
+  static std::array<segmented_view, 3>
+  three_parts(const segmented_view& enc_str);
+
 public: // Exposed APIs
   /**
    * Returns the payload component object by reference.
@@ -962,6 +1182,15 @@ public: // Exposed APIs
    * Get the secret to be used for signing.
    */
   std::string secret() const
+  {
+    return { secret_.material().data(), secret_.material().length() };
+  }
+
+  /**
+   * Get the handle to the key used for signing.
+   * Copies of the object share the same key.
+   */
+  const jwt::key& key() const noexcept
   {
     return secret_;
   }
@@ -971,7 +1200,15 @@ public: // Exposed APIs
    */
   void secret(const jwt::string_view sv)
   {
-    secret_.assign(sv.data(), sv.length());
+    secret_ = jwt::key::from_secret(sv);
+  }
+
+  /**
+   * Set the key to be used for signing.
+   */
+  void secret(const jwt::key& k)
+  {
+    secret_ = k;
   }
 
   /**
@@ -1032,7 +1269,7 @@ public: // Exposed APIs
    *
    * @note: See `jwt_payload::has_claim` for more details.
    */
-  bool has_claim(const jwt::string_view cname) const noexcept
+  bool has_claim(const jwt::string_view cname) const
   {
     return payload().has_claim(cname);
   }
@@ -1043,7 +1280,7 @@ public: // Exposed APIs
    *
    * @note: See `jwt_payload::has_claim` for more details.
    */
-  bool has_claim(SCOPED_ENUM registered_claims cname) const noexcept
+  bool has_claim(SCOPED_ENUM registered_claims cname) const
   {
     return payload().has_claim(cname);
   }
@@ -1064,6 +1301,27 @@ public: // Exposed APIs
    */
   std::string signature() const;
 
+  /**
+   * Returns the binary form of the header and payload,
+   * for passing a verified object to another process or
+   * keeping it in a shared cache without the JSON text.
+   * The key is not part of it.
+   */
+  std::vector<uint8_t> to_binary() const;
+
+  /**
+   * Overwrites the header and payload with the ones held
+   * in the binary form at `data`.
+   * Reports errors as the component versions do.
+   */
+  void from_binary(const uint8_t* data, size_t len, std::error_code& ec);
+
+  /**
+   * Exception throwing version of `from_binary`.
+   * Throws `DecodeError` exception.
+   */
+  void from_binary(const uint8_t* data, size_t len);
+
   /**
    * Verify the signature.
    * TODO: Returns an error_code instead of taking
@@ -1085,11 +1343,21 @@ private: // private APIs
   template <typename M, typename... Rest>
   void set_parameters(params::detail::payload_param<M>&&, Rest&&...);
 
+  /**
+   */
+  template <typename T, typename... Rest>
+  void set_parameters(params::detail::claims_param<T>&&, Rest&&...);
+
   /**
    */
   template <typename... Rest>
   void set_parameters(params::detail::secret_param, Rest&&...);
 
+  /**
+   */
+  template <typename... Rest>
+  void set_parameters(params::detail::key_param, Rest&&...);
+
   /**
    */
   template <typename... Rest>
@@ -1112,6 +1380,27 @@ public: //TODO: Not good
   template <typename DecodeParams, typename T, typename... Rest>
   static void set_decode_params(DecodeParams& dparams, params::detail::secret_function_param<T>&& s, Rest&&... args);
 
+  template <typename DecodeParams, typename... Rest>
+  static void set_decode_params(DecodeParams& dparams, params::detail::key_param k, Rest&&... args);
+
+  template <typename DecodeParams, typename... Rest>
+  static void set_decode_params(DecodeParams& dparams, params::detail::key_ring_param r, Rest&&... args);
+
+  template <typename DecodeParams, typename... Rest>
+  static void set_decode_params(DecodeParams& dparams, params::detail::cache_param c, Rest&&... args);
+
+  template <typename DecodeParams, typename... Rest>
+  static void set_decode_params(DecodeParams& dparams, params::detail::shared_cache_param c, Rest&&... args);
+
+  template <typename DecodeParams, typename... Rest>
+  static void set_decode_params(DecodeParams& dparams, params::detail::replay_param r, Rest&&... args);
+
+  template <typename DecodeParams, typename... Rest>
+  static void set_decode_params(DecodeParams& dparams, params::detail::revoked_param r, Rest&&... args);
+
+  template <typename DecodeParams, typename... Rest>
+  static void set_decode_params(DecodeParams& dparams, params::detail::max_length_param m, Rest&&... args);
+
   template <typename DecodeParams, typename... Rest>
   static void set_decode_params(DecodeParams& dparams, params::detail::leeway_param l, Rest&&... args);
 
@@ -1144,10 +1433,54 @@ private: // Data Members
   /// JWT payload section
   jwt_payload payload_;
 
-  /// The secret key
-  std::string secret_;
+  /// The secret key. Parsed once and shared by copies.
+  jwt::key secret_;
 };
 
+namespace detail {
+
+/**
+ * The signature check which is left to do once a token
+ * has been parsed and its claims verified.
+ *
+ * Holds offsets into the encoded token instead of views so
+ * that it can be run against a copy of the token, possibly
+ * on another thread.
+ */
+struct pending_signature
+{
+  /// False if there is nothing left to check
+  bool required = false;
+
+  /// Signer set up with the key to verify with
+  jwt_signature sign;
+
+  /// Length of the encoded header and payload with the '.'
+  size_t signed_len = 0;
+
+  /// Start of the encoded signature
+  size_t sign_pos = 0;
+
+  /// Store to record the jti in once the signature checks out
+  jwt::jti_store* replay = nullptr;
+  std::string jti;
+  uint64_t jti_expiry = 0;
+
+  /**
+   * Verifies the signature of `enc_str`, and if it is
+   * valid records the jti in the replay store.
+   */
+  std::error_code run(const jwt_header& hdr, const jwt::string_view enc_str);
+
+  /**
+   * Verifies the signature of a token spread over
+   * several segments.
+   */
+  std::error_code run(const jwt_header& hdr, const segmented_view& enc_str);
+};
+
+} // END namespace detail
+
 /**
  * Decode the JWT signature to create the `jwt_object`.
  * This version reports error back using `std::error_code`.
@@ -1182,6 +1515,28 @@ private: // Data Members
  * then set InvalidIAT error.
  *
  * 8. validate_jti: Checks if jti claim is present or not.
+ *
+ * The `secret` parameter can also be a `jwt::key` handle, or a
+ * `jwt::key_ring` in which case the key is looked up by the `kid`
+ * header of the token.
+ *
+ * 9. cache: A `jwt::token_cache` (see "jwt/token_cache.hpp") which
+ * is consulted before and filled after decoding. Only used when
+ * verification is enabled and no `replay` store is passed.
+ * A `shared_cache`, a `jwt::shared_token_cache` (see
+ * "jwt/shared_token_cache.hpp"), is used the same way, and is
+ * consulted after the `cache` when both are passed.
+ *
+ * 10. replay: A `jwt::jti_store`. The jti claim is then required,
+ * and a token whose jti is already in the store is rejected with
+ * TokenReplayed. The jti is recorded only after the signature
+ * has been verified.
+ *
+ * 11. revoked: A `jwt::revocation_set`. Tokens whose jti or
+ * signature is in the set are rejected with TokenRevoked.
+ *
+ * 12. max_length: Tokens longer than this are rejected with
+ * TokenTooLarge before any parsing.
  */
 template <typename SequenceT, typename... Args>
 jwt_object decode(const jwt::string_view enc_str, 
@@ -1198,6 +1553,77 @@ jwt_object decode(const jwt::string_view enc_str,
                   const params::detail::algorithms_param<SequenceT>& algos,
                   Args&&... args);
 
+/**
+ * Extracts the token from the value of an `Authorization`
+ * header carrying Bearer credentials (RFC 6750), i.e.
+ * "Bearer <token>".
+ *
+ * The scheme is matched case-insensitively and surrounding
+ * whitespace is ignored. The returned view points into
+ * `header_value`; nothing is copied or allocated.
+ *
+ * Sets `ec` to AuthSchemeMismatch for other schemes,
+ * TokenTooLarge for tokens longer than `max_len` and
+ * SignatureFormatError for an empty token or one with
+ * characters outside of the token68 set.
+ */
+inline jwt::string_view bearer_token(const jwt::string_view header_value,
+                                     std::error_code& ec,
+                                     size_t max_len = detail::default_max_bearer_length) noexcept;
+
+/**
+ * Decodes the token carried by the value of an `Authorization`
+ * header. Malformed header values are rejected by `bearer_token`
+ * before anything is parsed or allocated, and an empty object is
+ * returned. The token is then decoded in place.
+ *
+ * Takes the same parameters as `decode`. The `max_length`
+ * parameter overrides `detail::default_max_bearer_length`.
+ */
+template <typename SequenceT, typename... Args>
+jwt_object decode_bearer(const jwt::string_view header_value,
+                         const params::detail::algorithms_param<SequenceT>& algos,
+                         std::error_code& ec,
+                         Args&&... args);
+
+/**
+ * Decodes the token carried by the value of an `Authorization`
+ * header. This version reports error back by throwing exceptions.
+ */
+template <typename SequenceT, typename... Args>
+jwt_object decode_bearer(const jwt::string_view header_value,
+                         const params::detail::algorithms_param<SequenceT>& algos,
+                         Args&&... args);
+
+/**
+ * Decode a JWT which is spread over several segments,
+ * for eg. the `iovec`s filled by a `readv` call or the
+ * chunks of an HTTP header handed out by a parser.
+ *
+ * The header and payload are base64 decoded straight
+ * from the segments and the signed part is fed to the
+ * verifier a segment at a time. Only the encoded signature
+ * is gathered when it spans segments.
+ *
+ * Takes the same parameters as the contiguous version.
+ * With a `cache` or `shared_cache` parameter the token is
+ * gathered first since the caches are keyed on the whole token.
+ */
+template <typename SequenceT, typename... Args>
+jwt_object decode(const segmented_view& enc_str,
+                  const params::detail::algorithms_param<SequenceT>& algos,
+                  std::error_code& ec,
+                  Args&&... args);
+
+/**
+ * Decode a JWT which is spread over several segments.
+ * This version reports error back by throwing exceptions.
+ */
+template <typename SequenceT, typename... Args>
+jwt_object decode(const segmented_view& enc_str,
+                  const params::detail::algorithms_param<SequenceT>& algos,
+                  Args&&... args);
+
 
 } // END namespace jwt
 
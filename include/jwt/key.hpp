@@ -0,0 +1,409 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_KEY_HPP
+#define CPP_JWT_KEY_HPP
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <system_error>
+
+#include "jwt/config.hpp"
+#include "jwt/algorithm.hpp"
+#include "jwt/exceptions.hpp"
+#include "jwt/error_codes.hpp"
+#include "jwt/string_view.hpp"
+#include "jwt/ec_nonce_pool.hpp"
+#include "jwt/detail/hash.hpp"
+#include "jwt/detail/asn1.hpp"
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/param_build.h>
+#endif
+
+namespace jwt {
+
+/**
+ * The kind of key material held by a `jwt::key`.
+ */
+enum class key_type
+{
+  // Empty handle
+  NONE = 0,
+  // Shared secret for the HMAC algorithms
+  SECRET,
+  // Public key for the RSA and EC algorithms
+  PUBLIC,
+  // Private key for the RSA and EC algorithms
+  PRIVATE,
+};
+
+class key;
+class ec_nonce_pool;
+
+/// The function pointer type for signing with a key handle
+using sign_key_func_t = sign_result_t (*) (const key& k,
+                                           const jwt::string_view data);
+
+/// The function pointer type for verifying with a key handle
+using verify_key_func_t = verify_result_t (*) (const key& k,
+                                               const segmented_view& head,
+                                               const jwt::string_view jwt_sign);
+
+/**
+ * A shared, immutable handle to key material.
+ *
+ * The material is copied once when the handle is created and
+ * the asymmetric keys are parsed into an `EVP_PKEY` at the same
+ * time. Copying the handle only bumps a reference count, so
+ * any number of owners (key rings, decode parameters, signers)
+ * can refer to the same parsed key.
+ *
+ * A handle can optionally be pinned to an algorithm, in which
+ * case tokens with any other `alg` header are rejected when
+ * verified with it.
+ *
+ * Every use of an `EVP_PKEY` by OpenSSL bumps its reference
+ * count, so a single key shared by many verifying threads turns
+ * into a contended cache line. See `replicated` for handles
+ * which keep a copy of the parsed key per thread slot.
+ */
+class key
+{
+public: // 'tors
+  /**
+   * Constructs an empty handle.
+   */
+  key() = default;
+
+  /// Default copy, move and assignment
+  key(const key&) = default;
+  key& operator=(const key&) = default;
+  key(key&&) = default;
+  key& operator=(key&&) = default;
+
+  ~key() = default;
+
+public: // Exposed static APIs
+  /**
+   * Creates a handle from a string that can be used as
+   * the `secret` of the decode and encode APIs.
+   *
+   * If the string is a PEM encoded public or private key
+   * it is parsed as one, otherwise it is taken as an HMAC
+   * secret.
+   */
+  static key from_secret(const jwt::string_view secret,
+                         SCOPED_ENUM algorithm alg = algorithm::UNKN);
+
+  /**
+   * Creates a handle from a PEM encoded public or private key.
+   * Sets InvalidKeyErr in `ec` if the PEM could not be parsed.
+   */
+  static key from_pem(const jwt::string_view pem,
+                      std::error_code& ec,
+                      SCOPED_ENUM algorithm alg = algorithm::UNKN);
+
+  /**
+   * Exception throwing version of `from_pem`.
+   * Throws `InvalidKeyError`.
+   */
+  static key from_pem(const jwt::string_view pem,
+                      SCOPED_ENUM algorithm alg = algorithm::UNKN);
+
+  /**
+   * Creates a handle from a raw HMAC secret.
+   *
+   * Unlike `from_secret`, the bytes are never looked at as a
+   * PEM encoded key, which suits binary secrets.
+   */
+  static key from_raw_secret(const jwt::string_view secret,
+                             SCOPED_ENUM algorithm alg = algorithm::UNKN);
+
+  /**
+   * Creates a handle from a DER encoded RSA or EC key. Takes a
+   * public key as a `SubjectPublicKeyInfo` (as written by
+   * `i2d_PUBKEY`), or a private key as a PKCS#8 `PrivateKeyInfo`
+   * or in the traditional `RSAPrivateKey` / `ECPrivateKey` form.
+   * Encrypted private keys are not supported.
+   * Sets InvalidKeyErr in `ec` if the DER could not be parsed.
+   */
+  static key from_der(const jwt::string_view der,
+                      std::error_code& ec,
+                      SCOPED_ENUM algorithm alg = algorithm::UNKN);
+
+  /**
+   * Exception throwing version of `from_der`.
+   * Throws `InvalidKeyError`.
+   */
+  static key from_der(const jwt::string_view der,
+                      SCOPED_ENUM algorithm alg = algorithm::UNKN);
+
+  /**
+   * Creates a handle from a raw EC public point in the SEC 1
+   * uncompressed (0x04 || X || Y) or compressed form.
+   *
+   * `alg` picks the curve (P-256, P-384 and P-521 for ES256,
+   * ES384 and ES512) and the handle is pinned to it.
+   * Sets InvalidKeyErr in `ec` if `alg` is not an EC algorithm
+   * or the point is not on the curve.
+   */
+  static key from_ec_point(const jwt::string_view point,
+                           SCOPED_ENUM algorithm alg,
+                           std::error_code& ec);
+
+  /**
+   * Exception throwing version of `from_ec_point`.
+   * Throws `InvalidKeyError`.
+   */
+  static key from_ec_point(const jwt::string_view point,
+                           SCOPED_ENUM algorithm alg);
+
+public: // Exposed APIs
+  /**
+   * Returns a handle to the same key which keeps `slots`
+   * private copies of the parsed key (rounded up to a power
+   * of two, defaulting to the number of hardware threads).
+   *
+   * Threads are pinned to a slot by their id and the copy for
+   * a slot is parsed on its first use. Only useful for PUBLIC
+   * and PRIVATE keys; for others it returns the handle as is.
+   */
+  key replicated(size_t slots = 0) const;
+
+  /**
+   * Returns a handle to the same EC private key whose ES256,
+   * ES384 and ES512 signatures take their nonces from a pool of
+   * up to `capacity` precomputed ones, kept full by a background
+   * thread (see `jwt::ec_nonce_pool`). The thread stops when the
+   * last copy of the returned handle goes away.
+   *
+   * Meant for issuers with bursty load: a signature with a ready
+   * nonce costs a few scalar operations instead of a point
+   * multiplication. For other keys, or where OpenSSL is built
+   * without its deprecated EC_KEY API, it returns the handle as
+   * is.
+   */
+  key with_nonce_pool(size_t capacity = 64) const;
+
+  /**
+   * The nonce pool of the handle, if any.
+   */
+  ec_nonce_pool* nonce_pool() const noexcept
+  {
+#if defined(CPP_JWT_HAS_EC_NONCE_POOL)
+    return data_ ? data_->nonces.get() : nullptr;
+#else
+    return nullptr;
+#endif
+  }
+
+  /**
+   * Number of replica slots. Zero if the key is not replicated.
+   */
+  size_t replicas() const noexcept
+  {
+    return data_ && data_->replicas ? data_->replica_mask + 1 : 0;
+  }
+
+  /**
+   * Checks if the handle refers to any key.
+   */
+  explicit operator bool() const noexcept
+  {
+    return data_ != nullptr;
+  }
+
+  /**
+   * The kind of key material.
+   */
+  SCOPED_ENUM key_type type() const noexcept
+  {
+    return data_ ? data_->type : key_type::NONE;
+  }
+
+  /**
+   * The algorithm the key is pinned to.
+   * `algorithm::UNKN` if it is not pinned.
+   */
+  SCOPED_ENUM algorithm algo() const noexcept
+  {
+    return data_ ? data_->alg : algorithm::UNKN;
+  }
+
+  /**
+   * The key material as provided while creating the handle.
+   */
+  jwt::string_view material() const noexcept
+  {
+    return data_ ? jwt::string_view{data_->material} : jwt::string_view{};
+  }
+
+  /**
+   * The parsed key for the PUBLIC and PRIVATE key types.
+   * nullptr otherwise.
+   */
+  EVP_PKEY* evp_pkey() const noexcept
+  {
+    return data_ ? data_->pkey.get() : nullptr;
+  }
+
+  /**
+   * The parsed key to be used by the calling thread.
+   * Same as `evp_pkey` unless the handle is replicated.
+   */
+  EVP_PKEY* local_pkey() const;
+
+  /**
+   * The HMAC pad states of a SECRET key for `Hasher` (one of
+   * `algo::HS256`, `algo::HS384` and `algo::HS512`), computed
+   * on first use and kept with the key. nullptr for the other
+   * key types and for an empty secret.
+   */
+  template <typename Hasher>
+  const typename Hasher::mac_state* mac_state() const
+  {
+    if (!data_ || data_->type != key_type::SECRET || data_->material.empty()) {
+      return nullptr;
+    }
+
+    auto& slot = std::get<pad_slot<typename Hasher::mac_state>>(data_->pads);
+    std::call_once(slot.once, [&] {
+      slot.state.init(data_->material.data(), data_->material.length());
+    });
+    return &slot.state;
+  }
+
+private: // Private types
+  /*!
+   * A lazily computed HMAC pad state.
+   */
+  template <typename State>
+  struct pad_slot
+  {
+    State state;
+    std::once_flag once;
+  };
+
+  /*!
+   */
+  struct data
+  {
+    data() = default;
+    data(const data&) = delete;
+    data& operator=(const data&) = delete;
+
+    ~data()
+    {
+      std::get<0>(pads).state.clear();
+      std::get<1>(pads).state.clear();
+      std::get<2>(pads).state.clear();
+
+      if (!replicas) return;
+      for (size_t i = 0; i <= replica_mask; ++i) {
+        EVP_PKEY* p = replicas[i].load(std::memory_order_relaxed);
+        if (p) EVP_PKEY_free(p);
+      }
+    }
+
+    key_type type = key_type::NONE;
+    SCOPED_ENUM algorithm alg = algorithm::UNKN;
+    std::string material;
+    /// `material` is DER rather than PEM
+    bool der = false;
+    EC_PKEY_uptr pkey{nullptr, ev_pkey_deletor};
+
+    /// HMAC pad states of a SECRET key, one per hash
+    mutable std::tuple<pad_slot<detail::hmac_sha256_key>,
+                       pad_slot<detail::hmac_sha384_key>,
+                       pad_slot<detail::hmac_sha512_key>> pads;
+
+#if defined(CPP_JWT_HAS_EC_NONCE_POOL)
+    /// Precomputed ECDSA nonces, see `with_nonce_pool`
+    std::unique_ptr<ec_nonce_pool> nonces;
+#endif
+
+    /// Per thread slot copies of `pkey`, parsed lazily
+    size_t replica_mask = 0;
+    std::unique_ptr<std::atomic<EVP_PKEY*>[]> replicas;
+  };
+
+  /*!
+   */
+  explicit key(std::shared_ptr<const data> d)
+    : data_(std::move(d))
+  {
+  }
+
+  /*!
+   */
+  static EVP_PKEY* parse_pem(const jwt::string_view pem, SCOPED_ENUM key_type& type);
+
+  /*!
+   */
+  static EVP_PKEY* parse_der(const jwt::string_view der, SCOPED_ENUM key_type& type);
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  /*!
+   * Imports an RSA or EC public key from its SPKI parts,
+   * bypassing the decoder framework of OpenSSL 3.
+   * Sets `handled` to false for other key types.
+   */
+  static EVP_PKEY* import_public(const detail::spki_parts& parts, bool& handled);
+#endif
+
+  /*!
+   * Parses the material of `d` again.
+   */
+  static EVP_PKEY* parse_material(const data& d, SCOPED_ENUM key_type& type)
+  {
+    return d.der ? parse_der(d.material, type) : parse_pem(d.material, type);
+  }
+
+  /*!
+   * Hash of the calling thread's id.
+   */
+  static size_t thread_slot_hash() noexcept
+  {
+    static thread_local const size_t h = [] {
+      size_t id = std::hash<std::thread::id>{}(std::this_thread::get_id());
+      return static_cast<size_t>(detail::hash_bytes(&id, sizeof(id)));
+    }();
+    return h;
+  }
+
+private: // Data members
+  /// The shared key material
+  std::shared_ptr<const data> data_;
+};
+
+} // END namespace jwt
+
+#include "jwt/impl/key.ipp"
+
+#endif
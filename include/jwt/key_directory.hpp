@@ -0,0 +1,294 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_KEY_DIRECTORY_HPP
+#define CPP_JWT_KEY_DIRECTORY_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "jwt/jwt.hpp"
+#include "jwt/key.hpp"
+#include "jwt/key_ring.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+# define CPP_JWT_HAS_KEY_DIRECTORY 1
+#endif
+
+#if defined(__linux__)
+# define CPP_JWT_HAS_INOTIFY 1
+#endif
+
+#if defined(CPP_JWT_HAS_KEY_DIRECTORY)
+
+namespace jwt {
+
+/**
+ * The keys found in a directory, one per file, indexed by the
+ * file name without its extension as the key id.
+ *
+ * Meant for keys deployed by a configuration agent. A file
+ * holds a PEM or DER encoded RSA or EC key, public or private.
+ * Hidden files (starting with '.') and anything which is not a
+ * regular file, or a link to one, are skipped.
+ *
+ * The keys live in a `jwt::key_ring`, so decoding with
+ * `secret(dir)` looks them up in its current snapshot without
+ * blocking on reloads.
+ *
+ * - `refresh` lists the directory and parses only the files
+ *   whose inode, size or modification time changed since the
+ *   previous refresh. The first refresh parses the files on
+ *   several threads. The new set of keys is published at once.
+ * - A file which cannot be read or parsed keeps the key it had
+ *   before, if any, and is tried again on the next refresh.
+ *   A half written file thus does not take its key away.
+ * - `watch` refreshes from a background thread whenever inotify
+ *   reports a change in the directory. Elsewhere, or without
+ *   watching, call `refresh` from a timer.
+ */
+class key_directory
+{
+public: // 'tors
+  /**
+   * Constructs an empty set for the directory at `path`.
+   * Nothing is read until `refresh` is called.
+   */
+  explicit key_directory(std::string path)
+    : path_(std::move(path))
+  {
+  }
+
+  /// Non copyable and assignable
+  key_directory(const key_directory&) = delete;
+  key_directory& operator=(const key_directory&) = delete;
+
+  /**
+   * Stops the watching thread.
+   */
+  ~key_directory()
+  {
+    stop();
+  }
+
+public: // Exposed APIs
+  /**
+   * Reads the directory again and publishes the keys if
+   * anything changed.
+   *
+   * Sets a system error in `ec` if the directory could not be
+   * listed, in which case nothing changes. Sets InvalidKeyErr
+   * if some of the files could not be parsed; the others are
+   * published all the same.
+   *
+   * Arguments:
+   *  @threads : Most threads parsing the changed files.
+   *             Defaults to the number of hardware threads.
+   */
+  void refresh(std::error_code& ec, size_t threads = 0);
+
+  /**
+   * Exception throwing version of `refresh`.
+   * Throws `std::system_error` or `InvalidKeyError`.
+   */
+  void refresh(size_t threads = 0);
+
+  /**
+   * Starts refreshing from a background thread on every change
+   * to the directory. Does a refresh first.
+   *
+   * Sets `operation_not_supported` in `ec` where inotify is not
+   * available, or a system error if the watch could not be set.
+   * Errors of the refresh done first are set as well, but the
+   * watch is started anyway.
+   */
+  void watch(std::error_code& ec);
+
+  /**
+   * Stops the background thread, if any.
+   */
+  void stop();
+
+  /**
+   * Checks if the background thread is running.
+   */
+  bool watching() const noexcept
+  {
+    return watcher_.joinable();
+  }
+
+  /**
+   * The error of the last refresh.
+   */
+  std::error_code last_error() const
+  {
+    std::lock_guard<std::mutex> lk{refresh_mtx_};
+    return last_error_;
+  }
+
+  /**
+   * Number of times a new set of keys was published.
+   * Increases after the keys are visible to readers.
+   */
+  uint64_t generation() const noexcept
+  {
+    return generation_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * The ring holding the keys.
+   */
+  const jwt::key_ring& ring() const noexcept
+  {
+    return ring_;
+  }
+
+  /**
+   * Finds the key with the given key id.
+   * Returns an empty handle if not found.
+   */
+  jwt::key find(const jwt::string_view kid) const
+  {
+    return ring_.find(kid);
+  }
+
+  /**
+   * Number of keys.
+   */
+  size_t size() const noexcept
+  {
+    return ring_.size();
+  }
+
+  /**
+   * The directory.
+   */
+  const std::string& path() const noexcept
+  {
+    return path_;
+  }
+
+private: // Private types
+  /*!
+   * What identifies a version of a file.
+   */
+  struct file_stamp
+  {
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+    uint64_t size = 0;
+    int64_t mtime_sec = 0;
+    int64_t mtime_nsec = 0;
+
+    bool operator==(const file_stamp& other) const noexcept
+    {
+      return dev == other.dev && ino == other.ino && size == other.size &&
+             mtime_sec == other.mtime_sec && mtime_nsec == other.mtime_nsec;
+    }
+  };
+
+  /*!
+   * A key file as last seen.
+   * `stamp` is left empty if the file could not be parsed.
+   */
+  struct file_entry
+  {
+    file_stamp stamp;
+    jwt::key key;
+  };
+
+  /*!
+   * A file to parse in a refresh.
+   */
+  struct parse_job
+  {
+    std::string name;
+    file_stamp stamp;
+    jwt::key key;
+  };
+
+private: // Private APIs
+  /*!
+   * Lists the key files with their stamps.
+   */
+  bool list_files(std::map<std::string, file_stamp>& files, std::error_code& ec) const;
+
+  /*!
+   * Reads and parses `job.name`. Leaves the key empty on error.
+   */
+  void parse_file(parse_job& job) const;
+
+  /*!
+   * The key id for a file name.
+   */
+  static std::string kid_of(const std::string& name);
+
+  /*!
+   */
+  void refresh_locked(std::error_code& ec, size_t threads);
+
+  /*!
+   */
+  void watch_loop(int inotify_fd, int wake_fd);
+
+private: // Data members
+  std::string path_;
+  jwt::key_ring ring_;
+
+  /// Serializes refreshes
+  mutable std::mutex refresh_mtx_;
+  std::map<std::string, file_entry> files_;
+  std::error_code last_error_;
+
+  std::atomic<uint64_t> generation_{0};
+
+  std::thread watcher_;
+  /// Write end of the pipe waking the watcher up to stop
+  int wake_fd_ = -1;
+};
+
+namespace params {
+
+/**
+ * Decodes with the keys of a `jwt::key_directory`, looked up
+ * by the `kid` header of the token.
+ */
+inline detail::key_ring_param secret(const jwt::key_directory& d)
+{
+  return { d.ring() };
+}
+
+} // END namespace params
+
+} // END namespace jwt
+
+#include "jwt/impl/key_directory.ipp"
+
+#endif // CPP_JWT_HAS_KEY_DIRECTORY
+
+#endif
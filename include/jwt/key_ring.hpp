@@ -0,0 +1,223 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_KEY_RING_HPP
+#define CPP_JWT_KEY_RING_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+#include "jwt/key.hpp"
+#include "jwt/string_view.hpp"
+#include "jwt/detail/binary_form.hpp"
+#include "jwt/detail/parallel.hpp"
+
+namespace jwt {
+
+/**
+ * A set of keys indexed by their key id (the `kid` header).
+ *
+ * The keys are kept in an immutable snapshot, a vector sorted
+ * by key id, which is published through an atomic shared pointer.
+ * Readers take a reference to the current snapshot and look up
+ * keys without blocking on writers. Writers build a new snapshot
+ * and swap it in, so a rotation is seen by readers all at once.
+ *
+ * Writers are serialized among themselves.
+ *
+ * For a fast start with many keys, `load` parses them on all
+ * cores, and `save_snapshot` / `load_snapshot` keep the parsed
+ * set in a file of DER encoded keys, which skips the PEM
+ * decoding on the next start.
+ */
+class key_ring
+{
+public: // typedefs
+  /// An entry in the ring
+  using value_type = std::pair<std::string, jwt::key>;
+
+  /// The immutable sorted set of entries
+  using snapshot_type = std::vector<value_type>;
+
+  /// Shared pointer to a published snapshot
+  using snapshot_ptr = std::shared_ptr<const snapshot_type>;
+
+  /// A key id and its PEM or DER encoded key, for `load`
+  using source_type = std::pair<std::string, std::string>;
+
+public: // 'tors
+  /**
+   * Constructs an empty key ring.
+   */
+  key_ring()
+    : snapshot_(std::make_shared<const snapshot_type>())
+  {
+  }
+
+  /// Non copyable and assignable
+  key_ring(const key_ring&) = delete;
+  key_ring& operator=(const key_ring&) = delete;
+
+  ~key_ring() = default;
+
+public: // Exposed APIs
+  /**
+   * Returns the current snapshot of the ring.
+   * The snapshot remains valid as long as the returned
+   * pointer is held, irrespective of later rotations.
+   */
+  snapshot_ptr snapshot() const noexcept
+  {
+    return std::atomic_load_explicit(&snapshot_, std::memory_order_acquire);
+  }
+
+  /**
+   * Finds the key with the given key id.
+   * Returns an empty handle if not found.
+   */
+  jwt::key find(const jwt::string_view kid) const
+  {
+    return find(*snapshot(), kid);
+  }
+
+  /**
+   * Finds the key with the given key id in a snapshot.
+   * Returns an empty handle if not found.
+   */
+  static jwt::key find(const snapshot_type& snap, const jwt::string_view kid);
+
+  /**
+   * Number of keys in the ring.
+   */
+  size_t size() const noexcept
+  {
+    return snapshot()->size();
+  }
+
+  /**
+   * Adds a key to the ring or replaces the one with the same key id.
+   */
+  void insert(const jwt::string_view kid, jwt::key k);
+
+  /**
+   * Removes the key with the given key id.
+   * Returns false if no such key was present.
+   */
+  bool erase(const jwt::string_view kid);
+
+  /**
+   * Replaces the whole set of keys at once.
+   * Duplicate key ids are resolved in favour of the last one.
+   */
+  void assign(std::vector<value_type> keys);
+
+  /**
+   * Parses the PEM or DER encoded keys on up to `threads`
+   * threads (defaulting to the number of hardware threads) and
+   * replaces the whole set with them at once.
+   *
+   * Sets InvalidKeyErr in `ec` and leaves the ring as it was if
+   * any of the keys could not be parsed.
+   */
+  void load(const std::vector<source_type>& sources,
+            std::error_code& ec,
+            size_t threads = 0);
+
+  /**
+   * Writes the current set of keys to the file at `path`: the
+   * key ids, types and pinned algorithms, and the keys as DER
+   * (secrets as they are). The file is written next to `path`
+   * and renamed over it, readable by its owner only.
+   *
+   * Sets a system error in `ec` if the file could not be
+   * written, or InvalidKeyErr if a key could not be encoded.
+   */
+  void save_snapshot(const std::string& path, std::error_code& ec) const;
+
+  /**
+   * Replaces the whole set of keys with the ones in a file
+   * written by `save_snapshot`, parsing them on up to `threads`
+   * threads.
+   *
+   * The file is checked against its SHA-256 digest first. Sets
+   * BinaryFormatError or BinaryVersionMismatch in `ec` if it is
+   * not a snapshot of this version, InvalidKeyErr if a key does
+   * not parse to its recorded type, or a system error if it
+   * could not be read. The ring is left as it was on error.
+   */
+  void load_snapshot(const std::string& path,
+                     std::error_code& ec,
+                     size_t threads = 0);
+
+private: // Private types
+  /// Version of the snapshot file
+  static constexpr uint8_t snapshot_version = 1;
+
+  /// "JWKR" and the version
+  static constexpr size_t snapshot_prefix_size = 5;
+
+  static constexpr size_t snapshot_digest_size = 32;
+
+private: // Private APIs
+  /*!
+   * Encodes the key for a snapshot.
+   * Returns false if it could not.
+   */
+  static bool snapshot_material(const jwt::key& k, std::string& out);
+
+  /*!
+   */
+  static bool kid_less(const value_type& v, const jwt::string_view kid) noexcept
+  {
+    return jwt::string_view{v.first} < kid;
+  }
+
+  /*!
+   */
+  void publish(snapshot_type snap)
+  {
+    std::atomic_store_explicit(
+        &snapshot_,
+        snapshot_ptr{std::make_shared<const snapshot_type>(std::move(snap))},
+        std::memory_order_release);
+  }
+
+private: // Data members
+  /// The published snapshot.
+  /// Accessed only through the atomic shared_ptr functions.
+  snapshot_ptr snapshot_;
+
+  /// Serializes the writers
+  std::mutex write_mtx_;
+};
+
+} // END namespace jwt
+
+#include "jwt/impl/key_ring.ipp"
+
+#endif
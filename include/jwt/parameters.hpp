@@ -31,11 +31,19 @@ SOFTWARE.
 #include <unordered_map>
 
 #include "jwt/algorithm.hpp"
+#include "jwt/key.hpp"
+#include "jwt/key_ring.hpp"
+#include "jwt/jti_store.hpp"
+#include "jwt/revocation_set.hpp"
 #include "jwt/detail/meta.hpp"
 #include "jwt/string_view.hpp"
 
 namespace jwt {
 
+class token_cache;
+class shared_token_cache;
+class key_directory;
+
 using system_time_t = std::chrono::time_point<std::chrono::system_clock>;
 
 namespace params {
@@ -60,12 +68,33 @@ struct payload_param
     : payload_(std::forward<MappingConcept>(mc))
   {}
 
-  MappingConcept get() && { return std::move(payload_); }
+  MappingConcept get() && { return std::forward<MappingConcept>(payload_); }
   const MappingConcept& get() const& { return payload_; }
 
   MappingConcept payload_;
 };
 
+/**
+ * Parameter for providing the payload as a ready
+ * JSON object or as a claims struct convertible to
+ * one (through nlohmann `to_json`).
+ * An rvalue is moved into the payload of the object.
+ *
+ * Modeled as ParameterConcept.
+ */
+template <typename T>
+struct claims_param
+{
+  claims_param(T&& claims)
+    : claims_(std::forward<T>(claims))
+  {}
+
+  T get() && { return std::forward<T>(claims_); }
+  const T& get() const& { return claims_; }
+
+  T claims_;
+};
+
 /**
  * Parameter for providing the secret key.
  * Stores only the view of the provided string
@@ -84,6 +113,39 @@ struct secret_param
   string_view secret_;
 };
 
+/**
+ * Parameter for providing the key as a `jwt::key` handle.
+ * Holds a reference to the shared key, not a copy.
+ *
+ * Modeled as ParameterConcept.
+ */
+struct key_param
+{
+  key_param(const jwt::key& k)
+    : key_(k)
+  {}
+
+  const jwt::key& get() const noexcept { return key_; }
+  jwt::key key_;
+};
+
+/**
+ * Parameter for providing a `jwt::key_ring` from which
+ * the key is picked by the `kid` header of the token.
+ * Stores only a reference to the ring.
+ *
+ * Modeled as ParameterConcept.
+ */
+struct key_ring_param
+{
+  key_ring_param(const jwt::key_ring& r)
+    : ring_(&r)
+  {}
+
+  const jwt::key_ring& get() const noexcept { return *ring_; }
+  const jwt::key_ring* ring_;
+};
+
 template <typename T>
 struct secret_function_param
 {
@@ -93,6 +155,40 @@ struct secret_function_param
   T fun_;
 };
 
+/**
+ * Parameter for providing a `jwt::token_cache` to
+ * consult and fill while decoding.
+ * Stores only a reference to the cache.
+ *
+ * Modeled as ParameterConcept.
+ */
+struct cache_param
+{
+  cache_param(jwt::token_cache& c)
+    : cache_(&c)
+  {}
+
+  jwt::token_cache& get() const noexcept { return *cache_; }
+  jwt::token_cache* cache_;
+};
+
+/**
+ * Parameter for providing a `jwt::shared_token_cache` to
+ * consult and fill while decoding.
+ * Stores only a reference to the cache.
+ *
+ * Modeled as ParameterConcept.
+ */
+struct shared_cache_param
+{
+  shared_cache_param(jwt::shared_token_cache& c)
+    : cache_(&c)
+  {}
+
+  jwt::shared_token_cache& get() const noexcept { return *cache_; }
+  jwt::shared_token_cache* cache_;
+};
+
 /**
  * Parameter for providing the algorithm to use.
  * The parameter can accept either the string representation
@@ -132,7 +228,7 @@ struct headers_param
     : headers_(std::forward<MappingConcept>(mc))
   {}
 
-  MappingConcept get() && { return std::move(headers_); }
+  MappingConcept get() && { return std::forward<MappingConcept>(headers_); }
   const MappingConcept& get() const& { return headers_; }
 
   MappingConcept headers_;
@@ -247,6 +343,51 @@ struct validate_jti_param
   bool jti_;
 };
 
+/**
+ * Parameter for providing the `jwt::jti_store`
+ * used to reject replayed tokens.
+ * Stores only a reference to the store.
+ */
+struct replay_param
+{
+  replay_param(jwt::jti_store& s)
+    : store_(&s)
+  {}
+
+  jwt::jti_store& get() const noexcept { return *store_; }
+  jwt::jti_store* store_;
+};
+
+/**
+ * Parameter for providing the `jwt::revocation_set`
+ * to check tokens against.
+ * Stores only a reference to the set.
+ */
+struct revoked_param
+{
+  revoked_param(const jwt::revocation_set& s)
+    : set_(&s)
+  {}
+
+  const jwt::revocation_set& get() const noexcept { return *set_; }
+  const jwt::revocation_set* set_;
+};
+
+/**
+ * Parameter for providing the maximum length
+ * of the encoded token.
+ */
+struct max_length_param
+{
+  max_length_param(size_t n)
+    : len_(n)
+  {}
+
+  size_t get() const noexcept { return len_; }
+
+  size_t len_;
+};
+
 /**
  */
 struct nbf_param
@@ -265,6 +406,29 @@ struct nbf_param
   uint64_t duration_;
 };
 
+/**
+ * Returns the first parameter of type `P`
+ * in the pack or nullptr if there is none.
+ */
+template <typename P>
+const P* find_param() noexcept
+{
+  return nullptr;
+}
+
+template <typename P, typename... Rest>
+const P* find_param(const P& p, const Rest&...) noexcept
+{
+  return &p;
+}
+
+template <typename P, typename First, typename... Rest,
+          typename=std::enable_if_t<!std::is_same<P, First>::value>>
+const P* find_param(const First&, const Rest&... rest) noexcept
+{
+  return find_param<P>(rest...);
+}
+
 } // END namespace detail
 
 // Useful typedef
@@ -274,16 +438,18 @@ using param_seq_list_t  = std::initializer_list<jwt::string_view>;
 
 /**
  */
-inline detail::payload_param<std::unordered_map<std::string, std::string>>
+/// The key-value views of an initializer list.
+/// Refers to the strings of the caller.
+using param_kv_views_t = std::vector<std::pair<jwt::string_view, jwt::string_view>>;
+
+/**
+ * @note: Only the views of the keys and values are kept,
+ * so they must outlive the construction of the object.
+ */
+inline detail::payload_param<param_kv_views_t>
 payload(const param_init_list_t& kvs)
 {
-  std::unordered_map<std::string, std::string> m;
-
-  for (const auto& elem : kvs) {
-    m.emplace(elem.first.data(), elem.second.data());
-  }
-
-  return { std::move(m) };
+  return { param_kv_views_t(kvs) };
 }
 
 /**
@@ -299,6 +465,19 @@ payload(MappingConcept&& mc)
 }
 
 
+/**
+ * Takes the payload as a `json_t` object or as a claims
+ * struct which can be converted to one.
+ * Pass an rvalue to move the claims into the payload
+ * without copying them.
+ */
+template <typename T>
+detail::claims_param<T>
+claims(T&& c)
+{
+  return { std::forward<T>(c) };
+}
+
 /**
  */
 inline detail::secret_param secret(const string_view sv)
@@ -306,8 +485,26 @@ inline detail::secret_param secret(const string_view sv)
   return { sv };
 }
 
+/**
+ */
+inline detail::key_param secret(const jwt::key& k)
+{
+  return { k };
+}
+
+/**
+ */
+inline detail::key_ring_param secret(const jwt::key_ring& r)
+{
+  return { r };
+}
+
 template <typename T>
-inline std::enable_if_t<!std::is_convertible<T, string_view>::value, detail::secret_function_param<T>>  
+inline std::enable_if_t<!std::is_convertible<T, string_view>::value &&
+                        !std::is_same<std::decay_t<T>, jwt::key>::value &&
+                        !std::is_same<std::decay_t<T>, jwt::key_ring>::value &&
+                        !std::is_same<std::decay_t<T>, jwt::key_directory>::value,
+                        detail::secret_function_param<T>>
 secret(T&& fun)
 {
   return detail::secret_function_param<T>{ fun };
@@ -329,16 +526,14 @@ inline detail::algorithm_param algorithm(jwt::algorithm alg)
 
 /**
  */
-inline detail::headers_param<std::map<std::string, std::string>>
+/**
+ * @note: Only the views of the keys and values are kept,
+ * so they must outlive the construction of the object.
+ */
+inline detail::headers_param<param_kv_views_t>
 headers(const param_init_list_t& kvs)
 {
-  std::map<std::string, std::string> m;
-
-  for (const auto& elem : kvs) {
-    m.emplace(elem.first.data(), elem.second.data());
-  }
-
-  return { std::move(m) };
+  return { param_kv_views_t(kvs) };
 }
 
 /**
@@ -421,6 +616,22 @@ validate_iat(bool v)
   return { v };
 }
 
+/**
+ */
+inline detail::replay_param
+replay(jwt::jti_store& s)
+{
+  return { s };
+}
+
+/**
+ */
+inline detail::revoked_param
+revoked(const jwt::revocation_set& s)
+{
+  return { s };
+}
+
 /**
  */
 inline detail::validate_jti_param
@@ -429,6 +640,30 @@ validate_jti(bool v)
   return { v };
 }
 
+/**
+ */
+inline detail::cache_param
+cache(jwt::token_cache& c)
+{
+  return { c };
+}
+
+/**
+ */
+inline detail::shared_cache_param
+shared_cache(jwt::shared_token_cache& c)
+{
+  return { c };
+}
+
+/**
+ */
+inline detail::max_length_param
+max_length(size_t n)
+{
+  return { n };
+}
+
 /**
  */
 inline detail::nbf_param
@@ -0,0 +1,277 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_REVOCATION_SET_HPP
+#define CPP_JWT_REVOCATION_SET_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <system_error>
+
+#include "jwt/string_view.hpp"
+#include "jwt/detail/hash.hpp"
+#include "jwt/detail/bloom.hpp"
+
+namespace jwt {
+
+/**
+ * A set of revoked tokens, identified by their `jti` claim
+ * or by their encoded signature.
+ *
+ * Passed to `jwt::decode` through the `revoked` parameter.
+ *
+ * Entries are 64 bit hashes kept in a sorted array, fronted
+ * by a blocked Bloom filter. As nearly every token checked is
+ * not revoked, a lookup is usually answered by the filter with
+ * a single cache line read, and the array is only searched on
+ * a filter hit. Lookups do not allocate.
+ *
+ * The filter and array form an immutable snapshot published
+ * through an atomic shared pointer, as for `jwt::key_ring`.
+ * Writers rebuild the snapshot, so revoke in batches when
+ * adding many entries.
+ *
+ * The set can be saved to and loaded from a snapshot file
+ * holding the filter and the array as they are in memory:
+ *
+ *   offset 0  : header (64 bytes, see `snapshot_header`)
+ *   offset 64 : filter blocks, 64 bytes each
+ *   then      : sorted hashes, 8 bytes each
+ *
+ * On POSIX systems `load` maps the file read-only and answers
+ * lookups straight from the mapping, so loading takes no time
+ * and processes loading the same file share its pages. `save`
+ * writes to a temporary file renamed over the target, so
+ * readers never see a partial snapshot.
+ */
+class revocation_set
+{
+public: // 'tors
+  /**
+   * Constructs an empty set.
+   *
+   * Arguments:
+   *  @bits_per_key : Bloom filter bits per entry.
+   */
+  explicit revocation_set(size_t bits_per_key = 16);
+
+  /// Non copyable and assignable
+  revocation_set(const revocation_set&) = delete;
+  revocation_set& operator=(const revocation_set&) = delete;
+
+  ~revocation_set() = default;
+
+public: // Exposed static APIs
+  /**
+   * The entry hash for a `jti` claim value.
+   */
+  static uint64_t jti_hash(const jwt::string_view jti) noexcept
+  {
+    return detail::hash_bytes(jti.data(), jti.length(), jti_seed);
+  }
+
+  /**
+   * The entry hash for a token signature, i.e. the
+   * base64url encoded part after the second '.'.
+   */
+  static uint64_t signature_hash(const jwt::string_view sign) noexcept
+  {
+    return detail::hash_bytes(sign.data(), sign.length(), signature_seed);
+  }
+
+public: // Exposed APIs
+  /**
+   * Revokes the tokens with this `jti`.
+   */
+  void revoke_jti(const jwt::string_view jti)
+  {
+    insert({ jti_hash(jti) });
+  }
+
+  /**
+   * Revokes the token with this encoded signature.
+   */
+  void revoke_signature(const jwt::string_view sign)
+  {
+    insert({ signature_hash(sign) });
+  }
+
+  /**
+   * Adds a batch of entry hashes.
+   */
+  void insert(std::vector<uint64_t> hashes);
+
+  /**
+   * Replaces all the entries at once.
+   */
+  void assign(std::vector<uint64_t> hashes);
+
+  /**
+   * Checks if the entry hash is in the set.
+   */
+  bool contains(uint64_t hash) const noexcept;
+
+  /**
+   * Checks if tokens with this `jti` are revoked.
+   */
+  bool is_revoked_jti(const jwt::string_view jti) const noexcept
+  {
+    return contains(jti_hash(jti));
+  }
+
+  /**
+   * Checks if the token with this encoded signature is revoked.
+   */
+  bool is_revoked_signature(const jwt::string_view sign) const noexcept
+  {
+    return contains(signature_hash(sign));
+  }
+
+  /**
+   * Writes the current entries to a snapshot file.
+   * The file is replaced atomically by a rename.
+   */
+  void save(const std::string& path, std::error_code& ec) const;
+
+  /**
+   * Exception throwing version of `save`.
+   * Throws `std::system_error`.
+   */
+  void save(const std::string& path) const;
+
+  /**
+   * Replaces all the entries with the ones of a snapshot file.
+   * The set keeps the file mapped until it is replaced again.
+   * Sets `invalid_argument` in `ec` for malformed files.
+   */
+  void load(const std::string& path, std::error_code& ec);
+
+  /**
+   * Exception throwing version of `load`.
+   * Throws `std::system_error`.
+   */
+  void load(const std::string& path);
+
+  /**
+   * Number of entries.
+   */
+  size_t size() const noexcept
+  {
+    return snapshot()->count;
+  }
+
+private: // Private types
+  /// Seeds keeping the jti and signature hashes apart
+  static constexpr uint64_t jti_seed = 0x6a7469;
+  static constexpr uint64_t signature_seed = 0x736967;
+
+  /*!
+   * An immutable filter and sorted hash array. The views
+   * point into the owned vectors or into a mapped file.
+   */
+  struct table
+  {
+    const uint64_t* filter = nullptr;
+    size_t blocks = 0;
+    const uint64_t* hashes = nullptr;
+    size_t count = 0;
+
+    std::vector<uint64_t> filter_store;
+    std::vector<uint64_t> hash_store;
+
+    /// Keeps the mapped file, if any, alive
+    std::shared_ptr<const void> mapping;
+  };
+
+  /*!
+   * Layout of the snapshot file header.
+   * All fields are in host byte order.
+   */
+  struct snapshot_header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t blocks;
+    uint64_t count;
+    uint64_t filter_offset;
+    uint64_t hashes_offset;
+    uint64_t reserved[2];
+  };
+
+  /// Eight bytes including the terminating nul
+  static const char* snapshot_magic() noexcept { return "JWTREVS"; }
+  static constexpr uint32_t snapshot_version = 1;
+  static constexpr uint32_t snapshot_byte_order = 0x01020304;
+
+  using table_ptr = std::shared_ptr<const table>;
+
+private: // Private APIs
+  /*!
+   */
+  table_ptr snapshot() const noexcept
+  {
+    return std::atomic_load_explicit(&table_, std::memory_order_acquire);
+  }
+
+  /*!
+   * Reads the file into memory, or maps it where possible.
+   * Returns the file contents and its size.
+   */
+  static std::shared_ptr<const void> map_file(const std::string& path,
+                                              size_t& size,
+                                              std::error_code& ec);
+
+  /*!
+   * Builds a table from sorted unique hashes.
+   */
+  table_ptr build(std::vector<uint64_t> sorted) const;
+
+  /*!
+   */
+  void publish(table_ptr t)
+  {
+    std::atomic_store_explicit(&table_, std::move(t), std::memory_order_release);
+  }
+
+private: // Data members
+  /// Bloom filter bits per entry
+  size_t bits_per_key_;
+
+  /// The published table.
+  /// Accessed only through the atomic shared_ptr functions.
+  table_ptr table_;
+
+  /// Serializes the writers
+  std::mutex write_mtx_;
+};
+
+} // END namespace jwt
+
+#include "jwt/impl/revocation_set.ipp"
+
+#endif
@@ -0,0 +1,190 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_SEGMENTS_HPP
+#define CPP_JWT_SEGMENTS_HPP
+
+#include <cstddef>
+#include <cstring>
+
+#include "jwt/string_view.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/uio.h>
+#define CPP_JWT_HAS_IOVEC 1
+#endif
+
+namespace jwt {
+
+/**
+ * A read only view over a byte string which is split
+ * into several non-contiguous segments, as handed out
+ * by scatter/gather I/O or by an HTTP parser.
+ *
+ * The view does not own the segments nor the array
+ * describing them. Both must outlive the view.
+ *
+ * A view can be narrowed down to a sub range with
+ * `subview`, which is what the decoder does to address
+ * the parts of a token without gathering them.
+ */
+class segmented_view
+{
+public: // typedefs
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+public: // 'tors
+  segmented_view() = default;
+
+  /**
+   * A view of a single contiguous segment.
+   */
+  explicit segmented_view(const jwt::string_view sv) noexcept
+    : single_(sv)
+    , length_(sv.length())
+  {
+  }
+
+  /**
+   * A view of `count` segments described by `segs`.
+   */
+  segmented_view(const jwt::string_view* segs, size_t count) noexcept;
+
+#if defined(CPP_JWT_HAS_IOVEC)
+  /**
+   * A view of `count` segments described by `iov`.
+   */
+  segmented_view(const struct iovec* iov, size_t count) noexcept;
+#endif
+
+  /// Copy constructor and assignment operator
+  segmented_view(const segmented_view&) = default;
+  segmented_view& operator=(const segmented_view&) = default;
+
+public: // Exposed APIs
+  /**
+   * Total number of bytes in the view.
+   */
+  size_t length() const noexcept
+  {
+    return length_;
+  }
+
+  /**
+   * Checks if there are no bytes in the view.
+   */
+  bool empty() const noexcept
+  {
+    return length_ == 0;
+  }
+
+  /**
+   * Position of the first `ch` at or after `pos`.
+   * `npos` if there is none.
+   */
+  size_t find(char ch, size_t pos = 0) const noexcept;
+
+  /**
+   * Number of occurrences of `ch`.
+   */
+  size_t count(char ch) const noexcept;
+
+  /**
+   * A view of `len` bytes starting at `pos`.
+   * The range is clamped to the bytes in the view.
+   */
+  segmented_view subview(size_t pos, size_t len = npos) const noexcept;
+
+  /**
+   * Checks if all the bytes of the view lie
+   * within a single segment.
+   */
+  bool contiguous() const noexcept;
+
+  /**
+   * The bytes of the view.
+   * @note: Valid only if the view is `contiguous`.
+   */
+  jwt::string_view as_contiguous() const noexcept;
+
+  /**
+   * Copies the bytes of the view to `out`, which must
+   * have space for `length()` bytes.
+   */
+  void copy(char* out) const noexcept;
+
+  /**
+   * Calls `fn` with each non-empty contiguous
+   * piece of the view, in order, as `jwt::string_view`.
+   */
+  template <typename Func>
+  void for_each(Func&& fn) const
+  {
+    size_t start = 0;
+    size_t rem = length_;
+
+    for (size_t i = 0; i < num_segments() && rem; ++i) {
+      jwt::string_view seg = segment(i);
+      size_t seg_end = start + seg.length();
+
+      if (seg_end > offset_) {
+        size_t skip = offset_ > start ? offset_ - start : 0;
+        size_t len = seg.length() - skip;
+        if (len > rem) len = rem;
+        if (len) fn(jwt::string_view{seg.data() + skip, len});
+        rem -= len;
+      }
+      start = seg_end;
+    }
+  }
+
+private: // Private implementation
+  /*!
+   */
+  size_t num_segments() const noexcept
+  {
+    return segs_ || iov_ ? count_ : 1;
+  }
+
+  /*!
+   */
+  jwt::string_view segment(size_t i) const noexcept;
+
+private: // Data members
+  /// The segments. Both null for a single segment view.
+  const jwt::string_view* segs_ = nullptr;
+  const void* iov_ = nullptr;
+  size_t count_ = 0;
+
+  /// The segment of a single segment view
+  jwt::string_view single_;
+
+  /// The range of the view within the concatenated segments
+  size_t offset_ = 0;
+  size_t length_ = 0;
+};
+
+} // END namespace jwt
+
+#include "jwt/impl/segments.ipp"
+
+#endif
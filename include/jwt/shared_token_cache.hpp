@@ -0,0 +1,272 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_SHARED_TOKEN_CACHE_HPP
+#define CPP_JWT_SHARED_TOKEN_CACHE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+#include "jwt/jwt.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+# define CPP_JWT_HAS_SHARED_CACHE 1
+#endif
+
+#if defined(CPP_JWT_HAS_SHARED_CACHE)
+
+namespace jwt {
+
+/**
+ * A cache of verified tokens in a POSIX shared memory segment,
+ * shared by every process attached to the same segment.
+ *
+ * Passed to `jwt::decode` through the `shared_cache` parameter.
+ * Meant for prefork servers: once one worker has verified a
+ * token, the others find it with a lookup instead of a JSON
+ * parse and a signature check.
+ *
+ * - The segment holds a fixed open addressing table. A token
+ *   goes to one of `probe_length` slots after the one picked by
+ *   its SHA-256 digest, evicting the entry closest to expiry
+ *   when they are all taken.
+ * - Each slot holds the digest, the expiry time and the binary
+ *   form of the decoded object (see `jwt_object::to_binary`),
+ *   behind a sequence lock. Readers do not write to the segment
+ *   and retry if a writer got in the way. Writers take a slot by
+ *   making its sequence odd, and skip slots held by another one.
+ * - Tokens are matched on their SHA-256 digest, the token itself
+ *   is not stored.
+ * - Only verified tokens are stored, until their `exp` claim or
+ *   for `max_ttl` if they have none. Objects with a binary form
+ *   larger than the slot are not stored.
+ *
+ * Objects found in the cache carry no key, as for `from_binary`.
+ *
+ * @note: As with `jwt::token_cache`, the cache does not know the
+ * decode parameters. Use one segment per verification policy.
+ * Every process which can attach to the segment can make the
+ * others accept a token, so the segment is created readable and
+ * writable by its owner only.
+ *
+ * @note: A process dying in the middle of a write leaves that
+ * slot locked and unused until `clear` is called.
+ */
+class shared_token_cache
+{
+public: // 'tors
+  /**
+   * Construct a cache which is not attached to any segment
+   * yet. Lookups miss and inserts are dropped until `attach`
+   * succeeds.
+   *
+   * Arguments:
+   *  @max_ttl : How long to keep verified tokens without `exp`.
+   */
+  explicit shared_token_cache(std::chrono::seconds max_ttl = std::chrono::seconds{300})
+    : max_ttl_(static_cast<uint64_t>(max_ttl.count()))
+  {
+  }
+
+  /// Non copyable and assignable
+  shared_token_cache(const shared_token_cache&) = delete;
+  shared_token_cache& operator=(const shared_token_cache&) = delete;
+
+  /**
+   * Unmaps the segment. The segment itself stays until
+   * `remove` is called.
+   */
+  ~shared_token_cache()
+  {
+    detach();
+  }
+
+public: // Exposed static APIs
+  /**
+   * Removes the named segment. Processes attached to it keep
+   * using it until they detach.
+   */
+  static void remove(const std::string& name, std::error_code& ec);
+
+public: // Exposed APIs
+  /**
+   * Attaches to the named segment, creating it if it does not
+   * exist. `name` is as for `shm_open`, e.g. "/myapp-tokens".
+   *
+   * An existing segment is used with the geometry it was created
+   * with. Sets `invalid_argument` in `ec` if it is not a cache
+   * segment, and `resource_unavailable_try_again` if its creator
+   * did not finish setting it up in time.
+   *
+   * Arguments:
+   *  @slots : Number of slots. Rounded up to a power of two.
+   *  @max_form_size : Largest binary form stored, in bytes.
+   */
+  void attach(const std::string& name,
+              std::error_code& ec,
+              size_t slots = 1 << 14,
+              size_t max_form_size = 1024);
+
+  /**
+   * Exception throwing version of `attach`.
+   * Throws `std::system_error`.
+   */
+  void attach(const std::string& name,
+              size_t slots = 1 << 14,
+              size_t max_form_size = 1024);
+
+  /**
+   * Unmaps the segment.
+   */
+  void detach() noexcept;
+
+  /**
+   * Checks if the cache is attached to a segment.
+   */
+  bool attached() const noexcept
+  {
+    return base_ != nullptr;
+  }
+
+  /**
+   * Looks up the token.
+   * Returns false on a miss, else sets `obj` to the object
+   * which was stored for it.
+   */
+  bool find(const jwt::string_view token, jwt_object& obj) const;
+
+  /**
+   * Stores the verified object decoded from the token.
+   */
+  void insert(const jwt::string_view token, const jwt_object& obj);
+
+  /**
+   * Returns the cached object for the token if present,
+   * else calls `decode_fn(ec)` and stores what it returns
+   * if it was verified. Used by `jwt::decode`.
+   */
+  template <typename DecodeFn>
+  jwt_object decode(const jwt::string_view token, std::error_code& ec, DecodeFn&& decode_fn);
+
+  /**
+   * Number of live entries. Walks the whole table.
+   */
+  size_t size() const noexcept;
+
+  /**
+   * Number of slots in the segment.
+   */
+  size_t capacity() const noexcept;
+
+  /**
+   * Drops all the entries, in every attached process.
+   * Must not run concurrently with writers.
+   */
+  void clear() noexcept;
+
+private: // Private types
+  /// Slots looked at for a token
+  static constexpr size_t probe_length = 8;
+
+  static constexpr size_t digest_size = 32;
+
+  /*!
+   * Layout of the segment header.
+   * `ready` is set last by the creator.
+   */
+  struct segment_header
+  {
+    std::atomic<uint32_t> ready;
+    uint32_t version;
+    uint64_t magic;
+    uint64_t slots;
+    uint64_t slot_size;
+    uint64_t max_form_size;
+    uint64_t reserved[3];
+  };
+
+  /*!
+   * Layout of a slot, followed by up to `max_form_size`
+   * bytes of binary form.
+   */
+  struct slot_header
+  {
+    std::atomic<uint32_t> seq;
+    uint32_t form_size;
+    uint64_t expiry;
+    unsigned char digest[digest_size];
+  };
+
+  static constexpr uint64_t segment_magic = 0x4a5754534843ULL; // "JWTSHC"
+  static constexpr uint32_t segment_version = 1;
+
+private: // Private APIs
+  /*!
+   */
+  static uint64_t now() noexcept
+  {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count());
+  }
+
+  /*!
+   * SHA-256 of the token. Returns false on failure.
+   */
+  static bool token_digest(const jwt::string_view token, unsigned char* out);
+
+  /*!
+   */
+  slot_header* slot_at(size_t index) const noexcept
+  {
+    return reinterpret_cast<slot_header*>(
+        static_cast<char*>(base_) + sizeof(segment_header) + index * slot_size_);
+  }
+
+  /*!
+   */
+  uint64_t expiry_for(const jwt_object& obj, uint64_t now) const;
+
+private: // Data members
+  /// TTL for tokens without `exp`
+  uint64_t max_ttl_;
+
+  /// The mapping
+  void* base_ = nullptr;
+  size_t map_size_ = 0;
+
+  /// Geometry of the attached segment
+  size_t slots_ = 0;
+  size_t slot_size_ = 0;
+  size_t max_form_size_ = 0;
+};
+
+} // END namespace jwt
+
+#include "jwt/impl/shared_token_cache.ipp"
+
+#endif // CPP_JWT_HAS_SHARED_CACHE
+
+#endif
@@ -29,6 +29,12 @@ SOFTWARE.
 namespace jwt {
 /*
  * A basic_string implementation using stack allocation.
+ * The string is placed in the stack buffer of its arena
+ * and moves to heap blocks if it outgrows the buffer.
+ *
+ * Usage:
+ *   Arena<256> arena;
+ *   short_string<256> str{arena};
  */
 template <size_t N>
 using short_string = std::basic_string<char, std::char_traits<char>, stack_alloc<char, N>>;
@@ -32,10 +32,18 @@
 
 #include <cstddef>
 #include <cassert>
+#include <new>
 
 namespace jwt {
 
 /*
+ * A monotonic arena which hands out memory from a stack
+ * resident buffer of `N` bytes first and from a chain of
+ * heap allocated blocks once that is exhausted.
+ *
+ * Memory is only given back when the arena is released
+ * or destroyed, except for the most recent allocation
+ * which can be rolled back by `deallocate`.
  */
 template <
   /// Size of the stack allocated byte buffer.
@@ -48,6 +56,8 @@ class Arena
 public: // 'tors
   Arena() noexcept
     : ptr_(buf_)
+    , begin_(buf_)
+    , end_(buf_ + N)
   {
     static_assert (alignment <= alignof(std::max_align_t),
         "Alignment chosen is more than the maximum supported alignment");
@@ -59,33 +69,41 @@ public: // 'tors
 
   ~Arena() 
   { 
+    release();
     ptr_ = nullptr; 
   }
 
 public: // Public APIs
 
   /*
-   * Reserves space within the buffer of size atleast 'n'
-   * bytes.
+   * Reserves space of size atleast 'n' bytes.
    * More bytes maybe reserved based on the alignment requirements.
    *
-   * Returns:
-   * 1. The pointer within the storage buffer where the object can be constructed.
-   * 2. nullptr if space cannot be reserved for requested number of bytes 
-   *    (+ alignment padding if applicable)
+   * Returns the pointer within the stack buffer or within
+   * a heap block where the object can be constructed.
+   *
+   * Throws std::bad_alloc if a heap block could not be allocated.
    */
   template <
     /// The requested alignment for this allocation.
     /// Must be less than or equal to the 'alignment'.
     size_t requested_alignment
   >
-  char* allocate(size_t n) noexcept;
+  char* allocate(size_t n);
 
   /*
-   * Free back the space pointed by p within the storage buffer.
+   * Free back the space pointed by p.
+   * Only the most recent allocation is actually reclaimed.
    */
   void deallocate(char* p, size_t n) noexcept;
 
+  /*
+   * Frees all the heap blocks and makes the whole stack
+   * buffer available again.
+   * All the memory handed out before is invalidated.
+   */
+  void release() noexcept;
+
   /*
    * The size of the internal storage buffer.
    */
@@ -95,25 +113,52 @@ public: // Public APIs
   }
 
   /*
-   * Returns number of remaining bytes within the storage buffer
-   * that can be used for further allocation requests.
+   * Returns number of bytes handed out since
+   * the arena was created or last released.
    */
   size_t used() const noexcept
   {
-    return static_cast<size_t>(ptr_ - buf_);
+    return retired_ + static_cast<size_t>(ptr_ - begin_);
   }
 
-private: // Private member functions
+  /*
+   * Returns number of bytes held in heap blocks.
+   */
+  size_t heap_size() const noexcept
+  {
+    return heap_size_;
+  }
 
   /*
-   * A check to determine if the pointer 'p'
-   * points to a region within storage.
+   * Returns number of heap blocks in the chain.
    */
-  bool pointer_in_storage(char* p) const noexcept
+  size_t heap_blocks() const noexcept
   {
-    return (buf_ <= p) && (p <= (buf_ + N));
+    size_t n = 0;
+    for (block* b = blocks_; b; b = b->next) ++n;
+    return n;
   }
 
+private: // Private types
+
+  /*
+   * Header of a heap block.
+   * The usable bytes follow the header.
+   */
+  struct block
+  {
+    block* next;
+    size_t size;
+  };
+
+private: // Private member functions
+
+  /*
+   * Allocates a heap block of atleast 'n' usable bytes
+   * and makes it the current block.
+   */
+  void grow(size_t n);
+
   /*
    * Rounds up the number to the next closest number
    * as per the alignment.
@@ -127,8 +172,21 @@ private: // data members
   /// Storage
   alignas(alignment) char buf_[N];
 
-  /// Current allocation pointer within storage
+  /// Current allocation pointer within the current block
   char* ptr_ = nullptr;
+
+  /// Bounds of the current block
+  char* begin_ = nullptr;
+  char* end_ = nullptr;
+
+  /// Bytes handed out from the blocks before the current one
+  size_t retired_ = 0;
+
+  /// Chain of heap blocks, most recent first
+  block* blocks_ = nullptr;
+
+  /// Total usable bytes in the heap blocks
+  size_t heap_size_ = 0;
 };
 
 
@@ -178,7 +236,7 @@ public: // Exposed APIs
    * Allocate memory of 'n' bytes for object
    * of type 'T'
    */
-  T* allocate(size_t n) noexcept;
+  T* allocate(size_t n);
 
   /*
    * Deallocate the storage reserved for the object
@@ -186,7 +244,24 @@ public: // Exposed APIs
    */
   void deallocate(T* p, size_t n) noexcept;
 
+  /*
+   * Allocators are equal if they share the arena.
+   */
+  template <typename U>
+  bool operator==(const stack_alloc<U, N, alignment>& other) const noexcept
+  {
+    return &arena_ == &other.arena_;
+  }
+
+  template <typename U>
+  bool operator!=(const stack_alloc<U, N, alignment>& other) const noexcept
+  {
+    return !(*this == other);
+  }
+
 private: // Private APIs
+  template <typename U, size_t M, size_t A>
+  friend class stack_alloc;
 
 private: // Private data members
   /// The arena
@@ -0,0 +1,205 @@
+/*
+Copyright (c) 2017 Arun Muralidharan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef CPP_JWT_TOKEN_CACHE_HPP
+#define CPP_JWT_TOKEN_CACHE_HPP
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <system_error>
+
+#include "jwt/jwt.hpp"
+#include "jwt/detail/hash.hpp"
+#include "jwt/detail/time_wheel.hpp"
+
+namespace jwt {
+
+/**
+ * A bounded cache of decode results keyed by the encoded token.
+ *
+ * Passed to `jwt::decode` through the `cache` parameter, it
+ * remembers the verified `jwt_object`, or the error the token was
+ * rejected with, so that a token seen again is answered with one
+ * hash lookup instead of a JSON parse and a signature check.
+ *
+ * - Verified tokens are kept until their `exp` claim, or for
+ *   `max_ttl` if they have none.
+ * - Rejected tokens are kept for `negative_ttl`. Errors which
+ *   may go away on retry (`ImmatureSignature`, `KeyNotPresent`)
+ *   are not cached.
+ * - The cache is split into shards, each with its own lock,
+ *   a CLOCK eviction hand and a timing wheel which drops
+ *   entries as soon as they expire.
+ * - Entries store the full token and are matched byte for byte,
+ *   the hash only picks the slot.
+ *
+ * @note: The cache does not know the decode parameters. Use one
+ * cache instance per verification policy (algorithms, keys,
+ * issuer and so on).
+ */
+class token_cache
+{
+public: // typedefs
+  /// Shared immutable decoded object
+  using object_ptr = std::shared_ptr<const jwt_object>;
+
+public: // 'tors
+  /**
+   * Construct the cache.
+   *
+   * Arguments:
+   *  @capacity : Maximum number of tokens held.
+   *  @shards : Number of shards. Rounded up to a power of two.
+   *  @max_ttl : How long to keep verified tokens without `exp`.
+   *  @negative_ttl : How long to keep rejected tokens.
+   */
+  explicit token_cache(size_t capacity = 1 << 16,
+                       size_t shards = 16,
+                       std::chrono::seconds max_ttl = std::chrono::seconds{300},
+                       std::chrono::seconds negative_ttl = std::chrono::seconds{60});
+
+  /// Non copyable and assignable
+  token_cache(const token_cache&) = delete;
+  token_cache& operator=(const token_cache&) = delete;
+
+  ~token_cache() = default;
+
+public: // Exposed APIs
+  /**
+   * Looks up the token.
+   * Returns false on a miss. On a hit sets `obj` and `ec` as
+   * they were returned by the decode which recorded them.
+   */
+  bool find(const jwt::string_view token, object_ptr& obj, std::error_code& ec);
+
+  /**
+   * Records the decode result of a token.
+   */
+  void insert(const jwt::string_view token, object_ptr obj, const std::error_code& ec);
+
+  /**
+   * Returns the cached result for the token if present,
+   * else calls `decode_fn(ec)` and caches what it returns.
+   * Used by `jwt::decode`.
+   */
+  template <typename DecodeFn>
+  jwt_object decode(const jwt::string_view token, std::error_code& ec, DecodeFn&& decode_fn);
+
+  /**
+   * Number of tokens held.
+   */
+  size_t size() const;
+
+  /**
+   * Drops all the entries.
+   */
+  void clear();
+
+private: // Private types
+  /*!
+   */
+  struct entry
+  {
+    uint64_t hash = 0;
+    uint64_t expiry = 0;
+    uint32_t gen = 0;
+    bool used = false;
+    bool ref = false;
+    std::string token;
+    object_ptr obj;
+    std::error_code ec;
+  };
+
+  /*!
+   * Slot index and generation of a scheduled expiry.
+   */
+  using timer_type = std::pair<uint32_t, uint32_t>;
+
+  /*!
+   */
+  struct shard
+  {
+    std::mutex mtx;
+    std::vector<entry> slots;
+    std::unordered_map<uint64_t, uint32_t> index;
+    std::vector<uint32_t> free;
+    size_t hand = 0;
+    detail::time_wheel<timer_type> wheel;
+  };
+
+private: // Private APIs
+  /*!
+   */
+  static uint64_t now() noexcept
+  {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count());
+  }
+
+  /*!
+   */
+  shard& shard_for(uint64_t hash) noexcept
+  {
+    return *shards_[(hash >> 32) & (shards_.size() - 1)];
+  }
+
+  /*!
+   */
+  uint64_t expiry_for(const jwt_object* obj, const std::error_code& ec, uint64_t now) const;
+
+  /*!
+   */
+  static void expire(shard& s, uint64_t now);
+
+  /*!
+   */
+  static void release(shard& s, uint32_t slot);
+
+  /*!
+   * Frees a slot using the CLOCK hand.
+   */
+  static uint32_t evict(shard& s);
+
+private: // Data members
+  /// Entries per shard
+  size_t shard_capacity_;
+
+  /// TTL for tokens without `exp`
+  uint64_t max_ttl_;
+
+  /// TTL for rejected tokens
+  uint64_t negative_ttl_;
+
+  /// The shards
+  std::vector<std::unique_ptr<shard>> shards_;
+};
+
+} // END namespace jwt
+
+#include "jwt/impl/token_cache.ipp"
+
+#endif
@@ -0,0 +1,131 @@
+#include <atomic>
+#include <cctype>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+
+static std::atomic<int> g_signs{0};
+static std::atomic<int> g_verifies{0};
+
+/// A signer standing in for a hardware module
+jwt::sign_result_t counting_sign(const jwt::key& k, const jwt::string_view data)
+{
+  ++g_signs;
+  return jwt::builtin_algorithm_impl(jwt::algorithm::HS256).sign_key(k, data);
+}
+
+jwt::verify_result_t counting_verify(const jwt::key& k,
+                                     const jwt::segmented_view& head,
+                                     const jwt::string_view sign)
+{
+  ++g_verifies;
+  return jwt::builtin_algorithm_impl(jwt::algorithm::HS256).verify_key(k, head, sign);
+}
+
+/// The linear, case insensitive scan `str_to_alg` replaces
+jwt::algorithm reference_str_to_alg(const std::string& s)
+{
+  for (int i = 0; i < static_cast<int>(jwt::algorithm::UNKN); ++i) {
+    auto alg = static_cast<jwt::algorithm>(i);
+    auto name = jwt::alg_to_str(alg);
+    if (name.length() == s.length() && !strncasecmp(s.data(), name.data(), s.length())) return alg;
+  }
+  return jwt::algorithm::UNKN;
+}
+
+TEST (AlgorithmRegistry, StrToAlg)
+{
+  for (int i = 0; i < static_cast<int>(jwt::algorithm::UNKN); ++i) {
+    auto alg = static_cast<jwt::algorithm>(i);
+    std::string name(jwt::alg_to_str(alg));
+
+    EXPECT_EQ (jwt::str_to_alg(name), alg) << name;
+
+    std::string lower = name;
+    for (auto& c : lower) c = static_cast<char>(std::tolower(c));
+    EXPECT_EQ (jwt::str_to_alg(lower), alg) << lower;
+
+    // Every single changed character, most of which give
+    // no algorithm
+    for (size_t pos = 0; pos < name.length(); ++pos) {
+      for (int c = 0; c < 256; ++c) {
+        std::string other = name;
+        other[pos] = static_cast<char>(c);
+        EXPECT_EQ (jwt::str_to_alg(other), reference_str_to_alg(other)) << other;
+      }
+    }
+
+    // Only the viewed characters count
+    std::string longer = name + "xyz";
+    EXPECT_EQ (jwt::str_to_alg(jwt::string_view{longer.data(), name.length()}), alg);
+    EXPECT_EQ (jwt::str_to_alg(longer), jwt::algorithm::UNKN);
+  }
+
+  for (const char* s : {"", "HS", "HS25", "HS2566", "UNKN", "TERM", "PS256", "EdDSA"}) {
+    EXPECT_EQ (jwt::str_to_alg(s), jwt::algorithm::UNKN) << s;
+  }
+}
+
+TEST (AlgorithmRegistry, BuiltinEntries)
+{
+  const auto& hs = jwt::algorithm_impl(jwt::algorithm::HS384);
+  EXPECT_EQ (hs.sign, static_cast<jwt::sign_func_t>(jwt::HMACSign<jwt::algo::HS384>::sign));
+  EXPECT_EQ (hs.verify, static_cast<jwt::verify_func_t>(jwt::HMACSign<jwt::algo::HS384>::verify));
+  EXPECT_EQ (hs.key_kind, jwt::key_type::SECRET);
+
+  const auto& es = jwt::algorithm_impl(jwt::algorithm::ES256);
+  EXPECT_EQ (es.sign, static_cast<jwt::sign_func_t>(jwt::PEMSign<jwt::algo::ES256>::sign));
+  EXPECT_EQ (es.key_kind, jwt::key_type::PUBLIC);
+
+  EXPECT_EQ (jwt::algorithm_impl(jwt::algorithm::NONE).key_kind, jwt::key_type::NONE);
+
+  for (auto alg : {jwt::algorithm::UNKN, jwt::algorithm::TERM}) {
+    const auto& e = jwt::algorithm_impl(alg);
+    EXPECT_EQ (e.sign, nullptr);
+    EXPECT_EQ (e.verify, nullptr);
+    EXPECT_EQ (e.sign_key, nullptr);
+    EXPECT_EQ (e.verify_key, nullptr);
+  }
+}
+
+TEST (AlgorithmRegistry, OverrideAndReset)
+{
+  using namespace jwt::params;
+
+  jwt::algorithm_entry entry;
+  entry.sign_key = counting_sign;
+  entry.verify_key = counting_verify;
+  entry.key_kind = jwt::key_type::PUBLIC;
+  ASSERT_TRUE (jwt::register_algorithm(jwt::algorithm::HS256, entry));
+
+  // The other functions and the key kind stay built-in
+  const auto& e = jwt::algorithm_impl(jwt::algorithm::HS256);
+  EXPECT_EQ (e.sign_key, counting_sign);
+  EXPECT_EQ (e.sign, jwt::builtin_algorithm_impl(jwt::algorithm::HS256).sign);
+  EXPECT_EQ (e.key_kind, jwt::key_type::SECRET);
+
+  auto k = jwt::key::from_raw_secret("secret");
+  jwt::jwt_object obj{algorithm("HS256"), secret(k)};
+  obj.add_claim("iss", "arun.muralidharan");
+  const std::string token = obj.signature();
+  EXPECT_EQ (g_signs.load(), 1);
+
+  std::error_code ec;
+  jwt::decode(token, algorithms({"HS256"}), ec, secret(k));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (g_verifies.load(), 1);
+
+  // Plain secrets keep using the built-in functions
+  jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (g_verifies.load(), 1);
+
+  jwt::reset_algorithm(jwt::algorithm::HS256);
+  jwt::decode(token, algorithms({"HS256"}), ec, secret(k));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (g_verifies.load(), 1);
+
+  EXPECT_FALSE (jwt::register_algorithm(jwt::algorithm::UNKN, entry));
+  EXPECT_FALSE (jwt::register_algorithm(jwt::algorithm::TERM, entry));
+}
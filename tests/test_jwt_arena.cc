@@ -0,0 +1,98 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+#include "jwt/short_string.hpp"
+
+TEST (Arena, GrowsIntoHeapBlocks)
+{
+  jwt::Arena<64> arena;
+  EXPECT_EQ (arena.used(), 0u);
+
+  char* a = arena.allocate<1>(16);
+  char* b = arena.allocate<1>(16);
+  EXPECT_EQ (b, a + 16);
+  EXPECT_EQ (arena.heap_blocks(), 0u);
+
+  // Rolls back only the most recent allocation
+  arena.deallocate(a, 16);
+  EXPECT_EQ (arena.used(), 32u);
+  arena.deallocate(b, 16);
+  EXPECT_EQ (arena.used(), 16u);
+
+  // Does not fit the stack buffer anymore
+  char* c = arena.allocate<1>(100);
+  EXPECT_EQ (arena.heap_blocks(), 1u);
+  EXPECT_GE (arena.heap_size(), 100u);
+  std::fill(c, c + 100, 'x');
+
+  // Blocks grow geometrically
+  for (int i = 0; i < 64; ++i) arena.allocate<1>(64);
+  EXPECT_LE (arena.heap_blocks(), 8u);
+  EXPECT_EQ (arena.used(), 16u + 112u + 64u * 64u);
+
+  arena.release();
+  EXPECT_EQ (arena.used(), 0u);
+  EXPECT_EQ (arena.heap_blocks(), 0u);
+  EXPECT_EQ (arena.heap_size(), 0u);
+  EXPECT_EQ (arena.allocate<1>(16), a);
+}
+
+TEST (Arena, ShortStringOutgrowsBuffer)
+{
+  jwt::Arena<32> arena;
+  jwt::short_string<32> str{arena};
+
+  std::string expected;
+  for (int i = 0; i < 1000; ++i) {
+    str += static_cast<char>('a' + i % 26);
+    expected += static_cast<char>('a' + i % 26);
+  }
+
+  EXPECT_EQ (std::string(str.data(), str.length()), expected);
+  EXPECT_GT (arena.heap_blocks(), 0u);
+
+  jwt::short_string<32> other{str};
+  EXPECT_EQ (other.get_allocator(), str.get_allocator());
+  EXPECT_TRUE (other == str);
+}
+
+TEST (Arena, Base64IntoArenaStrings)
+{
+  std::string input;
+  for (int i = 0; i < 3000; ++i) input += static_cast<char>(i * 7);
+
+  std::string enc = jwt::base64_encode(input.data(), input.length());
+  auto len = jwt::base64_uri_encode(&enc[0], enc.length());
+  enc.resize(len);
+
+  // Larger than the scratch buffers of the decoder
+  jwt::Arena<128> arena;
+  jwt::short_string<128> dec{arena};
+  jwt::base64_uri_decode(enc.data(), enc.length(), dec);
+
+  EXPECT_EQ (std::string(dec.data(), dec.length()), input);
+  EXPECT_EQ (jwt::base64_uri_decode(enc.data(), enc.length()), input);
+
+  char out[jwt::encoding_size(5)];
+  EXPECT_EQ (jwt::base64_encode("hello", 5, out), 8u);
+  EXPECT_EQ (std::string(out, 8), "aGVsbG8=");
+}
+
+TEST (Arena, LargeTokensRoundTrip)
+{
+  using namespace jwt::params;
+
+  // Larger than the stack buffers used for decoding
+  std::string big(5000, 'p');
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret")};
+  obj.header().add_header("xtra", std::string(400, 'h'));
+  obj.add_claim("big", big);
+
+  std::error_code ec;
+  auto dec_obj = jwt::decode(obj.signature(), algorithms({"HS256"}), ec, secret("secret"));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (dec_obj.payload().get_claim_value<std::string>("big"), big);
+  EXPECT_EQ (dec_obj.header().create_json_obj()["xtra"].get<std::string>().length(), 400u);
+}
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <future>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+#include "jwt/async.hpp"
+
+#define RSA256_PUB_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_pub.pem"
+#define RSA256_PRIV_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_priv.pem"
+
+std::string read_from_file(const std::string& path)
+{
+  std::string contents;
+  std::ifstream is{path, std::ifstream::binary};
+
+  if (is) {
+    // get length of file:
+    is.seekg (0, is.end);
+    auto length = is.tellg();
+    is.seekg (0, is.beg);
+    contents.resize(length);
+
+    is.read(&contents[0], length);
+    if (!is) {
+      is.close();
+      return {};
+    }
+  }
+
+  is.close();
+  return contents;
+}
+
+bool is_ready(const std::future<jwt::decode_result_t>& fut)
+{
+  return fut.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+}
+
+TEST (AsyncDecode, VerifiesOnPool)
+{
+  using namespace jwt::params;
+
+  std::string priv_key = read_from_file(RSA256_PRIV_KEY);
+  std::string pub_key = read_from_file(RSA256_PUB_KEY);
+  ASSERT_TRUE (priv_key.length());
+  ASSERT_TRUE (pub_key.length());
+
+  jwt::jwt_object obj{algorithm("RS256"), secret(priv_key), payload({{"sub", "user-1"}})};
+  const std::string token = obj.signature();
+
+  jwt::verify_pool pool{2, 16};
+  auto key = jwt::key::from_pem(pub_key);
+
+  std::vector<std::future<jwt::decode_result_t>> futs;
+  for (int i = 0; i < 8; ++i) {
+    futs.push_back(jwt::decode_async(pool, token, algorithms({"RS256"}), secret(key)));
+  }
+
+  for (auto& fut : futs) {
+    auto res = fut.get();
+    EXPECT_FALSE (res.second);
+    EXPECT_EQ (res.first.payload().get_claim_value<std::string>("sub"), "user-1");
+  }
+
+  // Tampered signature is caught on the pool
+  std::string bad = token;
+  bad.back() = bad.back() == 'A' ? 'B' : 'A';
+  auto res = jwt::decode_async(pool, bad, algorithms({"RS256"}), secret(key)).get();
+  EXPECT_TRUE (res.second);
+
+  // Same outcome as the synchronous decode
+  std::error_code ec;
+  jwt::decode(bad, algorithms({"RS256"}), ec, secret(key));
+  EXPECT_EQ (res.second, ec);
+}
+
+TEST (AsyncDecode, CheapChecksStayInline)
+{
+  using namespace jwt::params;
+
+  jwt::verify_pool pool{1, 1};
+
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret")};
+  obj.add_claim("exp", std::chrono::system_clock::now() - std::chrono::seconds{10});
+  const std::string token = obj.signature();
+
+  auto fut = jwt::decode_async(pool, token, algorithms({"HS256"}), secret("secret"));
+  ASSERT_TRUE (is_ready(fut));
+  EXPECT_EQ (fut.get().second.value(), static_cast<int>(jwt::VerificationErrc::TokenExpired));
+
+  fut = jwt::decode_async(pool, "not.a-token", algorithms({"HS256"}), secret("secret"));
+  ASSERT_TRUE (is_ready(fut));
+  EXPECT_TRUE (fut.get().second);
+
+  fut = jwt::decode_async(pool, token, algorithms({"RS256"}), secret("secret"));
+  ASSERT_TRUE (is_ready(fut));
+  EXPECT_EQ (fut.get().second.value(), static_cast<int>(jwt::VerificationErrc::InvalidAlgorithm));
+}
+
+TEST (AsyncDecode, RejectWhenFull)
+{
+  using namespace jwt::params;
+
+  jwt::verify_pool pool{1, 1, jwt::overflow_policy::reject};
+
+  std::promise<void> gate;
+  std::shared_future<void> opened = gate.get_future().share();
+  std::promise<void> started;
+
+  // Keep the only worker busy and fill the queue
+  ASSERT_TRUE (pool.submit([&started, opened] { started.set_value(); opened.wait(); }));
+  started.get_future().wait();
+  ASSERT_TRUE (pool.submit([] {}));
+
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret")};
+  const std::string token = obj.signature();
+
+  auto fut = jwt::decode_async(pool, token, algorithms({"HS256"}), secret("secret"));
+  ASSERT_TRUE (is_ready(fut));
+  EXPECT_EQ (fut.get().second, std::errc::resource_unavailable_try_again);
+
+  gate.set_value();
+  while (pool.queued()) std::this_thread::yield();
+
+  // Once drained the pool takes jobs again
+  fut = jwt::decode_async(pool, token, algorithms({"HS256"}), secret("secret"));
+  EXPECT_FALSE (fut.get().second);
+}
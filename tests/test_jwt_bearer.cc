@@ -0,0 +1,122 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+
+/*
+ * Counts the calls to operator new.
+ */
+static std::atomic<size_t> g_allocs{0};
+
+void* operator new(std::size_t n)
+{
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+std::string make_token()
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret")};
+  obj.add_claim("iss", "arun.muralidharan");
+  return obj.signature();
+}
+
+TEST (BearerTest, ExtractsTokenInPlace)
+{
+  const std::string token = make_token();
+  std::error_code ec;
+
+  for (const std::string& value : {"Bearer " + token,
+                                   "bearer " + token,
+                                   "BEARER \t " + token + "  ",
+                                   " \tBearer " + token}) {
+    jwt::string_view sv = jwt::bearer_token(value, ec);
+    EXPECT_FALSE (ec) << value;
+    EXPECT_EQ (std::string(sv.data(), sv.length()), token);
+
+    // Points into the header value
+    EXPECT_GE (sv.data(), value.data());
+    EXPECT_LE (sv.data() + sv.length(), value.data() + value.length());
+  }
+
+  // Padding is allowed at the end only
+  EXPECT_EQ (jwt::bearer_token("Bearer abc==", ec), jwt::string_view{"abc=="});
+  EXPECT_FALSE (ec);
+}
+
+TEST (BearerTest, RejectsMalformedValues)
+{
+  std::error_code ec;
+
+  for (const char* value : {"", "   ", "Basic dXNlcjpwYXNz", "Bearerabc.def.ghi",
+                            "Bear abc", "Token abc.def"}) {
+    jwt::bearer_token(value, ec);
+    EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::AuthSchemeMismatch)) << value;
+  }
+
+  for (const char* value : {"Bearer", "Bearer   ", "Bearer abc def", "Bearer a=b",
+                            "Bearer ===", "Bearer abc\"", "Bearer a,b"}) {
+    jwt::bearer_token(value, ec);
+    EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::SignatureFormatError)) << value;
+  }
+
+  jwt::bearer_token("Bearer " + std::string(100, 'a'), ec, 99);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::TokenTooLarge));
+
+  jwt::bearer_token("Bearer " + std::string(100, 'a'), ec, 100);
+  EXPECT_FALSE (ec);
+}
+
+TEST (BearerTest, DecodeBearer)
+{
+  using namespace jwt::params;
+
+  const std::string value = "Bearer " + make_token();
+
+  std::error_code ec;
+  auto dec_obj = jwt::decode_bearer(value, algorithms({"HS256"}), ec, secret("secret"));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (dec_obj.payload().get_claim_value<std::string>("iss"), "arun.muralidharan");
+
+  jwt::decode_bearer(value, algorithms({"HS256"}), ec, secret("secret"), max_length(16));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::TokenTooLarge));
+
+  // The limit applies to plain decode too
+  jwt::decode(value.substr(7), algorithms({"HS256"}), ec, secret("secret"), max_length(16));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::TokenTooLarge));
+
+  EXPECT_THROW (jwt::decode_bearer("Basic dXNlcjpwYXNz", algorithms({"HS256"}), secret("secret")),
+                jwt::DecodeError);
+  EXPECT_THROW (jwt::decode_bearer(value, algorithms({"HS256"}), secret("other")),
+                jwt::InvalidSignatureError);
+}
+
+TEST (BearerTest, RejectedWithoutAllocating)
+{
+  const std::string oversized = "Bearer " + std::string(10000, 'a');
+  const std::string valid = "Bearer " + make_token();
+
+  std::error_code ec;
+  for (const char* value : {"Basic dXNlcjpwYXNz", "Bearer", "Bearer a b",
+                            oversized.c_str(), valid.c_str()}) {
+    size_t before = g_allocs.load();
+    jwt::bearer_token(value, ec);
+    EXPECT_EQ (g_allocs.load(), before);
+  }
+}
@@ -0,0 +1,149 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+
+jwt::jwt_object make_object()
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret"),
+                      headers({{"kid", "key-1"}})};
+  obj.add_claim("iss", "arun.muralidharan")
+     .add_claim("exp", 4102444800)
+     .add_claim("admin", true)
+     .add_claim("name", "J\xC3\xB6rg \xE2\x9C\x93");
+  return obj;
+}
+
+TEST (BinaryTest, PayloadRoundTrip)
+{
+  jwt::jwt_payload pld;
+  pld.add_claim("iss", "arun.muralidharan");
+  pld.add_claim("exp", static_cast<uint64_t>(18446744073709551615ULL));
+  pld.add_claim("ratio", 0.25);
+  pld.add_claim("skew", -300);
+  pld.add_claim("roles", std::vector<std::string>{"admin", "ops"});
+
+  auto bin = pld.to_binary();
+  ASSERT_GT (bin.size(), jwt::detail::binary_prefix_size);
+  EXPECT_EQ (bin[3], jwt::detail::binary_version);
+
+  jwt::jwt_payload copy;
+  std::error_code ec;
+  copy.from_binary(bin.data(), bin.size(), ec);
+  ASSERT_FALSE (ec);
+
+  EXPECT_EQ (copy.create_json_obj(), pld.create_json_obj());
+  EXPECT_TRUE (copy.has_claim("roles"));
+  EXPECT_EQ (copy.get_claim_value<uint64_t>("exp"), 18446744073709551615ULL);
+  EXPECT_EQ (copy.get_claim_value<std::string>("iss"), "arun.muralidharan");
+
+  // More compact than the JSON text
+  EXPECT_LT (bin.size(), pld.create_json_obj().dump().length());
+}
+
+TEST (BinaryTest, HeaderRoundTripSetsTypedFields)
+{
+  jwt::jwt_header hdr{jwt::algorithm::RS512};
+  hdr.add_header("kid", "key-7");
+
+  auto bin = hdr.to_binary();
+
+  jwt::jwt_header copy;
+  EXPECT_EQ (copy.algo(), jwt::algorithm::NONE);
+  copy.from_binary(bin.data(), bin.size());
+
+  EXPECT_EQ (copy.algo(), jwt::algorithm::RS512);
+  EXPECT_EQ (copy.typ(), jwt::type::JWT);
+  EXPECT_EQ (copy.kid(), jwt::string_view{"key-7"});
+  EXPECT_EQ (copy.create_json_obj(), hdr.create_json_obj());
+}
+
+TEST (BinaryTest, ObjectRoundTripFromDecodedToken)
+{
+  using namespace jwt::params;
+
+  std::error_code ec;
+  auto dec_obj = jwt::decode(make_object().signature(), algorithms({"HS256"}), ec, secret("secret"));
+  ASSERT_FALSE (ec);
+
+  auto bin = dec_obj.to_binary();
+
+  jwt::jwt_object copy;
+  copy.from_binary(bin.data(), bin.size(), ec);
+  ASSERT_FALSE (ec);
+
+  EXPECT_EQ (copy.header().algo(), jwt::algorithm::HS256);
+  EXPECT_EQ (copy.header().kid(), jwt::string_view{"key-1"});
+  EXPECT_EQ (copy.payload().create_json_obj(), dec_obj.payload().create_json_obj());
+  EXPECT_EQ (copy.payload().get_claim_value<std::string>("name"), "J\xC3\xB6rg \xE2\x9C\x93");
+
+  // The key is not carried over
+  EXPECT_TRUE (copy.secret().empty());
+
+  // Serializing again gives the same bytes
+  EXPECT_EQ (copy.to_binary(), bin);
+}
+
+TEST (BinaryTest, RejectsMalformedInput)
+{
+  auto bin = make_object().to_binary();
+  std::error_code ec;
+
+  // Every truncation is rejected, none is accepted half way
+  for (size_t len = 0; len < bin.size(); ++len) {
+    jwt::jwt_object obj;
+    obj.from_binary(bin.data(), len, ec);
+    EXPECT_TRUE (ec) << "length " << len;
+  }
+
+  auto other = bin;
+  other[3] = jwt::detail::binary_version + 1;
+  jwt::jwt_object obj;
+  obj.from_binary(other.data(), other.size(), ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::BinaryVersionMismatch));
+
+  // A payload form is not an object form
+  auto pld_bin = make_object().payload().to_binary();
+  obj.from_binary(pld_bin.data(), pld_bin.size(), ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::BinaryFormatError));
+
+  // A value which is not an object
+  std::vector<uint8_t> not_object{'J', 'W', 'B', jwt::detail::binary_version,
+                                  static_cast<uint8_t>(jwt::detail::binary_kind::PAYLOAD)};
+  jwt::detail::binary_write(json_t::array({1, 2, 3}), not_object);
+  jwt::jwt_payload pld;
+  pld.from_binary(not_object.data(), not_object.size(), ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::BinaryFormatError));
+
+  // Header whose alg is not a string
+  json_t hdr_json = {{"alg", 5}};
+  std::vector<uint8_t> bad_hdr{'J', 'W', 'B', jwt::detail::binary_version,
+                               static_cast<uint8_t>(jwt::detail::binary_kind::HEADER)};
+  jwt::detail::binary_write(hdr_json, bad_hdr);
+  jwt::jwt_header hdr;
+  hdr.from_binary(bad_hdr.data(), bad_hdr.size(), ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::BinaryFormatError));
+
+  // Nesting deeper than the reader accepts
+  json_t deep = json_t::object();
+  for (int i = 0; i < 100; ++i) deep = json_t{{"d", deep}};
+  jwt::jwt_payload deep_pld;
+  deep_pld.add_claim("deep", deep);
+  auto deep_bin = deep_pld.to_binary();
+  pld.from_binary(deep_bin.data(), deep_bin.size(), ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::BinaryFormatError));
+
+  // Counts larger than the input
+  std::vector<uint8_t> huge{'J', 'W', 'B', jwt::detail::binary_version,
+                            static_cast<uint8_t>(jwt::detail::binary_kind::PAYLOAD),
+                            static_cast<uint8_t>(jwt::detail::binary_tag::OBJECT),
+                            0xff, 0xff, 0xff, 0x0f};
+  pld.from_binary(huge.data(), huge.size(), ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::BinaryFormatError));
+
+  EXPECT_THROW (obj.from_binary(bin.data(), 3), jwt::DecodeError);
+}
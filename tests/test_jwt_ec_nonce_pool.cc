@@ -0,0 +1,167 @@
+#include <chrono>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+
+#define RSA256_PRIV_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_priv.pem"
+#define EC384_PUB_KEY CERT_ROOT_DIR "/ec_certs/ec384_pub.pem"
+#define EC384_PRIV_KEY CERT_ROOT_DIR "/ec_certs/ec384_priv.pem"
+
+#if defined(CPP_JWT_HAS_EC_NONCE_POOL)
+
+std::string read_from_file(const std::string& path)
+{
+  std::string contents;
+  std::ifstream is{path, std::ifstream::binary};
+
+  if (is) {
+    // get length of file:
+    is.seekg (0, is.end);
+    auto length = is.tellg();
+    is.seekg (0, is.beg);
+    contents.resize(length);
+
+    is.read(&contents[0], length);
+    if (!is) {
+      is.close();
+      return {};
+    }
+  }
+
+  is.close();
+  return contents;
+}
+
+/// A fresh P-256 key pair
+std::pair<jwt::key, jwt::key> make_p256_keys()
+{
+  EVP_PKEY* pkey = EVP_EC_gen("P-256");
+  unsigned char* priv = nullptr;
+  unsigned char* pub = nullptr;
+  int priv_len = i2d_PrivateKey(pkey, &priv);
+  int pub_len = i2d_PUBKEY(pkey, &pub);
+
+  auto keys = std::make_pair(
+      jwt::key::from_der(jwt::string_view{reinterpret_cast<char*>(priv), static_cast<size_t>(priv_len)}),
+      jwt::key::from_der(jwt::string_view{reinterpret_cast<char*>(pub), static_cast<size_t>(pub_len)}));
+
+  OPENSSL_free(priv);
+  OPENSSL_free(pub);
+  EVP_PKEY_free(pkey);
+  return keys;
+}
+
+/// Waits for the pool to fill up
+bool wait_filled(const jwt::ec_nonce_pool& pool)
+{
+  for (int i = 0; i < 1000 && pool.available() < pool.capacity(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return pool.available() == pool.capacity();
+}
+
+/// Signs `count` tokens with `sign_key`, verifies them with
+/// `verify_key` and checks that no two share `r`
+void sign_and_verify(const char* alg, const jwt::key& sign_key, const jwt::key& verify_key, size_t count)
+{
+  using namespace jwt::params;
+
+  std::set<std::string> rs;
+
+  for (size_t i = 0; i < count; ++i) {
+    jwt::jwt_object obj{algorithm(alg), secret(sign_key)};
+    obj.add_claim("iss", "arun.muralidharan");
+    const std::string token = obj.signature();
+
+    std::error_code ec;
+    auto dec_obj = jwt::decode(token, algorithms({alg}), ec, secret(verify_key));
+    ASSERT_FALSE (ec) << alg << ": " << ec.message();
+    EXPECT_EQ (dec_obj.payload().get_claim_value<std::string>("iss"), "arun.muralidharan");
+
+    const std::string enc = token.substr(token.rfind('.') + 1);
+    const std::string sig = jwt::base64_uri_decode(enc.data(), enc.length());
+    EXPECT_TRUE (rs.insert(sig.substr(0, sig.length() / 2)).second) << "nonce used twice";
+  }
+}
+
+TEST (ECNoncePool, SignsWithPooledNonces)
+{
+  auto keys = make_p256_keys();
+  auto pooled = keys.first.with_nonce_pool(16);
+
+  jwt::ec_nonce_pool* pool = pooled.nonce_pool();
+  ASSERT_NE (pool, nullptr);
+  EXPECT_TRUE (pool->running());
+  EXPECT_EQ (pool->capacity(), 16u);
+  ASSERT_TRUE (wait_filled(*pool));
+
+  // A full pool serves as many signatures without a miss
+  sign_and_verify("ES256", pooled, keys.second, 16);
+  EXPECT_EQ (pool->misses(), 0u);
+
+  // Bursts past the pool fall back to inline nonces
+  sign_and_verify("ES256", pooled, keys.second, 100);
+
+  // The plain handle is unchanged
+  EXPECT_EQ (keys.first.nonce_pool(), nullptr);
+  sign_and_verify("ES256", keys.first, keys.second, 2);
+}
+
+TEST (ECNoncePool, ES384FromPEM)
+{
+  auto priv = jwt::key::from_pem(read_from_file(EC384_PRIV_KEY)).with_nonce_pool(4);
+  auto pub = jwt::key::from_pem(read_from_file(EC384_PUB_KEY));
+  ASSERT_NE (priv.nonce_pool(), nullptr);
+
+  sign_and_verify("ES384", priv, pub, 10);
+
+  // Copies share the pool
+  auto copy = priv;
+  EXPECT_EQ (copy.nonce_pool(), priv.nonce_pool());
+}
+
+TEST (ECNoncePool, StopKeepsComputedNonces)
+{
+  auto keys = make_p256_keys();
+  auto pooled = keys.first.with_nonce_pool(8);
+  jwt::ec_nonce_pool* pool = pooled.nonce_pool();
+  ASSERT_TRUE (wait_filled(*pool));
+
+  pool->stop();
+  EXPECT_FALSE (pool->running());
+  EXPECT_EQ (pool->available(), 8u);
+
+  sign_and_verify("ES256", pooled, keys.second, 10);
+  EXPECT_EQ (pool->available(), 0u);
+  EXPECT_EQ (pool->misses(), 2u);
+
+  pool->start();
+  EXPECT_TRUE (wait_filled(*pool));
+}
+
+TEST (ECNoncePool, OnlyForECPrivateKeys)
+{
+  auto rsa = jwt::key::from_pem(read_from_file(RSA256_PRIV_KEY));
+  EXPECT_EQ (rsa.with_nonce_pool().nonce_pool(), nullptr);
+
+  auto pub = jwt::key::from_pem(read_from_file(EC384_PUB_KEY));
+  EXPECT_EQ (pub.with_nonce_pool().nonce_pool(), nullptr);
+  EXPECT_EQ (jwt::key::from_raw_secret("secret").with_nonce_pool().nonce_pool(), nullptr);
+
+  jwt::ec_nonce_pool pool{pub.evp_pkey(), 4};
+  std::error_code ec;
+  pool.start(ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr));
+  EXPECT_FALSE (pool.running());
+  EXPECT_THROW (pool.start(), jwt::InvalidKeyError);
+
+  jwt::ec_nonce_pool rsa_pool{rsa.evp_pkey(), 4};
+  EXPECT_EQ (rsa_pool.sign(EVP_sha256(), "data").second.value(),
+             static_cast<int>(jwt::AlgorithmErrc::SigningErr));
+}
+
+#endif // CPP_JWT_HAS_EC_NONCE_POOL
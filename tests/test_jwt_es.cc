@@ -147,3 +147,90 @@ TEST (ESAlgo, ES384EncodingDecodingValidTest)
   EXPECT_EQ (dec_obj2.header().algo(), jwt::algorithm::ES384);
 }
 
+
+TEST (ESAlgo, ECDSASigDERRawRoundTrip)
+{
+  // r has its high bit set (needs a pad byte), s has leading zeros
+  uint8_t raw[64];
+  for (size_t i = 0; i < 32; ++i) raw[i] = static_cast<uint8_t>(0x80 + i);
+  for (size_t i = 32; i < 64; ++i) raw[i] = (i < 35) ? 0x00 : static_cast<uint8_t>(i);
+
+  uint8_t der[jwt::detail::ecdsa_max_der_size];
+  size_t der_len = jwt::detail::ecdsa_raw_to_der(raw, 32, der, sizeof(der));
+  ASSERT_TRUE (der_len);
+
+  // SEQ{ INT(0x00 || r), INT(s without the leading zeros) }
+  EXPECT_EQ (der_len, 2 + (2 + 33) + (2 + 29));
+  EXPECT_EQ (der[0], 0x30);
+  EXPECT_EQ (der[3], 33);
+  EXPECT_EQ (der[4], 0x00);
+
+  uint8_t back[64];
+  ASSERT_TRUE (jwt::detail::ecdsa_der_to_raw(der, der_len, back, 32));
+  EXPECT_EQ (memcmp(raw, back, sizeof(raw)), 0);
+
+  // P-521 coordinates need the long form SEQUENCE length
+  uint8_t raw521[132];
+  memset(raw521, 0xFF, sizeof(raw521));
+  raw521[0] = raw521[66] = 0x01;
+  der_len = jwt::detail::ecdsa_raw_to_der(raw521, 66, der, sizeof(der));
+  ASSERT_TRUE (der_len);
+  EXPECT_EQ (der[1], 0x81);
+
+  uint8_t back521[132];
+  ASSERT_TRUE (jwt::detail::ecdsa_der_to_raw(der, der_len, back521, 66));
+  EXPECT_EQ (memcmp(raw521, back521, sizeof(raw521)), 0);
+}
+
+TEST (ESAlgo, ECDSASigMalformedDER)
+{
+  uint8_t raw[64];
+
+  // Truncated
+  const uint8_t trunc[] = {0x30, 0x06, 0x02, 0x01, 0x01, 0x02};
+  EXPECT_FALSE (jwt::detail::ecdsa_der_to_raw(trunc, sizeof(trunc), raw, 32));
+
+  // Negative integer
+  const uint8_t neg[] = {0x30, 0x06, 0x02, 0x01, 0x81, 0x02, 0x01, 0x01};
+  EXPECT_FALSE (jwt::detail::ecdsa_der_to_raw(neg, sizeof(neg), raw, 32));
+
+  // Trailing garbage
+  const uint8_t trail[] = {0x30, 0x06, 0x02, 0x01, 0x01, 0x02, 0x01, 0x01, 0x00};
+  EXPECT_FALSE (jwt::detail::ecdsa_der_to_raw(trail, sizeof(trail), raw, 32));
+
+  // Integer wider than the coordinate size
+  uint8_t wide[2 + 2 + 2 + 33 + 1];
+  wide[0] = 0x30; wide[1] = sizeof(wide) - 2;
+  wide[2] = 0x02; wide[3] = 33;
+  memset(wide + 4, 0x11, 33);
+  wide[37] = 0x02; wide[38] = 0x01; wide[39] = 0x01;
+  EXPECT_FALSE (jwt::detail::ecdsa_der_to_raw(wide, sizeof(wide), raw, 32));
+
+  const uint8_t ok[] = {0x30, 0x06, 0x02, 0x01, 0x01, 0x02, 0x01, 0x02};
+  ASSERT_TRUE (jwt::detail::ecdsa_der_to_raw(ok, sizeof(ok), raw, 32));
+  EXPECT_EQ (raw[31], 0x01);
+  EXPECT_EQ (raw[63], 0x02);
+  EXPECT_EQ (raw[0], 0x00);
+}
+
+TEST (ESAlgo, ES384TamperedSignatureTest)
+{
+  using namespace jwt::params;
+
+  std::string key = read_from_file(EC384_PRIV_KEY);
+  ASSERT_TRUE (key.length());
+
+  jwt::jwt_object obj{algorithm("ES384"), secret(key)};
+  obj.add_claim("iss", "arun.muralidharan");
+
+  auto enc_str = obj.signature();
+  key = read_from_file(EC384_PUB_KEY);
+
+  // Flip a character in the middle of the signature
+  auto pos = enc_str.rfind('.') + 10;
+  enc_str[pos] = (enc_str[pos] == 'A') ? 'B' : 'A';
+
+  std::error_code ec;
+  auto dec_obj = jwt::decode(enc_str, algorithms({"ES384"}), ec, verify(true), secret(key));
+  EXPECT_TRUE (ec);
+}
@@ -0,0 +1,149 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+
+/// HMAC-SHA-256 from OpenSSL, the reference
+std::string openssl_hmac(const std::string& key, const std::string& msg)
+{
+  unsigned char mac[EVP_MAX_MD_SIZE];
+  unsigned int len = 0;
+  HMAC(EVP_sha256(), key.data(), static_cast<int>(key.length()),
+       reinterpret_cast<const unsigned char*>(msg.data()), msg.length(), mac, &len);
+  return std::string(reinterpret_cast<const char*>(mac), len);
+}
+
+std::string random_bytes(std::mt19937& rng, size_t len)
+{
+  std::string s(len, '\0');
+  for (auto& c : s) c = static_cast<char>(rng());
+  return s;
+}
+
+/// The kernels the CPU can run
+std::vector<jwt::detail::sha256_mb_kernel> usable_kernels()
+{
+  using jwt::detail::sha256_mb_kernel;
+
+  std::vector<sha256_mb_kernel> kernels;
+  switch (jwt::detail::sha256_mb_best_kernel()) {
+    case sha256_mb_kernel::X8_AVX2:
+      kernels.push_back(sha256_mb_kernel::X8_AVX2);
+      //FALLTHROUGH
+    case sha256_mb_kernel::X4_SSSE3:
+      kernels.push_back(sha256_mb_kernel::X4_SSSE3);
+      break;
+    default:
+      break;
+  }
+  return kernels;
+}
+
+TEST (HMACBatch, PortableMatchesOpenSSL)
+{
+  std::mt19937 rng{42};
+
+  for (size_t key_len : {1, 20, 32, 63, 64, 65, 200}) {
+    const std::string key = random_bytes(rng, key_len);
+    jwt::detail::hmac_sha256_key pads;
+    pads.init(key.data(), key.length());
+
+    // Every tail length, and one and two padding blocks
+    for (size_t len = 0; len <= 300; ++len) {
+      const std::string msg = random_bytes(rng, len);
+      uint8_t mac[32];
+      jwt::detail::hmac_sha256(pads, reinterpret_cast<const uint8_t*>(msg.data()), len, mac);
+      ASSERT_EQ (std::string(reinterpret_cast<const char*>(mac), 32), openssl_hmac(key, msg))
+        << "key " << key_len << " message " << len;
+    }
+  }
+}
+
+TEST (HMACBatch, KernelsMatchOpenSSL)
+{
+  std::mt19937 rng{7};
+
+  for (auto kernel : usable_kernels()) {
+    for (size_t key_len : {16, 64, 100}) {
+      const std::string key = random_bytes(rng, key_len);
+      jwt::detail::hmac_sha256_key pads;
+      pads.init(key.data(), key.length());
+
+      // Lengths in random order, so that lanes finish at
+      // different times and are refilled mid batch
+      std::vector<std::string> msgs;
+      for (size_t len = 0; len <= 300; ++len) msgs.push_back(random_bytes(rng, len));
+      std::shuffle(msgs.begin(), msgs.end(), rng);
+      msgs.push_back(random_bytes(rng, 5000));
+
+      for (size_t count : {size_t{1}, size_t{3}, size_t{8}, size_t{9}, msgs.size()}) {
+        std::vector<jwt::string_view> views;
+        for (size_t i = 0; i < count; ++i) views.emplace_back(msgs[i].data(), msgs[i].length());
+
+        std::vector<uint8_t> macs(32 * count);
+        ASSERT_TRUE (jwt::detail::hmac_sha256_batch(pads, views.data(), count,
+                                                    reinterpret_cast<uint8_t (*)[32]>(macs.data()),
+                                                    kernel));
+
+        for (size_t i = 0; i < count; ++i) {
+          ASSERT_EQ (std::string(reinterpret_cast<const char*>(&macs[32 * i]), 32),
+                     openssl_hmac(key, msgs[i]))
+            << "kernel " << static_cast<int>(kernel) << " count " << count << " message " << i;
+        }
+      }
+    }
+  }
+
+  EXPECT_FALSE (jwt::detail::hmac_sha256_batch(jwt::detail::hmac_sha256_key{}, nullptr, 0, nullptr,
+                                               jwt::detail::sha256_mb_kernel::NONE));
+}
+
+TEST (HMACBatch, SignAndVerifyBatch)
+{
+  using namespace jwt::params;
+
+  std::vector<std::string> tokens;
+  for (int i = 0; i < 50; ++i) {
+    jwt::jwt_object obj{algorithm("HS256"), secret("secret")};
+    obj.add_claim("iss", "arun.muralidharan").add_claim("n", i).add_claim("pad", std::string(i * 3, 'x'));
+    tokens.push_back(obj.signature());
+  }
+
+  std::vector<jwt::string_view> heads, signs;
+  for (const auto& t : tokens) {
+    auto dot = t.rfind('.');
+    heads.emplace_back(t.data(), dot);
+    signs.emplace_back(t.data() + dot + 1, t.length() - dot - 1);
+  }
+
+  // Same MACs as the one-shot path
+  std::vector<jwt::sign_result_t> signed_out(tokens.size());
+  jwt::HMACSign<jwt::algo::HS256>::sign_batch("secret", heads.data(), heads.size(), signed_out.data());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    EXPECT_FALSE (signed_out[i].second);
+    EXPECT_EQ (signed_out[i].first, jwt::HMACSign<jwt::algo::HS256>::sign("secret", heads[i]).first);
+  }
+
+  // Every other signature is for another token
+  std::vector<jwt::string_view> mixed = signs;
+  for (size_t i = 0; i < mixed.size(); i += 2) mixed[i] = signs[(i + 1) % signs.size()];
+
+  std::vector<jwt::verify_result_t> verified(tokens.size());
+  jwt::HMACSign<jwt::algo::HS256>::verify_batch("secret", heads.data(), mixed.data(),
+                                                 heads.size(), verified.data());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    EXPECT_EQ (verified[i].first, i % 2 == 1) << i;
+  }
+
+  jwt::HMACSign<jwt::algo::HS256>::verify_batch("other", heads.data(), signs.data(),
+                                                 heads.size(), verified.data());
+  for (const auto& r : verified) EXPECT_FALSE (r.first);
+
+  // Other algorithms take the one-shot path
+  std::vector<jwt::sign_result_t> hs384(heads.size());
+  jwt::HMACSign<jwt::algo::HS384>::sign_batch("secret", heads.data(), heads.size(), hs384.data());
+  EXPECT_EQ (hs384[3].first, jwt::HMACSign<jwt::algo::HS384>::sign("secret", heads[3]).first);
+  EXPECT_EQ (hs384[3].first.length(), 48u);
+}
@@ -0,0 +1,132 @@
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+
+/// HMAC from OpenSSL, the reference
+std::string openssl_hmac(const EVP_MD* md, const std::string& key, const std::string& msg)
+{
+  unsigned char mac[EVP_MAX_MD_SIZE];
+  unsigned int len = 0;
+  HMAC(md, key.data(), static_cast<int>(key.length()),
+       reinterpret_cast<const unsigned char*>(msg.data()), msg.length(), mac, &len);
+  return std::string(reinterpret_cast<const char*>(mac), len);
+}
+
+std::string random_bytes(std::mt19937& rng, size_t len)
+{
+  std::string s(len, '\0');
+  for (auto& c : s) c = static_cast<char>(rng());
+  return s;
+}
+
+/// Checks the in-tree MAC of `State` against OpenSSL for
+/// keys around the block size and every tail length
+template <typename State>
+void check_against_openssl(const EVP_MD* md, size_t block_size)
+{
+  std::mt19937 rng{static_cast<unsigned>(block_size + State::digest_size)};
+
+  for (size_t key_len : {size_t{1}, size_t{20}, block_size - 1, block_size, block_size + 1, 3 * block_size}) {
+    const std::string key = random_bytes(rng, key_len);
+    State state;
+    state.init(key.data(), key.length());
+
+    for (size_t len = 0; len <= 3 * block_size; ++len) {
+      const std::string msg = random_bytes(rng, len);
+      uint8_t mac[State::digest_size];
+      state.mac(reinterpret_cast<const uint8_t*>(msg.data()), len, mac);
+      ASSERT_EQ (std::string(reinterpret_cast<const char*>(mac), sizeof(mac)),
+                 openssl_hmac(md, key, msg))
+        << "key " << key_len << " message " << len;
+    }
+  }
+}
+
+TEST (HMACInline, SHA256MatchesOpenSSL)
+{
+  check_against_openssl<jwt::detail::hmac_sha256_key>(EVP_sha256(), 64);
+}
+
+TEST (HMACInline, SHA384MatchesOpenSSL)
+{
+  check_against_openssl<jwt::detail::hmac_sha384_key>(EVP_sha384(), 128);
+}
+
+TEST (HMACInline, SHA512MatchesOpenSSL)
+{
+  check_against_openssl<jwt::detail::hmac_sha512_key>(EVP_sha512(), 128);
+}
+
+TEST (HMACInline, SHANIMatchesPortable)
+{
+  if (!jwt::detail::sha256_ni_supported()) {
+    GTEST_SKIP() << "No SHA extensions on this CPU";
+  }
+
+#if defined(CPP_JWT_HAS_SHA_NI)
+  std::mt19937 rng{3};
+  const std::string data = random_bytes(rng, 64 * 9);
+
+  for (size_t nblocks = 0; nblocks <= 9; ++nblocks) {
+    uint32_t portable[8], ni[8];
+    for (size_t i = 0; i < 8; ++i) portable[i] = ni[i] = static_cast<uint32_t>(rng());
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+    jwt::detail::sha256_compress(portable, p, nblocks);
+    jwt::detail::sha256_ni_compress(ni, p, nblocks);
+    EXPECT_EQ (std::string(reinterpret_cast<char*>(portable), sizeof(portable)),
+               std::string(reinterpret_cast<char*>(ni), sizeof(ni))) << nblocks << " blocks";
+  }
+#endif
+}
+
+TEST (HMACInline, HMACSignMatchesOpenSSL)
+{
+  std::mt19937 rng{11};
+  const std::string key = "a-32-byte-shared-secret-for-hmac";
+
+  // Short messages take the in-tree path, long ones OpenSSL
+  for (size_t len : {0u, 150u, 300u, 1024u, 1025u, 5000u}) {
+    const std::string msg = random_bytes(rng, len);
+
+    EXPECT_EQ (jwt::HMACSign<jwt::algo::HS256>::sign(key, msg).first,
+               openssl_hmac(EVP_sha256(), key, msg)) << len;
+    EXPECT_EQ (jwt::HMACSign<jwt::algo::HS384>::sign(key, msg).first,
+               openssl_hmac(EVP_sha384(), key, msg)) << len;
+    EXPECT_EQ (jwt::HMACSign<jwt::algo::HS512>::sign(key, msg).first,
+               openssl_hmac(EVP_sha512(), key, msg)) << len;
+  }
+}
+
+TEST (HMACInline, KeyHandlePadStates)
+{
+  using namespace jwt::params;
+
+  auto k = jwt::key::from_raw_secret("secret");
+  const auto* state = k.mac_state<jwt::algo::HS384>();
+  ASSERT_NE (state, nullptr);
+  EXPECT_EQ (k.mac_state<jwt::algo::HS384>(), state);
+
+  for (const char* alg : {"HS256", "HS384", "HS512"}) {
+    jwt::jwt_object obj{algorithm(alg), secret(k)};
+    obj.add_claim("iss", "arun.muralidharan");
+    const std::string token = obj.signature();
+
+    // Same token as with the plain string secret
+    jwt::jwt_object plain{algorithm(alg), secret("secret")};
+    plain.add_claim("iss", "arun.muralidharan");
+    EXPECT_EQ (token, plain.signature()) << alg;
+
+    std::error_code ec;
+    jwt::decode(token, algorithms({alg}), ec, secret(k));
+    EXPECT_FALSE (ec) << alg;
+
+    jwt::decode(token, algorithms({alg}), ec, secret(jwt::key::from_raw_secret("other")));
+    EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::InvalidSignature)) << alg;
+  }
+
+  EXPECT_EQ (jwt::key{}.mac_state<jwt::algo::HS256>(), nullptr);
+  EXPECT_EQ (jwt::key::from_raw_secret("").mac_state<jwt::algo::HS256>(), nullptr);
+}
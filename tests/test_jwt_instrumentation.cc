@@ -0,0 +1,217 @@
+// The hooks are compiled in for this test only
+#ifndef CPP_JWT_INSTRUMENT
+#define CPP_JWT_INSTRUMENT
+#endif
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+#include "jwt/token_cache.hpp"
+
+/*
+ * Keeps the traces it receives.
+ */
+struct recording_sink : jwt::decode_sink
+{
+  void record(const jwt::decode_trace& trace) noexcept override
+  {
+    traces.push_back(trace);
+  }
+
+  std::vector<jwt::decode_trace> traces;
+};
+
+/*
+ * Installs a sink for the scope of a test.
+ */
+struct scoped_sink
+{
+  explicit scoped_sink(jwt::decode_sink* sink) { jwt::set_decode_sink(sink); }
+  ~scoped_sink() { jwt::set_decode_sink(nullptr); }
+};
+
+std::string make_token()
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret")};
+  obj.add_claim("iss", "arun.muralidharan");
+  return obj.signature();
+}
+
+TEST (InstrumentationTest, TracesEveryStage)
+{
+  using namespace jwt::params;
+
+  const std::string token = make_token();
+  recording_sink sink;
+  scoped_sink installed{&sink};
+
+  std::error_code ec;
+  jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"));
+  ASSERT_FALSE (ec);
+  ASSERT_EQ (sink.traces.size(), 1u);
+
+  const jwt::decode_trace& t = sink.traces[0];
+  EXPECT_EQ (t.alg, jwt::algorithm::HS256);
+  EXPECT_EQ (t.outcome(), jwt::decode_outcome::OK);
+
+  for (size_t i = 0; i < jwt::decode_stage_count; ++i) {
+    auto stage = static_cast<jwt::decode_stage>(i);
+    EXPECT_TRUE (t.ran(stage)) << i;
+    EXPECT_LE (t.nanos[i], t.nanos[static_cast<size_t>(jwt::decode_stage::TOTAL)]) << i;
+  }
+
+  const size_t dot1 = token.find('.');
+  const size_t dot2 = token.find('.', dot1 + 1);
+  auto bytes = [&t](jwt::decode_stage s) { return t.bytes[static_cast<size_t>(s)]; };
+
+  EXPECT_EQ (bytes(jwt::decode_stage::TOTAL), token.length());
+  EXPECT_EQ (bytes(jwt::decode_stage::SPLIT), token.length());
+  EXPECT_EQ (bytes(jwt::decode_stage::HEADER_BASE64), dot1);
+  EXPECT_EQ (bytes(jwt::decode_stage::PAYLOAD_BASE64), dot2 - dot1 - 1);
+  EXPECT_EQ (bytes(jwt::decode_stage::SIGNATURE), dot2);
+  EXPECT_LT (bytes(jwt::decode_stage::HEADER_JSON), bytes(jwt::decode_stage::HEADER_BASE64));
+}
+
+TEST (InstrumentationTest, TracesFailures)
+{
+  using namespace jwt::params;
+
+  const std::string token = make_token();
+  recording_sink sink;
+  scoped_sink installed{&sink};
+
+  std::error_code ec;
+  jwt::decode(token, algorithms({"HS256"}), ec, secret("other"));
+  jwt::decode("abc", algorithms({"HS256"}), ec, secret("secret"));
+  jwt::decode(token, algorithms({"RS256"}), ec, secret("secret"));
+  EXPECT_THROW (jwt::decode(token, algorithms({"HS256"}), secret("other")),
+                jwt::InvalidSignatureError);
+  ASSERT_EQ (sink.traces.size(), 4u);
+
+  // Bad signature
+  EXPECT_EQ (sink.traces[0].outcome(), jwt::decode_outcome::VERIFICATION_ERROR);
+  EXPECT_EQ (sink.traces[0].ec.value(), static_cast<int>(jwt::VerificationErrc::InvalidSignature));
+  EXPECT_TRUE (sink.traces[0].ran(jwt::decode_stage::SIGNATURE));
+
+  // Stops at the split, before the algorithm is known
+  EXPECT_EQ (sink.traces[1].outcome(), jwt::decode_outcome::DECODE_ERROR);
+  EXPECT_EQ (sink.traces[1].alg, jwt::algorithm::UNKN);
+  EXPECT_TRUE (sink.traces[1].ran(jwt::decode_stage::SPLIT));
+  EXPECT_FALSE (sink.traces[1].ran(jwt::decode_stage::HEADER_BASE64));
+
+  // Algorithm not allowed, the signature is not checked
+  EXPECT_EQ (sink.traces[2].alg, jwt::algorithm::HS256);
+  EXPECT_TRUE (sink.traces[2].ran(jwt::decode_stage::CLAIMS));
+  EXPECT_FALSE (sink.traces[2].ran(jwt::decode_stage::SIGNATURE));
+
+  EXPECT_EQ (sink.traces[3].outcome(), jwt::decode_outcome::VERIFICATION_ERROR);
+}
+
+TEST (InstrumentationTest, NestedDecodeIsTracedOnce)
+{
+  using namespace jwt::params;
+
+  const std::string token = make_token();
+  std::vector<jwt::string_view> segs = {
+    jwt::string_view{token.data(), 10},
+    jwt::string_view{token.data() + 10, token.length() - 10},
+  };
+  jwt::segmented_view view{segs.data(), segs.size()};
+
+  recording_sink sink;
+  scoped_sink installed{&sink};
+
+  // The segments are joined and decoded again through the cache
+  jwt::token_cache tc;
+  std::error_code ec;
+  jwt::decode(view, algorithms({"HS256"}), ec, secret("secret"), cache(tc));
+  ASSERT_FALSE (ec);
+  ASSERT_EQ (sink.traces.size(), 1u);
+  EXPECT_TRUE (sink.traces[0].ran(jwt::decode_stage::SIGNATURE));
+  EXPECT_EQ (sink.traces[0].bytes[static_cast<size_t>(jwt::decode_stage::SPLIT)], token.length());
+
+  // A cache hit runs no stage
+  jwt::decode(view, algorithms({"HS256"}), ec, secret("secret"), cache(tc));
+  ASSERT_EQ (sink.traces.size(), 2u);
+  EXPECT_EQ (sink.traces[1].stages, 1u << static_cast<unsigned>(jwt::decode_stage::TOTAL));
+}
+
+TEST (InstrumentationTest, NoSinkNoTrace)
+{
+  using namespace jwt::params;
+
+  recording_sink sink;
+  {
+    scoped_sink installed{&sink};
+    EXPECT_EQ (jwt::current_decode_sink(), &sink);
+  }
+  EXPECT_EQ (jwt::current_decode_sink(), nullptr);
+
+  jwt::decode(make_token(), algorithms({"HS256"}), secret("secret"));
+  EXPECT_TRUE (sink.traces.empty());
+}
+
+TEST (InstrumentationTest, HistogramBuckets)
+{
+  using jwt::latency_histogram;
+
+  EXPECT_EQ (latency_histogram::bucket_of(0), 0u);
+  EXPECT_EQ (latency_histogram::bucket_of(1), 0u);
+  EXPECT_EQ (latency_histogram::bucket_of(2), 1u);
+  EXPECT_EQ (latency_histogram::bucket_of(1023), 9u);
+  EXPECT_EQ (latency_histogram::bucket_of(1024), 10u);
+  EXPECT_EQ (latency_histogram::bucket_of(~uint64_t{0}), latency_histogram::bucket_count - 1);
+
+  latency_histogram h;
+  EXPECT_EQ (h.quantile_nanos(0.5), 0u);
+
+  h.count = 100;
+  h.buckets[10] = 90;
+  h.buckets[20] = 10;
+  EXPECT_EQ (h.quantile_nanos(0.5), 2048u);
+  EXPECT_EQ (h.quantile_nanos(0.9), 2048u);
+  EXPECT_EQ (h.quantile_nanos(0.99), uint64_t{1} << 21);
+}
+
+TEST (InstrumentationTest, HistogramSinkAcrossThreads)
+{
+  using namespace jwt::params;
+
+  const std::string token = make_token();
+  jwt::histogram_sink sink;
+  scoped_sink installed{&sink};
+
+  constexpr int threads = 4;
+  constexpr int per_thread = 50;
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back([&token] {
+      std::error_code ec;
+      for (int n = 0; n < per_thread; ++n) {
+        jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"));
+        jwt::decode(token, algorithms({"HS256"}), ec, secret("other"));
+      }
+    });
+  }
+  for (auto& w : workers) w.join();
+
+  EXPECT_EQ (sink.count(jwt::algorithm::HS256, jwt::decode_outcome::OK), uint64_t{threads * per_thread});
+  EXPECT_EQ (sink.count(jwt::algorithm::HS256, jwt::decode_outcome::VERIFICATION_ERROR),
+             uint64_t{threads * per_thread});
+  EXPECT_EQ (sink.count(jwt::algorithm::RS256, jwt::decode_outcome::OK), 0u);
+
+  auto sig = sink.histogram(jwt::algorithm::HS256, jwt::decode_outcome::OK, jwt::decode_stage::SIGNATURE);
+  EXPECT_EQ (sig.count, uint64_t{threads * per_thread});
+  EXPECT_EQ (sig.total_bytes, sig.count * token.rfind('.'));
+  EXPECT_GT (sig.mean_nanos(), 0.0);
+  EXPECT_LE (sig.quantile_nanos(0.5), sig.quantile_nanos(0.99));
+
+  auto total = sink.histogram(jwt::algorithm::HS256, jwt::decode_outcome::OK, jwt::decode_stage::TOTAL);
+  EXPECT_GE (total.total_nanos, sig.total_nanos);
+}
@@ -0,0 +1,119 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+#include "jwt/token_cache.hpp"
+
+uint64_t now_secs()
+{
+  return std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+TEST (JTIStore, RejectsReplayedTokens)
+{
+  using namespace jwt::params;
+
+  jwt::jti_store store;
+
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret"), payload({{"jti", "id-1"}})};
+  obj.add_claim("exp", std::chrono::system_clock::now() + std::chrono::seconds{60});
+  const std::string token = obj.signature();
+
+  std::error_code ec;
+  jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"), replay(store));
+  EXPECT_FALSE (ec);
+  EXPECT_TRUE (store.contains("id-1"));
+
+  jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"), replay(store));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::TokenReplayed));
+
+  EXPECT_THROW (jwt::decode(token, algorithms({"HS256"}), secret("secret"), replay(store)),
+                jwt::TokenReplayedError);
+
+  // The jti is required
+  jwt::jwt_object no_jti{algorithm("HS256"), secret("secret")};
+  jwt::decode(no_jti.signature(), algorithms({"HS256"}), ec, secret("secret"), replay(store));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::InvalidJTI));
+
+  // Forged tokens do not burn the jti
+  jwt::jwt_object forged{algorithm("HS256"), secret("other"), payload({{"jti", "id-2"}})};
+  jwt::decode(forged.signature(), algorithms({"HS256"}), ec, secret("secret"), replay(store));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::InvalidSignature));
+  EXPECT_FALSE (store.contains("id-2"));
+
+  // Non string jti values are accepted too
+  jwt::jwt_object num_jti{algorithm("HS256"), secret("secret")};
+  num_jti.add_claim("jti", 42);
+  jwt::decode(num_jti.signature(), algorithms({"HS256"}), ec, secret("secret"), replay(store));
+  EXPECT_FALSE (ec);
+  EXPECT_TRUE (store.contains("42"));
+
+  // The cache is bypassed so that a hit can not hide a replay
+  jwt::token_cache tc;
+  jwt::jwt_object cached{algorithm("HS256"), secret("secret"), payload({{"jti", "id-3"}})};
+  const std::string cached_token = cached.signature();
+  jwt::decode(cached_token, algorithms({"HS256"}), ec, secret("secret"), replay(store), cache(tc));
+  EXPECT_FALSE (ec);
+  jwt::decode(cached_token, algorithms({"HS256"}), ec, secret("secret"), replay(store), cache(tc));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::TokenReplayed));
+}
+
+TEST (JTIStore, ExpiryAndGrowth)
+{
+  jwt::jti_store store{1};
+  const uint64_t t = now_secs();
+
+  // Already expired entries do not count as seen
+  EXPECT_TRUE (store.insert("old", t - 1));
+  EXPECT_FALSE (store.contains("old"));
+  EXPECT_TRUE (store.insert("old", t + 60));
+  EXPECT_FALSE (store.insert("old", t + 60));
+
+  // Many entries force the table to grow and expired
+  // ones are dropped by the wheel on later inserts
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE (store.insert("id-" + std::to_string(i), i % 2 ? t + 60 : t - 1));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ (store.contains("id-" + std::to_string(i)), i % 2 == 1);
+  }
+
+  // The wheel has one second resolution
+  std::this_thread::sleep_for(std::chrono::milliseconds{1100});
+  EXPECT_TRUE (store.insert("trigger", t + 60));
+  EXPECT_EQ (store.size(), 502u);
+
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ (store.contains("id-" + std::to_string(i)), i % 2 == 1);
+  }
+
+  store.clear();
+  EXPECT_EQ (store.size(), 0u);
+  EXPECT_FALSE (store.contains("old"));
+}
+
+TEST (JTIStore, ConcurrentInserts)
+{
+  jwt::jti_store store{8};
+  const uint64_t t = now_secs();
+  std::atomic<int> accepted{0};
+
+  // Every thread tries every id; each must be accepted once
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < 5000; ++j) {
+        if (store.insert("id-" + std::to_string(j), t + 60)) accepted++;
+      }
+    });
+  }
+  for (auto& th : threads) th.join();
+
+  EXPECT_EQ (accepted.load(), 5000);
+  EXPECT_EQ (store.size(), 5000u);
+}
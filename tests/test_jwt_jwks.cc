@@ -0,0 +1,199 @@
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+#include "jwt/jwks.hpp"
+
+#define RSA256_PUB_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_pub.pem"
+#define RSA256_PRIV_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_priv.pem"
+#define EC384_PRIV_KEY CERT_ROOT_DIR "/ec_certs/ec384_priv.pem"
+#define JWKS_FILE CERT_ROOT_DIR "/jwks/jwks.json"
+
+std::string read_from_file(const std::string& path)
+{
+  std::string contents;
+  std::ifstream is{path, std::ifstream::binary};
+
+  if (is) {
+    // get length of file:
+    is.seekg (0, is.end);
+    auto length = is.tellg();
+    is.seekg (0, is.beg);
+    contents.resize(length);
+
+    is.read(&contents[0], length);
+    if (!is) {
+      is.close();
+      return {};
+    }
+  }
+
+  is.close();
+  return contents;
+}
+
+std::string make_token(const char* alg, const char* kid, jwt::string_view key)
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm(alg), secret(key), headers({{"kid", kid}})};
+  obj.add_claim("iss", "arun.muralidharan");
+  return obj.signature();
+}
+
+TEST (JWKS, LoadsKeysAndVerifies)
+{
+  using namespace jwt::params;
+
+  const std::string text = read_from_file(JWKS_FILE);
+  ASSERT_TRUE (text.length());
+
+  jwt::key_ring ring;
+  jwt::jwks::load(text, ring);
+
+  // The encryption and the Ed25519 keys are skipped
+  EXPECT_EQ (ring.size(), 3u);
+  EXPECT_FALSE (ring.find("enc-1"));
+  EXPECT_FALSE (ring.find("ed-1"));
+
+  EXPECT_EQ (ring.find("rsa-1").type(), jwt::key_type::PUBLIC);
+  EXPECT_EQ (ring.find("rsa-1").algo(), jwt::algorithm::RS256);
+  // Pinned by its curve
+  EXPECT_EQ (ring.find("ec-1").algo(), jwt::algorithm::ES384);
+  EXPECT_EQ (ring.find("hmac-1").type(), jwt::key_type::SECRET);
+
+  std::error_code ec;
+  jwt::decode(make_token("RS256", "rsa-1", read_from_file(RSA256_PRIV_KEY)),
+              algorithms({"RS256"}), ec, secret(ring));
+  EXPECT_FALSE (ec) << ec.message();
+
+  jwt::decode(make_token("ES384", "ec-1", read_from_file(EC384_PRIV_KEY)),
+              algorithms({"ES384"}), ec, secret(ring));
+  EXPECT_FALSE (ec) << ec.message();
+
+  jwt::decode(make_token("HS256", "hmac-1", "secret"),
+              algorithms({"HS256"}), ec, secret(ring));
+  EXPECT_FALSE (ec) << ec.message();
+
+  // The RSA key is pinned to RS256
+  jwt::decode(make_token("RS512", "rsa-1", read_from_file(RSA256_PRIV_KEY)),
+              algorithms({"RS512"}), ec, secret(ring));
+  EXPECT_TRUE (ec);
+}
+
+TEST (JWKS, DerPublicKey)
+{
+  using namespace jwt::params;
+
+  // DER of the same key as the PEM
+  auto pem = jwt::key::from_pem(read_from_file(RSA256_PUB_KEY));
+  unsigned char* der = nullptr;
+  int der_len = i2d_PUBKEY(pem.evp_pkey(), &der);
+  ASSERT_GT (der_len, 0);
+  std::string der_str(reinterpret_cast<const char*>(der), der_len);
+  OPENSSL_free(der);
+
+  auto k = jwt::key::from_der(der_str);
+  EXPECT_EQ (k.type(), jwt::key_type::PUBLIC);
+
+  std::error_code ec;
+  jwt::decode(make_token("RS256", "any", read_from_file(RSA256_PRIV_KEY)),
+              algorithms({"RS256"}), ec, secret(k));
+  EXPECT_FALSE (ec) << ec.message();
+
+  // Replicas parse the DER again
+  jwt::decode(make_token("RS256", "any", read_from_file(RSA256_PRIV_KEY)),
+              algorithms({"RS256"}), ec, secret(k.replicated(2)));
+  EXPECT_FALSE (ec) << ec.message();
+
+  jwt::key::from_der(der_str.substr(0, der_str.length() - 1), ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr));
+  jwt::key::from_der(der_str + '\0', ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr));
+
+  EXPECT_THROW (jwt::key::from_der("not der"), jwt::InvalidKeyError);
+}
+
+TEST (JWKS, RejectsMalformedSets)
+{
+  json_t doc = json_t::parse(read_from_file(JWKS_FILE));
+  const json_t rsa = doc["keys"][0];
+  const json_t ec_key = doc["keys"][1];
+
+  jwt::key_ring ring;
+  ring.insert("kept", jwt::key::from_secret("secret"));
+
+  std::error_code ec;
+  for (const char* text : {"", "{", "[]", "{}", "{\"keys\": {}}"}) {
+    jwt::jwks::load(text, ring, ec);
+    EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::JsonParseError)) << text;
+  }
+
+  std::vector<json_t> bad_keys;
+
+  json_t k = rsa;
+  k.erase("n");
+  bad_keys.push_back(k);
+
+  k = rsa;
+  k["alg"] = "ES256";
+  bad_keys.push_back(k);
+
+  k = rsa;
+  k["e"] = "***";
+  bad_keys.push_back(k);
+
+  k = ec_key;
+  k["crv"] = "P-256";
+  bad_keys.push_back(k);
+
+  // A point which is not on the curve
+  k = ec_key;
+  std::string y = k["y"];
+  y[5] = y[5] == 'A' ? 'B' : 'A';
+  k["y"] = y;
+  bad_keys.push_back(k);
+
+  bad_keys.push_back(json_t{{"kid", "x"}});
+  bad_keys.push_back(json_t{{"kty", "oct"}});
+  bad_keys.push_back(json_t(5));
+
+  for (const auto& bad : bad_keys) {
+    json_t set = {{"keys", json_t::array({rsa, bad})}};
+    jwt::jwks::load(set.dump(), ring, ec);
+    EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr)) << bad.dump();
+  }
+
+  // Left as it was
+  EXPECT_EQ (ring.size(), 1u);
+  EXPECT_TRUE (ring.find("kept"));
+
+  EXPECT_THROW (jwt::jwks::load("{", ring), jwt::DecodeError);
+  json_t set = {{"keys", json_t::array({bad_keys[0]})}};
+  EXPECT_THROW (jwt::jwks::load(set.dump(), ring), jwt::InvalidKeyError);
+}
+
+TEST (JWKS, LoadsLargeSet)
+{
+  json_t doc = json_t::parse(read_from_file(JWKS_FILE));
+
+  json_t keys = json_t::array();
+  for (int i = 0; i < 5000; ++i) {
+    json_t k = doc["keys"][i % 2];
+    k["kid"] = "key-" + std::to_string(i);
+    keys.push_back(std::move(k));
+  }
+  json_t set = {{"keys", std::move(keys)}};
+
+  std::error_code ec;
+  auto loaded = jwt::jwks::load(set.dump(), ec);
+  ASSERT_FALSE (ec);
+  ASSERT_EQ (loaded.size(), 5000u);
+
+  jwt::key_ring ring;
+  ring.assign(std::move(loaded));
+  EXPECT_EQ (ring.find("key-4998").algo(), jwt::algorithm::RS256);
+  EXPECT_EQ (ring.find("key-4999").algo(), jwt::algorithm::ES384);
+}
@@ -0,0 +1,195 @@
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+
+#define RSA256_PUB_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_pub.pem"
+#define RSA256_PRIV_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_priv.pem"
+#define EC384_PUB_KEY CERT_ROOT_DIR "/ec_certs/ec384_pub.pem"
+#define EC384_PRIV_KEY CERT_ROOT_DIR "/ec_certs/ec384_priv.pem"
+
+std::string read_from_file(const std::string& path)
+{
+  std::string contents;
+  std::ifstream is{path, std::ifstream::binary};
+
+  if (is) {
+    // get length of file:
+    is.seekg (0, is.end);
+    auto length = is.tellg();
+    is.seekg (0, is.beg);
+    contents.resize(length);
+
+    is.read(&contents[0], length);
+    if (!is) {
+      is.close();
+      return {};
+    }
+  }
+
+  is.close();
+  return contents;
+}
+
+/// The DER forms a secret store may hand out
+enum class der_form { PUBLIC, PKCS8, TRADITIONAL };
+
+/// Converts the PEM key in `path` to DER
+std::string to_der(const char* path, der_form form)
+{
+  const jwt::key pem = jwt::key::from_pem(read_from_file(path));
+  EVP_PKEY* pkey = pem.evp_pkey();
+
+  unsigned char* buf = nullptr;
+  int len = -1;
+
+  switch (form) {
+    case der_form::PUBLIC:
+      len = i2d_PUBKEY(pkey, &buf);
+      break;
+    case der_form::PKCS8:
+    {
+      PKCS8_PRIV_KEY_INFO* p8 = EVP_PKEY2PKCS8(pkey);
+      if (p8) {
+        len = i2d_PKCS8_PRIV_KEY_INFO(p8, &buf);
+        PKCS8_PRIV_KEY_INFO_free(p8);
+      }
+      break;
+    }
+    case der_form::TRADITIONAL:
+      len = i2d_PrivateKey(pkey, &buf);
+      break;
+  }
+
+  if (len <= 0) return {};
+
+  std::string der(reinterpret_cast<const char*>(buf), len);
+  OPENSSL_free(buf);
+  return der;
+}
+
+/// Signs with `sign_key` and verifies with `verify_key`
+void sign_and_verify(const char* alg, const jwt::key& sign_key, const jwt::key& verify_key)
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm(alg), secret(sign_key)};
+  obj.add_claim("iss", "arun.muralidharan");
+
+  std::error_code ec;
+  auto dec_obj = jwt::decode(obj.signature(), algorithms({alg}), ec, secret(verify_key));
+  EXPECT_FALSE (ec) << alg << ": " << ec.message();
+  EXPECT_EQ (dec_obj.payload().get_claim_value<std::string>("iss"), "arun.muralidharan");
+}
+
+TEST (KeyDer, RSAPrivateAndPublicKeys)
+{
+  const std::string pub_der = to_der(RSA256_PUB_KEY, der_form::PUBLIC);
+  ASSERT_FALSE (pub_der.empty());
+
+  auto pub_key = jwt::key::from_der(pub_der, jwt::algorithm::RS256);
+  EXPECT_EQ (pub_key.type(), jwt::key_type::PUBLIC);
+
+  for (der_form form : {der_form::PKCS8, der_form::TRADITIONAL}) {
+    const std::string priv_der = to_der(RSA256_PRIV_KEY, form);
+    ASSERT_FALSE (priv_der.empty());
+
+    std::error_code ec;
+    auto priv_key = jwt::key::from_der(priv_der, ec, jwt::algorithm::RS256);
+    ASSERT_FALSE (ec);
+    EXPECT_EQ (priv_key.type(), jwt::key_type::PRIVATE);
+    EXPECT_EQ (priv_key.material(), jwt::string_view{priv_der});
+
+    sign_and_verify("RS256", priv_key, pub_key);
+    sign_and_verify("RS256", priv_key.replicated(2), pub_key.replicated(2));
+
+    // Trailing bytes
+    jwt::key::from_der(priv_der + '\0', ec);
+    EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr));
+  }
+}
+
+TEST (KeyDer, ECPrivateAndPublicKeys)
+{
+  auto pub_key = jwt::key::from_der(to_der(EC384_PUB_KEY, der_form::PUBLIC));
+  EXPECT_EQ (pub_key.type(), jwt::key_type::PUBLIC);
+
+  for (der_form form : {der_form::PKCS8, der_form::TRADITIONAL}) {
+    const std::string priv_der = to_der(EC384_PRIV_KEY, form);
+    ASSERT_FALSE (priv_der.empty());
+
+    auto priv_key = jwt::key::from_der(priv_der);
+    EXPECT_EQ (priv_key.type(), jwt::key_type::PRIVATE);
+
+    sign_and_verify("ES384", priv_key, pub_key);
+
+    std::error_code ec;
+    jwt::key::from_der(priv_der.substr(0, priv_der.length() / 2), ec);
+    EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr));
+  }
+
+  // PEM text is not DER
+  EXPECT_THROW (jwt::key::from_der(read_from_file(EC384_PRIV_KEY)), jwt::InvalidKeyError);
+}
+
+TEST (KeyDer, RawECPoint)
+{
+  // The uncompressed and compressed points of the key
+  const std::string pub_der = to_der(EC384_PUB_KEY, der_form::PUBLIC);
+  jwt::detail::spki_parts parts;
+  ASSERT_TRUE (jwt::detail::der_read_spki(reinterpret_cast<const uint8_t*>(pub_der.data()),
+                                          pub_der.length(), parts));
+  ASSERT_EQ (parts.key_len, 97u);
+
+  const std::string point(reinterpret_cast<const char*>(parts.key), parts.key_len);
+  std::string compressed(1, static_cast<char>(0x02 | (point[96] & 1)));
+  compressed.append(point, 1, 48);
+
+  auto sign_key = jwt::key::from_pem(read_from_file(EC384_PRIV_KEY));
+
+  for (const std::string& p : {point, compressed}) {
+    std::error_code ec;
+    auto k = jwt::key::from_ec_point(p, jwt::algorithm::ES384, ec);
+    ASSERT_FALSE (ec);
+    EXPECT_EQ (k.type(), jwt::key_type::PUBLIC);
+    EXPECT_EQ (k.algo(), jwt::algorithm::ES384);
+
+    sign_and_verify("ES384", sign_key, k);
+  }
+
+  std::error_code ec;
+
+  // Not on the curve
+  std::string off_curve = point;
+  off_curve[96] ^= 1;
+  jwt::key::from_ec_point(off_curve, jwt::algorithm::ES384, ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr));
+
+  // A point of the wrong curve
+  jwt::key::from_ec_point(point, jwt::algorithm::ES256, ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr));
+
+  jwt::key::from_ec_point(point, jwt::algorithm::RS256, ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr));
+
+  EXPECT_THROW (jwt::key::from_ec_point("", jwt::algorithm::ES384), jwt::InvalidKeyError);
+}
+
+TEST (KeyDer, RawSecret)
+{
+  // Binary secret with embedded zero bytes
+  const std::string bin_secret("\x00\x01\xfe\xff secret\x00", 12);
+
+  auto k = jwt::key::from_raw_secret(bin_secret, jwt::algorithm::HS256);
+  EXPECT_EQ (k.type(), jwt::key_type::SECRET);
+  EXPECT_EQ (k.material(), jwt::string_view{bin_secret});
+  EXPECT_EQ (k.evp_pkey(), nullptr);
+
+  sign_and_verify("HS256", k, k);
+
+  // PEM text is taken as a secret, not parsed
+  const std::string pem = read_from_file(RSA256_PUB_KEY);
+  EXPECT_EQ (jwt::key::from_raw_secret(pem).type(), jwt::key_type::SECRET);
+  EXPECT_EQ (jwt::key::from_secret(pem).type(), jwt::key_type::PUBLIC);
+}
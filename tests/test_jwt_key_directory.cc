@@ -0,0 +1,259 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "jwt/key_directory.hpp"
+
+#define RSA256_PUB_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_pub.pem"
+#define RSA256_PRIV_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_priv.pem"
+#define EC384_PUB_KEY CERT_ROOT_DIR "/ec_certs/ec384_pub.pem"
+#define EC384_PRIV_KEY CERT_ROOT_DIR "/ec_certs/ec384_priv.pem"
+
+std::string read_from_file(const std::string& path)
+{
+  std::string contents;
+  std::ifstream is{path, std::ifstream::binary};
+
+  if (is) {
+    // get length of file:
+    is.seekg (0, is.end);
+    auto length = is.tellg();
+    is.seekg (0, is.beg);
+    contents.resize(length);
+
+    is.read(&contents[0], length);
+    if (!is) {
+      is.close();
+      return {};
+    }
+  }
+
+  is.close();
+  return contents;
+}
+
+/// A temporary directory removed with its files
+struct temp_dir
+{
+  temp_dir()
+  {
+    char tmpl[] = "/tmp/cpp-jwt-keys-XXXXXX";
+    if (::mkdtemp(tmpl)) path = tmpl;
+  }
+
+  ~temp_dir()
+  {
+    if (DIR* dir = ::opendir(path.c_str())) {
+      while (struct dirent* ent = ::readdir(dir)) {
+        std::string name = ent->d_name;
+        if (name != "." && name != "..") ::unlink((path + '/' + name).c_str());
+      }
+      ::closedir(dir);
+    }
+    ::rmdir(path.c_str());
+  }
+
+  /// Writes the file through a rename, as a config agent would
+  void write(const std::string& name, const std::string& contents) const
+  {
+    const std::string tmp = path + "/." + name + ".tmp";
+    std::ofstream{tmp, std::ofstream::binary} << contents;
+    std::rename(tmp.c_str(), (path + '/' + name).c_str());
+  }
+
+  void remove(const std::string& name) const
+  {
+    ::unlink((path + '/' + name).c_str());
+  }
+
+  std::string path;
+};
+
+std::string make_token(const char* alg, const char* kid, const std::string& key)
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm(alg), secret(key), headers({{"kid", kid}})};
+  obj.add_claim("iss", "arun.muralidharan");
+  return obj.signature();
+}
+
+/// The public key in `path` as DER
+std::string to_der(const char* path)
+{
+  const jwt::key k = jwt::key::from_pem(read_from_file(path));
+
+  unsigned char* buf = nullptr;
+  int len = i2d_PUBKEY(k.evp_pkey(), &buf);
+  if (len <= 0) return {};
+
+  std::string der(reinterpret_cast<const char*>(buf), len);
+  OPENSSL_free(buf);
+  return der;
+}
+
+TEST (KeyDirectory, RefreshLoadsChangedFiles)
+{
+  using namespace jwt::params;
+
+  temp_dir dir;
+  ASSERT_FALSE (dir.path.empty());
+
+  dir.write("rsa-1.pem", read_from_file(RSA256_PUB_KEY));
+  dir.write("ec-1.der", to_der(EC384_PUB_KEY));
+  dir.write(".hidden.pem", read_from_file(RSA256_PUB_KEY));
+  dir.write("broken.pem", "-----BEGIN PUBLIC KEY-----\nAAAA\n");
+
+  jwt::key_directory keys{dir.path};
+  EXPECT_EQ (keys.size(), 0u);
+
+  std::error_code ec;
+  keys.refresh(ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr));
+  EXPECT_EQ (keys.size(), 2u);
+  EXPECT_EQ (keys.generation(), 1u);
+  EXPECT_FALSE (keys.find("hidden"));
+  EXPECT_FALSE (keys.find("broken"));
+
+  const std::string rsa_token = make_token("RS256", "rsa-1", read_from_file(RSA256_PRIV_KEY));
+  const std::string ec_token = make_token("ES384", "ec-1", read_from_file(EC384_PRIV_KEY));
+
+  jwt::decode(rsa_token, algorithms({"RS256", "ES384"}), ec, secret(keys));
+  EXPECT_FALSE (ec);
+  jwt::decode(ec_token, algorithms({"RS256", "ES384"}), ec, secret(keys));
+  EXPECT_FALSE (ec);
+
+  // Unchanged files are not parsed again and nothing is published
+  EVP_PKEY* ec_pkey = keys.find("ec-1").evp_pkey();
+  dir.remove("broken.pem");
+  keys.refresh(ec);
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (keys.generation(), 1u);
+
+  // Rotation; readers holding the old snapshot keep it
+  auto old_snap = keys.ring().snapshot();
+  dir.remove("rsa-1.pem");
+  dir.write("rsa-2.pem", read_from_file(RSA256_PUB_KEY));
+  keys.refresh(ec);
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (keys.generation(), 2u);
+  EXPECT_FALSE (keys.find("rsa-1"));
+  EXPECT_TRUE (keys.find("rsa-2"));
+  EXPECT_EQ (keys.find("ec-1").evp_pkey(), ec_pkey);
+  EXPECT_TRUE (jwt::key_ring::find(*old_snap, "rsa-1"));
+
+  jwt::decode(rsa_token, algorithms({"RS256"}), ec, secret(keys));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::KeyNotPresent));
+
+  // A file turning bad keeps its previous key
+  dir.write("ec-1.der", "garbage");
+  keys.refresh(ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr));
+  EXPECT_EQ (keys.last_error(), ec);
+  EXPECT_EQ (keys.find("ec-1").evp_pkey(), ec_pkey);
+
+  EXPECT_THROW (keys.refresh(), jwt::InvalidKeyError);
+
+  jwt::key_directory missing{dir.path + "/missing"};
+  missing.refresh(ec);
+  EXPECT_EQ (ec, std::errc::no_such_file_or_directory);
+  EXPECT_THROW (missing.refresh(), std::system_error);
+}
+
+TEST (KeyDirectory, ParallelInitialLoad)
+{
+  temp_dir dir;
+  ASSERT_FALSE (dir.path.empty());
+
+  const std::string pem = read_from_file(RSA256_PUB_KEY);
+  const std::string der = to_der(EC384_PUB_KEY);
+  for (int i = 0; i < 64; ++i) {
+    dir.write("key-" + std::to_string(i) + (i % 2 ? ".pem" : ".der"), i % 2 ? pem : der);
+  }
+
+  jwt::key_directory keys{dir.path};
+  std::error_code ec;
+  keys.refresh(ec, 4);
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (keys.size(), 64u);
+
+  for (int i = 0; i < 64; ++i) {
+    auto k = keys.find("key-" + std::to_string(i));
+    ASSERT_TRUE (k);
+    EXPECT_EQ (k.type(), jwt::key_type::PUBLIC);
+  }
+}
+
+TEST (KeyDirectory, WatchReloads)
+{
+#if defined(CPP_JWT_HAS_INOTIFY)
+  using namespace jwt::params;
+
+  temp_dir dir;
+  ASSERT_FALSE (dir.path.empty());
+  dir.write("rsa-1.pem", read_from_file(RSA256_PUB_KEY));
+
+  jwt::key_directory keys{dir.path};
+  std::error_code ec;
+  keys.watch(ec);
+  ASSERT_FALSE (ec);
+  EXPECT_TRUE (keys.watching());
+  EXPECT_TRUE (keys.find("rsa-1"));
+
+  auto wait_for = [&keys](uint64_t gen) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (keys.generation() < gen && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    }
+    return keys.generation() >= gen;
+  };
+
+  const std::string token = make_token("ES384", "ec-1", read_from_file(EC384_PRIV_KEY));
+
+  // Readers keep decoding while the directory changes
+  std::atomic<bool> done{false};
+  std::atomic<int> decoded{0};
+  std::thread reader{[&] {
+    while (!done.load()) {
+      std::error_code rec;
+      jwt::decode(token, algorithms({"ES384"}), rec, secret(keys));
+      if (!rec) decoded++;
+    }
+  }};
+
+  uint64_t gen = keys.generation();
+  dir.write("ec-1.pem", read_from_file(EC384_PUB_KEY));
+  ASSERT_TRUE (wait_for(gen + 1));
+  EXPECT_TRUE (keys.find("ec-1"));
+
+  while (decoded.load() == 0) std::this_thread::yield();
+
+  dir.remove("rsa-1.pem");
+  ASSERT_TRUE (wait_for(gen + 2));
+  EXPECT_FALSE (keys.find("rsa-1"));
+
+  done = true;
+  reader.join();
+
+  keys.stop();
+  EXPECT_FALSE (keys.watching());
+
+  // No longer reloaded
+  gen = keys.generation();
+  dir.write("rsa-1.pem", read_from_file(RSA256_PUB_KEY));
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  EXPECT_EQ (keys.generation(), gen);
+#else
+  jwt::key_directory keys{"."};
+  std::error_code ec;
+  keys.watch(ec);
+  EXPECT_EQ (ec, std::errc::operation_not_supported);
+#endif
+}
@@ -0,0 +1,362 @@
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+
+#define RSA256_PUB_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_pub.pem"
+#define RSA256_PRIV_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_priv.pem"
+
+std::string read_from_file(const std::string& path)
+{
+  std::string contents;
+  std::ifstream is{path, std::ifstream::binary};
+
+  if (is) {
+    // get length of file:
+    is.seekg (0, is.end);
+    auto length = is.tellg();
+    is.seekg (0, is.beg);
+    contents.resize(length);
+
+    is.read(&contents[0], length);
+    if (!is) {
+      is.close();
+      return {};
+    }
+  }
+
+  is.close();
+  return contents;
+}
+
+std::string make_token(const char* alg, const char* kid, jwt::string_view key)
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm(alg), secret(key), headers({{"kid", kid}})};
+  obj.add_claim("iss", "arun.muralidharan");
+  return obj.signature();
+}
+
+TEST (KeyRing, LookupByKid)
+{
+  using namespace jwt::params;
+
+  jwt::key_ring ring;
+  ring.insert("tenant-1", jwt::key::from_secret("secret-1"));
+  ring.insert("tenant-2", jwt::key::from_secret("secret-2"));
+  EXPECT_EQ (ring.size(), 2u);
+
+  std::error_code ec;
+  auto dec_obj = jwt::decode(make_token("HS256", "tenant-1", "secret-1"),
+                             algorithms({"HS256"}), ec, secret(ring));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (dec_obj.header().kid(), jwt::string_view{"tenant-1"});
+
+  // Right kid, wrong secret
+  jwt::decode(make_token("HS256", "tenant-2", "secret-1"),
+              algorithms({"HS256"}), ec, secret(ring));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::InvalidSignature));
+
+  // Unknown kid
+  jwt::decode(make_token("HS256", "tenant-3", "secret-1"),
+              algorithms({"HS256"}), ec, secret(ring));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::DecodeErrc::KeyNotPresent));
+
+  EXPECT_THROW (jwt::decode(make_token("HS256", "tenant-3", "secret-1"),
+                            algorithms({"HS256"}), secret(ring)),
+                jwt::KeyNotPresentError);
+}
+
+TEST (KeyRing, EraseAndAssign)
+{
+  jwt::key_ring ring;
+  ring.insert("b", jwt::key::from_secret("2"));
+  ring.insert("a", jwt::key::from_secret("1"));
+  ring.insert("b", jwt::key::from_secret("3"));
+
+  EXPECT_EQ (ring.size(), 2u);
+  EXPECT_EQ (ring.find("b").material(), jwt::string_view{"3"});
+
+  auto old_snap = ring.snapshot();
+
+  EXPECT_TRUE (ring.erase("a"));
+  EXPECT_FALSE (ring.erase("a"));
+  EXPECT_FALSE (ring.find("a"));
+
+  // Earlier snapshots are not affected
+  EXPECT_TRUE (jwt::key_ring::find(*old_snap, "a"));
+
+  ring.assign({{"x", jwt::key::from_secret("1")},
+               {"y", jwt::key::from_secret("2")},
+               {"x", jwt::key::from_secret("3")}});
+  EXPECT_EQ (ring.size(), 2u);
+  EXPECT_EQ (ring.find("x").material(), jwt::string_view{"3"});
+  EXPECT_FALSE (ring.find("b"));
+}
+
+TEST (KeyRing, RSAKeysAndPinnedAlgorithm)
+{
+  using namespace jwt::params;
+
+  std::string priv_key = read_from_file(RSA256_PRIV_KEY);
+  std::string pub_key = read_from_file(RSA256_PUB_KEY);
+  ASSERT_TRUE (priv_key.length());
+  ASSERT_TRUE (pub_key.length());
+
+  jwt::key_ring ring;
+  ring.insert("rsa", jwt::key::from_pem(pub_key, jwt::algorithm::RS256));
+  EXPECT_EQ (ring.find("rsa").type(), jwt::key_type::PUBLIC);
+
+  std::error_code ec;
+  jwt::decode(make_token("RS256", "rsa", priv_key),
+              algorithms({"RS256", "RS384"}), ec, secret(ring));
+  EXPECT_FALSE (ec);
+
+  // The key is pinned to RS256
+  jwt::decode(make_token("RS384", "rsa", priv_key),
+              algorithms({"RS256", "RS384"}), ec, secret(ring));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::InvalidAlgorithm));
+
+  // Public key used as an HMAC secret
+  jwt::decode(make_token("HS256", "rsa", pub_key),
+              algorithms({"HS256"}), ec, secret(jwt::key::from_secret(pub_key)));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::AlgoConfusionAttack));
+
+  EXPECT_THROW (jwt::key::from_pem("not a pem"), jwt::InvalidKeyError);
+}
+
+TEST (KeyRing, ReadersDuringRotation)
+{
+  using namespace jwt::params;
+
+  jwt::key_ring ring;
+  ring.insert("k", jwt::key::from_secret("secret-0"));
+
+  const std::string token = make_token("HS256", "k", "secret-0");
+  std::atomic<bool> stop{false};
+  std::atomic<int> failures{0};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      while (!stop.load()) {
+        std::error_code ec;
+        jwt::decode(token, algorithms({"HS256"}), ec, secret(ring));
+        if (ec) failures++;
+      }
+    });
+  }
+
+  // Rotate in other keys while keeping the one in use
+  for (int i = 0; i < 200; ++i) {
+    ring.assign({{"k", jwt::key::from_secret("secret-0")},
+                 {"other-" + std::to_string(i), jwt::key::from_secret("x")}});
+  }
+
+  stop = true;
+  for (auto& t : readers) t.join();
+
+  EXPECT_EQ (failures.load(), 0);
+  EXPECT_EQ (ring.size(), 2u);
+}
+
+TEST (KeyRing, ReplicatedKeys)
+{
+  using namespace jwt::params;
+
+  std::string priv_key = read_from_file(RSA256_PRIV_KEY);
+  std::string pub_key = read_from_file(RSA256_PUB_KEY);
+  ASSERT_TRUE (priv_key.length());
+  ASSERT_TRUE (pub_key.length());
+
+  auto shared = jwt::key::from_pem(pub_key, jwt::algorithm::RS256);
+  EXPECT_EQ (shared.replicas(), 0u);
+  EXPECT_EQ (shared.local_pkey(), shared.evp_pkey());
+
+  auto key = shared.replicated(3);
+  EXPECT_EQ (key.replicas(), 4u);
+  EXPECT_EQ (key.evp_pkey(), shared.evp_pkey());
+  EXPECT_EQ (key.algo(), jwt::algorithm::RS256);
+
+  // A thread keeps using the copy of its slot
+  EVP_PKEY* local = key.local_pkey();
+  EXPECT_NE (local, key.evp_pkey());
+  EXPECT_EQ (local, key.local_pkey());
+
+  // Secrets have nothing to replicate
+  EXPECT_EQ (jwt::key::from_secret("secret").replicated().replicas(), 0u);
+
+  const std::string token = make_token("RS256", "rsa", priv_key);
+  std::atomic<int> failures{0};
+
+  std::vector<std::thread> verifiers;
+  for (int i = 0; i < 8; ++i) {
+    verifiers.emplace_back([&] {
+      for (int j = 0; j < 20; ++j) {
+        std::error_code ec;
+        jwt::decode(token, algorithms({"RS256"}), ec, secret(key));
+        if (ec) failures++;
+      }
+    });
+  }
+  for (auto& t : verifiers) t.join();
+
+  EXPECT_EQ (failures.load(), 0);
+}
+
+TEST (KeyRing, SharedSigningKey)
+{
+  using namespace jwt::params;
+
+  std::string priv_key = read_from_file(RSA256_PRIV_KEY);
+  std::string pub_key = read_from_file(RSA256_PUB_KEY);
+  ASSERT_TRUE (priv_key.length());
+  ASSERT_TRUE (pub_key.length());
+
+  auto sign_key = jwt::key::from_pem(priv_key, jwt::algorithm::RS256);
+  EXPECT_EQ (sign_key.type(), jwt::key_type::PRIVATE);
+
+  jwt::jwt_object obj{algorithm("RS256"), secret(sign_key)};
+  obj.add_claim("iss", "arun.muralidharan");
+
+  // Copies share the parsed key instead of the PEM text
+  jwt::jwt_object copy = obj;
+  EXPECT_EQ (copy.key().evp_pkey(), sign_key.evp_pkey());
+  EXPECT_EQ (copy.secret(), priv_key);
+
+  std::error_code ec;
+  auto dec_obj = jwt::decode(copy.signature(), algorithms({"RS256"}), ec,
+                             secret(jwt::key::from_pem(pub_key)));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (dec_obj.payload().get_claim_value<std::string>("iss"), "arun.muralidharan");
+
+  // Secrets set from a string are held by a handle as well
+  copy.header().algo("HS256");
+  copy.secret("secret");
+  EXPECT_EQ (copy.key().type(), jwt::key_type::SECRET);
+  dec_obj = jwt::decode(copy.signature(), algorithms({"HS256"}), ec,
+                        secret([](const jwt::jwt_payload&) {
+                          return std::string{"secret"};
+                        }));
+  EXPECT_FALSE (ec);
+
+  // The signing key does not match the algorithm
+  obj.header().algo("ES256");
+  obj.signature(ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::SigningErr));
+}
+
+TEST (KeyRing, ParallelLoad)
+{
+  const std::string rsa_pub = read_from_file(RSA256_PUB_KEY);
+  const std::string rsa_priv = read_from_file(RSA256_PRIV_KEY);
+  ASSERT_TRUE (rsa_pub.length());
+
+  std::vector<jwt::key_ring::source_type> sources;
+  for (int i = 0; i < 200; ++i) {
+    sources.emplace_back("tenant-" + std::to_string(i), rsa_pub);
+  }
+
+  // DER is accepted as well
+  unsigned char* buf = nullptr;
+  int len = i2d_PUBKEY(jwt::key::from_pem(rsa_pub).evp_pkey(), &buf);
+  ASSERT_GT (len, 0);
+  sources.emplace_back("der", std::string(reinterpret_cast<const char*>(buf), len));
+  OPENSSL_free(buf);
+
+  jwt::key_ring ring;
+  std::error_code ec;
+  ring.load(sources, ec, 4);
+  ASSERT_FALSE (ec);
+  EXPECT_EQ (ring.size(), 201u);
+
+  std::error_code dec_ec;
+  jwt::decode(make_token("RS256", "der", rsa_priv), jwt::params::algorithms({"RS256"}),
+              dec_ec, jwt::params::secret(ring));
+  EXPECT_FALSE (dec_ec);
+  jwt::decode(make_token("RS256", "tenant-199", rsa_priv), jwt::params::algorithms({"RS256"}),
+              dec_ec, jwt::params::secret(ring));
+  EXPECT_FALSE (dec_ec);
+
+  // One bad key and nothing changes
+  sources.emplace_back("bad", "not a key");
+  jwt::key_ring other;
+  other.insert("kept", jwt::key::from_secret("secret"));
+  other.load(sources, ec);
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::AlgorithmErrc::InvalidKeyErr));
+  EXPECT_EQ (other.size(), 1u);
+  EXPECT_TRUE (other.find("kept"));
+}
+
+TEST (KeyRing, SnapshotRoundTrip)
+{
+  using namespace jwt::params;
+
+  const std::string rsa_pub = read_from_file(RSA256_PUB_KEY);
+  const std::string rsa_priv = read_from_file(RSA256_PRIV_KEY);
+  const std::string path = "key_ring_snapshot.bin";
+
+  jwt::key_ring ring;
+  ring.insert("rsa-pub", jwt::key::from_pem(rsa_pub, jwt::algorithm::RS256));
+  ring.insert("rsa-priv", jwt::key::from_pem(rsa_priv));
+  ring.insert("hmac", jwt::key::from_secret(std::string("bin\0ary", 7), jwt::algorithm::HS384));
+
+  std::error_code ec;
+  ring.save_snapshot(path, ec);
+  ASSERT_FALSE (ec) << ec.message();
+
+  jwt::key_ring loaded;
+  loaded.load_snapshot(path, ec, 2);
+  ASSERT_FALSE (ec) << ec.message();
+  ASSERT_EQ (loaded.size(), 3u);
+
+  auto pub = loaded.find("rsa-pub");
+  EXPECT_EQ (pub.type(), jwt::key_type::PUBLIC);
+  EXPECT_EQ (pub.algo(), jwt::algorithm::RS256);
+  EXPECT_EQ (loaded.find("rsa-priv").type(), jwt::key_type::PRIVATE);
+  EXPECT_EQ (loaded.find("hmac").algo(), jwt::algorithm::HS384);
+  EXPECT_EQ (loaded.find("hmac").material(), jwt::string_view("bin\0ary", 7));
+
+  // Keys from the snapshot sign and verify
+  jwt::jwt_object obj{algorithm("RS256"), secret(loaded.find("rsa-priv")),
+                      headers({{"kid", "rsa-pub"}})};
+  jwt::decode(obj.signature(), algorithms({"RS256"}), ec, secret(loaded));
+  EXPECT_FALSE (ec);
+
+  // Saving the loaded ring gives the same file
+  const std::string bytes = read_from_file(path);
+  loaded.save_snapshot(path, ec);
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (read_from_file(path), bytes);
+
+  auto load_bytes = [&](const std::string& b) {
+    std::ofstream{path, std::ofstream::binary | std::ofstream::trunc} << b;
+    jwt::key_ring r;
+    r.insert("kept", jwt::key::from_secret("secret"));
+    r.load_snapshot(path, ec);
+    EXPECT_EQ (r.size(), 1u);
+    return ec.value();
+  };
+
+  // Any flipped byte is caught by the digest
+  std::string flipped = bytes;
+  flipped[bytes.length() / 2] ^= 1;
+  EXPECT_EQ (load_bytes(flipped), static_cast<int>(jwt::DecodeErrc::BinaryFormatError));
+  EXPECT_EQ (load_bytes(bytes.substr(0, bytes.length() - 1)),
+             static_cast<int>(jwt::DecodeErrc::BinaryFormatError));
+
+  std::string other_version = bytes;
+  other_version[4] ^= 0x7f;
+  EXPECT_EQ (load_bytes(other_version), static_cast<int>(jwt::DecodeErrc::BinaryVersionMismatch));
+
+  std::remove(path.c_str());
+  jwt::key_ring r;
+  r.load_snapshot(path, ec);
+  EXPECT_EQ (ec, std::errc::no_such_file_or_directory);
+}
@@ -0,0 +1,72 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+
+/*
+ * Counts the heap bytes requested through operator new.
+ */
+static std::atomic<size_t> g_heap_bytes{0};
+
+void* operator new(std::size_t n)
+{
+  g_heap_bytes.fetch_add(n, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+template <typename T>
+size_t heap_bytes_of_copy(const T& obj)
+{
+  size_t before = g_heap_bytes.load();
+  T copy(obj);
+  return g_heap_bytes.load() - before;
+}
+
+TEST (Layout, NoDuplicateKeySets)
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret"),
+                      headers({{"kid", "key-1"}})};
+  obj.add_claim("iss", "arun.muralidharan")
+     .add_claim("sub", "admin")
+     .add_claim("aud", "rift.io")
+     .add_claim("exp", 4102444800)
+     .add_claim("iat", 1513862371)
+     .add_claim("jti", "a-b-c-d-e-f-1-2-3");
+
+  std::error_code ec;
+  auto dec_obj = jwt::decode(obj.signature(), algorithms({"HS256"}), ec, secret("secret"));
+  ASSERT_FALSE (ec);
+
+  // Just the JSON object and the parsed enums
+  EXPECT_LE (sizeof(jwt::jwt_payload), sizeof(json_t) + sizeof(void*));
+  EXPECT_LE (sizeof(jwt::jwt_header), sizeof(json_t) + sizeof(void*));
+
+  size_t json_bytes = heap_bytes_of_copy(dec_obj.payload().create_json_obj());
+  size_t pld_bytes = heap_bytes_of_copy(dec_obj.payload());
+  size_t hdr_bytes = heap_bytes_of_copy(dec_obj.header());
+
+  std::cout << "sizeof(jwt_payload) = " << sizeof(jwt::jwt_payload)
+            << ", sizeof(jwt_header) = " << sizeof(jwt::jwt_header)
+            << ", payload heap bytes = " << pld_bytes
+            << ", header heap bytes = " << hdr_bytes << std::endl;
+
+  // The claim names are held once, by the JSON object
+  EXPECT_EQ (pld_bytes, json_bytes);
+  EXPECT_EQ (hdr_bytes, heap_bytes_of_copy(dec_obj.header().create_json_obj()));
+}
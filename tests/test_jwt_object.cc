@@ -11,6 +11,18 @@ struct Wrapper
     jwt::jwt_object object;
 };
 
+struct SessionClaims
+{
+    std::string iss;
+    std::string sub;
+    int level;
+};
+
+void to_json(json_t& j, const SessionClaims& c)
+{
+    j = json_t{{"iss", c.iss}, {"sub", c.sub}, {"level", c.level}};
+}
+
 } // END namespace
 
 TEST (ObjectTest, MoveConstructor)
@@ -28,3 +40,50 @@ TEST (ObjectTest, MoveConstructor)
   EXPECT_TRUE(wrapper.object.payload().has_claim_with_value("iss", "arun.muralidharan"));
 }
 
+
+TEST (ObjectTest, MoveClaimsIntoPayload)
+{
+  using namespace jwt::params;
+
+  json_t prepared{{"iss", "arun.muralidharan"}, {"big", std::string(1000, 'x')}};
+  const char* big_data = prepared["big"].get_ref<const std::string&>().data();
+
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret"), claims(std::move(prepared))};
+
+  // The claim values were moved, not copied
+  EXPECT_EQ (obj.payload().create_json_obj()["big"].get_ref<const std::string&>().data(), big_data);
+
+  // The claim names are picked up lazily
+  EXPECT_TRUE (obj.payload().has_claim("iss"));
+  EXPECT_FALSE (obj.payload().add_claim("iss", "someone.else"));
+  EXPECT_TRUE (obj.payload().remove_claim("big"));
+  EXPECT_FALSE (obj.payload().has_claim("big"));
+
+  std::error_code ec;
+  auto dec_obj = jwt::decode(obj.signature(), algorithms({"HS256"}), ec, secret("secret"));
+  EXPECT_FALSE (ec);
+  EXPECT_TRUE (dec_obj.payload().has_claim_with_value("iss", "arun.muralidharan"));
+}
+
+TEST (ObjectTest, ClaimsStructAndMerging)
+{
+  using namespace jwt::params;
+
+  SessionClaims session{"arun.muralidharan", "admin", 3};
+
+  // Claims from the struct are merged with the other payload claims
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret"),
+                      payload({{"aud", "rift.io"}, {"iss", "first"}}),
+                      claims(session)};
+
+  EXPECT_TRUE (obj.payload().has_claim_with_value("aud", "rift.io"));
+  EXPECT_TRUE (obj.payload().has_claim_with_value("iss", "first"));
+  EXPECT_TRUE (obj.payload().has_claim_with_value("level", 3));
+  EXPECT_EQ (session.iss, "arun.muralidharan");
+
+  // Values of a caller's map are copied, not moved from
+  std::map<std::string, std::string> hdrs{{"kid", "key-1"}};
+  jwt::jwt_object obj2{algorithm("HS256"), secret("secret"), headers(hdrs)};
+  EXPECT_EQ (obj2.header().kid(), jwt::string_view{"key-1"});
+  EXPECT_EQ (hdrs["kid"], "key-1");
+}
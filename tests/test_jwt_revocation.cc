@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+
+jwt::string_view signature_of(const std::string& token)
+{
+  auto pos = token.rfind('.');
+  return jwt::string_view{token.data() + pos + 1, token.length() - pos - 1};
+}
+
+TEST (RevocationSet, RejectsRevokedTokens)
+{
+  using namespace jwt::params;
+
+  jwt::revocation_set revoked_set;
+
+  jwt::jwt_object obj1{algorithm("HS256"), secret("secret"), payload({{"jti", "id-1"}})};
+  jwt::jwt_object obj2{algorithm("HS256"), secret("secret"), payload({{"sub", "user-2"}})};
+  const std::string token1 = obj1.signature();
+  const std::string token2 = obj2.signature();
+
+  std::error_code ec;
+  jwt::decode(token1, algorithms({"HS256"}), ec, secret("secret"), revoked(revoked_set));
+  EXPECT_FALSE (ec);
+
+  revoked_set.revoke_jti("id-1");
+  jwt::decode(token1, algorithms({"HS256"}), ec, secret("secret"), revoked(revoked_set));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::TokenRevoked));
+
+  // Tokens without jti are revoked by their signature
+  jwt::decode(token2, algorithms({"HS256"}), ec, secret("secret"), revoked(revoked_set));
+  EXPECT_FALSE (ec);
+
+  revoked_set.revoke_signature(signature_of(token2));
+  EXPECT_THROW (jwt::decode(token2, algorithms({"HS256"}), secret("secret"), revoked(revoked_set)),
+                jwt::TokenRevokedError);
+  EXPECT_EQ (revoked_set.size(), 2u);
+
+  // A jti is not mistaken for a signature
+  EXPECT_FALSE (revoked_set.is_revoked_signature("id-1"));
+  EXPECT_FALSE (revoked_set.is_revoked_jti(signature_of(token2)));
+}
+
+TEST (RevocationSet, BatchesAndFalsePositives)
+{
+  jwt::revocation_set set;
+
+  std::vector<uint64_t> hashes;
+  for (int i = 0; i < 100000; ++i) {
+    hashes.push_back(jwt::revocation_set::jti_hash("revoked-" + std::to_string(i)));
+  }
+  set.assign(hashes);
+  set.insert({ hashes[0], jwt::revocation_set::jti_hash("extra") });
+  EXPECT_EQ (set.size(), 100001u);
+
+  for (int i = 0; i < 100000; ++i) {
+    ASSERT_TRUE (set.is_revoked_jti("revoked-" + std::to_string(i)));
+  }
+  EXPECT_TRUE (set.is_revoked_jti("extra"));
+
+  // The exact set answers the filter's false positives
+  for (int i = 0; i < 100000; ++i) {
+    ASSERT_FALSE (set.is_revoked_jti("valid-" + std::to_string(i)));
+  }
+
+  // Filter alone: the rate of hits for absent keys stays low
+  std::vector<uint64_t> words(jwt::detail::block_bloom::blocks_for(hashes.size()) * 8);
+  const size_t blocks = words.size() / 8;
+  for (auto h : hashes) jwt::detail::block_bloom::add(words.data(), blocks, h);
+
+  size_t fp = 0;
+  for (int i = 0; i < 100000; ++i) {
+    uint64_t h = jwt::revocation_set::jti_hash("valid-" + std::to_string(i));
+    if (jwt::detail::block_bloom::may_contain(words.data(), blocks, h)) fp++;
+  }
+  EXPECT_LT (fp, 1000u);
+
+  set.assign({});
+  EXPECT_EQ (set.size(), 0u);
+  EXPECT_FALSE (set.is_revoked_jti("extra"));
+}
+
+TEST (RevocationSet, SnapshotFile)
+{
+  const std::string path = "revocation_snapshot.bin";
+
+  std::vector<uint64_t> hashes;
+  for (int i = 0; i < 5000; ++i) {
+    hashes.push_back(jwt::revocation_set::jti_hash("revoked-" + std::to_string(i)));
+  }
+
+  jwt::revocation_set set;
+  set.assign(hashes);
+  set.revoke_signature("c2lnbmF0dXJl");
+  set.save(path);
+
+  jwt::revocation_set loaded;
+  loaded.load(path);
+  EXPECT_EQ (loaded.size(), set.size());
+
+  for (int i = 0; i < 5000; ++i) {
+    ASSERT_TRUE (loaded.is_revoked_jti("revoked-" + std::to_string(i)));
+    ASSERT_FALSE (loaded.is_revoked_jti("valid-" + std::to_string(i)));
+  }
+  EXPECT_TRUE (loaded.is_revoked_signature("c2lnbmF0dXJl"));
+
+  // A new snapshot replaces the file the loaded set still maps
+  jwt::revocation_set next;
+  next.revoke_jti("next");
+  next.save(path);
+  EXPECT_TRUE (loaded.is_revoked_jti("revoked-1"));
+
+  loaded.load(path);
+  EXPECT_EQ (loaded.size(), 1u);
+  EXPECT_TRUE (loaded.is_revoked_jti("next"));
+  EXPECT_FALSE (loaded.is_revoked_jti("revoked-1"));
+
+  // Entries can still be added on top of a loaded snapshot
+  loaded.revoke_jti("more");
+  EXPECT_EQ (loaded.size(), 2u);
+  EXPECT_TRUE (loaded.is_revoked_jti("next"));
+  EXPECT_TRUE (loaded.is_revoked_jti("more"));
+
+  // Malformed and missing files leave the set as is
+  {
+    std::ofstream os{path, std::ofstream::binary | std::ofstream::trunc};
+    os << "definitely not a snapshot, but long enough to hold a header......";
+  }
+  std::error_code ec;
+  loaded.load(path, ec);
+  EXPECT_EQ (ec, std::errc::invalid_argument);
+  EXPECT_EQ (loaded.size(), 2u);
+
+  loaded.load("no_such_snapshot.bin", ec);
+  EXPECT_TRUE (ec);
+  EXPECT_THROW (loaded.load("no_such_snapshot.bin"), std::system_error);
+
+  std::remove(path.c_str());
+}
@@ -0,0 +1,212 @@
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+#include "jwt/revocation_set.hpp"
+
+#define RSA256_PUB_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_pub.pem"
+#define RSA256_PRIV_KEY CERT_ROOT_DIR "/rsa_certs/rsa256_priv.pem"
+#define EC384_PUB_KEY CERT_ROOT_DIR "/ec_certs/ec384_pub.pem"
+#define EC384_PRIV_KEY CERT_ROOT_DIR "/ec_certs/ec384_priv.pem"
+
+std::string read_from_file(const std::string& path)
+{
+  std::string contents;
+  std::ifstream is{path, std::ifstream::binary};
+
+  if (is) {
+    // get length of file:
+    is.seekg (0, is.end);
+    auto length = is.tellg();
+    is.seekg (0, is.beg);
+    contents.resize(length);
+
+    is.read(&contents[0], length);
+    if (!is) {
+      is.close();
+      return {};
+    }
+  }
+
+  is.close();
+  return contents;
+}
+
+std::string make_token(const char* alg, jwt::string_view key)
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm(alg), secret(key),
+                      payload({{"iss", "arun.muralidharan"}, {"sub", "segments"}})};
+  obj.add_claim("jti", "segmented-1");
+  return obj.signature();
+}
+
+/// Splits `token` into two segments at `pos`
+std::vector<jwt::string_view> split_at(const std::string& token, size_t pos)
+{
+  return { jwt::string_view{token.data(), pos},
+           jwt::string_view{token.data() + pos, token.length() - pos} };
+}
+
+/// Decodes `token` split at every position with `key`
+void decode_at_every_split(const std::string& token, const char* alg, const std::string& key)
+{
+  using namespace jwt::params;
+
+  for (size_t pos = 0; pos <= token.length(); ++pos) {
+    auto segs = split_at(token, pos);
+    jwt::segmented_view view{segs.data(), segs.size()};
+
+    std::error_code ec;
+    auto dec_obj = jwt::decode(view, algorithms({alg}), ec, secret(key));
+    ASSERT_FALSE (ec) << "split at " << pos << ": " << ec.message();
+    EXPECT_EQ (dec_obj.payload().get_claim_value<std::string>("sub"), "segments");
+    EXPECT_EQ (dec_obj.header().algo(), jwt::str_to_alg(alg));
+  }
+}
+
+TEST (SegmentsTest, ViewOperations)
+{
+  const std::string token = "abc.de.fgh";
+  std::vector<jwt::string_view> segs = {
+    jwt::string_view{token.data(), 2},
+    jwt::string_view{token.data() + 2, 0},
+    jwt::string_view{token.data() + 2, 5},
+    jwt::string_view{token.data() + 7, 3},
+  };
+
+  jwt::segmented_view view{segs.data(), segs.size()};
+  EXPECT_EQ (view.length(), token.length());
+  EXPECT_EQ (view.count('.'), 2u);
+  EXPECT_EQ (view.find('.'), 3u);
+  EXPECT_EQ (view.find('.', 4), 6u);
+  EXPECT_FALSE (view.find('x') != view.find('y'));
+  EXPECT_FALSE (view.contiguous());
+
+  auto mid = view.subview(2, 5);
+  EXPECT_TRUE (mid.contiguous());
+  EXPECT_EQ (mid.as_contiguous(), jwt::string_view{"c.de."});
+
+  auto tail = view.subview(4);
+  std::string copied(tail.length(), '\0');
+  tail.copy(&copied[0]);
+  EXPECT_EQ (copied, "de.fgh");
+
+  EXPECT_TRUE (view.subview(20).empty());
+}
+
+TEST (SegmentsTest, Base64DecodeAcrossSegments)
+{
+  const std::string input = "{\"iss\":\"arun.muralidharan\",\"n\":12345}";
+
+  for (size_t len = 0; len <= input.length(); ++len) {
+    std::string enc = jwt::base64_encode(input.data(), len);
+    enc.resize(jwt::base64_uri_encode(&enc[0], enc.length()));
+
+    for (size_t pos = 0; pos <= enc.length(); ++pos) {
+      auto segs = split_at(enc, pos);
+      jwt::segmented_view view{segs.data(), segs.size()};
+
+      std::string out;
+      EXPECT_TRUE (jwt::base64_uri_decode(view, out));
+      EXPECT_EQ (out, input.substr(0, len));
+    }
+  }
+
+  std::string out;
+  jwt::string_view bad[] = {"eyJh", "b*c"};
+  EXPECT_FALSE (jwt::base64_uri_decode(jwt::segmented_view{bad, 2}, out));
+}
+
+TEST (SegmentsTest, HMACAtEverySplit)
+{
+  decode_at_every_split(make_token("HS256", "secret"), "HS256", "secret");
+}
+
+TEST (SegmentsTest, RSAAtEverySplit)
+{
+  std::string priv_key = read_from_file(RSA256_PRIV_KEY);
+  std::string pub_key = read_from_file(RSA256_PUB_KEY);
+  ASSERT_TRUE (priv_key.length());
+  ASSERT_TRUE (pub_key.length());
+
+  decode_at_every_split(make_token("RS256", priv_key), "RS256", pub_key);
+}
+
+TEST (SegmentsTest, ECDSAAtEverySplit)
+{
+  std::string priv_key = read_from_file(EC384_PRIV_KEY);
+  std::string pub_key = read_from_file(EC384_PUB_KEY);
+  ASSERT_TRUE (priv_key.length());
+  ASSERT_TRUE (pub_key.length());
+
+  decode_at_every_split(make_token("ES384", priv_key), "ES384", pub_key);
+}
+
+TEST (SegmentsTest, DecodeFromIovec)
+{
+#if defined(CPP_JWT_HAS_IOVEC)
+  using namespace jwt::params;
+
+  std::string token = make_token("HS256", "secret");
+  std::vector<struct iovec> iov;
+
+  // Chunks of 7 bytes as a reader with a small buffer would hand out
+  for (size_t pos = 0; pos < token.length(); pos += 7) {
+    struct iovec v;
+    v.iov_base = &token[pos];
+    v.iov_len = std::min<size_t>(7, token.length() - pos);
+    iov.push_back(v);
+  }
+
+  jwt::segmented_view view{iov.data(), iov.size()};
+  auto dec_obj = jwt::decode(view, algorithms({"HS256"}), secret(jwt::key::from_secret("secret")));
+  EXPECT_EQ (dec_obj.payload().get_claim_value<std::string>("iss"), "arun.muralidharan");
+
+  EXPECT_THROW (jwt::decode(view, algorithms({"HS256"}), secret("other")),
+                jwt::InvalidSignatureError);
+#endif
+}
+
+TEST (SegmentsTest, ErrorsMatchContiguousDecode)
+{
+  using namespace jwt::params;
+
+  std::string token = make_token("HS256", "secret");
+  std::string tampered = token;
+  tampered[tampered.find('.') + 3] ^= 1;
+
+  std::string no_sig = token.substr(0, token.rfind('.') + 1);
+  std::string one_dot = token.substr(0, token.rfind('.'));
+  std::string extra_dot = token + ".abc";
+
+  for (const std::string& bad : {tampered, no_sig, one_dot, extra_dot}) {
+    std::error_code expected;
+    jwt::decode(bad, algorithms({"HS256"}), expected, secret("secret"));
+    ASSERT_TRUE (expected);
+
+    for (size_t pos = 1; pos < bad.length(); pos += 5) {
+      auto segs = split_at(bad, pos);
+      std::error_code ec;
+      jwt::decode(jwt::segmented_view{segs.data(), segs.size()},
+                  algorithms({"HS256"}), ec, secret("secret"));
+      EXPECT_EQ (ec, expected) << "split at " << pos;
+    }
+  }
+
+  // Wrong algorithm and revoked signature
+  auto segs = split_at(token, token.length() - 10);
+  jwt::segmented_view view{segs.data(), segs.size()};
+
+  std::error_code ec;
+  jwt::decode(view, algorithms({"HS384"}), ec, secret("secret"));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::InvalidAlgorithm));
+
+  jwt::revocation_set revoked;
+  revoked.revoke_signature(token.substr(token.rfind('.') + 1));
+  jwt::decode(view, algorithms({"HS256"}), ec, secret("secret"), jwt::params::revoked(revoked));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::TokenRevoked));
+}
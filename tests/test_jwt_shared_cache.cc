@@ -0,0 +1,205 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+#include "jwt/token_cache.hpp"
+#include "jwt/shared_token_cache.hpp"
+
+std::string segment_name(const char* test)
+{
+  return "/cpp-jwt-" + std::string(test) + "-" + std::to_string(::getpid());
+}
+
+std::string make_token(const std::string& sub, jwt::string_view key)
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm("HS256"), secret(key), payload({{"sub", sub}})};
+  obj.add_claim("exp", std::chrono::system_clock::now() + std::chrono::seconds{60});
+  return obj.signature();
+}
+
+TEST (SharedTokenCache, HitReturnsSameClaims)
+{
+  using namespace jwt::params;
+
+  const std::string name = segment_name("hit");
+  jwt::shared_token_cache stc;
+  stc.attach(name, 64);
+  ASSERT_TRUE (stc.attached());
+  EXPECT_EQ (stc.capacity(), 64u);
+
+  const std::string token = make_token("user-1", "secret");
+
+  std::error_code ec;
+  auto dec_obj = jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"), shared_cache(stc));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (stc.size(), 1u);
+
+  jwt::jwt_object hit;
+  ASSERT_TRUE (stc.find(token, hit));
+  EXPECT_EQ (hit.payload().create_json_obj(), dec_obj.payload().create_json_obj());
+  EXPECT_EQ (hit.header().algo(), jwt::algorithm::HS256);
+
+  // A token differing in the last byte misses
+  std::string other = token;
+  other.back() = other.back() == 'A' ? 'B' : 'A';
+  EXPECT_FALSE (stc.find(other, hit));
+
+  // Rejected tokens are not stored
+  jwt::decode(make_token("user-2", "other"), algorithms({"HS256"}), ec,
+              secret("secret"), shared_cache(stc));
+  EXPECT_TRUE (ec);
+  EXPECT_EQ (stc.size(), 1u);
+
+  // Nor are unverified ones
+  jwt::decode(make_token("user-3", "secret"), algorithms({"HS256"}), ec,
+              secret("secret"), verify(false), shared_cache(stc));
+  EXPECT_EQ (stc.size(), 1u);
+
+  // Both caches at once; the local one is filled from the shared one
+  jwt::token_cache tc;
+  auto both = jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"),
+                          cache(tc), shared_cache(stc));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (both.payload().get_claim_value<std::string>("sub"), "user-1");
+  EXPECT_EQ (tc.size(), 1u);
+
+  stc.clear();
+  EXPECT_EQ (stc.size(), 0u);
+
+  jwt::shared_token_cache::remove(name, ec);
+  EXPECT_FALSE (ec);
+}
+
+TEST (SharedTokenCache, SharedBetweenProcesses)
+{
+  using namespace jwt::params;
+
+  const std::string name = segment_name("fork");
+  const std::string token = make_token("user-1", "secret");
+
+  pid_t pid = ::fork();
+  ASSERT_GE (pid, 0);
+
+  if (pid == 0) {
+    // The child verifies the token and leaves
+    jwt::shared_token_cache stc;
+    std::error_code ec;
+    stc.attach(name, ec, 256);
+    if (ec) ::_exit(1);
+
+    jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"), shared_cache(stc));
+    ::_exit(ec ? 2 : 0);
+  }
+
+  int status = 0;
+  ASSERT_EQ (::waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE (WIFEXITED(status));
+  ASSERT_EQ (WEXITSTATUS(status), 0);
+
+  jwt::shared_token_cache stc;
+  // The geometry of the existing segment wins
+  stc.attach(name, 8);
+  EXPECT_EQ (stc.capacity(), 256u);
+
+  // Found without the key, so it was not verified here
+  std::error_code ec;
+  auto dec_obj = jwt::decode(token, algorithms({"HS256"}), ec, secret("wrong"), shared_cache(stc));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (dec_obj.payload().get_claim_value<std::string>("sub"), "user-1");
+
+  jwt::shared_token_cache::remove(name, ec);
+  EXPECT_FALSE (ec);
+}
+
+TEST (SharedTokenCache, OversizedAndUnattached)
+{
+  using namespace jwt::params;
+
+  // Unattached caches miss and drop inserts
+  jwt::shared_token_cache idle;
+  const std::string token = make_token("user-1", "secret");
+
+  std::error_code ec;
+  jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"), shared_cache(idle));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (idle.size(), 0u);
+
+  const std::string name = segment_name("small");
+  jwt::shared_token_cache stc;
+  stc.attach(name, 8, 32);
+
+  // The binary form does not fit the slot
+  jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"), shared_cache(stc));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (stc.size(), 0u);
+
+  EXPECT_THROW (stc.attach("no-slash/in-name", 8), std::system_error);
+  EXPECT_FALSE (stc.attached());
+
+  jwt::shared_token_cache::remove(name, ec);
+  EXPECT_FALSE (ec);
+  jwt::shared_token_cache::remove(name, ec);
+  EXPECT_TRUE (ec);
+}
+
+TEST (SharedTokenCache, ConcurrentWritersNeverTearReads)
+{
+  const std::string name = segment_name("race");
+  jwt::shared_token_cache stc;
+  // Few slots so that the writers keep evicting each other
+  stc.attach(name, 8);
+
+  std::vector<std::string> tokens;
+  std::vector<jwt::jwt_object> objs;
+  for (int i = 0; i < 32; ++i) {
+    tokens.push_back(make_token("user-" + std::to_string(i), "secret"));
+    objs.push_back(jwt::decode(tokens.back(), jwt::params::algorithms({"HS256"}),
+                               jwt::params::secret("secret")));
+  }
+
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> hits{0};
+  std::atomic<size_t> wrong{0};
+
+  std::vector<std::thread> threads;
+  for (int w = 0; w < 2; ++w) {
+    threads.emplace_back([&, w] {
+      for (size_t n = w; !stop.load(); ++n) {
+        stc.insert(tokens[n % tokens.size()], objs[n % objs.size()]);
+      }
+    });
+  }
+  for (int r = 0; r < 2; ++r) {
+    threads.emplace_back([&] {
+      jwt::jwt_object hit;
+      for (size_t n = 0; !stop.load(); ++n) {
+        size_t i = n % tokens.size();
+        if (stc.find(tokens[i], hit)) {
+          ++hits;
+          if (hit.payload().get_claim_value<std::string>("sub") != "user-" + std::to_string(i)) {
+            ++wrong;
+          }
+        }
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{300});
+  stop = true;
+  for (auto& t : threads) t.join();
+
+  EXPECT_GT (hits.load(), 0u);
+  EXPECT_EQ (wrong.load(), 0u);
+
+  std::error_code ec;
+  jwt::shared_token_cache::remove(name, ec);
+}
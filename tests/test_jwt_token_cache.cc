@@ -0,0 +1,150 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "jwt/jwt.hpp"
+#include "jwt/token_cache.hpp"
+
+std::string make_token(const std::string& sub, jwt::string_view key)
+{
+  using namespace jwt::params;
+
+  jwt::jwt_object obj{algorithm("HS256"), secret(key), payload({{"sub", sub}})};
+  obj.add_claim("exp", std::chrono::system_clock::now() + std::chrono::seconds{60});
+  return obj.signature();
+}
+
+TEST (TokenCache, HitReturnsSameClaims)
+{
+  using namespace jwt::params;
+
+  jwt::token_cache tc;
+  const std::string token = make_token("user-1", "secret");
+
+  std::error_code ec;
+  auto dec_obj = jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"), cache(tc));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (tc.size(), 1u);
+
+  jwt::token_cache::object_ptr hit;
+  EXPECT_TRUE (tc.find(token, hit, ec));
+  ASSERT_TRUE (hit);
+  EXPECT_FALSE (ec);
+
+  auto again = jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"), cache(tc));
+  EXPECT_FALSE (ec);
+  EXPECT_EQ (again.payload().get_claim_value<std::string>("sub"), "user-1");
+  EXPECT_EQ (again.payload().create_json_obj(), dec_obj.payload().create_json_obj());
+
+  // The throwing overload goes through the cache as well
+  auto thrown = jwt::decode(token, algorithms({"HS256"}), secret("secret"), cache(tc));
+  EXPECT_EQ (thrown.payload().get_claim_value<std::string>("sub"), "user-1");
+  EXPECT_EQ (tc.size(), 1u);
+
+  // A token differing in the last byte is a different entry
+  std::string other = token;
+  other.back() = other.back() == 'A' ? 'B' : 'A';
+  EXPECT_FALSE (tc.find(other, hit, ec));
+
+  // Nothing is cached when verification is off
+  jwt::decode(make_token("user-2", "secret"), algorithms({"HS256"}), ec,
+              secret("secret"), verify(false), cache(tc));
+  EXPECT_EQ (tc.size(), 1u);
+
+  tc.clear();
+  EXPECT_EQ (tc.size(), 0u);
+}
+
+TEST (TokenCache, RejectedTokensAreCached)
+{
+  using namespace jwt::params;
+
+  jwt::token_cache tc;
+  const std::string token = make_token("user-1", "wrong-secret");
+
+  std::error_code ec;
+  jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"), cache(tc));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::InvalidSignature));
+
+  jwt::token_cache::object_ptr hit;
+  EXPECT_TRUE (tc.find(token, hit, ec));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::InvalidSignature));
+
+  EXPECT_THROW (jwt::decode(token, algorithms({"HS256"}), secret("secret"), cache(tc)),
+                jwt::InvalidSignatureError);
+
+  // Tokens which may become valid later are not remembered
+  jwt::jwt_object obj{algorithm("HS256"), secret("secret")};
+  obj.add_claim("nbf", std::chrono::system_clock::now() + std::chrono::seconds{60});
+  const std::string immature = obj.signature();
+
+  jwt::decode(immature, algorithms({"HS256"}), ec, secret("secret"), cache(tc));
+  EXPECT_EQ (ec.value(), static_cast<int>(jwt::VerificationErrc::ImmatureSignature));
+  EXPECT_FALSE (tc.find(immature, hit, ec));
+}
+
+TEST (TokenCache, BoundedByCapacity)
+{
+  using namespace jwt::params;
+
+  jwt::token_cache tc{8, 1};
+  std::vector<std::string> tokens;
+  for (int i = 0; i < 32; ++i) {
+    tokens.push_back(make_token("user-" + std::to_string(i), "secret"));
+  }
+
+  std::error_code ec;
+  for (const auto& token : tokens) {
+    jwt::decode(token, algorithms({"HS256"}), ec, secret("secret"), cache(tc));
+    EXPECT_FALSE (ec);
+  }
+  EXPECT_EQ (tc.size(), 8u);
+
+  // Recently used entries survive the next evictions
+  jwt::token_cache::object_ptr hit;
+  EXPECT_TRUE (tc.find(tokens.back(), hit, ec));
+  jwt::decode(make_token("newcomer", "secret"), algorithms({"HS256"}), ec,
+              secret("secret"), cache(tc));
+  EXPECT_TRUE (tc.find(tokens.back(), hit, ec));
+  EXPECT_EQ (tc.size(), 8u);
+}
+
+TEST (TokenCache, TimeWheelExpiry)
+{
+  jwt::detail::time_wheel<int> wheel{1000};
+  std::vector<std::pair<int, uint64_t>> fired;
+  auto collect = [&](int item, uint64_t expiry) { fired.emplace_back(item, expiry); };
+
+  wheel.schedule(1000, 1);         // Already due
+  wheel.schedule(1010, 2);         // Level 0
+  wheel.schedule(1000 + 500, 3);   // Level 1
+  wheel.schedule(1000 + 70000, 4); // Level 2
+  wheel.schedule(1000 + (uint64_t(1) << 25), 5); // Beyond the span
+  EXPECT_EQ (wheel.size(), 5u);
+
+  wheel.advance(1001, collect);
+  ASSERT_EQ (fired.size(), 1u);
+  EXPECT_EQ (fired[0].first, 1);
+
+  wheel.advance(1499, collect);
+  ASSERT_EQ (fired.size(), 2u);
+  EXPECT_EQ (fired[1].first, 2);
+
+  wheel.advance(1500, collect);
+  ASSERT_EQ (fired.size(), 3u);
+  EXPECT_EQ (fired[2].first, 3);
+
+  // Step second by second across the level 2 boundary
+  for (uint64_t t = 1501; t <= 1000 + 70000; ++t) wheel.advance(t, collect);
+  ASSERT_EQ (fired.size(), 4u);
+  EXPECT_EQ (fired[3], std::make_pair(4, uint64_t(1000 + 70000)));
+
+  // A long jump re-places the rest in one go
+  wheel.advance(1000 + (uint64_t(1) << 25) - 1, collect);
+  EXPECT_EQ (fired.size(), 4u);
+  wheel.advance(1000 + (uint64_t(1) << 25), collect);
+  ASSERT_EQ (fired.size(), 5u);
+  EXPECT_EQ (fired[4].first, 5);
+  EXPECT_EQ (wheel.size(), 0u);
+}